@@ -0,0 +1,12 @@
+#version 450
+
+layout(location = 0) in vec2 fragUv;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D volumeImage;
+
+void main() {
+    // rgb: in-scattered emission, a: transmittance, blended as dst * a + rgb
+    outColor = texture(volumeImage, fragUv);
+}
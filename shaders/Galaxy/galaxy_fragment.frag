@@ -4,7 +4,8 @@ layout(location = 0) out vec4 outColor;
 
 layout(push_constant) uniform Push {
     mat4 modelMatrix;
-    mat4 normalMatrix;
+    float pointSizeScale;
+    float brightness;
 } push;
 
 // Gaussian function for smooth falloff
@@ -40,5 +41,8 @@ void main() {
         discard;
     }
 
-    outColor = vec4(finalColor, finalAlpha);
+    // Brightness compensates for stars and point area dropped by the quality governor.
+    // Once alpha saturates the remaining gain goes into the color instead.
+    float compensatedAlpha = finalAlpha * push.brightness;
+    outColor = vec4(finalColor * max(compensatedAlpha, 1.0), min(compensatedAlpha, 1.0));
 }
@@ -4,7 +4,8 @@ layout(location = 0) in vec3 inPosition;
 
 layout(push_constant) uniform Push {
     mat4 modelMatrix;
-    mat4 normalMatrix;
+    float pointSizeScale;
+    float brightness;
 } push;
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
@@ -21,5 +22,5 @@ void main() {
 
     float distanceToCamera = length(viewPosition.xyz);
     float baseSize = 20.0;
-    gl_PointSize = baseSize * (1.0 / distanceToCamera);
+    gl_PointSize = baseSize * push.pointSizeScale * (1.0 / distanceToCamera);
 }
@@ -0,0 +1,66 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+
+struct PointLight {
+    vec4 position; //  ignore w
+    vec4 color; // w is intensity
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+    mat4 invView;
+    vec4 ambientLightColor; // w is intensity
+    PointLight pointLights[10];
+    int numLights;
+} ubo;
+
+// One per draw, found through the draw's firstInstance
+struct DrawRecord {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    uint vertexBuffer;
+    uint indexBuffer; // INVALID_INDEX for non-indexed models
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer DrawRecords {
+    DrawRecord draws[];
+};
+
+// Every buffer in the bindless registry, read as raw words
+layout(std430, set = 2, binding = 0) readonly buffer Buffers {
+    uint words[];
+} buffers[];
+
+const uint INVALID_INDEX = 0xFFFFFFFFu;
+const uint VERTEX_STRIDE = 12; // Model::Vertex in words: position, color, normal, uv, materialId
+
+vec3 loadVec3(uint bufferIndex, uint word) {
+    return uintBitsToFloat(uvec3(buffers[nonuniformEXT(bufferIndex)].words[word],
+                                 buffers[nonuniformEXT(bufferIndex)].words[word + 1],
+                                 buffers[nonuniformEXT(bufferIndex)].words[word + 2]));
+}
+
+void main() {
+    DrawRecord draw = draws[gl_InstanceIndex];
+
+    uint vertexIndex = gl_VertexIndex;
+    if (draw.indexBuffer != INVALID_INDEX) {
+        vertexIndex = buffers[nonuniformEXT(draw.indexBuffer)].words[gl_VertexIndex];
+    }
+    uint base = vertexIndex * VERTEX_STRIDE;
+    vec3 position = loadVec3(draw.vertexBuffer, base);
+    vec3 color = loadVec3(draw.vertexBuffer, base + 3);
+    vec3 normal = loadVec3(draw.vertexBuffer, base + 6);
+
+    vec4 positionWorld = draw.modelMatrix * vec4(position, 1.0);
+    gl_Position = ubo.projection * (ubo.view * positionWorld);
+
+    fragNormalWorld = normalize(mat3(draw.normalMatrix) * normal);
+    fragPosWorld = positionWorld.xyz;
+    fragColor = color;
+}
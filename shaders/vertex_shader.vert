@@ -23,16 +23,26 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
     int numLights;
 } ubo;
 
-layout(push_constant) uniform Push {
+// One per draw, found through the draw's firstInstance. Same layout as in the bindless shader,
+// the buffer indices are unused here.
+struct DrawRecord {
     mat4 modelMatrix;
     mat4 normalMatrix;
-} push;
+    uint vertexBuffer;
+    uint indexBuffer;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer DrawRecords {
+    DrawRecord draws[];
+};
 
 void main() {
-    vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+    DrawRecord draw = draws[gl_InstanceIndex];
+
+    vec4 positionWorld = draw.modelMatrix * vec4(position, 1.0);
     gl_Position = ubo.projection * (ubo.view * positionWorld);
 
-    fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
+    fragNormalWorld = normalize(mat3(draw.normalMatrix) * normal);
     fragPosWorld = positionWorld.xyz;
     fragColor = color;
 }
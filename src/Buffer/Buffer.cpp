@@ -8,6 +8,7 @@
 #include "Buffer.h"
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
@@ -39,13 +40,90 @@ VgeBuffer::VgeBuffer(VgeDevice& device, VkDeviceSize instanceSize, uint32_t inst
       memoryPropertyFlags{memoryPropertyFlags} {
     alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
     bufferSize = alignmentSize * instanceCount;
-    device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+    device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, allocation);
 }
 
 VgeBuffer::~VgeBuffer() {
     unmap();
     vkDestroyBuffer(vgeDevice.device(), buffer, nullptr);
-    vkFreeMemory(vgeDevice.device(), memory, nullptr);
+    vgeDevice.getAllocator().free(allocation);
+}
+
+/**
+ * Registers this buffer with the allocator's defragmentation
+ *
+ * @param onMoved (Optional) Called after the buffer moved, to rebind the new handle
+ */
+void VgeBuffer::enableRelocation(std::function<void()> onMoved) {
+    this->onMoved = std::move(onMoved);
+    vgeDevice.getAllocator().setRelocateCallback(
+        allocation, [this](const VgeAllocation&, const VgeAllocation& to) { return relocate(to); });
+}
+
+/**
+ * Moves the buffer into the allocation the allocator picked. Runs under the allocator's lock, so
+ * it must not allocate or free memory itself.
+ *
+ * @return false to keep the buffer where it is
+ */
+bool VgeBuffer::relocate(const VgeAllocation& to) {
+    bool hostVisible = allocation.mapped && to.mapped;
+    VkBufferUsageFlags copyUsage =
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    if (!hostVisible && (usageFlags & copyUsage) != copyUsage) {
+        return false;
+    }
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = bufferSize;
+    bufferInfo.usage = usageFlags;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer moved;
+    if (vkCreateBuffer(vgeDevice.device(), &bufferInfo, nullptr, &moved) != VK_SUCCESS) {
+        return false;
+    }
+    if (vkBindBufferMemory(vgeDevice.device(), moved, to.memory, to.offset) != VK_SUCCESS) {
+        vkDestroyBuffer(vgeDevice.device(), moved, nullptr);
+        return false;
+    }
+
+    if (hostVisible) {
+        memcpy(to.mapped, allocation.mapped, bufferSize);
+    } else {
+        VkBuffer source = buffer;
+        VkDeviceSize size = bufferSize;
+        auto& transferManager = vgeDevice.getTransferManager();
+        auto copy = [source, moved, size](VkCommandBuffer cmd) {
+            VkBufferCopy copyRegion{0, 0, size};
+            vkCmdCopyBuffer(cmd, source, moved, 1, &copyRegion);
+
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = moved;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1, &barrier,
+                                 0, nullptr);
+        };
+        transferManager.wait(transferManager.recordGraphics(copy));
+    }
+
+    vkDestroyBuffer(vgeDevice.device(), buffer, nullptr);
+    if (mapped) {
+        mapped = static_cast<char*>(to.mapped) +
+                 (static_cast<char*>(mapped) - static_cast<char*>(allocation.mapped));
+    }
+    buffer = moved;
+    allocation = to;
+    if (onMoved) onMoved();
+    return true;
 }
 
 /**
@@ -55,23 +133,27 @@ VgeBuffer::~VgeBuffer() {
  * buffer range.
  * @param offset (Optional) Byte offset from beginning
  *
+ * @note Host visible memory is persistently mapped by the allocator, so this only hands out a
+ * pointer into that mapping
+ *
  * @return VkResult of the buffer mapping call
  */
 VkResult VgeBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
-    assert(buffer && memory && "Called map on buffer before create");
-    return vkMapMemory(vgeDevice.device(), memory, offset, size, 0, &mapped);
+    assert(buffer && allocation.memory && "Called map on buffer before create");
+    if (!allocation.mapped) {
+        return VK_ERROR_MEMORY_MAP_FAILED;
+    }
+    mapped = static_cast<char*>(allocation.mapped) + offset;
+    return VK_SUCCESS;
 }
 
 /**
  * Unmap a mapped memory range
  *
- * @note Does not return a result as vkUnmapMemory can't fail
+ * @note The block stays mapped, the allocator unmaps it when the memory is freed
  */
 void VgeBuffer::unmap() {
-    if (mapped) {
-        vkUnmapMemory(vgeDevice.device(), memory);
-        mapped = nullptr;
-    }
+    mapped = nullptr;
 }
 
 /**
@@ -107,11 +189,10 @@ void VgeBuffer::writeToBuffer(void* data, VkDeviceSize size, VkDeviceSize offset
  * @return VkResult of the flush call
  */
 VkResult VgeBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
+    if (memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+        return VK_SUCCESS;
+    }
+    VkMappedMemoryRange mappedRange = getMappedRange(size, offset);
     return vkFlushMappedMemoryRanges(vgeDevice.device(), 1, &mappedRange);
 }
 
@@ -127,12 +208,36 @@ VkResult VgeBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
  * @return VkResult of the invalidate call
  */
 VkResult VgeBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
+    if (memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+        return VK_SUCCESS;
+    }
+    VkMappedMemoryRange mappedRange = getMappedRange(size, offset);
+    return vkInvalidateMappedMemoryRanges(vgeDevice.device(), 1, &mappedRange);
+}
+
+/**
+ * Translates a range of the buffer into a range of the shared memory block
+ *
+ * @note Host visible allocations are aligned and sized to nonCoherentAtomSize by the allocator,
+ * so widening the range to whole atoms never leaves the allocation
+ *
+ * @param size Size of the range. Pass VK_WHOLE_SIZE for the rest of the buffer.
+ * @param offset Byte offset from beginning
+ *
+ * @return VkMappedMemoryRange covering the requested range
+ */
+VkMappedMemoryRange VgeBuffer::getMappedRange(VkDeviceSize size, VkDeviceSize offset) const {
+    VkDeviceSize atomSize = vgeDevice.getAllocator().getNonCoherentAtomSize();
+    VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.size : offset + size;
+    VkDeviceSize begin = offset / atomSize * atomSize;
+    end = std::min((end + atomSize - 1) / atomSize * atomSize, allocation.size);
+
     VkMappedMemoryRange mappedRange = {};
     mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
-    return vkInvalidateMappedMemoryRanges(vgeDevice.device(), 1, &mappedRange);
+    mappedRange.memory = allocation.memory;
+    mappedRange.offset = allocation.offset + begin;
+    mappedRange.size = end - begin;
+    return mappedRange;
 }
 
 /**
@@ -2,12 +2,18 @@
 
 #include "../Device/Device.h"
 
+// std
+#include <functional>
+
 namespace vge {
 
 class VgeBuffer {
    public:
     VkDeviceMemory getMemory() const {
-        return memory;
+        return allocation.memory;
+    }
+    const VgeAllocation& getAllocation() const {
+        return allocation;
     }
 
     VgeBuffer(VgeDevice& device, VkDeviceSize instanceSize, uint32_t instanceCount,
@@ -18,6 +24,12 @@ class VgeBuffer {
     VgeBuffer(const VgeBuffer&) = delete;
     VgeBuffer& operator=(const VgeBuffer&) = delete;
 
+    // Lets the allocator's defragmentation move this buffer. The contents are copied into a new
+    // VkBuffer at the new location, so getBuffer() changes and onMoved is called for the owner to
+    // rebind whatever still holds the old handle. Device local buffers need TRANSFER_SRC and
+    // TRANSFER_DST usage for the copy.
+    void enableRelocation(std::function<void()> onMoved = {});
+
     VkResult map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
     void unmap();
 
@@ -59,11 +71,14 @@ class VgeBuffer {
 
    private:
     static VkDeviceSize getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
+    VkMappedMemoryRange getMappedRange(VkDeviceSize size, VkDeviceSize offset) const;
+    bool relocate(const VgeAllocation& to);
 
     VgeDevice& vgeDevice;
     void* mapped = nullptr;
     VkBuffer buffer = VK_NULL_HANDLE;
-    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VgeAllocation allocation{};
+    std::function<void()> onMoved;
 
     VkDeviceSize bufferSize;
     uint32_t instanceCount;
@@ -0,0 +1,110 @@
+#include "FrameAllocator.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace vge {
+
+VgeFrameAllocator::VgeFrameAllocator(VgeDevice& device, uint32_t framesInFlight,
+                                     VkDeviceSize regionSize)
+    : vgeDevice{device} {
+    const VkPhysicalDeviceLimits& limits = device.properties.limits;
+    alignment = std::max(limits.minUniformBufferOffsetAlignment,
+                         limits.minStorageBufferOffsetAlignment);
+    alignment = std::max(alignment, limits.nonCoherentAtomSize);
+    this->regionSize = (regionSize + alignment - 1) / alignment * alignment;
+
+    uniformRange = std::min<VkDeviceSize>(limits.maxUniformBufferRange, 64 * 1024);
+    storageRange = std::min<VkDeviceSize>(limits.maxStorageBufferRange, this->regionSize);
+
+    // Descriptors always cover a whole range from the dynamic offset, so the tail is padded
+    // for allocations near the end of the last region
+    VkDeviceSize bufferSize =
+        this->regionSize * framesInFlight + std::max(uniformRange, storageRange);
+    buffer = std::make_unique<VgeBuffer>(
+        device, 1, static_cast<uint32_t>(bufferSize),
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    buffer->map();
+
+    descriptorAllocator = VgeDescriptorAllocator::Builder(device)
+                              .setInitialSets(2)
+                              .addRatio(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 0.5f)
+                              .addRatio(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 0.5f)
+                              .build();
+    // Transient sets are mostly storage buffers for compute, with the odd image or uniform
+    for (uint32_t i = 0; i < framesInFlight; i++) {
+        frameDescriptorAllocators.push_back(
+            VgeDescriptorAllocator::Builder(device)
+                .setInitialSets(16)
+                .addRatio(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f)
+                .addRatio(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f)
+                .addRatio(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f)
+                .addRatio(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f)
+                .build());
+    }
+    uniformSetLayout =
+        VgeDescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL)
+            .build();
+    storageSetLayout =
+        VgeDescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL)
+            .build();
+
+    auto uniformInfo = buffer->descriptorInfo(uniformRange, 0);
+    if (!VgeDescriptorWriter(*uniformSetLayout, *descriptorAllocator)
+             .writeBuffer(0, &uniformInfo)
+             .build(uniformDescriptorSet)) {
+        throw std::runtime_error("failed to allocate frame allocator uniform descriptor set!!!");
+    }
+    auto storageInfo = buffer->descriptorInfo(storageRange, 0);
+    if (!VgeDescriptorWriter(*storageSetLayout, *descriptorAllocator)
+             .writeBuffer(0, &storageInfo)
+             .build(storageDescriptorSet)) {
+        throw std::runtime_error("failed to allocate frame allocator storage descriptor set!!!");
+    }
+}
+
+void VgeFrameAllocator::beginFrame(int frameIndex) {
+    this->frameIndex = frameIndex;
+    regionBegin = static_cast<VkDeviceSize>(frameIndex) * regionSize;
+    head = regionBegin;
+    frameDescriptorAllocators[frameIndex]->resetPools();
+}
+
+void VgeFrameAllocator::flush() {
+    if (head > regionBegin) {
+        buffer->flush(head - regionBegin, regionBegin);
+    }
+}
+
+VgeFrameAllocator::Allocation VgeFrameAllocator::allocateUniform(VkDeviceSize size) {
+    assert(size <= uniformRange && "Uniform allocation larger than the bound range");
+    return allocate(size);
+}
+
+VgeFrameAllocator::Allocation VgeFrameAllocator::allocateStorage(VkDeviceSize size) {
+    assert(size <= storageRange && "Storage allocation larger than the bound range");
+    return allocate(size);
+}
+
+VgeFrameAllocator::Allocation VgeFrameAllocator::allocate(VkDeviceSize size) {
+    std::lock_guard<std::mutex> lock{headMutex};
+    VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+    if (offset + size > regionBegin + regionSize) {
+        throw std::runtime_error("failed to allocate per-frame data, frame region is full!!!");
+    }
+    head = offset + size;
+
+    Allocation allocation{};
+    allocation.data = static_cast<char*>(buffer->getMappedMemory()) + offset;
+    allocation.offset = static_cast<uint32_t>(offset);
+    allocation.size = size;
+    return allocation;
+}
+
+}  // namespace vge
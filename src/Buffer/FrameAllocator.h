@@ -0,0 +1,126 @@
+#pragma once
+
+#include "../Descriptor/Descriptors.h"
+#include "../Device/Device.h"
+#include "Buffer.h"
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vge {
+
+// Bump allocator for data that only lives for one frame. A single persistently mapped buffer is
+// split into one region per frame in flight; beginFrame rewinds the region of the frame that was
+// just waited for, so nothing the GPU may still read is ever overwritten.
+// Allocations are addressed through dynamic offsets on two shared descriptor sets, one dynamic
+// uniform buffer and one dynamic storage buffer, so systems can hand per-frame data to shaders
+// without creating buffers or descriptor sets of their own. Sets that change every frame come from
+// a per-frame descriptor allocator that is reset along with the region.
+class VgeFrameAllocator {
+public:
+    static constexpr VkDeviceSize DEFAULT_REGION_SIZE = 4 * 1024 * 1024;
+
+    struct Allocation {
+        void* data = nullptr;
+        uint32_t offset = 0;  // dynamic offset to bind the shared set with
+        VkDeviceSize size = 0;
+    };
+
+    VgeFrameAllocator(VgeDevice& device, uint32_t framesInFlight,
+                      VkDeviceSize regionSize = DEFAULT_REGION_SIZE);
+    ~VgeFrameAllocator() = default;
+
+    VgeFrameAllocator(const VgeFrameAllocator&) = delete;
+    VgeFrameAllocator& operator=(const VgeFrameAllocator&) = delete;
+
+    // Call once the frame that last used this index has completed
+    void beginFrame(int frameIndex);
+    // Makes this frame's writes visible to the device, call before submitting the frame
+    void flush();
+
+    // Uniform allocations must fit in getUniformRange(), storage ones in getStorageRange().
+    // Safe to call from the threads recording a frame in parallel.
+    Allocation allocateUniform(VkDeviceSize size);
+    Allocation allocateStorage(VkDeviceSize size);
+
+    template <typename T>
+    Allocation pushUniform(const T& value) {
+        Allocation allocation = allocateUniform(sizeof(T));
+        memcpy(allocation.data, &value, sizeof(T));
+        return allocation;
+    }
+    template <typename T>
+    Allocation pushStorage(const T* values, size_t count) {
+        Allocation allocation = allocateStorage(sizeof(T) * count);
+        memcpy(allocation.data, values, sizeof(T) * count);
+        return allocation;
+    }
+
+    // Binding 0 is a dynamic uniform buffer, visible to every stage
+    VkDescriptorSetLayout getUniformSetLayout() const {
+        return uniformSetLayout->getDescriptorSetLayout();
+    }
+    VkDescriptorSet getUniformDescriptorSet() const {
+        return uniformDescriptorSet;
+    }
+    // Binding 0 is a dynamic storage buffer, visible to every stage
+    VkDescriptorSetLayout getStorageSetLayout() const {
+        return storageSetLayout->getDescriptorSetLayout();
+    }
+    VkDescriptorSet getStorageDescriptorSet() const {
+        return storageDescriptorSet;
+    }
+    // Sets allocated here are only valid until this frame comes around again. Unlike the
+    // buffer allocations it is not thread safe.
+    VgeDescriptorAllocator& getDescriptorAllocator() {
+        return *frameDescriptorAllocators[frameIndex];
+    }
+
+    // Allocations can also be read as indirect draw arguments at their offset in this buffer
+    VkBuffer getBuffer() const {
+        return buffer->getBuffer();
+    }
+
+    VkDeviceSize getUniformRange() const {
+        return uniformRange;
+    }
+    VkDeviceSize getStorageRange() const {
+        return storageRange;
+    }
+    // Bytes handed out so far in the current frame
+    VkDeviceSize getFrameUsage() const {
+        return head - regionBegin;
+    }
+    VkDeviceSize getRegionSize() const {
+        return regionSize;
+    }
+
+private:
+    Allocation allocate(VkDeviceSize size);
+
+    VgeDevice& vgeDevice;
+    VkDeviceSize regionSize;
+    VkDeviceSize alignment;
+    VkDeviceSize uniformRange;
+    VkDeviceSize storageRange;
+
+    std::unique_ptr<VgeBuffer> buffer;
+    VkDeviceSize regionBegin = 0;
+    VkDeviceSize head = 0;
+    std::mutex headMutex;
+    int frameIndex = 0;
+
+    std::unique_ptr<VgeDescriptorAllocator> descriptorAllocator;
+    std::vector<std::unique_ptr<VgeDescriptorAllocator>> frameDescriptorAllocators;
+    std::unique_ptr<VgeDescriptorSetLayout> uniformSetLayout;
+    std::unique_ptr<VgeDescriptorSetLayout> storageSetLayout;
+    VkDescriptorSet uniformDescriptorSet = VK_NULL_HANDLE;
+    VkDescriptorSet storageDescriptorSet = VK_NULL_HANDLE;
+};
+
+}  // namespace vge
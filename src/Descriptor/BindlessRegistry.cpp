@@ -0,0 +1,186 @@
+#include "BindlessRegistry.h"
+
+// std
+#include <array>
+#include <stdexcept>
+
+namespace vge {
+
+uint32_t VgeBindlessRegistry::Slots::acquire() {
+    uint32_t index;
+    if (next < capacity) {
+        index = next++;
+    } else if (!released.empty()) {
+        index = released.front();
+        released.pop_front();
+    } else {
+        return INVALID_INDEX;
+    }
+    live++;
+    return index;
+}
+
+void VgeBindlessRegistry::Slots::release(uint32_t index) {
+    released.push_back(index);
+    live--;
+}
+
+VgeBindlessRegistry::VgeBindlessRegistry(VgeDevice& device, uint32_t maxBuffers,
+                                         uint32_t maxTextures)
+    : vgeDevice{device} {
+    buffers.capacity = maxBuffers;
+    textures.capacity = maxTextures;
+    createSetLayout();
+    createDescriptorSet();
+}
+
+VgeBindlessRegistry::~VgeBindlessRegistry() {
+    vkDestroyDescriptorPool(vgeDevice.device(), descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(vgeDevice.device(), setLayout, nullptr);
+}
+
+void VgeBindlessRegistry::createSetLayout() {
+    // Not from the layout cache, which has no notion of binding flags
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = BUFFER_BINDING;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].descriptorCount = buffers.capacity;
+    bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+    bindings[1].binding = TEXTURE_BINDING;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].descriptorCount = textures.capacity;
+    bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+    // Slots that were never written are fine as long as shaders do not read them
+    VkDescriptorBindingFlags flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                     VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                     VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    std::array<VkDescriptorBindingFlags, 2> bindingFlags{flags, flags};
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+    flagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &flagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(vgeDevice.device(), &layoutInfo, nullptr, &setLayout) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create bindless descriptor set layout!!!");
+    }
+}
+
+void VgeBindlessRegistry::createDescriptorSet() {
+    std::array<VkDescriptorPoolSize, 2> poolSizes{{
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffers.capacity},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, textures.capacity},
+    }};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    if (vkCreateDescriptorPool(vgeDevice.device(), &poolInfo, nullptr, &descriptorPool) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create bindless descriptor pool!!!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &setLayout;
+
+    if (vkAllocateDescriptorSets(vgeDevice.device(), &allocInfo, &descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate bindless descriptor set!!!");
+    }
+}
+
+uint32_t VgeBindlessRegistry::registerBuffer(VkBuffer buffer, VkDeviceSize offset,
+                                             VkDeviceSize range) {
+    std::lock_guard<std::mutex> lock{mutex};
+    uint32_t index = buffers.acquire();
+    if (index == INVALID_INDEX) {
+        throw std::runtime_error("failed to register buffer, bindless buffer slots are full!!!");
+    }
+    writeBuffer(index, buffer, offset, range);
+    return index;
+}
+
+void VgeBindlessRegistry::updateBuffer(uint32_t index, VkBuffer buffer, VkDeviceSize offset,
+                                       VkDeviceSize range) {
+    std::lock_guard<std::mutex> lock{mutex};
+    writeBuffer(index, buffer, offset, range);
+}
+
+void VgeBindlessRegistry::writeBuffer(uint32_t index, VkBuffer buffer, VkDeviceSize offset,
+                                      VkDeviceSize range) {
+    VkDescriptorBufferInfo bufferInfo{buffer, offset, range};
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptorSet;
+    write.dstBinding = BUFFER_BINDING;
+    write.dstArrayElement = index;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.descriptorCount = 1;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(vgeDevice.device(), 1, &write, 0, nullptr);
+}
+
+uint32_t VgeBindlessRegistry::registerTexture(VkImageView imageView, VkSampler sampler,
+                                              VkImageLayout layout) {
+    std::lock_guard<std::mutex> lock{mutex};
+    uint32_t index = textures.acquire();
+    if (index == INVALID_INDEX) {
+        throw std::runtime_error("failed to register texture, bindless texture slots are full!!!");
+    }
+
+    VkDescriptorImageInfo imageInfo{sampler, imageView, layout};
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptorSet;
+    write.dstBinding = TEXTURE_BINDING;
+    write.dstArrayElement = index;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.descriptorCount = 1;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(vgeDevice.device(), 1, &write, 0, nullptr);
+    return index;
+}
+
+void VgeBindlessRegistry::releaseBuffer(uint32_t index) {
+    if (index == INVALID_INDEX) return;
+    // Frames in flight may still read the slot, it is only freed once they retire
+    vgeDevice.getDeletionQueue().push([this, index]() {
+        std::lock_guard<std::mutex> lock{mutex};
+        buffers.release(index);
+    });
+}
+
+void VgeBindlessRegistry::releaseTexture(uint32_t index) {
+    if (index == INVALID_INDEX) return;
+    vgeDevice.getDeletionQueue().push([this, index]() {
+        std::lock_guard<std::mutex> lock{mutex};
+        textures.release(index);
+    });
+}
+
+uint32_t VgeBindlessRegistry::getBufferCount() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return buffers.live;
+}
+
+uint32_t VgeBindlessRegistry::getTextureCount() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return textures.live;
+}
+
+}  // namespace vge
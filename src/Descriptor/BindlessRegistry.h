@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../Device/Device.h"
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace vge {
+
+// A single descriptor set that holds every buffer and texture shaders reach by index. Binding 0
+// is an array of storage buffers, binding 1 an array of combined image samplers. Registering a
+// resource hands out a slot, and the slot index is what draw records carry instead of a bind.
+// The set is update-after-bind, so registering never invalidates recorded command buffers.
+class VgeBindlessRegistry {
+public:
+    static constexpr uint32_t BUFFER_BINDING = 0;
+    static constexpr uint32_t TEXTURE_BINDING = 1;
+    static constexpr uint32_t INVALID_INDEX = ~0u;
+
+    VgeBindlessRegistry(VgeDevice& device, uint32_t maxBuffers, uint32_t maxTextures);
+    ~VgeBindlessRegistry();
+
+    VgeBindlessRegistry(const VgeBindlessRegistry&) = delete;
+    VgeBindlessRegistry& operator=(const VgeBindlessRegistry&) = delete;
+
+    uint32_t registerBuffer(VkBuffer buffer, VkDeviceSize offset = 0,
+                            VkDeviceSize range = VK_WHOLE_SIZE);
+    // Points a registered slot at another buffer, e.g. after defragmentation moved it
+    void updateBuffer(uint32_t index, VkBuffer buffer, VkDeviceSize offset = 0,
+                      VkDeviceSize range = VK_WHOLE_SIZE);
+    uint32_t registerTexture(VkImageView imageView, VkSampler sampler,
+                             VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // The slot goes back to the free list through the device's deletion queue, so it is handed
+    // out again only after the frames that could still read it have retired. The device flushes
+    // the queue before it destroys the registry.
+    void releaseBuffer(uint32_t index);
+    void releaseTexture(uint32_t index);
+
+    VkDescriptorSetLayout getSetLayout() const {
+        return setLayout;
+    }
+    VkDescriptorSet getDescriptorSet() const {
+        return descriptorSet;
+    }
+
+    uint32_t getBufferCount() const;
+    uint32_t getTextureCount() const;
+
+private:
+    struct Slots {
+        uint32_t capacity = 0;
+        uint32_t next = 0;  // first slot never handed out
+        uint32_t live = 0;
+        std::deque<uint32_t> released;
+
+        uint32_t acquire();
+        void release(uint32_t index);
+    };
+
+    void createSetLayout();
+    void createDescriptorSet();
+    void writeBuffer(uint32_t index, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+
+    VgeDevice& vgeDevice;
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+    Slots buffers;
+    Slots textures;
+    mutable std::mutex mutex;  // also guards updates to the set
+};
+
+}  // namespace vge
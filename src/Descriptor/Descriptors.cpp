@@ -1,11 +1,97 @@
 #include "Descriptors.h"
 
 // std
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <stdexcept>
 
 namespace vge {
 
+// *************** Descriptor Layout Cache *********************
+
+VgeDescriptorLayoutCache::VgeDescriptorLayoutCache(VkDevice device) : device{device} {}
+
+VgeDescriptorLayoutCache::~VgeDescriptorLayoutCache() {
+    for (auto& [key, layout] : layouts) {
+        vkDestroyDescriptorSetLayout(device, layout, nullptr);
+    }
+}
+
+VkDescriptorSetLayout VgeDescriptorLayoutCache::getLayout(
+    const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings) {
+    LayoutKey key{};
+    key.bindings.reserve(bindings.size());
+    for (const auto& kv : bindings) {
+        key.bindings.push_back(kv.second);
+    }
+    std::sort(key.bindings.begin(), key.bindings.end(),
+              [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+                  return a.binding < b.binding;
+              });
+
+    std::lock_guard<std::mutex> lock{mutex};
+    auto it = layouts.find(key);
+    if (it != layouts.end()) {
+        cacheHits++;
+        return it->second;
+    }
+
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
+    descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(key.bindings.size());
+    descriptorSetLayoutInfo.pBindings = key.bindings.data();
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(device, &descriptorSetLayoutInfo, nullptr, &layout) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+    layouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+uint32_t VgeDescriptorLayoutCache::getLayoutCount() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return static_cast<uint32_t>(layouts.size());
+}
+
+uint64_t VgeDescriptorLayoutCache::getCacheHits() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return cacheHits;
+}
+
+bool VgeDescriptorLayoutCache::LayoutKey::operator==(const LayoutKey& other) const {
+    if (bindings.size() != other.bindings.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < bindings.size(); i++) {
+        const auto& a = bindings[i];
+        const auto& b = other.bindings[i];
+        // Immutable samplers are not used anywhere, so they are not part of the key
+        if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+            a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t VgeDescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const {
+    uint64_t value = 14695981039346656037ull;
+    auto mix = [&value](uint64_t field) {
+        value ^= field;
+        value *= 1099511628211ull;
+    };
+    for (const auto& binding : key.bindings) {
+        mix(binding.binding);
+        mix(static_cast<uint64_t>(binding.descriptorType));
+        mix(binding.descriptorCount);
+        mix(binding.stageFlags);
+    }
+    return static_cast<size_t>(value);
+}
+
 // *************** Descriptor Set Layout Builder *********************
 
 VgeDescriptorSetLayout::Builder& VgeDescriptorSetLayout::Builder::addBinding(
@@ -21,6 +107,16 @@ VgeDescriptorSetLayout::Builder& VgeDescriptorSetLayout::Builder::addBinding(
     return *this;
 }
 
+VgeDescriptorSetLayout::Builder& VgeDescriptorSetLayout::Builder::addBindings(
+    const ShaderReflection& reflection, uint32_t set) {
+    for (const auto& binding : reflection.bindings) {
+        if (binding.set != set) continue;
+        assert(binding.count > 0 && "Runtime sized descriptor arrays need an explicit count");
+        addBinding(binding.binding, binding.type, binding.stages, binding.count);
+    }
+    return *this;
+}
+
 std::unique_ptr<VgeDescriptorSetLayout> VgeDescriptorSetLayout::Builder::build() const {
     return std::make_unique<VgeDescriptorSetLayout>(vgeDevice, bindings);
 }
@@ -30,24 +126,7 @@ std::unique_ptr<VgeDescriptorSetLayout> VgeDescriptorSetLayout::Builder::build()
 VgeDescriptorSetLayout::VgeDescriptorSetLayout(
     VgeDevice& vgeDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
     : vgeDevice{vgeDevice}, bindings{bindings} {
-    std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
-    for (auto kv : bindings) {
-        setLayoutBindings.push_back(kv.second);
-    }
-
-    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
-    descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
-    descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
-
-    if (vkCreateDescriptorSetLayout(vgeDevice.device(), &descriptorSetLayoutInfo, nullptr,
-                                    &descriptorSetLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create descriptor set layout!");
-    }
-}
-
-VgeDescriptorSetLayout::~VgeDescriptorSetLayout() {
-    vkDestroyDescriptorSetLayout(vgeDevice.device(), descriptorSetLayout, nullptr);
+    descriptorSetLayout = vgeDevice.getDescriptorLayoutCache().getLayout(this->bindings);
 }
 
 // *************** Descriptor Pool Builder *********************
@@ -103,8 +182,7 @@ bool VgeDescriptorPool::allocateDescriptor(const VkDescriptorSetLayout descripto
     allocInfo.pSetLayouts = &descriptorSetLayout;
     allocInfo.descriptorSetCount = 1;
 
-    // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-    // a new pool whenever an old pool fills up. But this is beyond our current scope
+    // Fixed size pool, VgeDescriptorAllocator is the one that grows
     if (vkAllocateDescriptorSets(vgeDevice.device(), &allocInfo, &descriptor) != VK_SUCCESS) {
         return false;
     }
@@ -120,10 +198,109 @@ void VgeDescriptorPool::resetPool() {
     vkResetDescriptorPool(vgeDevice.device(), descriptorPool, 0);
 }
 
+// *************** Descriptor Allocator Builder *********************
+
+VgeDescriptorAllocator::Builder& VgeDescriptorAllocator::Builder::addRatio(
+    VkDescriptorType descriptorType, float descriptorsPerSet) {
+    ratios.push_back({descriptorType, descriptorsPerSet});
+    return *this;
+}
+
+VgeDescriptorAllocator::Builder& VgeDescriptorAllocator::Builder::setInitialSets(uint32_t count) {
+    initialSets = count;
+    return *this;
+}
+
+std::unique_ptr<VgeDescriptorAllocator> VgeDescriptorAllocator::Builder::build() const {
+    return std::make_unique<VgeDescriptorAllocator>(vgeDevice, initialSets, ratios);
+}
+
+// *************** Descriptor Allocator *********************
+
+VgeDescriptorAllocator::VgeDescriptorAllocator(
+    VgeDevice& vgeDevice, uint32_t initialSets,
+    std::vector<std::pair<VkDescriptorType, float>> ratios)
+    : vgeDevice{vgeDevice}, ratios{std::move(ratios)}, setsPerPool{std::max(initialSets, 1u)} {
+    readyPools.push_back(createPool(setsPerPool));
+}
+
+VgeDescriptorAllocator::~VgeDescriptorAllocator() {
+    for (VkDescriptorPool pool : readyPools) {
+        vkDestroyDescriptorPool(vgeDevice.device(), pool, nullptr);
+    }
+    for (VkDescriptorPool pool : fullPools) {
+        vkDestroyDescriptorPool(vgeDevice.device(), pool, nullptr);
+    }
+}
+
+bool VgeDescriptorAllocator::allocateDescriptor(const VkDescriptorSetLayout descriptorSetLayout,
+                                                VkDescriptorSet& descriptor) {
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = takePool();
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+    allocInfo.descriptorSetCount = 1;
+
+    VkResult result = vkAllocateDescriptorSets(vgeDevice.device(), &allocInfo, &descriptor);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+        // The pool is done for until the next reset, retry once on a fresh one
+        fullPools.push_back(allocInfo.descriptorPool);
+        allocInfo.descriptorPool = takePool();
+        result = vkAllocateDescriptorSets(vgeDevice.device(), &allocInfo, &descriptor);
+    }
+    readyPools.push_back(allocInfo.descriptorPool);
+    return result == VK_SUCCESS;
+}
+
+void VgeDescriptorAllocator::resetPools() {
+    for (VkDescriptorPool pool : readyPools) {
+        vkResetDescriptorPool(vgeDevice.device(), pool, 0);
+    }
+    for (VkDescriptorPool pool : fullPools) {
+        vkResetDescriptorPool(vgeDevice.device(), pool, 0);
+        readyPools.push_back(pool);
+    }
+    fullPools.clear();
+}
+
+VkDescriptorPool VgeDescriptorAllocator::takePool() {
+    if (!readyPools.empty()) {
+        VkDescriptorPool pool = readyPools.back();
+        readyPools.pop_back();
+        return pool;
+    }
+    // Each new pool is half again as big as the last, so a busy allocator settles on a few pools
+    setsPerPool = std::min(setsPerPool + setsPerPool / 2 + 1, MAX_SETS_PER_POOL);
+    return createPool(setsPerPool);
+}
+
+VkDescriptorPool VgeDescriptorAllocator::createPool(uint32_t setCount) {
+    std::vector<VkDescriptorPoolSize> poolSizes{};
+    poolSizes.reserve(ratios.size());
+    for (const auto& [type, ratio] : ratios) {
+        uint32_t count = static_cast<uint32_t>(std::ceil(ratio * static_cast<float>(setCount)));
+        poolSizes.push_back({type, std::max(count, 1u)});
+    }
+
+    VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+    descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    descriptorPoolInfo.pPoolSizes = poolSizes.data();
+    descriptorPoolInfo.maxSets = setCount;
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(vgeDevice.device(), &descriptorPoolInfo, nullptr, &pool) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+    return pool;
+}
+
 // *************** Descriptor Writer *********************
 
-VgeDescriptorWriter::VgeDescriptorWriter(VgeDescriptorSetLayout& setLayout, VgeDescriptorPool& pool)
-    : setLayout{setLayout}, pool{pool} {}
+VgeDescriptorWriter::VgeDescriptorWriter(VgeDescriptorSetLayout& setLayout,
+                                         VgeDescriptorAllocator& allocator)
+    : setLayout{setLayout}, allocator{allocator} {}
 
 VgeDescriptorWriter& VgeDescriptorWriter::writeBuffer(uint32_t binding,
                                                       VkDescriptorBufferInfo* bufferInfo) {
@@ -166,7 +343,7 @@ VgeDescriptorWriter& VgeDescriptorWriter::writeImage(uint32_t binding,
 }
 
 bool VgeDescriptorWriter::build(VkDescriptorSet& set) {
-    bool success = pool.allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
+    bool success = allocator.allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
     if (!success) {
         return false;
     }
@@ -178,6 +355,6 @@ void VgeDescriptorWriter::overwrite(VkDescriptorSet& set) {
     for (auto& write : writes) {
         write.dstSet = set;
     }
-    vkUpdateDescriptorSets(pool.vgeDevice.device(), writes.size(), writes.data(), 0, nullptr);
+    vkUpdateDescriptorSets(allocator.vgeDevice.device(), writes.size(), writes.data(), 0, nullptr);
 }
 }  // namespace vge
@@ -1,14 +1,47 @@
 #pragma once
 
 #include "../Device/Device.h"
+#include "../Graphics/ShaderReflection.h"
 
 // std
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
 namespace vge {
 
+// Device wide cache of set layouts. Layouts are deduplicated by their bindings, so every system
+// that declares the same set shares one VkDescriptorSetLayout; they live until the device does.
+class VgeDescriptorLayoutCache {
+   public:
+    VgeDescriptorLayoutCache(VkDevice device);
+    ~VgeDescriptorLayoutCache();
+    VgeDescriptorLayoutCache(const VgeDescriptorLayoutCache&) = delete;
+    VgeDescriptorLayoutCache& operator=(const VgeDescriptorLayoutCache&) = delete;
+
+    VkDescriptorSetLayout getLayout(
+        const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings);
+
+    uint32_t getLayoutCount() const;
+    uint64_t getCacheHits() const;
+
+   private:
+    struct LayoutKey {
+        std::vector<VkDescriptorSetLayoutBinding> bindings;  // sorted by binding
+
+        bool operator==(const LayoutKey& other) const;
+    };
+    struct LayoutKeyHash {
+        size_t operator()(const LayoutKey& key) const;
+    };
+
+    VkDevice device;
+    std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> layouts;
+    uint64_t cacheHits = 0;
+    mutable std::mutex mutex;
+};
+
 class VgeDescriptorSetLayout {
    public:
     class Builder {
@@ -17,6 +50,8 @@ class VgeDescriptorSetLayout {
 
         Builder& addBinding(uint32_t binding, VkDescriptorType descriptorType,
                             VkShaderStageFlags stageFlags, uint32_t count = 1);
+        // Every binding the shaders declare in the given set
+        Builder& addBindings(const ShaderReflection& reflection, uint32_t set);
         std::unique_ptr<VgeDescriptorSetLayout> build() const;
 
        private:
@@ -24,9 +59,10 @@ class VgeDescriptorSetLayout {
         std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
     };
 
+    // The VkDescriptorSetLayout is owned by the device's layout cache
     VgeDescriptorSetLayout(VgeDevice& vgeDevice,
                            std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
-    ~VgeDescriptorSetLayout();
+    ~VgeDescriptorSetLayout() = default;
     VgeDescriptorSetLayout(const VgeDescriptorSetLayout&) = delete;
     VgeDescriptorSetLayout& operator=(const VgeDescriptorSetLayout&) = delete;
 
@@ -73,16 +109,69 @@ class VgeDescriptorPool {
 
     void resetPool();
 
+    VkDescriptorPool getDescriptorPool() const {
+        return descriptorPool;
+    }
+
    private:
     VgeDevice& vgeDevice;
     VkDescriptorPool descriptorPool;
+};
+
+// Hands out descriptor sets from a chain of pools, adding a bigger pool whenever the current one
+// runs out, so nothing has to be sized by hand. Sets are never freed one by one; resetPools()
+// recycles every pool at once, which is how per-frame allocators are cleared.
+class VgeDescriptorAllocator {
+   public:
+    class Builder {
+       public:
+        Builder(VgeDevice& vgeDevice) : vgeDevice{vgeDevice} {}
+
+        // Descriptors of this type to reserve per set, e.g. 2 for a set of two storage buffers
+        Builder& addRatio(VkDescriptorType descriptorType, float descriptorsPerSet);
+        Builder& setInitialSets(uint32_t count);
+        std::unique_ptr<VgeDescriptorAllocator> build() const;
+
+       private:
+        VgeDevice& vgeDevice;
+        std::vector<std::pair<VkDescriptorType, float>> ratios{};
+        uint32_t initialSets = 8;
+    };
+
+    VgeDescriptorAllocator(VgeDevice& vgeDevice, uint32_t initialSets,
+                           std::vector<std::pair<VkDescriptorType, float>> ratios);
+    ~VgeDescriptorAllocator();
+    VgeDescriptorAllocator(const VgeDescriptorAllocator&) = delete;
+    VgeDescriptorAllocator& operator=(const VgeDescriptorAllocator&) = delete;
+
+    bool allocateDescriptor(const VkDescriptorSetLayout descriptorSetLayout,
+                            VkDescriptorSet& descriptor);
+
+    // Every set allocated so far becomes invalid
+    void resetPools();
+
+    uint32_t getPoolCount() const {
+        return static_cast<uint32_t>(readyPools.size() + fullPools.size());
+    }
+
+   private:
+    static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+    VkDescriptorPool takePool();
+    VkDescriptorPool createPool(uint32_t setCount);
+
+    VgeDevice& vgeDevice;
+    std::vector<std::pair<VkDescriptorType, float>> ratios;
+    uint32_t setsPerPool;
+    std::vector<VkDescriptorPool> readyPools;
+    std::vector<VkDescriptorPool> fullPools;
 
     friend class VgeDescriptorWriter;
 };
 
 class VgeDescriptorWriter {
    public:
-    VgeDescriptorWriter(VgeDescriptorSetLayout& setLayout, VgeDescriptorPool& pool);
+    VgeDescriptorWriter(VgeDescriptorSetLayout& setLayout, VgeDescriptorAllocator& allocator);
 
     VgeDescriptorWriter& writeBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo);
     VgeDescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo);
@@ -92,7 +181,7 @@ class VgeDescriptorWriter {
 
    private:
     VgeDescriptorSetLayout& setLayout;
-    VgeDescriptorPool& pool;
+    VgeDescriptorAllocator& allocator;
     std::vector<VkWriteDescriptorSet> writes;
 };
 }  // namespace vge
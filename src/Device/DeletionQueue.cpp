@@ -0,0 +1,52 @@
+#include "DeletionQueue.h"
+
+// std
+#include <vector>
+
+namespace vge {
+
+void VgeDeletionQueue::push(std::function<void()> deleter) {
+    std::lock_guard<std::mutex> lock{mutex};
+    entries.push_back({currentFrame, std::move(deleter)});
+}
+
+void VgeDeletionQueue::beginFrame(uint64_t frame, uint64_t completedFrame) {
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        currentFrame = frame;
+        // Entries are in frame order, so the retired ones are all at the front
+        while (!entries.empty() && entries.front().frame <= completedFrame) {
+            ready.push_back(std::move(entries.front().deleter));
+            entries.pop_front();
+        }
+    }
+    // Outside the lock, destructors of retired systems may push resources of their own
+    for (auto& deleter : ready) {
+        deleter();
+    }
+}
+
+void VgeDeletionQueue::flush() {
+    // Loops because deleters can push more entries
+    while (true) {
+        std::deque<Entry> pending;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (entries.empty()) {
+                return;
+            }
+            pending.swap(entries);
+        }
+        for (auto& entry : pending) {
+            entry.deleter();
+        }
+    }
+}
+
+size_t VgeDeletionQueue::getPendingCount() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return entries.size();
+}
+
+}  // namespace vge
@@ -0,0 +1,54 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+namespace vge {
+
+// Defers destruction of GPU resources until the frames that may still use them have retired,
+// so nothing has to wait for the device to go idle. Everything pushed is stamped with the frame
+// being recorded and released at the start of the first frame after the GPU has finished it.
+class VgeDeletionQueue {
+public:
+    VgeDeletionQueue() = default;
+    ~VgeDeletionQueue() = default;
+
+    VgeDeletionQueue(const VgeDeletionQueue&) = delete;
+    VgeDeletionQueue& operator=(const VgeDeletionQueue&) = delete;
+
+    void push(std::function<void()> deleter);
+
+    // Takes ownership of anything whose destructor frees GPU objects: unique_ptrs to buffers,
+    // pipelines, systems or whole scenes
+    template <typename T>
+    void retire(T&& resource) {
+        static_assert(!std::is_lvalue_reference_v<T>, "Retired resources must be moved in");
+        auto owner = std::make_shared<std::decay_t<T>>(std::move(resource));
+        push([owner]() mutable { owner.reset(); });
+    }
+
+    // Called by the renderer as each frame starts. Frames up to completedFrame, as read from the
+    // frame timeline, are finished on the GPU.
+    void beginFrame(uint64_t frame, uint64_t completedFrame);
+    // Releases everything regardless of frames, the device must be idle
+    void flush();
+
+    size_t getPendingCount() const;
+
+private:
+    struct Entry {
+        uint64_t frame;
+        std::function<void()> deleter;
+    };
+
+    std::deque<Entry> entries;
+    uint64_t currentFrame = 0;
+    mutable std::mutex mutex;
+};
+
+}  // namespace vge
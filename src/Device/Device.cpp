@@ -1,11 +1,25 @@
 #include "Device.h"
 
+#include "../Descriptor/BindlessRegistry.h"
+#include "../Descriptor/Descriptors.h"
+#include "../Graphics/PipelineCache.h"
+#include "../Graphics/PipelineCompiler.h"
+#include "../Graphics/ShaderRegistry.h"
+#include "FrameScheduler.h"
+#include "JobSystem.h"
+#include "TransferManager.h"
+
 // std headers
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <set>
 // #include <unordered_set>
 
+#ifndef ENGINE_DIR
+#define ENGINE_DIR "../"
+#endif
+
 namespace vge {
 
 // local callback functions
@@ -41,24 +55,60 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 }
 
 // class member functions
-VgeDevice::VgeDevice(Window& window) : window{window} {
+VgeDevice::VgeDevice(Window& window) : window{&window} {
+    init();
+}
+
+VgeDevice::VgeDevice(HeadlessMode mode) : computeOnly{mode == HeadlessMode::ComputeOnly} {
+    init();
+}
+
+void VgeDevice::init() {
     createInstance();
     setupDebugMessenger();
-    createSurface();
+    if (!isHeadless()) {
+        createSurface();
+    }
     pickPhysicalDevice();
     createLogicalDevice();
+    deletionQueue = std::make_unique<VgeDeletionQueue>();
+    frameScheduler = std::make_unique<VgeFrameScheduler>(device_);
+    allocator = std::make_unique<VgeMemoryAllocator>(device_, physicalDevice);
+    pipelineCache = std::make_unique<VgePipelineCache>(device_, properties,
+                                                       ENGINE_DIR "pipeline_cache.bin");
+    shaderRegistry = std::make_unique<VgeShaderRegistry>(device_);
+    descriptorLayoutCache = std::make_unique<VgeDescriptorLayoutCache>(device_);
+    createBindlessRegistry();
+    pipelineCompiler = std::make_unique<VgePipelineCompiler>(*this);
+    jobSystem = std::make_unique<VgeJobSystem>();
     createCommandPool();
+    transferManager = std::make_unique<VgeTransferManager>(*this, useDedicatedTransferQueue);
 }
 
 VgeDevice::~VgeDevice() {
+    // Whatever was retired after the last frame, its deleters still need the rest of the device
+    vkDeviceWaitIdle(device_);
+    deletionQueue->flush();
+    transferManager.reset();
     vkDestroyCommandPool(device_, commandPool, nullptr);
+    jobSystem.reset();
+    pipelineCompiler.reset();
+    bindlessRegistry.reset();
+    descriptorLayoutCache.reset();
+    shaderRegistry.reset();
+    pipelineCache.reset();  // saves the cache to disk
+    allocator.reset();
+    frameScheduler.reset();
+    deletionQueue.reset();
     vkDestroyDevice(device_, nullptr);
 
     if (enableValidationLayers) {
         DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
     }
 
-    vkDestroySurfaceKHR(instance, surface_, nullptr);
+    if (surface_ != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(instance, surface_, nullptr);
+    }
     vkDestroyInstance(instance, nullptr);
 }
 
@@ -73,7 +123,8 @@ void VgeDevice::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // 1.2 for descriptor indexing, older devices still work and skip the bindless path
+    appInfo.apiVersion = VK_API_VERSION_1_2;
 
     VkInstanceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -132,6 +183,10 @@ void VgeDevice::createLogicalDevice() {
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+    bool dedicatedTransfer = useDedicatedTransferQueue && indices.transferFamilyHasValue;
+    if (dedicatedTransfer) {
+        uniqueQueueFamilies.insert(indices.transferFamily);
+    }
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -143,8 +198,53 @@ void VgeDevice::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    wireframeSupported = supportedFeatures.fillModeNonSolid == VK_TRUE;
+
+    multiDrawIndirectSupported = supportedFeatures.multiDrawIndirect == VK_TRUE &&
+                                 supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+
     VkPhysicalDeviceFeatures deviceFeatures = {};
-    deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.samplerAnisotropy = isHeadless() ? VK_FALSE : VK_TRUE;
+    deviceFeatures.fillModeNonSolid = supportedFeatures.fillModeNonSolid;
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+    // Bindless rendering needs non-uniform indexing into partially bound, update-after-bind
+    // arrays of storage buffers and sampled images
+    VkPhysicalDeviceDescriptorIndexingFeatures supportedIndexing{};
+    supportedIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    if (properties.apiVersion >= VK_API_VERSION_1_2) {
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &supportedIndexing;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+    }
+    bindlessSupported = supportedIndexing.runtimeDescriptorArray &&
+                        supportedIndexing.descriptorBindingPartiallyBound &&
+                        supportedIndexing.descriptorBindingUpdateUnusedWhilePending &&
+                        supportedIndexing.descriptorBindingStorageBufferUpdateAfterBind &&
+                        supportedIndexing.descriptorBindingSampledImageUpdateAfterBind &&
+                        supportedIndexing.shaderStorageBufferArrayNonUniformIndexing &&
+                        supportedIndexing.shaderSampledImageArrayNonUniformIndexing;
+
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+    indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    indexingFeatures.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+    indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+    // Frame and transfer synchronization runs on timeline semaphores, checked for when picking
+    // the physical device
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineFeatures.timelineSemaphore = VK_TRUE;
+    timelineFeatures.pNext = bindlessSupported ? &indexingFeatures : nullptr;
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -153,6 +253,8 @@ void VgeDevice::createLogicalDevice() {
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
     createInfo.pEnabledFeatures = &deviceFeatures;
+    createInfo.pNext = &timelineFeatures;
+    auto deviceExtensions = getDeviceExtensions();
     createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
     createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
@@ -171,6 +273,11 @@ void VgeDevice::createLogicalDevice() {
 
     vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
     vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+    if (dedicatedTransfer) {
+        vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
+    } else {
+        transferQueue_ = graphicsQueue_;
+    }
 }
 
 void VgeDevice::createCommandPool() {
@@ -187,8 +294,31 @@ void VgeDevice::createCommandPool() {
     }
 }
 
+void VgeDevice::createBindlessRegistry() {
+    if (!bindlessSupported) {
+        std::cout << "descriptor indexing not supported, bindless rendering disabled" << std::endl;
+        return;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &indexingProperties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+    // Plenty for this engine, and well below what any device with the feature allows
+    uint32_t maxBuffers = std::min<uint32_t>(
+        4096, std::min(indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                       indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers));
+    uint32_t maxTextures = std::min<uint32_t>(
+        1024, std::min(indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+                       indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages));
+    bindlessRegistry = std::make_unique<VgeBindlessRegistry>(*this, maxBuffers, maxTextures);
+}
+
 void VgeDevice::createSurface() {
-    window.createWindowSurface(instance, &surface_);
+    window->createWindowSurface(instance, &surface_);
 }
 
 bool VgeDevice::isDeviceSuitable(VkPhysicalDevice device) {
@@ -196,8 +326,9 @@ bool VgeDevice::isDeviceSuitable(VkPhysicalDevice device) {
 
     bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
+    // Headless rendering never presents
+    bool swapChainAdequate = isHeadless();
+    if (extensionsSupported && !isHeadless()) {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
         swapChainAdequate =
             !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
@@ -206,8 +337,27 @@ bool VgeDevice::isDeviceSuitable(VkPhysicalDevice device) {
     VkPhysicalDeviceFeatures supportedFeatures;
     vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-    return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-           supportedFeatures.samplerAnisotropy;
+    // Nothing samples with anisotropy headless, it is only required for the windowed engine
+    bool featuresAdequate = isHeadless() || supportedFeatures.samplerAnisotropy;
+
+    return indices.isComplete() && extensionsSupported && swapChainAdequate && featuresAdequate &&
+           supportsTimelineSemaphores(device);
+}
+
+bool VgeDevice::supportsTimelineSemaphores(VkPhysicalDevice device) {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+    if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &timelineFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+    return timelineFeatures.timelineSemaphore == VK_TRUE;
 }
 
 void VgeDevice::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
@@ -258,11 +408,14 @@ bool VgeDevice::checkValidationLayerSupport() {
 }
 
 std::vector<const char*> VgeDevice::getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    // GLFW is never initialized without a window, and nothing needs surface extensions then
+    std::vector<const char*> extensions;
+    if (!isHeadless()) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -302,6 +455,7 @@ bool VgeDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
                                          availableExtensions.data());
 
+    auto deviceExtensions = getDeviceExtensions();
     std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
 
     for (const auto& extension : availableExtensions) {
@@ -311,6 +465,13 @@ bool VgeDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     return requiredExtensions.empty();
 }
 
+std::vector<const char*> VgeDevice::getDeviceExtensions() const {
+    if (isHeadless()) {
+        return {};
+    }
+    return {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+}
+
 QueueFamilyIndices VgeDevice::findQueueFamilies(VkPhysicalDevice device) {
     QueueFamilyIndices indices;
 
@@ -320,14 +481,22 @@ QueueFamilyIndices VgeDevice::findQueueFamilies(VkPhysicalDevice device) {
     std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
+    // A compute only device submits everything to the "graphics" queue, which then only
+    // needs compute
+    VkQueueFlags mainQueueFlags = computeOnly ? VK_QUEUE_COMPUTE_BIT : VK_QUEUE_GRAPHICS_BIT;
+
     int i = 0;
     for (const auto& queueFamily : queueFamilies) {
-        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & mainQueueFlags) {
             indices.graphicsFamily = i;
             indices.graphicsFamilyHasValue = true;
         }
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+        // Without a surface the "present" queue is only where finished frames are read back,
+        // it is always the graphics queue
+        VkBool32 presentSupport = isHeadless() && (queueFamily.queueFlags & mainQueueFlags);
+        if (!isHeadless()) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+        }
         if (queueFamily.queueCount > 0 && presentSupport) {
             indices.presentFamily = i;
             indices.presentFamilyHasValue = true;
@@ -339,6 +508,17 @@ QueueFamilyIndices VgeDevice::findQueueFamilies(VkPhysicalDevice device) {
         i++;
     }
 
+    // A transfer only family maps to the copy engines, which run alongside graphics work
+    for (uint32_t j = 0; j < queueFamilyCount; j++) {
+        VkQueueFlags flags = queueFamilies[j].queueFlags;
+        if (queueFamilies[j].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) &&
+            !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            indices.transferFamily = j;
+            indices.transferFamilyHasValue = true;
+            break;
+        }
+    }
+
     return indices;
 }
 
@@ -398,7 +578,7 @@ uint32_t VgeDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags pr
 
 void VgeDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
                              VkMemoryPropertyFlags properties, VkBuffer& buffer,
-                             VkDeviceMemory& bufferMemory) {
+                             VgeAllocation& allocation) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
@@ -412,82 +592,15 @@ void VgeDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    // Buffers that only feed transfers are short lived
+    auto strategy = usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+                        ? VgeMemoryAllocator::Strategy::Linear
+                        : VgeMemoryAllocator::Strategy::Pooled;
+    allocation = allocator->allocate(memRequirements, properties, strategy);
 
-    if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate vertex buffer memory!");
+    if (vkBindBufferMemory(device_, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("failed to bind buffer memory!!!");
     }
-
-    vkBindBufferMemory(device_, buffer, bufferMemory, 0);
-}
-
-VkCommandBuffer VgeDevice::beginSingleTimeCommands() {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = commandPool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-    return commandBuffer;
-}
-
-void VgeDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
-    vkEndCommandBuffer(commandBuffer);
-
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-
-    vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue_);
-
-    vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
-}
-
-void VgeDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-    VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0;  // Optional
-    copyRegion.dstOffset = 0;  // Optional
-    copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-    endSingleTimeCommands(commandBuffer);
-}
-
-void VgeDevice::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height,
-                                  uint32_t layerCount) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = layerCount;
-
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {width, height, 1};
-
-    vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
-                           &region);
-    endSingleTimeCommands(commandBuffer);
 }
 
 void VgeDevice::createImageWithInfo(const VkImageCreateInfo& imageInfo,
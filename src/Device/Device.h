@@ -1,14 +1,26 @@
 #pragma once
 
+#include "../Memory/MemoryAllocator.h"
 #include "../Window.h"
+#include "DeletionQueue.h"
 
 // std lib headers
 #include <vulkan/vulkan_core.h>
 
+#include <memory>
 #include <vector>
 
 namespace vge {
 
+class VgeTransferManager;
+class VgePipelineCache;
+class VgePipelineCompiler;
+class VgeShaderRegistry;
+class VgeDescriptorLayoutCache;
+class VgeBindlessRegistry;
+class VgeFrameScheduler;
+class VgeJobSystem;
+
 struct SwapChainSupportDetails {
     VkSurfaceCapabilitiesKHR capabilities;
     std::vector<VkSurfaceFormatKHR> formats;
@@ -18,8 +30,10 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
     uint32_t graphicsFamily;
     uint32_t presentFamily;
+    uint32_t transferFamily;  // transfer only family, if the device has one
     bool graphicsFamilyHasValue = false;
     bool presentFamilyHasValue = false;
+    bool transferFamilyHasValue = false;
     bool isComplete() {
         return graphicsFamilyHasValue && presentFamilyHasValue;
     }
@@ -32,8 +46,19 @@ class VgeDevice {
 #else
     const bool enableValidationLayers = true;
 #endif
+    const bool useDedicatedTransferQueue = true;
+
+    enum class HeadlessMode {
+        // Renders to offscreen images, any device with graphics and timeline semaphores
+        // qualifies, including CPU implementations such as lavapipe
+        Offscreen,
+        // Compute work only, a compute queue is enough and no graphics features are required
+        ComputeOnly,
+    };
 
     VgeDevice(Window& window);
+    // Headless: no window, surface or swap chain extension
+    explicit VgeDevice(HeadlessMode mode = HeadlessMode::Offscreen);
     ~VgeDevice();
 
     // Not copyable or movable
@@ -51,12 +76,38 @@ class VgeDevice {
     VkSurfaceKHR surface() {
         return surface_;
     }
+    // Rendering goes to offscreen images, nothing is presented
+    bool isHeadless() const {
+        return window == nullptr;
+    }
+    // Nothing is drawn, graphicsQueue() is a compute queue and there is no present queue
+    bool isComputeOnly() const {
+        return computeOnly;
+    }
     VkQueue graphicsQueue() {
         return graphicsQueue_;
     }
     VkQueue presentQueue() {
         return presentQueue_;
     }
+    VkQueue transferQueue() {
+        return transferQueue_;
+    }
+    bool hasDedicatedTransferQueue() const {
+        return transferQueue_ != graphicsQueue_;
+    }
+    // Line polygon mode, optional in Vulkan and enabled whenever the device has it
+    bool supportsWireframe() const {
+        return wireframeSupported;
+    }
+    // Descriptor indexing, needs a Vulkan 1.2 device; without it there is no bindless registry
+    bool supportsBindless() const {
+        return bindlessSupported;
+    }
+    // Many draws per vkCmdDrawIndirect, each with its own firstInstance
+    bool supportsMultiDrawIndirect() const {
+        return multiDrawIndirectSupported;
+    }
 
     SwapChainSupportDetails getSwapChainSupport() {
         return querySwapChainSupport(physicalDevice);
@@ -74,15 +125,42 @@ class VgeDevice {
     VkPhysicalDevice getPhysicalDevice() const {
         return physicalDevice;
     }
+    VgeMemoryAllocator& getAllocator() {
+        return *allocator;
+    }
+    VgeTransferManager& getTransferManager() {
+        return *transferManager;
+    }
+    VgePipelineCache& getPipelineCache() {
+        return *pipelineCache;
+    }
+    VgePipelineCompiler& getPipelineCompiler() {
+        return *pipelineCompiler;
+    }
+    VgeShaderRegistry& getShaderRegistry() {
+        return *shaderRegistry;
+    }
+    VgeDescriptorLayoutCache& getDescriptorLayoutCache() {
+        return *descriptorLayoutCache;
+    }
+    VgeBindlessRegistry& getBindlessRegistry() {
+        return *bindlessRegistry;
+    }
+    // Where anything the GPU might still be using goes instead of being destroyed in place
+    VgeDeletionQueue& getDeletionQueue() {
+        return *deletionQueue;
+    }
+    VgeFrameScheduler& getFrameScheduler() {
+        return *frameScheduler;
+    }
+    VgeJobSystem& getJobSystem() {
+        return *jobSystem;
+    }
 
     // Buffer Helper Functions
+    // Memory comes from the sub-allocator; pure staging buffers use its linear pages
     void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-                      VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-    VkCommandBuffer beginSingleTimeCommands();
-    void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height,
-                           uint32_t layerCount);
+                      VkBuffer& buffer, VgeAllocation& allocation);
 
     void createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties,
                              VkImage& image, VkDeviceMemory& imageMemory);
@@ -90,36 +168,54 @@ class VgeDevice {
     VkPhysicalDeviceProperties properties;
 
    private:
+    void init();
     void createInstance();
     void setupDebugMessenger();
     void createSurface();
     void pickPhysicalDevice();
     void createLogicalDevice();
     void createCommandPool();
+    void createBindlessRegistry();
 
     // helper functions
     bool isDeviceSuitable(VkPhysicalDevice device);
+    bool supportsTimelineSemaphores(VkPhysicalDevice device);
     std::vector<const char*> getRequiredExtensions();
     bool checkValidationLayerSupport();
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
     void hasGflwRequiredInstanceExtensions();
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    std::vector<const char*> getDeviceExtensions() const;
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-    Window& window;
+    Window* window = nullptr;
+    bool computeOnly = false;
     VkCommandPool commandPool;
+    std::unique_ptr<VgeTransferManager> transferManager;
 
     VkDevice device_;
-    VkSurfaceKHR surface_;
+    std::unique_ptr<VgeDeletionQueue> deletionQueue;
+    std::unique_ptr<VgeFrameScheduler> frameScheduler;
+    std::unique_ptr<VgeMemoryAllocator> allocator;
+    std::unique_ptr<VgePipelineCache> pipelineCache;
+    std::unique_ptr<VgeShaderRegistry> shaderRegistry;
+    std::unique_ptr<VgeDescriptorLayoutCache> descriptorLayoutCache;
+    std::unique_ptr<VgeBindlessRegistry> bindlessRegistry;
+    std::unique_ptr<VgePipelineCompiler> pipelineCompiler;
+    std::unique_ptr<VgeJobSystem> jobSystem;
+    VkSurfaceKHR surface_ = VK_NULL_HANDLE;
     VkQueue graphicsQueue_;
     VkQueue presentQueue_;
+    VkQueue transferQueue_;
+    bool wireframeSupported = false;
+    bool bindlessSupported = false;
+    bool multiDrawIndirectSupported = false;
 
     const std::vector<const char*> validationLayers = {"VK_LAYER_KHRONOS_validation"};
-    const std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 };
 
 }  // namespace vge
@@ -0,0 +1,53 @@
+#include "FrameScheduler.h"
+
+// std
+#include <stdexcept>
+
+namespace vge {
+
+VgeFrameScheduler::VgeFrameScheduler(VkDevice device) : device{device} {
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &timeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create frame timeline semaphore!!!");
+    }
+}
+
+VgeFrameScheduler::~VgeFrameScheduler() {
+    vkDestroySemaphore(device, timeline, nullptr);
+}
+
+uint64_t VgeFrameScheduler::beginFrame() {
+    return ++currentFrame;
+}
+
+uint64_t VgeFrameScheduler::getCompletedFrame() const {
+    uint64_t value = 0;
+    if (vkGetSemaphoreCounterValue(device, timeline, &value) != VK_SUCCESS) {
+        throw std::runtime_error("failed to read frame timeline semaphore!!!");
+    }
+    return value;
+}
+
+bool VgeFrameScheduler::waitForFrame(uint64_t frame, uint64_t timeout) const {
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timeline;
+    waitInfo.pValues = &frame;
+
+    VkResult result = vkWaitSemaphores(device, &waitInfo, timeout);
+    if (result != VK_SUCCESS && result != VK_TIMEOUT) {
+        throw std::runtime_error("failed to wait on frame timeline semaphore!!!");
+    }
+    return result == VK_SUCCESS;
+}
+
+}  // namespace vge
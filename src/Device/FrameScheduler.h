@@ -0,0 +1,48 @@
+#pragma once
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+
+namespace vge {
+
+// One timeline semaphore counting frames. Frame N is the N-th frame begun, and the submit that
+// ends it signals the semaphore to N, so the semaphore value is the newest frame the GPU has
+// finished. Anything that needs to know whether the GPU is done with a frame polls or waits on
+// that value instead of holding a fence per frame in flight.
+class VgeFrameScheduler {
+public:
+    explicit VgeFrameScheduler(VkDevice device);
+    ~VgeFrameScheduler();
+
+    VgeFrameScheduler(const VgeFrameScheduler&) = delete;
+    VgeFrameScheduler& operator=(const VgeFrameScheduler&) = delete;
+
+    // Moves on to the next frame and returns its number, only once its submit is certain
+    uint64_t beginFrame();
+
+    // Frame being recorded, or the last one submitted between frames. 0 before the first frame.
+    uint64_t getCurrentFrame() const {
+        return currentFrame;
+    }
+    // Newest frame the GPU has finished, never blocks
+    uint64_t getCompletedFrame() const;
+    bool isFrameComplete(uint64_t frame) const {
+        return getCompletedFrame() >= frame;
+    }
+    // Returns false when the timeout (in nanoseconds) runs out first
+    bool waitForFrame(uint64_t frame, uint64_t timeout = UINT64_MAX) const;
+
+    // Submits signal this with the current frame number, once per frame
+    VkSemaphore getSemaphore() const {
+        return timeline;
+    }
+
+private:
+    VkDevice device;
+    VkSemaphore timeline = VK_NULL_HANDLE;
+    uint64_t currentFrame = 0;
+};
+
+}  // namespace vge
@@ -0,0 +1,104 @@
+#include "JobSystem.h"
+
+// std
+#include <algorithm>
+
+namespace vge {
+
+VgeJobSystem::VgeJobSystem(uint32_t workerCount) {
+    if (workerCount == 0) {
+        // The submitting thread is the last one, it runs jobs while it waits
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    for (uint32_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(&VgeJobSystem::workerLoop, this, i + 1);
+    }
+}
+
+VgeJobSystem::~VgeJobSystem() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    batchAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void VgeJobSystem::parallelFor(uint32_t count, const Job& job) {
+    // Waking the workers costs more than a single job
+    if (count <= 1 || workers.empty()) {
+        for (uint32_t i = 0; i < count; i++) {
+            job(i, 0);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> submitLock{submitMutex};
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        batchJob = &job;
+        batchCount = count;
+        nextIndex.store(0, std::memory_order_relaxed);
+        busyWorkers = static_cast<uint32_t>(workers.size());
+        batchError = nullptr;
+        generation++;
+    }
+    batchAvailable.notify_all();
+
+    runBatch(0);
+
+    std::exception_ptr error;
+    {
+        // Every worker checks in, so none can still be reading the batch once this returns
+        std::unique_lock<std::mutex> lock{mutex};
+        batchFinished.wait(lock, [this] { return busyWorkers == 0; });
+        batchJob = nullptr;
+        error = std::move(batchError);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void VgeJobSystem::runBatch(uint32_t threadIndex) {
+    for (uint32_t i = nextIndex.fetch_add(1); i < batchCount; i = nextIndex.fetch_add(1)) {
+        try {
+            (*batchJob)(i, threadIndex);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (!batchError) {
+                batchError = std::current_exception();
+            }
+        }
+    }
+}
+
+void VgeJobSystem::workerLoop(uint32_t threadIndex) {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            batchAvailable.wait(lock,
+                                [&] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        runBatch(threadIndex);
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            last = --busyWorkers == 0;
+        }
+        if (last) {
+            batchFinished.notify_one();
+        }
+    }
+}
+
+}  // namespace vge
@@ -0,0 +1,58 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vge {
+
+// Runs batches of short jobs across a pool of worker threads, for work that is split up every
+// frame such as recording command buffers. The thread that submits a batch works through it
+// alongside the workers and returns once every job has finished.
+class VgeJobSystem {
+public:
+    // Called with the job's index in the batch and the index of the thread running it. Thread 0
+    // is the one that submitted the batch, workers are 1 to getThreadCount() - 1.
+    using Job = std::function<void(uint32_t index, uint32_t threadIndex)>;
+
+    explicit VgeJobSystem(uint32_t workerCount = 0);
+    ~VgeJobSystem();
+
+    VgeJobSystem(const VgeJobSystem&) = delete;
+    VgeJobSystem& operator=(const VgeJobSystem&) = delete;
+
+    // Runs job for every index below count. The first exception thrown by a job is rethrown
+    // here once the batch has finished. Batches from several threads run one after another.
+    void parallelFor(uint32_t count, const Job& job);
+
+    uint32_t getThreadCount() const {
+        return static_cast<uint32_t>(workers.size()) + 1;
+    }
+
+private:
+    void workerLoop(uint32_t threadIndex);
+    void runBatch(uint32_t threadIndex);
+
+    std::vector<std::thread> workers;
+    std::mutex submitMutex;
+
+    // The current batch, published under mutex by bumping generation
+    const Job* batchJob = nullptr;
+    uint32_t batchCount = 0;
+    std::atomic<uint32_t> nextIndex{0};
+    uint64_t generation = 0;
+    uint32_t busyWorkers = 0;
+    std::exception_ptr batchError;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable batchAvailable;
+    std::condition_variable batchFinished;
+};
+
+}  // namespace vge
@@ -0,0 +1,439 @@
+#include "TransferManager.h"
+
+#include "../Buffer/Buffer.h"
+#include "Device.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace vge {
+
+// Copy regions in the ring start on this boundary
+static constexpr VkDeviceSize RING_ALIGNMENT = 16;
+
+VgeTransferManager::VgeTransferManager(VgeDevice& device, bool useDedicatedQueue,
+                                       VkDeviceSize ringSize)
+    : vgeDevice{device}, ringSize{ringSize} {
+    dedicatedQueue = useDedicatedQueue && device.hasDedicatedTransferQueue();
+
+    QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
+    graphicsFamily = indices.graphicsFamily;
+    transferFamily = dedicatedQueue ? indices.transferFamily : indices.graphicsFamily;
+    transferQueue = dedicatedQueue ? device.transferQueue() : device.graphicsQueue();
+
+    createCommandPools();
+    createTimeline();
+
+    stagingRing = std::make_unique<VgeBuffer>(
+        device, 1, static_cast<uint32_t>(ringSize), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    stagingRing->map();
+    ringData = static_cast<char*>(stagingRing->getMappedMemory());
+}
+
+VgeTransferManager::~VgeTransferManager() {
+    waitIdle();
+
+    for (auto& batch : freeBatches) {
+        destroyBatch(*batch);
+    }
+    stagingRing.reset();
+
+    vkDestroySemaphore(vgeDevice.device(), timeline, nullptr);
+    vkDestroyCommandPool(vgeDevice.device(), transferCommandPool, nullptr);
+    if (acquireCommandPool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(vgeDevice.device(), acquireCommandPool, nullptr);
+    }
+}
+
+void VgeTransferManager::createCommandPools() {
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = transferFamily;
+    poolInfo.flags =
+        VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    if (vkCreateCommandPool(vgeDevice.device(), &poolInfo, nullptr, &transferCommandPool) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create transfer command pool!!!");
+    }
+
+    if (dedicatedQueue) {
+        poolInfo.queueFamilyIndex = graphicsFamily;
+        if (vkCreateCommandPool(vgeDevice.device(), &poolInfo, nullptr, &acquireCommandPool) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create transfer acquire command pool!!!");
+        }
+    }
+}
+
+void VgeTransferManager::createTimeline() {
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(vgeDevice.device(), &semaphoreInfo, nullptr, &timeline) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create transfer timeline semaphore!!!");
+    }
+}
+
+std::unique_ptr<VgeTransferManager::Batch> VgeTransferManager::createBatch() {
+    auto batch = std::make_unique<Batch>();
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = transferCommandPool;
+    allocInfo.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(vgeDevice.device(), &allocInfo, &batch->transferCommands) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate transfer command buffer!!!");
+    }
+
+    if (dedicatedQueue) {
+        allocInfo.commandPool = acquireCommandPool;
+        if (vkAllocateCommandBuffers(vgeDevice.device(), &allocInfo, &batch->acquireCommands) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate transfer acquire command buffer!!!");
+        }
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        if (vkCreateSemaphore(vgeDevice.device(), &semaphoreInfo, nullptr,
+                              &batch->transferDone) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create transfer semaphore!!!");
+        }
+    }
+
+    return batch;
+}
+
+void VgeTransferManager::destroyBatch(Batch& batch) {
+    vkFreeCommandBuffers(vgeDevice.device(), transferCommandPool, 1, &batch.transferCommands);
+    if (dedicatedQueue) {
+        vkFreeCommandBuffers(vgeDevice.device(), acquireCommandPool, 1, &batch.acquireCommands);
+        vkDestroySemaphore(vgeDevice.device(), batch.transferDone, nullptr);
+    }
+}
+
+VgeTransferManager::Batch& VgeTransferManager::getOpenBatch() {
+    if (openBatch) {
+        return *openBatch;
+    }
+
+    if (freeBatches.empty()) {
+        openBatch = createBatch();
+    } else {
+        openBatch = std::move(freeBatches.back());
+        freeBatches.pop_back();
+        vkResetCommandBuffer(openBatch->transferCommands, 0);
+        if (dedicatedQueue) {
+            vkResetCommandBuffer(openBatch->acquireCommands, 0);
+        }
+    }
+
+    openBatch->ringEnd = ringHead;
+    openBatch->ringBytes = 0;
+    openBatch->ownershipTransfers.clear();
+    openBatch->graphicsCommands.clear();
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(openBatch->transferCommands, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording transfer command buffer!!!");
+    }
+    return *openBatch;
+}
+
+VkDeviceSize VgeTransferManager::reserveRing(VkDeviceSize size) {
+    size = (size + RING_ALIGNMENT - 1) / RING_ALIGNMENT * RING_ALIGNMENT;
+    assert(size <= ringSize && "Upload chunk larger than the staging ring");
+
+    while (true) {
+        if (ringUsed == 0) {
+            ringHead = 0;
+            ringTail = 0;
+        }
+
+        bool full = ringUsed > 0 && ringHead == ringTail;
+        VkDeviceSize skipped = 0;
+        VkDeviceSize offset = 0;
+        bool fits = false;
+        if (!full && ringHead >= ringTail) {
+            // Free space is the end of the ring plus the start up to the tail
+            if (ringSize - ringHead >= size) {
+                offset = ringHead;
+                fits = true;
+            } else if (ringTail >= size) {
+                skipped = ringSize - ringHead;
+                offset = 0;
+                fits = true;
+            }
+        } else if (!full && ringTail - ringHead >= size) {
+            offset = ringHead;
+            fits = true;
+        }
+
+        if (fits) {
+            Batch& batch = getOpenBatch();
+            ringHead = offset + size;
+            ringUsed += skipped + size;
+            batch.ringBytes += skipped + size;
+            batch.ringEnd = ringHead;
+            return offset;
+        }
+
+        // Out of space, push out what is pending and wait for the oldest batch to finish
+        stats.ringStalls++;
+        if (openBatch && openBatch->ringBytes > 0) {
+            flushLocked();
+        }
+        retireCompleted(true);
+    }
+}
+
+void VgeTransferManager::recordOwnershipTransfer(Batch& batch, VkBuffer buffer,
+                                                 VkDeviceSize offset, VkDeviceSize size) {
+    // Chunks of one large upload extend the previous barrier
+    if (!batch.ownershipTransfers.empty()) {
+        VkBufferMemoryBarrier& last = batch.ownershipTransfers.back();
+        if (last.buffer == buffer && last.offset + last.size == offset) {
+            last.size += size;
+            return;
+        }
+    }
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = transferFamily;
+    barrier.dstQueueFamilyIndex = graphicsFamily;
+    barrier.buffer = buffer;
+    barrier.offset = offset;
+    barrier.size = size;
+    batch.ownershipTransfers.push_back(barrier);
+}
+
+uint64_t VgeTransferManager::upload(VkBuffer dstBuffer, const void* data, VkDeviceSize size,
+                                    VkDeviceSize dstOffset) {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    const char* source = static_cast<const char*>(data);
+    while (size > 0) {
+        VkDeviceSize chunk = std::min(size, ringSize / 2);
+        VkDeviceSize ringOffset = reserveRing(chunk);
+        Batch& batch = getOpenBatch();
+
+        memcpy(ringData + ringOffset, source, chunk);
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = ringOffset;
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size = chunk;
+        vkCmdCopyBuffer(batch.transferCommands, stagingRing->getBuffer(), dstBuffer, 1,
+                        &copyRegion);
+        if (dedicatedQueue) {
+            recordOwnershipTransfer(batch, dstBuffer, dstOffset, chunk);
+        }
+
+        stats.uploads++;
+        stats.bytesUploaded += chunk;
+        source += chunk;
+        dstOffset += chunk;
+        size -= chunk;
+    }
+
+    return submittedTicket + 1;
+}
+
+uint64_t VgeTransferManager::recordGraphics(std::function<void(VkCommandBuffer)> commands) {
+    std::lock_guard<std::mutex> lock{mutex};
+    Batch& batch = getOpenBatch();
+
+    // Without a dedicated queue the batch already runs on the graphics queue
+    if (dedicatedQueue) {
+        batch.graphicsCommands.push_back(std::move(commands));
+    } else {
+        commands(batch.transferCommands);
+    }
+    return submittedTicket + 1;
+}
+
+uint64_t VgeTransferManager::flush() {
+    std::lock_guard<std::mutex> lock{mutex};
+    return flushLocked();
+}
+
+uint64_t VgeTransferManager::flushLocked() {
+    if (!openBatch) {
+        return submittedTicket;
+    }
+    Batch& batch = *openBatch;
+
+    if (dedicatedQueue) {
+        // Release on the transfer queue, then acquire on the graphics queue once the copies
+        // are done, so later graphics submits are ordered after the upload
+        for (auto& barrier : batch.ownershipTransfers) {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+        }
+        vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+                             static_cast<uint32_t>(batch.ownershipTransfers.size()),
+                             batch.ownershipTransfers.data(), 0, nullptr);
+    } else {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0,
+                             nullptr);
+    }
+
+    if (vkEndCommandBuffer(batch.transferCommands) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record transfer command buffer!!!");
+    }
+
+    // The last submit of the batch signals the timeline to its ticket
+    uint64_t ticket = submittedTicket + 1;
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &ticket;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.transferCommands;
+
+    if (!dedicatedQueue) {
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &timeline;
+        if (vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit transfer command buffer!!!");
+        }
+    } else {
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &batch.transferDone;
+        if (vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit transfer command buffer!!!");
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(batch.acquireCommands, &beginInfo);
+        for (auto& barrier : batch.ownershipTransfers) {
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        }
+        vkCmdPipelineBarrier(batch.acquireCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+                             static_cast<uint32_t>(batch.ownershipTransfers.size()),
+                             batch.ownershipTransfers.data(), 0, nullptr);
+        for (auto& commands : batch.graphicsCommands) {
+            commands(batch.acquireCommands);
+        }
+        batch.graphicsCommands.clear();
+        if (vkEndCommandBuffer(batch.acquireCommands) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record transfer acquire command buffer!!!");
+        }
+
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkSubmitInfo acquireInfo{};
+        acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        acquireInfo.waitSemaphoreCount = 1;
+        acquireInfo.pWaitSemaphores = &batch.transferDone;
+        acquireInfo.pWaitDstStageMask = &waitStage;
+        acquireInfo.commandBufferCount = 1;
+        acquireInfo.pCommandBuffers = &batch.acquireCommands;
+        acquireInfo.pNext = &timelineInfo;
+        acquireInfo.signalSemaphoreCount = 1;
+        acquireInfo.pSignalSemaphores = &timeline;
+        if (vkQueueSubmit(vgeDevice.graphicsQueue(), 1, &acquireInfo, VK_NULL_HANDLE) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to submit transfer acquire command buffer!!!");
+        }
+    }
+
+    batch.ticket = ticket;
+    submittedTicket = ticket;
+    inFlight.push_back(std::move(openBatch));
+    stats.submits++;
+    return submittedTicket;
+}
+
+void VgeTransferManager::retireCompleted(bool waitForOldest) {
+    if (inFlight.empty()) {
+        return;
+    }
+
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(vgeDevice.device(), timeline, &completed);
+    while (!inFlight.empty()) {
+        Batch& batch = *inFlight.front();
+        if (batch.ticket > completed) {
+            if (!waitForOldest) {
+                break;
+            }
+            VkSemaphoreWaitInfo waitInfo{};
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &timeline;
+            waitInfo.pValues = &batch.ticket;
+            vkWaitSemaphores(vgeDevice.device(), &waitInfo, UINT64_MAX);
+            completed = batch.ticket;
+            waitForOldest = false;
+        }
+
+        ringTail = batch.ringEnd;
+        ringUsed -= batch.ringBytes;
+        completedTicket = batch.ticket;
+        freeBatches.push_back(std::move(inFlight.front()));
+        inFlight.pop_front();
+    }
+}
+
+bool VgeTransferManager::isComplete(uint64_t ticket) {
+    std::lock_guard<std::mutex> lock{mutex};
+    retireCompleted(false);
+    return ticket <= completedTicket;
+}
+
+void VgeTransferManager::wait(uint64_t ticket) {
+    std::lock_guard<std::mutex> lock{mutex};
+    waitLocked(ticket);
+}
+
+void VgeTransferManager::waitLocked(uint64_t ticket) {
+    if (ticket > submittedTicket) {
+        flushLocked();
+    }
+    while (completedTicket < ticket && !inFlight.empty()) {
+        retireCompleted(true);
+    }
+}
+
+void VgeTransferManager::waitIdle() {
+    std::lock_guard<std::mutex> lock{mutex};
+    waitLocked(submittedTicket + 1);
+}
+
+VgeTransferManager::Stats VgeTransferManager::getStats() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return stats;
+}
+
+}  // namespace vge
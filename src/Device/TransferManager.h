@@ -0,0 +1,117 @@
+#pragma once
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vge {
+
+class VgeDevice;
+class VgeBuffer;
+
+// Batches buffer uploads into a few submits instead of one blocking submit per copy. Data is
+// copied into a persistent host visible staging ring and the copy is recorded into the open
+// batch; flush() submits the batch, on a dedicated transfer queue when the device has one.
+// Every upload returns a ticket. Tickets grow monotonically, so waiting on one also covers all
+// earlier uploads. Work submitted to the graphics queue after a flush sees the uploaded data
+// without waiting on anything. Tickets are the values of a timeline semaphore, so the host can
+// poll them and submits on other queues can wait on one.
+class VgeTransferManager {
+public:
+    static constexpr VkDeviceSize DEFAULT_RING_SIZE = 32 * 1024 * 1024;
+
+    struct Stats {
+        uint64_t submits = 0;
+        uint64_t uploads = 0;
+        uint64_t bytesUploaded = 0;
+        uint64_t ringStalls = 0;  // times an upload had to wait for the GPU to free ring space
+    };
+
+    VgeTransferManager(VgeDevice& device, bool useDedicatedQueue,
+                       VkDeviceSize ringSize = DEFAULT_RING_SIZE);
+    ~VgeTransferManager();
+
+    VgeTransferManager(const VgeTransferManager&) = delete;
+    VgeTransferManager& operator=(const VgeTransferManager&) = delete;
+
+    // Copies size bytes of data into dstBuffer at dstOffset. Uploads larger than the ring are
+    // split over several batches.
+    uint64_t upload(VkBuffer dstBuffer, const void* data, VkDeviceSize size,
+                    VkDeviceSize dstOffset = 0);
+
+    // Adds commands that need the graphics queue to the open batch, such as image uploads that
+    // transition the image for sampling. They run on the graphics queue after the batch's copies
+    // and are recorded by flush() with a dedicated transfer queue, right away otherwise.
+    uint64_t recordGraphics(std::function<void(VkCommandBuffer)> commands);
+
+    // Submits the open batch if it has any copies and returns the newest ticket
+    uint64_t flush();
+    bool isComplete(uint64_t ticket);
+    void wait(uint64_t ticket);
+    void waitIdle();
+
+    // Signaled to each ticket once its batch is done
+    VkSemaphore getTimelineSemaphore() const {
+        return timeline;
+    }
+    bool usesDedicatedQueue() const {
+        return dedicatedQueue;
+    }
+    Stats getStats() const;
+
+private:
+    struct Batch {
+        VkCommandBuffer transferCommands = VK_NULL_HANDLE;
+        VkCommandBuffer acquireCommands = VK_NULL_HANDLE;  // dedicated queue only
+        VkSemaphore transferDone = VK_NULL_HANDLE;         // dedicated queue only
+        uint64_t ticket = 0;
+        VkDeviceSize ringEnd = 0;
+        VkDeviceSize ringBytes = 0;  // includes space skipped when wrapping around
+        std::vector<VkBufferMemoryBarrier> ownershipTransfers;
+        std::vector<std::function<void(VkCommandBuffer)>> graphicsCommands;  // dedicated only
+    };
+
+    void createCommandPools();
+    void createTimeline();
+    std::unique_ptr<Batch> createBatch();
+    void destroyBatch(Batch& batch);
+    Batch& getOpenBatch();
+    VkDeviceSize reserveRing(VkDeviceSize size);
+    void recordOwnershipTransfer(Batch& batch, VkBuffer buffer, VkDeviceSize offset,
+                                 VkDeviceSize size);
+    uint64_t flushLocked();
+    void retireCompleted(bool waitForOldest);
+    void waitLocked(uint64_t ticket);
+
+    VgeDevice& vgeDevice;
+    bool dedicatedQueue;
+    VkQueue transferQueue;
+    uint32_t transferFamily;
+    uint32_t graphicsFamily;
+    VkCommandPool transferCommandPool = VK_NULL_HANDLE;
+    VkCommandPool acquireCommandPool = VK_NULL_HANDLE;
+    VkSemaphore timeline = VK_NULL_HANDLE;
+
+    std::unique_ptr<VgeBuffer> stagingRing;
+    char* ringData = nullptr;
+    VkDeviceSize ringSize;
+    VkDeviceSize ringHead = 0;
+    VkDeviceSize ringTail = 0;
+    VkDeviceSize ringUsed = 0;
+
+    std::unique_ptr<Batch> openBatch;
+    std::deque<std::unique_ptr<Batch>> inFlight;
+    std::vector<std::unique_ptr<Batch>> freeBatches;
+    uint64_t submittedTicket = 0;
+    uint64_t completedTicket = 0;
+
+    Stats stats{};
+    mutable std::mutex mutex;
+};
+
+}  // namespace vge
@@ -9,6 +9,8 @@
 
 namespace vge {
 
+class VgeFrameAllocator;
+
 #define MAX_LIGHTS 10
 
 struct PointLight {
@@ -33,5 +35,7 @@ struct FrameInfo {
     Camera& camera;
     VkDescriptorSet globalDescriptorSet;
     GameObject::Map& gameObjects;
+    VgeFrameAllocator& frameAllocator;
+    uint32_t globalUboOffset;  // dynamic offset to bind globalDescriptorSet with
 };
 }  // namespace vge
@@ -51,6 +51,9 @@ class GameObject {
 
     glm::vec3 color{};
     TransformComponent transform{};
+    // Drawn from commands that are recorded once and replayed, see RenderSystem::renderStatic.
+    // Such objects may still move, but every move costs a rebuild of all static draws.
+    bool isStatic = false;
 
     // Optional pointer components
     std::shared_ptr<Model> model{};
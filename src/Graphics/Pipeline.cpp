@@ -3,25 +3,19 @@
 #include <vulkan/vulkan_core.h>
 
 #include <cassert>
+#include <chrono>
 #include <cstdint>
-#include <fstream>
 #include <iostream>
 #include <stdexcept>
 
 #include "../Models/Model.h"
-
-#ifndef ENGINE_DIR
-#define ENGINE_DIR "../"
-#endif
+#include "PipelineCache.h"
 
 namespace vge {
 
 Pipeline::Pipeline(VgeDevice& device, const std::string& vertFilepath,
                    const std::string& fragFilepath, const PipelineConfigInfo& configInfo)
     : vgeDevice{device},
-      vertShaderModule{VK_NULL_HANDLE},
-      fragShaderModule{VK_NULL_HANDLE},
-      compShaderModule{VK_NULL_HANDLE},
       graphicsPipeline{VK_NULL_HANDLE},
       computePipeline{VK_NULL_HANDLE} {
     createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
@@ -31,27 +25,12 @@ Pipeline::Pipeline(VgeDevice& device, const std::string& vertFilepath,
 Pipeline::Pipeline(VgeDevice& device, const std::string& compFilepath,
                    const PipelineConfigInfo& configInfo)
     : vgeDevice{device},
-      vertShaderModule{VK_NULL_HANDLE},
-      fragShaderModule{VK_NULL_HANDLE},
-      compShaderModule{VK_NULL_HANDLE},
       graphicsPipeline{VK_NULL_HANDLE},
       computePipeline{VK_NULL_HANDLE} {
     createComputePipeline(compFilepath, configInfo);
 }
 
 Pipeline::~Pipeline() {
-    if (vertShaderModule != VK_NULL_HANDLE) {
-        vkDestroyShaderModule(vgeDevice.device(), vertShaderModule, nullptr);
-        vertShaderModule = VK_NULL_HANDLE;
-    }
-    if (fragShaderModule != VK_NULL_HANDLE) {
-        vkDestroyShaderModule(vgeDevice.device(), fragShaderModule, nullptr);
-        fragShaderModule = VK_NULL_HANDLE;
-    }
-    if (compShaderModule != VK_NULL_HANDLE) {
-        vkDestroyShaderModule(vgeDevice.device(), compShaderModule, nullptr);
-        compShaderModule = VK_NULL_HANDLE;
-    }
     if (graphicsPipeline != VK_NULL_HANDLE) {
         vkDestroyPipeline(vgeDevice.device(), graphicsPipeline, nullptr);
         graphicsPipeline = VK_NULL_HANDLE;
@@ -62,25 +41,6 @@ Pipeline::~Pipeline() {
     }
 }
 
-std::vector<char> Pipeline::readFile(const std::string& filepath) {
-    std::string enginePath = ENGINE_DIR + filepath;
-    std::ifstream file{enginePath, std::ios::ate | std::ios::binary};
-
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open file: " + enginePath);
-    }
-
-    size_t fileSize = static_cast<size_t>(file.tellg());
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-
-    file.close();
-
-    return buffer;
-}
-
 void Pipeline::createGraphicsPipeline(const std::string& vertFilepath,
                                       const std::string& fragFilepath,
                                       const PipelineConfigInfo& configInfo) {
@@ -88,16 +48,16 @@ void Pipeline::createGraphicsPipeline(const std::string& vertFilepath,
            "Cannot create graphics pipeline:: no piplineLayout provided in configInfo");
     assert(configInfo.renderPass != VK_NULL_HANDLE &&
            "Cannot create graphics pipeline:: no renderPass provided in configInfo");
-    auto vertCode = readFile(vertFilepath);
-    auto fragCode = readFile(fragFilepath);
-
-    createShaderModule(vertCode, &vertShaderModule);
-    createShaderModule(fragCode, &fragShaderModule);
+    auto& shaders = vgeDevice.getShaderRegistry();
+    vertShader = shaders.load(vertFilepath);
+    fragShader = shaders.load(fragFilepath);
+    assert(vertShader->getStage() == VK_SHADER_STAGE_VERTEX_BIT && "Expected a vertex shader");
+    assert(fragShader->getStage() == VK_SHADER_STAGE_FRAGMENT_BIT && "Expected a fragment shader");
 
     VkPipelineShaderStageCreateInfo shaderStages[2];
     shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].module = vertShader->getModule();
     shaderStages[0].pName = "main";
     shaderStages[0].flags = 0;
     shaderStages[0].pNext = nullptr;
@@ -105,7 +65,7 @@ void Pipeline::createGraphicsPipeline(const std::string& vertFilepath,
 
     shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].module = fragShader->getModule();
     shaderStages[1].pName = "main";
     shaderStages[1].flags = 0;
     shaderStages[1].pNext = nullptr;
@@ -142,22 +102,26 @@ void Pipeline::createGraphicsPipeline(const std::string& vertFilepath,
     pipelineInfo.basePipelineIndex = -1;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(vgeDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
-                                  &graphicsPipeline) != VK_SUCCESS) {
+    auto& cache = vgeDevice.getPipelineCache();
+    auto start = std::chrono::high_resolution_clock::now();
+    if (vkCreateGraphicsPipelines(vgeDevice.device(), cache.getCache(), 1, &pipelineInfo,
+                                  nullptr, &graphicsPipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline");
     }
+    cache.recordPipelineCreation(std::chrono::duration<float, std::chrono::milliseconds::period>(
+                                     std::chrono::high_resolution_clock::now() - start)
+                                     .count());
 }
 
 void Pipeline::createComputePipeline(const std::string& compFilepath,
                                      const PipelineConfigInfo& configInfo) {
-    auto compCode = readFile(compFilepath);
-
-    createShaderModule(compCode, &compShaderModule);
+    compShader = vgeDevice.getShaderRegistry().load(compFilepath);
+    assert(compShader->getStage() == VK_SHADER_STAGE_COMPUTE_BIT && "Expected a compute shader");
 
     VkPipelineShaderStageCreateInfo shaderStage{};
     shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-    shaderStage.module = compShaderModule;
+    shaderStage.module = compShader->getModule();
     shaderStage.pName = "main";
 
     VkComputePipelineCreateInfo pipelineInfo{};
@@ -167,22 +131,15 @@ void Pipeline::createComputePipeline(const std::string& compFilepath,
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    if (vkCreateComputePipelines(vgeDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
+    auto& cache = vgeDevice.getPipelineCache();
+    auto start = std::chrono::high_resolution_clock::now();
+    if (vkCreateComputePipelines(vgeDevice.device(), cache.getCache(), 1, &pipelineInfo, nullptr,
                                  &computePipeline) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create compute pipeline!!!");
     }
-}
-
-void Pipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule) {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-    if (vkCreateShaderModule(vgeDevice.device(), &createInfo, nullptr, shaderModule) !=
-        VK_SUCCESS) {
-        throw std::runtime_error("failed to create shader module");
-    }
+    cache.recordPipelineCreation(std::chrono::duration<float, std::chrono::milliseconds::period>(
+                                     std::chrono::high_resolution_clock::now() - start)
+                                     .count());
 }
 
 void Pipeline::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint) {
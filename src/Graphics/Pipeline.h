@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../Device/Device.h"
+#include "ShaderRegistry.h"
 
 // std
 #include <vulkan/vulkan_core.h>
@@ -55,8 +56,6 @@ class Pipeline {
     static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
 
    private:
-    static std::vector<char> readFile(const std::string& filepath);
-
     // Functions for creating graphics and compute pipelines
     void createGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath,
                                 const PipelineConfigInfo& configInfo);
@@ -64,13 +63,12 @@ class Pipeline {
     void createComputePipeline(const std::string& compFilepath,
                                const PipelineConfigInfo& configInfo);
 
-    void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
-
     VgeDevice& vgeDevice;
     VkPipeline graphicsPipeline;
     VkPipeline computePipeline;
-    VkShaderModule vertShaderModule;
-    VkShaderModule fragShaderModule;
-    VkShaderModule compShaderModule;
+    // Shared through the device's shader registry
+    ShaderHandle vertShader;
+    ShaderHandle fragShader;
+    ShaderHandle compShader;
 };
 }  // namespace vge
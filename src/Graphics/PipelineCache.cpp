@@ -0,0 +1,133 @@
+#include "PipelineCache.h"
+
+// std
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace vge {
+
+VgePipelineCache::VgePipelineCache(VkDevice device, const VkPhysicalDeviceProperties& properties,
+                                   std::string filepath)
+    : device{device}, properties{properties}, filepath{std::move(filepath)} {
+    std::vector<char> initialData = loadFromDisk();
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = initialData.size();
+    createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+    if (vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!!!");
+    }
+
+    stats.loadedFromDisk = !initialData.empty();
+    stats.loadedBytes = initialData.size();
+}
+
+VgePipelineCache::~VgePipelineCache() {
+    save();
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
+}
+
+std::vector<char> VgePipelineCache::loadFromDisk() const {
+    std::error_code error;
+    uintmax_t fileSize = std::filesystem::file_size(filepath, error);
+    std::ifstream file{filepath, std::ios::binary};
+    if (error || !file.is_open()) {
+        return {};
+    }
+
+    FileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.driverVersion != properties.driverVersion) {
+        std::cout << "pipeline cache: ignoring stale " << filepath << std::endl;
+        return {};
+    }
+
+    // A truncated or corrupt header must not make us allocate whatever dataSize claims
+    if (fileSize < sizeof(header) || header.dataSize != fileSize - sizeof(header)) {
+        std::cout << "pipeline cache: ignoring truncated " << filepath << std::endl;
+        return {};
+    }
+
+    std::vector<char> data(header.dataSize);
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!file || !isCompatible(data)) {
+        std::cout << "pipeline cache: ignoring stale " << filepath << std::endl;
+        return {};
+    }
+    return data;
+}
+
+bool VgePipelineCache::isCompatible(const std::vector<char>& data) const {
+    VkPipelineCacheHeaderVersionOne header{};
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+
+    return header.headerSize >= sizeof(header) &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+           memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void VgePipelineCache::save() {
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS ||
+        dataSize == 0) {
+        return;
+    }
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+        return;
+    }
+
+    FileHeader header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.driverVersion = properties.driverVersion;
+    header.dataSize = dataSize;
+
+    // Write next to the old file and swap, a crash mid write must not leave a torn cache
+    std::string tempPath = filepath + ".tmp";
+    {
+        std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+        if (!file.is_open()) {
+            std::cerr << "pipeline cache: failed to write " << tempPath << std::endl;
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(data.data(), static_cast<std::streamsize>(dataSize));
+        if (!file) {
+            std::cerr << "pipeline cache: failed to write " << tempPath << std::endl;
+            return;
+        }
+    }
+
+    // Replaces an existing cache file, on Windows too
+    std::error_code error;
+    std::filesystem::rename(tempPath, filepath, error);
+    if (error) {
+        std::cerr << "pipeline cache: failed to replace " << filepath << ": " << error.message()
+                  << std::endl;
+        std::filesystem::remove(tempPath, error);
+    }
+}
+
+void VgePipelineCache::recordPipelineCreation(float milliseconds) {
+    std::lock_guard<std::mutex> lock{mutex};
+    stats.pipelinesCreated++;
+    stats.creationTime += milliseconds;
+}
+
+VgePipelineCache::Stats VgePipelineCache::getStats() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return stats;
+}
+
+}  // namespace vge
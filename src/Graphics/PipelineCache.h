@@ -0,0 +1,65 @@
+#pragma once
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vge {
+
+// Device wide VkPipelineCache that survives restarts. The blob saved on exit is loaded again on
+// the next launch if it was written by the same driver for the same device; anything else is
+// thrown away and the cache starts empty. Pipelines also report how long creation took so the
+// effect of a warm cache can be read off the stats.
+class VgePipelineCache {
+public:
+    struct Stats {
+        bool loadedFromDisk = false;
+        size_t loadedBytes = 0;
+        uint32_t pipelinesCreated = 0;
+        float creationTime = 0.0f;  // ms spent in vkCreate*Pipelines
+    };
+
+    VgePipelineCache(VkDevice device, const VkPhysicalDeviceProperties& properties,
+                     std::string filepath);
+    ~VgePipelineCache();
+
+    VgePipelineCache(const VgePipelineCache&) = delete;
+    VgePipelineCache& operator=(const VgePipelineCache&) = delete;
+
+    VkPipelineCache getCache() const {
+        return pipelineCache;
+    }
+
+    void save();
+    void recordPipelineCreation(float milliseconds);
+    Stats getStats() const;
+
+private:
+    // Written in front of the driver's blob, the blob's own header is checked as well
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t driverVersion;
+        uint64_t dataSize;
+    };
+
+    static constexpr char MAGIC[4] = {'V', 'G', 'P', 'C'};
+    static constexpr uint32_t VERSION = 1;
+
+    std::vector<char> loadFromDisk() const;
+    bool isCompatible(const std::vector<char>& data) const;
+
+    VkDevice device;
+    VkPhysicalDeviceProperties properties;
+    std::string filepath;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
+    Stats stats{};
+    mutable std::mutex mutex;
+};
+
+}  // namespace vge
@@ -0,0 +1,90 @@
+#include "PipelineCompiler.h"
+
+// std
+#include <algorithm>
+
+namespace vge {
+
+VgePipelineCompiler::VgePipelineCompiler(VgeDevice& device, uint32_t workerCount)
+    : vgeDevice{device} {
+    if (workerCount == 0) {
+        // Leave a core for the thread that is constructing the scene
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    for (uint32_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(&VgePipelineCompiler::workerLoop, this);
+    }
+}
+
+VgePipelineCompiler::~VgePipelineCompiler() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+PendingPipeline VgePipelineCompiler::compileGraphics(
+    std::string vertFilepath, std::string fragFilepath,
+    std::unique_ptr<PipelineConfigInfo> configInfo) {
+    // std::function needs a copyable callable, so the config travels in a shared_ptr
+    std::shared_ptr<PipelineConfigInfo> config = std::move(configInfo);
+    return enqueue([this, vertFilepath, fragFilepath, config] {
+        return std::make_unique<Pipeline>(vgeDevice, vertFilepath, fragFilepath, *config);
+    });
+}
+
+PendingPipeline VgePipelineCompiler::compileCompute(
+    std::string compFilepath, std::unique_ptr<PipelineConfigInfo> configInfo) {
+    std::shared_ptr<PipelineConfigInfo> config = std::move(configInfo);
+    return enqueue([this, compFilepath, config] {
+        return std::make_unique<Pipeline>(vgeDevice, compFilepath, *config);
+    });
+}
+
+PendingPipeline VgePipelineCompiler::enqueue(std::function<std::unique_ptr<Pipeline>()> build) {
+    auto task =
+        std::make_shared<std::packaged_task<std::unique_ptr<Pipeline>()>>(std::move(build));
+    PendingPipeline pending{task->get_future()};
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        jobs.emplace_back([task] { (*task)(); });
+    }
+    jobAvailable.notify_one();
+    return pending;
+}
+
+void VgePipelineCompiler::waitIdle() {
+    std::unique_lock<std::mutex> lock{mutex};
+    idle.wait(lock, [this] { return jobs.empty() && activeJobs == 0; });
+}
+
+void VgePipelineCompiler::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            activeJobs++;
+        }
+
+        // Exceptions end up in the future and are rethrown on the thread that waits for it
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            activeJobs--;
+        }
+        idle.notify_all();
+    }
+}
+
+}  // namespace vge
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Pipeline.h"
+
+// std
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vge {
+
+// A pipeline that is being compiled on a worker thread. The first access waits for the
+// compilation, later accesses are free.
+class PendingPipeline {
+public:
+    PendingPipeline() = default;
+    explicit PendingPipeline(std::future<std::unique_ptr<Pipeline>> future)
+        : future{std::move(future)} {}
+    ~PendingPipeline() {
+        wait();
+    }
+
+    PendingPipeline(PendingPipeline&&) = default;
+    PendingPipeline& operator=(PendingPipeline&& other) {
+        wait();
+        future = std::move(other.future);
+        pipeline = std::move(other.pipeline);
+        return *this;
+    }
+
+    Pipeline& get() {
+        if (future.valid()) {
+            pipeline = future.get();
+        }
+        return *pipeline;
+    }
+    Pipeline* operator->() {
+        return &get();
+    }
+    explicit operator bool() const {
+        return future.valid() || pipeline != nullptr;
+    }
+    // True once get() would return without blocking
+    bool isReady() const {
+        return pipeline != nullptr ||
+               (future.valid() &&
+                future.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    }
+
+private:
+    // A worker must not outlive the layouts and device it compiles against
+    void wait() {
+        if (future.valid()) {
+            future.wait();
+        }
+    }
+
+    std::future<std::unique_ptr<Pipeline>> future;
+    std::unique_ptr<Pipeline> pipeline;
+};
+
+// Compiles pipelines on a pool of worker threads. Systems queue their pipelines while they are
+// being constructed and carry on with the rest of their setup, so all pipelines of a scene are
+// compiled at the same time. Compilation goes through the device's pipeline cache, which is
+// internally synchronized.
+class VgePipelineCompiler {
+public:
+    VgePipelineCompiler(VgeDevice& device, uint32_t workerCount = 0);
+    ~VgePipelineCompiler();
+
+    VgePipelineCompiler(const VgePipelineCompiler&) = delete;
+    VgePipelineCompiler& operator=(const VgePipelineCompiler&) = delete;
+
+    // The config is kept alive until the worker is done with it
+    PendingPipeline compileGraphics(std::string vertFilepath, std::string fragFilepath,
+                                    std::unique_ptr<PipelineConfigInfo> configInfo);
+    PendingPipeline compileCompute(std::string compFilepath,
+                                   std::unique_ptr<PipelineConfigInfo> configInfo);
+
+    // Blocks until every queued pipeline has been compiled
+    void waitIdle();
+
+    uint32_t getWorkerCount() const {
+        return static_cast<uint32_t>(workers.size());
+    }
+
+private:
+    PendingPipeline enqueue(std::function<std::unique_ptr<Pipeline>()> build);
+    void workerLoop();
+
+    VgeDevice& vgeDevice;
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    uint32_t activeJobs = 0;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable idle;
+};
+
+}  // namespace vge
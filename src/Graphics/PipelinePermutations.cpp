@@ -0,0 +1,83 @@
+#include "PipelinePermutations.h"
+
+// std
+#include <memory>
+
+namespace vge {
+
+uint64_t PipelineStateKey::hash() const {
+    // FNV-1a over the fields, the struct has padding so it is not hashed as raw bytes
+    uint64_t value = 14695981039346656037ull;
+    auto mix = [&value](uint64_t field) {
+        value ^= field;
+        value *= 1099511628211ull;
+    };
+    mix(static_cast<uint64_t>(topology));
+    mix(static_cast<uint64_t>(polygonMode));
+    mix(static_cast<uint64_t>(cullMode));
+    mix(static_cast<uint64_t>(blendMode));
+    mix(depthTest ? 1 : 0);
+    mix(depthWrite ? 1 : 0);
+    return value;
+}
+
+void PipelineStateKey::applyTo(PipelineConfigInfo& configInfo) const {
+    configInfo.inputAssemblyInfo.topology = topology;
+    configInfo.rasterizationInfo.polygonMode = polygonMode;
+    configInfo.rasterizationInfo.cullMode = cullMode;
+
+    auto& blend = configInfo.colorBlendAttachment;
+    blend.blendEnable = blendMode == BlendMode::Opaque ? VK_FALSE : VK_TRUE;
+    blend.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    blend.dstColorBlendFactor = blendMode == BlendMode::Additive
+                                    ? VK_BLEND_FACTOR_ONE
+                                    : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    blend.colorBlendOp = VK_BLEND_OP_ADD;
+    blend.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    blend.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    blend.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    configInfo.depthStencilInfo.depthTestEnable = depthTest ? VK_TRUE : VK_FALSE;
+    configInfo.depthStencilInfo.depthWriteEnable = depthWrite ? VK_TRUE : VK_FALSE;
+}
+
+VgePipelinePermutations::VgePipelinePermutations(VgeDevice& device, std::string vertFilepath,
+                                                 std::string fragFilepath, BaseConfig baseConfig,
+                                                 const PipelineStateKey& fallback)
+    : vgeDevice{device},
+      vertFilepath{std::move(vertFilepath)},
+      fragFilepath{std::move(fragFilepath)},
+      baseConfig{std::move(baseConfig)},
+      fallbackKey{fallback} {
+    request(fallbackKey);
+}
+
+Pipeline& VgePipelinePermutations::get(const PipelineStateKey& key) {
+    PendingPipeline& pipeline = request(key);
+    if (key == fallbackKey || pipeline.isReady()) {
+        return pipeline.get();
+    }
+    return variants.at(fallbackKey).get();
+}
+
+bool VgePipelinePermutations::isReady(const PipelineStateKey& key) const {
+    auto it = variants.find(key);
+    return it != variants.end() && it->second.isReady();
+}
+
+PendingPipeline& VgePipelinePermutations::request(const PipelineStateKey& key) {
+    auto it = variants.find(key);
+    if (it != variants.end()) {
+        return it->second;
+    }
+
+    auto configInfo = std::make_unique<PipelineConfigInfo>();
+    Pipeline::defaultPipelineConfigInfo(*configInfo);
+    baseConfig(*configInfo);
+    key.applyTo(*configInfo);
+    auto pending = vgeDevice.getPipelineCompiler().compileGraphics(vertFilepath, fragFilepath,
+                                                                   std::move(configInfo));
+    return variants.emplace(key, std::move(pending)).first->second;
+}
+
+}  // namespace vge
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Pipeline.h"
+#include "PipelineCompiler.h"
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+namespace vge {
+
+enum class BlendMode : uint8_t {
+    Opaque,
+    Alpha,     // src * a + dst * (1 - a)
+    Additive,  // src * a + dst
+};
+
+// The part of a graphics pipeline that systems switch at runtime. Everything else, vertex input,
+// layout and render pass, is fixed per system and comes from its base config.
+struct PipelineStateKey {
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+    BlendMode blendMode = BlendMode::Opaque;
+    bool depthTest = true;
+    bool depthWrite = true;
+
+    bool operator==(const PipelineStateKey& other) const = default;
+
+    uint64_t hash() const;
+    void applyTo(PipelineConfigInfo& configInfo) const;
+};
+
+struct PipelineStateKeyHash {
+    size_t operator()(const PipelineStateKey& key) const {
+        return static_cast<size_t>(key.hash());
+    }
+};
+
+// Lazily built variants of one graphics pipeline. A variant is queued on the pipeline compiler
+// the first time it is asked for, and until it is ready the fallback variant is returned in its
+// place, so switching render modes never waits on a compile. The fallback is queued up front
+// and is the only variant that may block, on the very first draw.
+class VgePipelinePermutations {
+public:
+    // Sets everything the state key does not cover. Variants compile whenever they are first
+    // asked for, so whatever the config references, the render pass in particular, must stay
+    // valid for the lifetime of the permutations.
+    using BaseConfig = std::function<void(PipelineConfigInfo&)>;
+
+    VgePipelinePermutations(VgeDevice& device, std::string vertFilepath, std::string fragFilepath,
+                            BaseConfig baseConfig, const PipelineStateKey& fallback);
+
+    VgePipelinePermutations(const VgePipelinePermutations&) = delete;
+    VgePipelinePermutations& operator=(const VgePipelinePermutations&) = delete;
+
+    Pipeline& get(const PipelineStateKey& key);
+
+    bool isReady(const PipelineStateKey& key) const;
+
+    size_t getVariantCount() const {
+        return variants.size();
+    }
+
+private:
+    PendingPipeline& request(const PipelineStateKey& key);
+
+    VgeDevice& vgeDevice;
+    std::string vertFilepath;
+    std::string fragFilepath;
+    BaseConfig baseConfig;
+    PipelineStateKey fallbackKey;
+    std::unordered_map<PipelineStateKey, PendingPipeline, PipelineStateKeyHash> variants;
+};
+
+}  // namespace vge
@@ -0,0 +1,388 @@
+#include "ShaderReflection.h"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace vge {
+
+namespace {
+
+// The handful of SPIR-V enums the reflection needs, values from the SPIR-V specification
+constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+constexpr size_t SPIRV_HEADER_WORDS = 5;
+
+enum Op : uint32_t {
+    OpEntryPoint = 15,
+    OpTypeBool = 20,
+    OpTypeInt = 21,
+    OpTypeFloat = 22,
+    OpTypeVector = 23,
+    OpTypeMatrix = 24,
+    OpTypeImage = 25,
+    OpTypeSampler = 26,
+    OpTypeSampledImage = 27,
+    OpTypeArray = 28,
+    OpTypeRuntimeArray = 29,
+    OpTypeStruct = 30,
+    OpTypePointer = 32,
+    OpConstant = 43,
+    OpVariable = 59,
+    OpDecorate = 71,
+    OpMemberDecorate = 72,
+};
+
+enum Decoration : uint32_t {
+    DecorationBufferBlock = 3,
+    DecorationArrayStride = 6,
+    DecorationMatrixStride = 7,
+    DecorationBinding = 33,
+    DecorationDescriptorSet = 34,
+    DecorationOffset = 35,
+};
+
+enum StorageClass : uint32_t {
+    StorageClassUniformConstant = 0,
+    StorageClassUniform = 2,
+    StorageClassPushConstant = 9,
+    StorageClassStorageBuffer = 12,
+};
+
+constexpr uint32_t DIM_BUFFER = 5;
+constexpr uint32_t DIM_SUBPASS_DATA = 6;
+
+struct Id {
+    uint32_t opcode = 0;
+    std::vector<uint32_t> operands;  // everything after the result id
+
+    // Decorations
+    bool bufferBlock = false;
+    uint32_t set = 0;
+    uint32_t binding = 0;
+    uint32_t arrayStride = 0;
+    std::vector<uint32_t> memberOffsets;
+    std::vector<uint32_t> memberMatrixStrides;
+};
+
+class SpirvModule {
+public:
+    SpirvModule(const uint32_t* code, size_t wordCount) {
+        if (wordCount < SPIRV_HEADER_WORDS || code[0] != SPIRV_MAGIC) {
+            throw std::runtime_error("invalid SPIR-V module!!!");
+        }
+        ids.resize(code[3]);
+
+        size_t offset = SPIRV_HEADER_WORDS;
+        while (offset < wordCount) {
+            uint32_t wordLength = code[offset] >> 16;
+            uint32_t opcode = code[offset] & 0xffff;
+            if (wordLength == 0 || offset + wordLength > wordCount) {
+                throw std::runtime_error("truncated SPIR-V module!!!");
+            }
+            parseInstruction(opcode, code + offset + 1, wordLength - 1);
+            offset += wordLength;
+        }
+    }
+
+    const Id& at(uint32_t id) const {
+        if (id >= ids.size()) {
+            throw std::runtime_error("SPIR-V id out of bounds!!!");
+        }
+        return ids[id];
+    }
+
+    VkShaderStageFlags stage = 0;
+    std::vector<uint32_t> variables;
+
+private:
+    void parseInstruction(uint32_t opcode, const uint32_t* words, uint32_t count) {
+        switch (opcode) {
+            case OpEntryPoint:
+                if (stage == 0 && count > 0) {
+                    stage = executionModelStage(words[0]);
+                }
+                break;
+            case OpDecorate:
+                if (count >= 2) {
+                    decorate(idAt(words[0]), words[1], count >= 3 ? words[2] : 0);
+                }
+                break;
+            case OpMemberDecorate:
+                if (count >= 4) {
+                    memberDecorate(idAt(words[0]), words[1], words[2], words[3]);
+                }
+                break;
+            case OpTypeBool:
+            case OpTypeInt:
+            case OpTypeFloat:
+            case OpTypeVector:
+            case OpTypeMatrix:
+            case OpTypeImage:
+            case OpTypeSampler:
+            case OpTypeSampledImage:
+            case OpTypeArray:
+            case OpTypeRuntimeArray:
+            case OpTypeStruct:
+            case OpTypePointer:
+                if (count >= 1) {
+                    define(words[0], opcode, words + 1, count - 1);
+                }
+                break;
+            case OpConstant:
+            case OpVariable:
+                // Result type comes first, the operands keep it so the layout matches the spec
+                if (count >= 2) {
+                    Id& id = define(words[1], opcode, words + 2, count - 2);
+                    id.operands.insert(id.operands.begin(), words[0]);
+                    if (opcode == OpVariable) {
+                        variables.push_back(words[1]);
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    Id& idAt(uint32_t id) {
+        if (id >= ids.size()) {
+            throw std::runtime_error("SPIR-V id out of bounds!!!");
+        }
+        return ids[id];
+    }
+
+    Id& define(uint32_t result, uint32_t opcode, const uint32_t* operands, uint32_t count) {
+        Id& id = idAt(result);
+        id.opcode = opcode;
+        id.operands.assign(operands, operands + count);
+        return id;
+    }
+
+    static void decorate(Id& id, uint32_t decoration, uint32_t value) {
+        switch (decoration) {
+            case DecorationBufferBlock:
+                id.bufferBlock = true;
+                break;
+            case DecorationArrayStride:
+                id.arrayStride = value;
+                break;
+            case DecorationBinding:
+                id.binding = value;
+                break;
+            case DecorationDescriptorSet:
+                id.set = value;
+                break;
+            default:
+                break;
+        }
+    }
+
+    static void memberDecorate(Id& id, uint32_t member, uint32_t decoration, uint32_t value) {
+        auto assign = [member, value](std::vector<uint32_t>& values) {
+            if (values.size() <= member) {
+                values.resize(member + 1, 0);
+            }
+            values[member] = value;
+        };
+        if (decoration == DecorationOffset) {
+            assign(id.memberOffsets);
+        } else if (decoration == DecorationMatrixStride) {
+            assign(id.memberMatrixStrides);
+        }
+    }
+
+    static VkShaderStageFlags executionModelStage(uint32_t model) {
+        switch (model) {
+            case 0:
+                return VK_SHADER_STAGE_VERTEX_BIT;
+            case 1:
+                return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+            case 2:
+                return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+            case 3:
+                return VK_SHADER_STAGE_GEOMETRY_BIT;
+            case 4:
+                return VK_SHADER_STAGE_FRAGMENT_BIT;
+            case 5:
+                return VK_SHADER_STAGE_COMPUTE_BIT;
+            default:
+                throw std::runtime_error("unsupported SPIR-V execution model!!!");
+        }
+    }
+
+    std::vector<Id> ids;
+};
+
+uint32_t constantValue(const SpirvModule& module, uint32_t id) {
+    const Id& constant = module.at(id);
+    if (constant.opcode != OpConstant || constant.operands.size() < 2) {
+        throw std::runtime_error("SPIR-V array length is not a constant!!!");
+    }
+    return constant.operands[1];
+}
+
+uint32_t typeSize(const SpirvModule& module, uint32_t typeId, uint32_t matrixStride = 0) {
+    const Id& type = module.at(typeId);
+    switch (type.opcode) {
+        case OpTypeBool:
+            return 4;
+        case OpTypeInt:
+        case OpTypeFloat:
+            return type.operands[0] / 8;
+        case OpTypeVector:
+            return type.operands[1] * typeSize(module, type.operands[0]);
+        case OpTypeMatrix: {
+            uint32_t columnSize =
+                matrixStride > 0 ? matrixStride : typeSize(module, type.operands[0]);
+            return type.operands[1] * columnSize;
+        }
+        case OpTypeArray: {
+            uint32_t length = constantValue(module, type.operands[1]);
+            uint32_t stride = type.arrayStride > 0
+                                  ? type.arrayStride
+                                  : typeSize(module, type.operands[0], matrixStride);
+            return length * stride;
+        }
+        case OpTypeRuntimeArray:
+            return 0;
+        case OpTypeStruct: {
+            uint32_t size = 0;
+            for (size_t i = 0; i < type.operands.size(); i++) {
+                uint32_t offset = i < type.memberOffsets.size() ? type.memberOffsets[i] : size;
+                uint32_t stride =
+                    i < type.memberMatrixStrides.size() ? type.memberMatrixStrides[i] : 0;
+                size = std::max(size, offset + typeSize(module, type.operands[i], stride));
+            }
+            return size;
+        }
+        default:
+            throw std::runtime_error("unsupported SPIR-V type in shader interface!!!");
+    }
+}
+
+VkDescriptorType descriptorType(const Id& type, uint32_t storageClass) {
+    if (storageClass == StorageClassStorageBuffer) {
+        return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    }
+    if (storageClass == StorageClassUniform) {
+        return type.bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+                                : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    }
+
+    switch (type.opcode) {
+        case OpTypeSampler:
+            return VK_DESCRIPTOR_TYPE_SAMPLER;
+        case OpTypeSampledImage:
+            return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        case OpTypeImage: {
+            uint32_t dim = type.operands[1];
+            bool storage = type.operands[5] == 2;
+            if (dim == DIM_SUBPASS_DATA) {
+                return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            }
+            if (dim == DIM_BUFFER) {
+                return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER
+                               : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            }
+            return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        }
+        default:
+            throw std::runtime_error("unsupported SPIR-V descriptor type!!!");
+    }
+}
+
+}  // namespace
+
+ShaderReflection ShaderReflection::parse(const uint32_t* code, size_t wordCount) {
+    SpirvModule module{code, wordCount};
+
+    ShaderReflection reflection{};
+    reflection.stages = module.stage;
+
+    for (uint32_t variableId : module.variables) {
+        const Id& variable = module.at(variableId);
+        uint32_t storageClass = variable.operands[1];
+        if (storageClass != StorageClassUniformConstant && storageClass != StorageClassUniform &&
+            storageClass != StorageClassStorageBuffer &&
+            storageClass != StorageClassPushConstant) {
+            continue;
+        }
+
+        const Id& pointer = module.at(variable.operands[0]);
+        uint32_t typeId = pointer.operands[1];
+
+        if (storageClass == StorageClassPushConstant) {
+            reflection.pushConstantSize = typeSize(module, typeId);
+            reflection.pushConstantStages = module.stage;
+            continue;
+        }
+
+        // Arrays of descriptors, 0 stands for a runtime sized array
+        uint32_t count = 1;
+        const Id* type = &module.at(typeId);
+        if (type->opcode == OpTypeArray) {
+            count = constantValue(module, type->operands[1]);
+            typeId = type->operands[0];
+        } else if (type->opcode == OpTypeRuntimeArray) {
+            count = 0;
+            typeId = type->operands[0];
+        }
+        type = &module.at(typeId);
+
+        Binding binding{};
+        binding.set = variable.set;
+        binding.binding = variable.binding;
+        binding.type = descriptorType(*type, storageClass);
+        binding.count = count;
+        binding.stages = module.stage;
+        reflection.bindings.push_back(binding);
+    }
+
+    std::sort(reflection.bindings.begin(), reflection.bindings.end(),
+              [](const Binding& a, const Binding& b) {
+                  return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+              });
+    return reflection;
+}
+
+void ShaderReflection::merge(const ShaderReflection& other) {
+    stages |= other.stages;
+
+    for (const Binding& incoming : other.bindings) {
+        auto it = std::find_if(bindings.begin(), bindings.end(), [&](const Binding& existing) {
+            return existing.set == incoming.set && existing.binding == incoming.binding;
+        });
+        if (it == bindings.end()) {
+            bindings.push_back(incoming);
+            continue;
+        }
+        if (it->type != incoming.type || it->count != incoming.count) {
+            throw std::runtime_error("shader stages disagree on descriptor set " +
+                                     std::to_string(incoming.set) + " binding " +
+                                     std::to_string(incoming.binding) + "!!!");
+        }
+        it->stages |= incoming.stages;
+    }
+    std::sort(bindings.begin(), bindings.end(), [](const Binding& a, const Binding& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+    if (other.pushConstantStages != 0) {
+        pushConstantSize = std::max(pushConstantSize, other.pushConstantSize);
+        pushConstantStages |= other.pushConstantStages;
+    }
+}
+
+std::vector<VkPushConstantRange> ShaderReflection::pushConstantRanges() const {
+    if (pushConstantStages == 0) {
+        return {};
+    }
+    VkPushConstantRange range{};
+    range.stageFlags = pushConstantStages;
+    range.offset = 0;
+    range.size = pushConstantSize;
+    return {range};
+}
+
+}  // namespace vge
@@ -0,0 +1,38 @@
+#pragma once
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vge {
+
+// Descriptor and push constant interface of one or more shader stages, read straight from the
+// SPIR-V. Merging the reflection of every stage of a pipeline gives everything needed to build
+// its set layouts and push constant range, so systems don't restate what the shaders declare.
+struct ShaderReflection {
+    struct Binding {
+        uint32_t set;
+        uint32_t binding;
+        VkDescriptorType type;
+        uint32_t count;
+        VkShaderStageFlags stages;
+    };
+
+    VkShaderStageFlags stages = 0;
+    std::vector<Binding> bindings;  // sorted by set, then binding
+    uint32_t pushConstantSize = 0;
+    VkShaderStageFlags pushConstantStages = 0;
+
+    // Only the first entry point is looked at, every shader in this repo has exactly one
+    static ShaderReflection parse(const uint32_t* code, size_t wordCount);
+
+    void merge(const ShaderReflection& other);
+
+    // Empty when no stage declares a push constant block
+    std::vector<VkPushConstantRange> pushConstantRanges() const;
+};
+
+}  // namespace vge
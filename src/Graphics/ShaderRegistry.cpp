@@ -0,0 +1,214 @@
+#include "ShaderRegistry.h"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef ENGINE_DIR
+#define ENGINE_DIR "../"
+#endif
+
+namespace vge {
+
+namespace {
+
+// Read only view of a whole file, unmapped when it goes out of scope
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+        LARGE_INTEGER fileSize{};
+        GetFileSizeEx(file, &fileSize);
+        size = static_cast<size_t>(fileSize.QuadPart);
+        if (size > 0) {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        }
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+        struct stat fileStat {};
+        if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+            size = static_cast<size_t>(fileStat.st_size);
+            data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                data = nullptr;
+            }
+        }
+        // The mapping keeps the file alive on its own
+        close(fd);
+#endif
+        if (data == nullptr) {
+            release();
+            throw std::runtime_error("failed to map shader file " + path + "!!!");
+        }
+    }
+
+    ~MappedFile() {
+        release();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint32_t* words() const {
+        return static_cast<const uint32_t*>(data);
+    }
+    size_t getSize() const {
+        return size;
+    }
+
+private:
+    void release() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap(data, size);
+#endif
+        data = nullptr;
+    }
+
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+    void* data = nullptr;
+    size_t size = 0;
+};
+
+}  // namespace
+
+VgeShaderModule::VgeShaderModule(VkDevice device, const uint32_t* code, size_t size)
+    : device{device},
+      code(code, code + size / sizeof(uint32_t)),
+      reflection{ShaderReflection::parse(code, size / sizeof(uint32_t))} {
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = size;
+    createInfo.pCode = code;
+
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module");
+    }
+}
+
+VgeShaderModule::~VgeShaderModule() {
+    vkDestroyShaderModule(device, shaderModule, nullptr);
+}
+
+bool VgeShaderModule::matches(const uint32_t* words, size_t wordCount) const {
+    return code.size() == wordCount && std::equal(code.begin(), code.end(), words);
+}
+
+VgeShaderRegistry::VgeShaderRegistry(VkDevice device) : device{device} {}
+
+VgeShaderRegistry::~VgeShaderRegistry() {
+    // Pipelines hold their modules, all of them are gone before the device tears this down
+    modules.clear();
+}
+
+ShaderHandle VgeShaderRegistry::load(const std::string& filepath) {
+    MappedFile file{ENGINE_DIR + filepath};
+    if (file.getSize() % sizeof(uint32_t) != 0) {
+        throw std::runtime_error("shader file " + filepath + " is not SPIR-V!!!");
+    }
+    size_t wordCount = file.getSize() / sizeof(uint32_t);
+    uint64_t key = hashCode(file.words(), wordCount);
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stats.loads++;
+        if (ShaderHandle existing = findLocked(key, file.words(), wordCount)) {
+            stats.cacheHits++;
+            return existing;
+        }
+    }
+
+    // Created outside the lock so workers loading other shaders are not held up by the driver
+    auto module = std::make_shared<VgeShaderModule>(device, file.words(), file.getSize());
+
+    std::lock_guard<std::mutex> lock{mutex};
+    // Another thread may have created the same module meanwhile, ours is then dropped
+    if (ShaderHandle existing = findLocked(key, file.words(), wordCount)) {
+        stats.cacheHits++;
+        return existing;
+    }
+    modules.emplace(key, module);
+    return module;
+}
+
+ShaderHandle VgeShaderRegistry::findLocked(uint64_t key, const uint32_t* code,
+                                           size_t wordCount) const {
+    auto [begin, end] = modules.equal_range(key);
+    for (auto it = begin; it != end; ++it) {
+        if (it->second->matches(code, wordCount)) {
+            return it->second;
+        }
+    }
+    return nullptr;
+}
+
+ShaderReflection VgeShaderRegistry::reflect(std::initializer_list<std::string> filepaths) {
+    ShaderReflection reflection{};
+    for (const auto& filepath : filepaths) {
+        reflection.merge(load(filepath)->getReflection());
+    }
+    return reflection;
+}
+
+void VgeShaderRegistry::releaseUnused() {
+    std::lock_guard<std::mutex> lock{mutex};
+    // Only the registry's own reference is left, nobody can copy it from under the lock
+    for (auto it = modules.begin(); it != modules.end();) {
+        if (it->second.use_count() == 1) {
+            it = modules.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+VgeShaderRegistry::Stats VgeShaderRegistry::getStats() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    Stats result = stats;
+    result.modules = static_cast<uint32_t>(modules.size());
+    for (const auto& [key, module] : modules) {
+        if (module.use_count() == 1) {
+            result.unusedModules++;
+        }
+    }
+    return result;
+}
+
+uint64_t VgeShaderRegistry::hashCode(const uint32_t* code, size_t wordCount) {
+    // FNV-1a over the words with the length mixed into the seed
+    uint64_t hash = 14695981039346656037ull ^ wordCount;
+    for (size_t i = 0; i < wordCount; i++) {
+        hash ^= code[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+}  // namespace vge
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "ShaderReflection.h"
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vge {
+
+// One VkShaderModule per distinct SPIR-V blob, shared by every pipeline that uses it
+class VgeShaderModule {
+public:
+    VgeShaderModule(VkDevice device, const uint32_t* code, size_t size);
+    ~VgeShaderModule();
+
+    VgeShaderModule(const VgeShaderModule&) = delete;
+    VgeShaderModule& operator=(const VgeShaderModule&) = delete;
+
+    VkShaderModule getModule() const {
+        return shaderModule;
+    }
+    VkShaderStageFlagBits getStage() const {
+        return static_cast<VkShaderStageFlagBits>(reflection.stages);
+    }
+    const ShaderReflection& getReflection() const {
+        return reflection;
+    }
+    // Whether the module was created from exactly these words
+    bool matches(const uint32_t* words, size_t wordCount) const;
+
+private:
+    VkDevice device;
+    std::vector<uint32_t> code;  // kept to tell apart blobs whose hashes collide
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    ShaderReflection reflection;
+};
+
+using ShaderHandle = std::shared_ptr<const VgeShaderModule>;
+
+// Loads SPIR-V by memory mapping the file and hands out reference counted modules. Files with
+// identical contents share a module, found by hashing the mapped words and comparing them, so
+// the same shader used by several systems or reloaded with a scene is only created once. Modules
+// nobody holds any more stay cached until releaseUnused() so a scene that is unloaded and loaded
+// again finds them still there. Safe to call from the pipeline compiler's workers.
+class VgeShaderRegistry {
+public:
+    struct Stats {
+        uint32_t modules = 0;
+        uint32_t unusedModules = 0;
+        uint64_t loads = 0;
+        uint64_t cacheHits = 0;  // loads that reused an existing module
+    };
+
+    VgeShaderRegistry(VkDevice device);
+    ~VgeShaderRegistry();
+
+    VgeShaderRegistry(const VgeShaderRegistry&) = delete;
+    VgeShaderRegistry& operator=(const VgeShaderRegistry&) = delete;
+
+    // Path is relative to the engine directory, like every other asset path
+    ShaderHandle load(const std::string& filepath);
+
+    // Merged interface of all the given stages, for building set and pipeline layouts
+    ShaderReflection reflect(std::initializer_list<std::string> filepaths);
+
+    void releaseUnused();
+    Stats getStats() const;
+
+private:
+    static uint64_t hashCode(const uint32_t* code, size_t wordCount);
+    // Must hold the mutex
+    ShaderHandle findLocked(uint64_t key, const uint32_t* code, size_t wordCount) const;
+
+    VkDevice device;
+    // Keyed by the hash of the words, colliding blobs share a key
+    std::unordered_multimap<uint64_t, std::shared_ptr<VgeShaderModule>> modules;
+    Stats stats{};
+    mutable std::mutex mutex;
+};
+
+}  // namespace vge
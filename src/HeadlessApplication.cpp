@@ -0,0 +1,129 @@
+#include "HeadlessApplication.h"
+
+#include "Camera/Camera.h"
+#include "Game/GameObject.h"
+#include "Presentation/SwapChain.h"
+#include "Scenes/Galaxy/GalaxyScene.h"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+namespace vge {
+
+HeadlessApplication::HeadlessApplication(const Settings& settings) : settings{settings} {
+    frameAllocator =
+        std::make_unique<VgeFrameAllocator>(vgeDevice, VgeSwapChain::MAX_FRAMES_IN_FLIGHT);
+    auto galaxyScene = std::make_unique<GalaxyScene>(vgeDevice, vgeRenderer,
+                                                     frameAllocator->getUniformSetLayout());
+    // Runs must be repeatable, so quality may not follow how fast this machine happens to be
+    galaxyScene->setAdaptiveQuality(false);
+    currentScene = std::move(galaxyScene);
+}
+
+HeadlessApplication::~HeadlessApplication() {}
+
+std::string HeadlessApplication::capturePathForFrame(int frame) const {
+    if (settings.captureEvery <= 0) {
+        return settings.capturePath;
+    }
+    size_t dot = settings.capturePath.find_last_of('.');
+    size_t slash = settings.capturePath.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return settings.capturePath + "_" + std::to_string(frame);
+    }
+    return settings.capturePath.substr(0, dot) + "_" + std::to_string(frame) +
+           settings.capturePath.substr(dot);
+}
+
+void HeadlessApplication::run() {
+    Camera camera{};
+
+    auto viewerObject = GameObject::createGameObject();
+    viewerObject.transform.translation.z = -2.5f;
+    camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+    camera.setPerspectiveProjection(glm::radians(50.f), vgeRenderer.getAspectRatio(), 0.1f,
+                                    1000.f);
+
+    float cpuTimeTotal = 0.0f;
+    float gpuTimeTotal = 0.0f;
+    int framesRendered = 0;
+
+    auto runStart = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < settings.frames; frame++) {
+        bool lastFrame = frame + 1 == settings.frames;
+        if (!settings.capturePath.empty() &&
+            (settings.captureEvery > 0 ? frame % settings.captureEvery == 0 : lastFrame)) {
+            vgeRenderer.captureFrame(capturePathForFrame(frame));
+        }
+
+        // Offscreen images are always available, a frame is only skipped if the swap chain
+        // had to be recreated, and then tried again
+        auto commandBuffer = vgeRenderer.beginFrame();
+        if (!commandBuffer) {
+            frame--;
+            continue;
+        }
+        int frameIndex = vgeRenderer.getFrameIndex();
+
+        frameAllocator->beginFrame(frameIndex);
+        auto uboAllocation = frameAllocator->allocateUniform(sizeof(GlobalUbo));
+
+        GameObject::Map& sceneObjects = currentScene->getGameObjects();
+        FrameInfo frameInfo{frameIndex,
+                            settings.frameTime,
+                            commandBuffer,
+                            camera,
+                            frameAllocator->getUniformDescriptorSet(),
+                            sceneObjects,
+                            *frameAllocator,
+                            uboAllocation.offset};
+
+        GlobalUbo& ubo = *static_cast<GlobalUbo*>(uboAllocation.data);
+        ubo.projection = camera.getProjection();
+        ubo.view = camera.getView();
+        ubo.inverseView = camera.getInverseView();
+        ubo.ambientLightColor = glm::vec4{1.f, 1.f, 1.f, .02f};
+        ubo.numLights = 0;
+
+        currentScene->update(frameInfo);
+        currentScene->updateUbo(ubo, frameInfo);
+
+        vgeRenderer.beginSwapChainRenderPass(commandBuffer);
+        currentScene->render(frameInfo);
+        vgeRenderer.endSwapChainRenderPass(commandBuffer);
+        frameAllocator->flush();
+        vgeRenderer.endFrame();
+
+        // Timings lag a couple of frames behind, the first ones read back as 0
+        cpuTimeTotal += vgeRenderer.getCpuFrameTime();
+        gpuTimeTotal += vgeRenderer.getGpuFrameTime();
+        framesRendered++;
+    }
+
+    vkDeviceWaitIdle(vgeDevice.device());
+    vgeDevice.getDeletionQueue().flush();
+
+    float totalTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                          std::chrono::high_resolution_clock::now() - runStart)
+                          .count();
+    if (framesRendered > 0) {
+        std::cout << framesRendered << " frames in " << totalTime << " ms, average cpu "
+                  << cpuTimeTotal / framesRendered << " ms";
+        if (vgeRenderer.hasGpuTimings()) {
+            std::cout << ", gpu " << gpuTimeTotal / framesRendered << " ms";
+        }
+        std::cout << std::endl;
+    }
+}
+
+}  // namespace vge
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Buffer/FrameAllocator.h"
+#include "Device/Device.h"
+#include "Rendering/Renderer.h"
+#include "Scenes/Scene.h"
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <memory>
+#include <string>
+
+namespace vge {
+// Renders the galaxy scene without a window, for CI and batch rendering. Frames go to offscreen
+// images and can be written out as PNG or raw RGBA. Works with a CPU Vulkan driver such as
+// lavapipe, since nothing needs a display or a surface.
+class HeadlessApplication {
+public:
+    struct Settings {
+        uint32_t width = 1280;
+        uint32_t height = 720;
+        int frames = 120;
+        // Simulated time per frame, fixed so runs are repeatable however slow the device is
+        float frameTime = 1.0f / 60.0f;
+        // Empty for no captures. Only the last frame is captured unless captureEvery is set,
+        // in which case the frame number is inserted before the extension.
+        std::string capturePath;
+        int captureEvery = 0;
+    };
+
+    explicit HeadlessApplication(const Settings& settings);
+    ~HeadlessApplication();
+
+    HeadlessApplication(const HeadlessApplication&) = delete;
+    HeadlessApplication& operator=(const HeadlessApplication&) = delete;
+
+    void run();
+
+private:
+    std::string capturePathForFrame(int frame) const;
+
+    Settings settings;
+    VgeDevice vgeDevice{};
+    Renderer vgeRenderer{vgeDevice, {settings.width, settings.height}};
+
+    std::unique_ptr<VgeFrameAllocator> frameAllocator{};
+    std::unique_ptr<Scene> currentScene;
+};
+}  // namespace vge
@@ -1,6 +1,11 @@
 #include "ImGuiManager.h"
 
+#include "../Descriptor/BindlessRegistry.h"
+#include "../Descriptor/Descriptors.h"
 #include "../Device/Device.h"
+#include "../Device/TransferManager.h"
+#include "../Graphics/PipelineCache.h"
+#include "../Graphics/ShaderRegistry.h"
 #include "../Rendering/Renderer.h"
 #include "../Scenes/Galaxy/GalaxyScene.h"
 #include "../Scenes/Light/LightScene.h"
@@ -18,6 +23,7 @@
 #include <vulkan/vulkan_core.h>
 
 #include <fstream>
+#include <iostream>
 #include <memory>
 #include <stdexcept>
 
@@ -31,28 +37,12 @@ VgeImgui::VgeImgui(Window& window, VgeDevice& device, Renderer& renderer, uint32
       currentScenePtr{scenePtr},
       globalSetLayout{globalSetLayout},
       input{input} {
-    // Set up descriptor pool stored on this instance
-    VkDescriptorPoolSize pool_sizes[] = {{VK_DESCRIPTOR_TYPE_SAMPLER, 1000},
-                                         {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000},
-                                         {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1000},
-                                         {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1000},
-                                         {VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1000},
-                                         {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1000},
-                                         {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000},
-                                         {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000},
-                                         {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1000},
-                                         {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1000},
-                                         {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1000}};
-    VkDescriptorPoolCreateInfo pool_info = {};
-    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-    pool_info.maxSets = 1000 * IM_ARRAYSIZE(pool_sizes);
-    pool_info.poolSizeCount = (uint32_t)IM_ARRAYSIZE(pool_sizes);
-    pool_info.pPoolSizes = pool_sizes;
-    if (vkCreateDescriptorPool(device.device(), &pool_info, nullptr, &descriptorPool) !=
-        VK_SUCCESS) {
-        throw std::runtime_error("Failed to set up descriptor pool for imgui!!!");
-    }
+    // The backend only allocates the font texture set, plus any textures shown through it
+    descriptorPool = VgeDescriptorPool::Builder(device)
+                         .setMaxSets(16)
+                         .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 16)
+                         .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+                         .build();
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
@@ -85,8 +75,8 @@ VgeImgui::VgeImgui(Window& window, VgeDevice& device, Renderer& renderer, uint32
     init_info.QueueFamily = indices.graphicsFamily;
     init_info.Queue = device.graphicsQueue();
 
-    init_info.PipelineCache = VK_NULL_HANDLE;
-    init_info.DescriptorPool = descriptorPool;
+    init_info.PipelineCache = device.getPipelineCache().getCache();
+    init_info.DescriptorPool = descriptorPool->getDescriptorPool();
     init_info.Allocator = VK_NULL_HANDLE;
     init_info.MinImageCount = 2;
     init_info.ImageCount = imageCount;
@@ -97,12 +87,14 @@ VgeImgui::VgeImgui(Window& window, VgeDevice& device, Renderer& renderer, uint32
         throw std::runtime_error("Failed to initialize ImGui Vulkan implementation!!!");
     }
 
-    // upload fonts, this is done by recording and submitting a one time use
-    // command buffer which can be done easily by using some existin helper
-    // functions on vge device object
-    auto commandBuffer = device.beginSingleTimeCommands();
-    ImGui_ImplVulkan_CreateFontsTexture(commandBuffer);
-    device.endSingleTimeCommands(commandBuffer);
+    // upload fonts with the transfer manager's next batch, the font image is transitioned for
+    // sampling so the commands go to the graphics queue. Waiting on the ticket only waits for
+    // that batch, the staging buffer imgui used can be freed afterwards.
+    VgeTransferManager& transferManager = device.getTransferManager();
+    uint64_t ticket = transferManager.recordGraphics(
+        [](VkCommandBuffer commandBuffer) { ImGui_ImplVulkan_CreateFontsTexture(commandBuffer); });
+    transferManager.wait(ticket);
+    ImGui_ImplVulkan_DestroyFontUploadObjects();
 
     loadSettings();
 }
@@ -111,7 +103,6 @@ VgeImgui::~VgeImgui() {
     saveSettings();
     ImGui_ImplVulkan_Shutdown();
     ImGui_ImplGlfw_Shutdown();
-    vkDestroyDescriptorPool(vgeDevice.device(), descriptorPool, nullptr);
     ImGui::DestroyContext();
 }
 
@@ -254,15 +245,19 @@ void VgeImgui::renderSceneSelector() {
     if (ImGui::Button("Load Galaxy Scene")) {
         // Only create new scene if we don't have one
         if (!*currentScenePtr) {
+            auto start = std::chrono::high_resolution_clock::now();
             (*currentScenePtr) =
                 std::make_unique<GalaxyScene>(vgeDevice, vgeRenderer, globalSetLayout);
+            recordSceneLoad(start);
         }
     }
 
     if (ImGui::Button("Load Light Scene")) {
         if (!*currentScenePtr) {
+            auto start = std::chrono::high_resolution_clock::now();
             (*currentScenePtr) =
                 std::make_unique<LightScene>(vgeDevice, vgeRenderer, globalSetLayout);
+            recordSceneLoad(start);
         }
     }
 
@@ -312,10 +307,59 @@ void VgeImgui::renderGlobalControls() {
         vgeRenderer.setBackgroundColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
     }
 
+    // Fewer frames in flight and a non-queuing present mode cut latency at some throughput
+    VkPresentModeKHR presentMode = vgeRenderer.getPresentMode();
+    if (ImGui::BeginCombo("Present Mode", VgeSwapChain::getPresentModeName(presentMode))) {
+        for (VkPresentModeKHR mode : vgeRenderer.getSupportedPresentModes()) {
+            if (ImGui::Selectable(VgeSwapChain::getPresentModeName(mode), mode == presentMode)) {
+                vgeRenderer.setPresentMode(mode);
+            }
+        }
+        ImGui::EndCombo();
+    }
+    int framesInFlight = static_cast<int>(vgeRenderer.getFramesInFlight());
+    if (ImGui::SliderInt("Frames In Flight", &framesInFlight, 1,
+                         VgeSwapChain::MAX_FRAMES_IN_FLIGHT)) {
+        vgeRenderer.setFramesInFlight(static_cast<uint32_t>(framesInFlight));
+    }
+    FramePacer::Settings& pacing = vgeRenderer.getFramePacer().settings;
+    ImGui::Checkbox("Frame Pacing", &pacing.enabled);
+    if (pacing.enabled) {
+        ImGui::SliderFloat("Wake Margin (ms)", &pacing.safetyMargin, 0.0f, 5.0f, "%.1f");
+    }
+    ImGui::SliderFloat("FPS Cap", &pacing.frameRateCap, 0.0f, 240.0f,
+                       pacing.frameRateCap > 0.0f ? "%.0f" : "Off");
+    // Off records everything into the one primary command buffer, to compare CPU times
+    bool parallelRecording = vgeRenderer.isParallelRecording();
+    if (ImGui::Checkbox("Parallel Recording", &parallelRecording)) {
+        vgeRenderer.setParallelRecording(parallelRecording);
+    }
+
+    // Renders the scene below native resolution to hold the GPU frame time, the UI stays sharp
+    if (vgeRenderer.hasDynamicResolution() && vgeRenderer.hasGpuTimings()) {
+        VgeResolutionScaler::Settings& resolution = vgeRenderer.getResolutionSettings();
+        ImGui::Checkbox("Dynamic Resolution", &resolution.enabled);
+        if (resolution.enabled) {
+            ImGui::SliderFloat("Target GPU Time (ms)", &resolution.targetGpuTime, 1.0f, 33.0f,
+                               "%.1f");
+            ImGui::SliderFloat("Min Scale", &resolution.minScale, 0.25f, 1.0f, "%.2f");
+            ImGui::SliderFloat("Max Scale", &resolution.maxScale, resolution.minScale, 1.0f,
+                               "%.2f");
+            ImGui::SliderFloat("Sharpness", &resolution.sharpness, 0.0f, 1.0f, "%.2f");
+        }
+    }
+
     ImGui::Spacing();
     ImGui::Separator();
 }
 
+void VgeImgui::recordSceneLoad(std::chrono::high_resolution_clock::time_point start) {
+    lastSceneLoadTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                            std::chrono::high_resolution_clock::now() - start)
+                            .count();
+    std::cout << "scene load: " << lastSceneLoadTime << " ms" << std::endl;
+}
+
 /*---------------------------------------------------------- */
 
 void VgeImgui::renderCameraControls() {
@@ -345,6 +389,55 @@ void VgeImgui::renderPerformanceMetrics() {
     ImGui::Text("Current:");
     ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate,
                 ImGui::GetIO().Framerate);
+    ImGui::Text("CPU %.3f ms, GPU %.3f ms", vgeRenderer.getCpuFrameTime(),
+                vgeRenderer.getGpuFrameTime());
+    VkExtent2D renderExtent = vgeRenderer.getRenderExtent();
+    ImGui::Text("Render scale %.2f (%ux%u)", vgeRenderer.getResolutionScale(), renderExtent.width,
+                renderExtent.height);
+    ImGui::Text("Input latency: %.1f ms (%s, %u in flight)", vgeRenderer.getInputLatency(),
+                VgeSwapChain::getPresentModeName(vgeRenderer.getPresentMode()),
+                vgeRenderer.getFramesInFlight());
+    auto& pacer = vgeRenderer.getFramePacer();
+    ImGui::Text("Pacer: slept %.2f ms, slot wait %.2f ms, interval %.2f ms", pacer.getSleepTime(),
+                pacer.getSlotWaitTime(), pacer.getFrameInterval());
+
+    auto memoryStats = vgeDevice.getAllocator().getStats();
+    ImGui::Text("GPU Memory: %.1f / %.1f MB in %u allocations",
+                memoryStats.usedBytes / (1024.0 * 1024.0),
+                memoryStats.reservedBytes / (1024.0 * 1024.0), memoryStats.deviceAllocations);
+    ImGui::Text("%u blocks, %u staging pages, %u dedicated", memoryStats.pooledBlocks,
+                memoryStats.linearPages, memoryStats.dedicatedAllocations);
+    auto cacheStats = vgeDevice.getPipelineCache().getStats();
+    ImGui::Text("Pipelines: %u in %.1f ms, cache %s", cacheStats.pipelinesCreated,
+                cacheStats.creationTime, cacheStats.loadedFromDisk ? "warm" : "cold");
+    if (lastSceneLoadTime > 0.0f) {
+        ImGui::Text("Last scene load: %.1f ms", lastSceneLoadTime);
+    }
+    auto shaderStats = vgeDevice.getShaderRegistry().getStats();
+    ImGui::Text("Shaders: %u modules (%u unused), %llu of %llu loads shared", shaderStats.modules,
+                shaderStats.unusedModules, static_cast<unsigned long long>(shaderStats.cacheHits),
+                static_cast<unsigned long long>(shaderStats.loads));
+    if (shaderStats.unusedModules > 0 && ImGui::Button("Release unused shaders")) {
+        vgeDevice.getShaderRegistry().releaseUnused();
+    }
+    auto& layoutCache = vgeDevice.getDescriptorLayoutCache();
+    ImGui::Text("Set layouts: %u, %llu shared", layoutCache.getLayoutCount(),
+                static_cast<unsigned long long>(layoutCache.getCacheHits()));
+    if (vgeDevice.supportsBindless()) {
+        auto& bindless = vgeDevice.getBindlessRegistry();
+        ImGui::Text("Bindless: %u buffers, %u textures", bindless.getBufferCount(),
+                    bindless.getTextureCount());
+    }
+    auto transferStats = vgeDevice.getTransferManager().getStats();
+    ImGui::Text("Uploads: %llu in %llu submits (%.1f MB)%s",
+                static_cast<unsigned long long>(transferStats.uploads),
+                static_cast<unsigned long long>(transferStats.submits),
+                transferStats.bytesUploaded / (1024.0 * 1024.0),
+                vgeDevice.getTransferManager().usesDedicatedQueue() ? ", transfer queue" : "");
+
+    if (*currentScenePtr) {
+        (*currentScenePtr)->renderPerformanceUI();
+    }
 }
 
 /*---------------------------------------------------------- */
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../Descriptor/Descriptors.h"
 #include "../Device/Device.h"
 #include "../Input/Input.h"
 #include "../Rendering/Renderer.h"
@@ -9,6 +10,7 @@
 // libs
 #include <vulkan/vulkan_core.h>
 
+#include <chrono>
 #include <memory>
 
 #include "imgui.h"
@@ -49,9 +51,11 @@ class VgeImgui {
     void renderPerformanceMetrics();
 
    private:
+    void recordSceneLoad(std::chrono::high_resolution_clock::time_point start);
+
     Renderer& vgeRenderer;
     VgeDevice& vgeDevice;
-    VkDescriptorPool descriptorPool;
+    std::unique_ptr<VgeDescriptorPool> descriptorPool;
     std::unique_ptr<Scene>* currentScenePtr;
     VkDescriptorSetLayout globalSetLayout;
 
@@ -72,6 +76,7 @@ class VgeImgui {
     float avgFps = 0.0f;
     float timeSinceLastUpdate = 0.0f;
     const float UPDATE_INTERVAL = 1.0f;
+    float lastSceneLoadTime = 0.0f;  // ms, includes pipeline creation
 
     Input* input;
 };
@@ -0,0 +1,482 @@
+#include "MemoryAllocator.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace vge {
+
+// One vkAllocateMemory object, carved up according to its kind
+class MemoryBlock {
+public:
+    enum class Kind { Pooled, Linear, Dedicated };
+
+    MemoryBlock(VkDevice device, VkDeviceMemory memory, VkDeviceSize size, void* mapped,
+                uint32_t memoryTypeIndex, Kind kind)
+        : device{device},
+          memory{memory},
+          size{size},
+          mapped{mapped},
+          memoryTypeIndex{memoryTypeIndex},
+          kind{kind} {
+        if (kind == Kind::Pooled) {
+            ranges = std::make_unique<TlsfRange>(size);
+        }
+    }
+
+    ~MemoryBlock() {
+        // Freeing implicitly unmaps
+        vkFreeMemory(device, memory, nullptr);
+    }
+
+    MemoryBlock(const MemoryBlock&) = delete;
+    MemoryBlock& operator=(const MemoryBlock&) = delete;
+
+    bool isEmpty() const {
+        switch (kind) {
+            case Kind::Pooled:
+                return ranges->isEmpty();
+            case Kind::Linear:
+                return linearLiveCount == 0;
+            case Kind::Dedicated:
+                return false;
+        }
+        return false;
+    }
+
+    VkDeviceSize getUsedBytes() const {
+        switch (kind) {
+            case Kind::Pooled:
+                return ranges->getUsedBytes();
+            case Kind::Linear:
+                return linearUsedBytes;
+            case Kind::Dedicated:
+                return size;
+        }
+        return 0;
+    }
+
+    uint32_t getAllocationCount() const {
+        switch (kind) {
+            case Kind::Pooled:
+                return ranges->getAllocationCount();
+            case Kind::Linear:
+                return linearLiveCount;
+            case Kind::Dedicated:
+                return 1;
+        }
+        return 0;
+    }
+
+    VkDevice device;
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    void* mapped;
+    uint32_t memoryTypeIndex;
+    Kind kind;
+
+    std::unique_ptr<TlsfRange> ranges;  // pooled only
+
+    // Linear only
+    VkDeviceSize linearHead = 0;
+    VkDeviceSize linearUsedBytes = 0;
+    uint32_t linearLiveCount = 0;
+
+    // Pooled only, keyed by TLSF node
+    struct Relocation {
+        VgeMemoryAllocator::RelocateCallback callback;
+        VkDeviceSize alignment;
+    };
+    std::unordered_map<uint32_t, Relocation> relocations;
+};
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+VgeMemoryAllocator::VgeMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice)
+    : device{device} {
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+    pools.resize(memoryProperties.memoryTypeCount);
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        // Large heaps get 64 MiB blocks, small ones (e.g. 256 MiB BAR) an eighth of the heap
+        VkDeviceSize heapSize =
+            memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex].size;
+        VkDeviceSize blockSize = 64ull * 1024 * 1024;
+        if (heapSize < 1024ull * 1024 * 1024) {
+            blockSize = std::max<VkDeviceSize>(alignUp(heapSize / 8, 1024 * 1024), 1024 * 1024);
+        }
+        pools[i].blockSize = blockSize;
+    }
+}
+
+VgeMemoryAllocator::~VgeMemoryAllocator() {
+    Stats stats = getStats();
+    assert(stats.allocations == 0 && "Device memory leaked, allocations still alive");
+    (void)stats;
+}
+
+uint32_t VgeMemoryAllocator::findMemoryType(uint32_t typeFilter,
+                                            VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) &&
+            (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+std::unique_ptr<MemoryBlock> VgeMemoryAllocator::createBlock(uint32_t memoryTypeIndex,
+                                                             VkDeviceSize size, bool linear) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate device memory block!!!");
+    }
+
+    // Host visible memory stays mapped for the lifetime of the block
+    void* mapped = nullptr;
+    VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+    if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+            vkFreeMemory(device, memory, nullptr);
+            throw std::runtime_error("failed to map device memory block!!!");
+        }
+    }
+
+    MemoryBlock::Kind kind = linear ? MemoryBlock::Kind::Linear : MemoryBlock::Kind::Pooled;
+    return std::make_unique<MemoryBlock>(device, memory, size, mapped, memoryTypeIndex, kind);
+}
+
+VgeAllocation VgeMemoryAllocator::allocate(const VkMemoryRequirements& requirements,
+                                           VkMemoryPropertyFlags properties, Strategy strategy) {
+    uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+    VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+
+    VkDeviceSize size = requirements.size;
+    VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+    // Flush and invalidate work on whole atoms, keep neighbours out of each other's atoms. This
+    // also covers memory that happens to be coherent without the caller asking for it.
+    if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        alignment = std::max(alignment, nonCoherentAtomSize);
+        size = alignUp(size, nonCoherentAtomSize);
+    }
+
+    std::lock_guard<std::mutex> lock{mutex};
+    const MemoryTypePool& pool = pools[memoryTypeIndex];
+
+    if (strategy == Strategy::Linear && size <= linearPageSize / 2) {
+        return allocateLinear(memoryTypeIndex, size, alignment);
+    }
+    if (strategy == Strategy::Dedicated || size > pool.blockSize / 2) {
+        return allocateDedicated(memoryTypeIndex, size);
+    }
+    return allocatePooled(memoryTypeIndex, size, alignment);
+}
+
+VgeAllocation VgeMemoryAllocator::allocateFromBlock(MemoryBlock& block, VkDeviceSize size,
+                                                    VkDeviceSize alignment) {
+    VgeAllocation allocation{};
+    VkDeviceSize offset = 0;
+    uint32_t node = block.ranges->allocate(size, alignment, offset);
+    if (node == TlsfRange::INVALID_NODE) {
+        return allocation;
+    }
+
+    allocation.memory = block.memory;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+    allocation.memoryTypeIndex = block.memoryTypeIndex;
+    allocation.alignment = alignment;
+    allocation.block = &block;
+    allocation.node = node;
+    return allocation;
+}
+
+VgeAllocation VgeMemoryAllocator::allocatePooled(uint32_t memoryTypeIndex, VkDeviceSize size,
+                                                 VkDeviceSize alignment) {
+    MemoryTypePool& pool = pools[memoryTypeIndex];
+    for (auto& block : pool.blocks) {
+        VgeAllocation allocation = allocateFromBlock(*block, size, alignment);
+        if (allocation.block) {
+            return allocation;
+        }
+    }
+
+    pool.blocks.push_back(createBlock(memoryTypeIndex, pool.blockSize, false));
+    VgeAllocation allocation = allocateFromBlock(*pool.blocks.back(), size, alignment);
+    if (!allocation.block) {
+        throw std::runtime_error("failed to sub-allocate from a new memory block!!!");
+    }
+    return allocation;
+}
+
+VgeAllocation VgeMemoryAllocator::allocateLinear(uint32_t memoryTypeIndex, VkDeviceSize size,
+                                                 VkDeviceSize alignment) {
+    MemoryTypePool& pool = pools[memoryTypeIndex];
+
+    MemoryBlock* page = nullptr;
+    VkDeviceSize offset = 0;
+    for (auto& candidate : pool.linearPages) {
+        offset = alignUp(candidate->linearHead, alignment);
+        if (offset + size <= candidate->size) {
+            page = candidate.get();
+            break;
+        }
+    }
+    if (!page) {
+        pool.linearPages.push_back(createBlock(memoryTypeIndex, linearPageSize, true));
+        page = pool.linearPages.back().get();
+        offset = 0;
+    }
+
+    page->linearHead = offset + size;
+    page->linearUsedBytes += size;
+    page->linearLiveCount++;
+
+    VgeAllocation allocation{};
+    allocation.memory = page->memory;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.mapped = page->mapped ? static_cast<char*>(page->mapped) + offset : nullptr;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    allocation.alignment = alignment;
+    allocation.block = page;
+    return allocation;
+}
+
+VgeAllocation VgeMemoryAllocator::allocateDedicated(uint32_t memoryTypeIndex, VkDeviceSize size) {
+    auto block = createBlock(memoryTypeIndex, size, false);
+    block->kind = MemoryBlock::Kind::Dedicated;
+    block->ranges.reset();
+
+    VgeAllocation allocation{};
+    allocation.memory = block->memory;
+    allocation.offset = 0;
+    allocation.size = size;
+    allocation.mapped = block->mapped;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    allocation.block = block.get();
+    allocation.node = 0;
+
+    dedicatedBlocks.push_back(std::move(block));
+    return allocation;
+}
+
+void VgeMemoryAllocator::free(VgeAllocation& allocation) {
+    std::lock_guard<std::mutex> lock{mutex};
+    freeLocked(allocation, true);
+}
+
+void VgeMemoryAllocator::freeLocked(VgeAllocation& allocation, bool releaseEmpty) {
+    MemoryBlock* block = allocation.block;
+    if (!block) {
+        return;
+    }
+
+    MemoryTypePool& pool = pools[block->memoryTypeIndex];
+    switch (block->kind) {
+        case MemoryBlock::Kind::Pooled:
+            block->relocations.erase(allocation.node);
+            block->ranges->free(allocation.node);
+            if (releaseEmpty) {
+                releaseIfEmpty(pool.blocks, block);
+            }
+            break;
+        case MemoryBlock::Kind::Linear:
+            block->linearUsedBytes -= allocation.size;
+            // Everything in the page is dead, start over from the beginning
+            if (--block->linearLiveCount == 0) {
+                block->linearHead = 0;
+                block->linearUsedBytes = 0;
+            }
+            if (releaseEmpty) {
+                releaseIfEmpty(pool.linearPages, block);
+            }
+            break;
+        case MemoryBlock::Kind::Dedicated:
+            auto it = std::find_if(dedicatedBlocks.begin(), dedicatedBlocks.end(),
+                                   [block](const auto& b) { return b.get() == block; });
+            assert(it != dedicatedBlocks.end() && "Unknown dedicated allocation");
+            dedicatedBlocks.erase(it);
+            break;
+    }
+
+    allocation = VgeAllocation{};
+}
+
+void VgeMemoryAllocator::releaseIfEmpty(std::vector<std::unique_ptr<MemoryBlock>>& blocks,
+                                        MemoryBlock* block) {
+    if (!block->isEmpty()) {
+        return;
+    }
+
+    // Keep one empty block around so the next allocation does not hit the driver
+    bool otherEmpty = std::any_of(blocks.begin(), blocks.end(), [block](const auto& b) {
+        return b.get() != block && b->isEmpty();
+    });
+    if (otherEmpty) {
+        blocks.erase(std::find_if(blocks.begin(), blocks.end(),
+                                  [block](const auto& b) { return b.get() == block; }));
+    }
+}
+
+void VgeMemoryAllocator::setRelocateCallback(const VgeAllocation& allocation,
+                                             RelocateCallback callback) {
+    std::lock_guard<std::mutex> lock{mutex};
+    // Linear and dedicated allocations never move
+    if (allocation.block && allocation.block->kind == MemoryBlock::Kind::Pooled) {
+        allocation.block->relocations[allocation.node] = {std::move(callback),
+                                                          allocation.alignment};
+    }
+}
+
+VgeMemoryAllocator::DefragmentationStats VgeMemoryAllocator::defragment(VkDeviceSize maxBytes) {
+    std::lock_guard<std::mutex> lock{mutex};
+    DefragmentationStats stats;
+
+    for (auto& pool : pools) {
+        if (pool.blocks.size() < 2) continue;
+
+        // Drain the emptiest blocks into the fullest ones. Blocks are only released at the end,
+        // so the pointers stay valid throughout.
+        std::vector<MemoryBlock*> order;
+        for (auto& block : pool.blocks) {
+            order.push_back(block.get());
+        }
+        std::sort(order.begin(), order.end(), [](MemoryBlock* a, MemoryBlock* b) {
+            return a->getUsedBytes() < b->getUsedBytes();
+        });
+
+        for (size_t source = 0; source + 1 < order.size(); source++) {
+            MemoryBlock* from = order[source];
+
+            struct Candidate {
+                uint32_t node;
+                VkDeviceSize offset;
+                VkDeviceSize size;
+            };
+            std::vector<Candidate> candidates;
+            from->ranges->forEachAllocation([&](uint32_t node, uint64_t offset, uint64_t size) {
+                if (from->relocations.count(node)) {
+                    candidates.push_back({node, offset, size});
+                }
+            });
+
+            for (const Candidate& candidate : candidates) {
+                if (stats.bytesMoved + candidate.size > maxBytes) {
+                    stats.blocksReleased = releaseEmptyBlocksLocked();
+                    return stats;
+                }
+
+                // Same alignment the resource was created with, e.g. its VkMemoryRequirements
+                MemoryBlock::Relocation relocation = std::move(from->relocations[candidate.node]);
+                VgeAllocation destination{};
+                for (size_t target = order.size() - 1; target > source; target--) {
+                    destination =
+                        allocateFromBlock(*order[target], candidate.size, relocation.alignment);
+                    if (destination.block) break;
+                }
+                if (!destination.block) {
+                    from->relocations[candidate.node] = std::move(relocation);
+                    continue;
+                }
+
+                VgeAllocation current{};
+                current.memory = from->memory;
+                current.offset = candidate.offset;
+                current.size = candidate.size;
+                current.mapped =
+                    from->mapped ? static_cast<char*>(from->mapped) + candidate.offset : nullptr;
+                current.memoryTypeIndex = from->memoryTypeIndex;
+                current.alignment = relocation.alignment;
+                current.block = from;
+                current.node = candidate.node;
+
+                if (!relocation.callback(current, destination)) {
+                    from->relocations[candidate.node] = std::move(relocation);
+                    destination.block->ranges->free(destination.node);
+                    continue;
+                }
+
+                destination.block->relocations[destination.node] = std::move(relocation);
+                freeLocked(current, false);
+                stats.allocationsMoved++;
+                stats.bytesMoved += candidate.size;
+            }
+        }
+    }
+
+    stats.blocksReleased = releaseEmptyBlocksLocked();
+    return stats;
+}
+
+uint32_t VgeMemoryAllocator::releaseEmptyBlocksLocked() {
+    uint32_t released = 0;
+    auto releaseFrom = [&](std::vector<std::unique_ptr<MemoryBlock>>& blocks) {
+        // Keep one empty block around so the next allocation does not hit the driver
+        bool keptOne = false;
+        for (auto it = blocks.begin(); it != blocks.end();) {
+            if ((*it)->isEmpty()) {
+                if (!keptOne) {
+                    keptOne = true;
+                } else {
+                    it = blocks.erase(it);
+                    released++;
+                    continue;
+                }
+            }
+            ++it;
+        }
+    };
+
+    for (auto& pool : pools) {
+        releaseFrom(pool.blocks);
+        releaseFrom(pool.linearPages);
+    }
+    return released;
+}
+
+VgeMemoryAllocator::Stats VgeMemoryAllocator::getStats() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    Stats stats;
+
+    auto accumulate = [&](const MemoryBlock& block) {
+        stats.deviceAllocations++;
+        stats.allocations += block.getAllocationCount();
+        stats.reservedBytes += block.size;
+        stats.usedBytes += block.getUsedBytes();
+    };
+
+    for (const auto& pool : pools) {
+        for (const auto& block : pool.blocks) {
+            accumulate(*block);
+            stats.pooledBlocks++;
+        }
+        for (const auto& page : pool.linearPages) {
+            accumulate(*page);
+            stats.linearPages++;
+        }
+    }
+    for (const auto& block : dedicatedBlocks) {
+        accumulate(*block);
+        stats.dedicatedAllocations++;
+    }
+    return stats;
+}
+
+}  // namespace vge
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "TlsfRange.h"
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace vge {
+
+class MemoryBlock;
+
+// Handle to a range of device memory. Resources bind at (memory, offset); mapped points at
+// offset inside the block's persistent mapping for host visible memory types.
+struct VgeAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;
+    uint32_t memoryTypeIndex = 0;
+    VkDeviceSize alignment = 1;  // what the offset was aligned to, kept when it moves
+
+    // Allocator bookkeeping
+    MemoryBlock* block = nullptr;
+    uint32_t node = TlsfRange::INVALID_NODE;
+};
+
+// Sub-allocates device memory so that resources share a few large vkAllocateMemory blocks
+// instead of each owning one.
+//   Pooled:    per memory type pools of large blocks, each managed by a TLSF range allocator
+//   Linear:    bump allocated pages for short lived data such as staging buffers, a page
+//              rewinds once everything in it has been freed
+//   Dedicated: requests too large for a block get their own allocation
+// Host visible blocks are mapped once for their lifetime, so many allocations can be "mapped"
+// at the same time even though they share one VkDeviceMemory.
+class VgeMemoryAllocator {
+public:
+    enum class Strategy { Pooled, Linear, Dedicated };
+
+    struct Stats {
+        uint32_t deviceAllocations = 0;  // live vkAllocateMemory objects
+        uint32_t pooledBlocks = 0;
+        uint32_t linearPages = 0;
+        uint32_t dedicatedAllocations = 0;
+        uint64_t allocations = 0;
+        VkDeviceSize reservedBytes = 0;
+        VkDeviceSize usedBytes = 0;
+    };
+
+    struct DefragmentationStats {
+        uint32_t allocationsMoved = 0;
+        VkDeviceSize bytesMoved = 0;
+        uint32_t blocksReleased = 0;
+    };
+
+    // Called with the current and the new allocation when defragmentation wants to move a
+    // resource. The owner copies its contents, rebinds, stores the new allocation and returns
+    // true, or returns false to keep the old one.
+    using RelocateCallback =
+        std::function<bool(const VgeAllocation& from, const VgeAllocation& to)>;
+
+    VgeMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice);
+    ~VgeMemoryAllocator();
+
+    VgeMemoryAllocator(const VgeMemoryAllocator&) = delete;
+    VgeMemoryAllocator& operator=(const VgeMemoryAllocator&) = delete;
+
+    VgeAllocation allocate(const VkMemoryRequirements& requirements,
+                           VkMemoryPropertyFlags properties, Strategy strategy = Strategy::Pooled);
+    // A pooled block or linear page left empty goes back to the driver, unless it is the only
+    // empty one of its memory type and kind, which is kept for the next allocation
+    void free(VgeAllocation& allocation);
+
+    // Defragmentation hooks. Only pooled allocations with a relocate callback are ever moved,
+    // freeing the allocation drops its callback.
+    void setRelocateCallback(const VgeAllocation& allocation, RelocateCallback callback);
+    // Empties the least used pooled blocks into the fuller ones, moving at most maxBytes, and
+    // releases the blocks left empty. The caller must make sure the GPU is not using the
+    // resources being moved, e.g. by calling this while the device is idle.
+    DefragmentationStats defragment(VkDeviceSize maxBytes = VK_WHOLE_SIZE);
+
+    Stats getStats() const;
+
+    VkDeviceSize getNonCoherentAtomSize() const {
+        return nonCoherentAtomSize;
+    }
+
+private:
+    struct MemoryTypePool {
+        VkDeviceSize blockSize = 0;
+        std::vector<std::unique_ptr<MemoryBlock>> blocks;
+        std::vector<std::unique_ptr<MemoryBlock>> linearPages;
+    };
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    std::unique_ptr<MemoryBlock> createBlock(uint32_t memoryTypeIndex, VkDeviceSize size,
+                                             bool linear);
+    VgeAllocation allocateFromBlock(MemoryBlock& block, VkDeviceSize size,
+                                    VkDeviceSize alignment);
+    VgeAllocation allocatePooled(uint32_t memoryTypeIndex, VkDeviceSize size,
+                                 VkDeviceSize alignment);
+    VgeAllocation allocateLinear(uint32_t memoryTypeIndex, VkDeviceSize size,
+                                 VkDeviceSize alignment);
+    VgeAllocation allocateDedicated(uint32_t memoryTypeIndex, VkDeviceSize size);
+    // Returns the allocation's range to its block, which is released when left empty unless
+    // the caller still holds pointers to blocks
+    void freeLocked(VgeAllocation& allocation, bool releaseEmpty);
+    void releaseIfEmpty(std::vector<std::unique_ptr<MemoryBlock>>& blocks, MemoryBlock* block);
+    uint32_t releaseEmptyBlocksLocked();
+
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    VkDeviceSize nonCoherentAtomSize = 1;
+    VkDeviceSize linearPageSize = 16 * 1024 * 1024;
+
+    std::vector<MemoryTypePool> pools;
+    std::vector<std::unique_ptr<MemoryBlock>> dedicatedBlocks;
+    mutable std::mutex mutex;
+};
+
+}  // namespace vge
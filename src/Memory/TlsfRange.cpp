@@ -0,0 +1,202 @@
+#include "TlsfRange.h"
+
+// std
+#include <bit>
+#include <cassert>
+
+namespace vge {
+
+TlsfRange::TlsfRange(uint64_t size) : size{size} {
+    for (auto& heads : freeHeads) {
+        for (auto& head : heads) {
+            head = INVALID_NODE;
+        }
+    }
+    insertFree(createNode(0, size));
+}
+
+void TlsfRange::mapping(uint64_t size, uint32_t& fl, uint32_t& sl) {
+    if (size < (1ull << FL_OFFSET)) {
+        fl = 0;
+        sl = static_cast<uint32_t>(size >> (FL_OFFSET - SL_LOG2));
+    } else {
+        uint32_t msb = static_cast<uint32_t>(std::bit_width(size)) - 1;
+        fl = msb - FL_OFFSET + 1;
+        sl = static_cast<uint32_t>(size >> (msb - SL_LOG2)) ^ SL_COUNT;
+    }
+}
+
+void TlsfRange::mappingSearch(uint64_t size, uint32_t& fl, uint32_t& sl) {
+    // Round up to the next size class so every range in the bin found is large enough
+    if (size >= (1ull << FL_OFFSET)) {
+        uint32_t msb = static_cast<uint32_t>(std::bit_width(size)) - 1;
+        size += (1ull << (msb - SL_LOG2)) - 1;
+    } else {
+        size += (1ull << (FL_OFFSET - SL_LOG2)) - 1;
+    }
+    mapping(size, fl, sl);
+}
+
+uint32_t TlsfRange::createNode(uint64_t offset, uint64_t size) {
+    uint32_t index;
+    if (!recycledNodes.empty()) {
+        index = recycledNodes.back();
+        recycledNodes.pop_back();
+    } else {
+        index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+    nodes[index] = Node{};
+    nodes[index].offset = offset;
+    nodes[index].size = size;
+    nodes[index].inUse = true;
+    return index;
+}
+
+void TlsfRange::releaseNode(uint32_t node) {
+    nodes[node].inUse = false;
+    recycledNodes.push_back(node);
+}
+
+void TlsfRange::insertFree(uint32_t index) {
+    Node& node = nodes[index];
+    uint32_t fl, sl;
+    mapping(node.size, fl, sl);
+
+    node.free = true;
+    node.prevFree = INVALID_NODE;
+    node.nextFree = freeHeads[fl][sl];
+    if (node.nextFree != INVALID_NODE) {
+        nodes[node.nextFree].prevFree = index;
+    }
+    freeHeads[fl][sl] = index;
+    flBitmap |= 1ull << fl;
+    slBitmap[fl] |= 1u << sl;
+}
+
+void TlsfRange::removeFree(uint32_t index) {
+    Node& node = nodes[index];
+    uint32_t fl, sl;
+    mapping(node.size, fl, sl);
+
+    if (node.prevFree != INVALID_NODE) {
+        nodes[node.prevFree].nextFree = node.nextFree;
+    } else {
+        freeHeads[fl][sl] = node.nextFree;
+    }
+    if (node.nextFree != INVALID_NODE) {
+        nodes[node.nextFree].prevFree = node.prevFree;
+    }
+
+    if (freeHeads[fl][sl] == INVALID_NODE) {
+        slBitmap[fl] &= ~(1u << sl);
+        if (slBitmap[fl] == 0) {
+            flBitmap &= ~(1ull << fl);
+        }
+    }
+    node.free = false;
+    node.prevFree = INVALID_NODE;
+    node.nextFree = INVALID_NODE;
+}
+
+uint32_t TlsfRange::findFree(uint32_t fl, uint32_t sl) const {
+    if (fl >= FL_COUNT) {
+        return INVALID_NODE;
+    }
+
+    uint32_t slMap = slBitmap[fl] & (~0u << sl);
+    if (slMap == 0) {
+        uint64_t flMap = fl + 1 < 64 ? flBitmap & (~0ull << (fl + 1)) : 0;
+        if (flMap == 0) {
+            return INVALID_NODE;
+        }
+        fl = static_cast<uint32_t>(std::countr_zero(flMap));
+        slMap = slBitmap[fl];
+    }
+    sl = static_cast<uint32_t>(std::countr_zero(slMap));
+    return freeHeads[fl][sl];
+}
+
+uint32_t TlsfRange::allocate(uint64_t requestSize, uint64_t alignment, uint64_t& offset) {
+    assert(requestSize > 0 && "Cannot allocate zero bytes");
+    alignment = alignment > 0 ? alignment : 1;
+
+    // Worst case padding is included in the search, so the bin found always fits
+    uint32_t fl, sl;
+    mappingSearch(requestSize + alignment - 1, fl, sl);
+    uint32_t index = findFree(fl, sl);
+    if (index == INVALID_NODE) {
+        return INVALID_NODE;
+    }
+    removeFree(index);
+
+    // Leading padding becomes its own free range
+    uint64_t alignedOffset = (nodes[index].offset + alignment - 1) / alignment * alignment;
+    uint64_t padding = alignedOffset - nodes[index].offset;
+    if (padding > 0) {
+        uint32_t paddingNode = createNode(nodes[index].offset, padding);
+        nodes[paddingNode].prevPhysical = nodes[index].prevPhysical;
+        nodes[paddingNode].nextPhysical = index;
+        if (nodes[index].prevPhysical != INVALID_NODE) {
+            nodes[nodes[index].prevPhysical].nextPhysical = paddingNode;
+        }
+        nodes[index].prevPhysical = paddingNode;
+        nodes[index].offset = alignedOffset;
+        nodes[index].size -= padding;
+        insertFree(paddingNode);
+    }
+
+    // Split off the tail when it is worth keeping
+    if (nodes[index].size - requestSize >= MIN_SPLIT) {
+        uint32_t tailNode =
+            createNode(nodes[index].offset + requestSize, nodes[index].size - requestSize);
+        nodes[tailNode].prevPhysical = index;
+        nodes[tailNode].nextPhysical = nodes[index].nextPhysical;
+        if (nodes[index].nextPhysical != INVALID_NODE) {
+            nodes[nodes[index].nextPhysical].prevPhysical = tailNode;
+        }
+        nodes[index].nextPhysical = tailNode;
+        nodes[index].size = requestSize;
+        insertFree(tailNode);
+    }
+
+    usedBytes += nodes[index].size;
+    allocationCount++;
+    offset = nodes[index].offset;
+    return index;
+}
+
+void TlsfRange::free(uint32_t index) {
+    assert(index < nodes.size() && nodes[index].inUse && !nodes[index].free &&
+           "Freeing a range that is not allocated");
+    usedBytes -= nodes[index].size;
+    allocationCount--;
+
+    // Merge with free physical neighbours
+    uint32_t prev = nodes[index].prevPhysical;
+    if (prev != INVALID_NODE && nodes[prev].free) {
+        removeFree(prev);
+        nodes[index].offset = nodes[prev].offset;
+        nodes[index].size += nodes[prev].size;
+        nodes[index].prevPhysical = nodes[prev].prevPhysical;
+        if (nodes[index].prevPhysical != INVALID_NODE) {
+            nodes[nodes[index].prevPhysical].nextPhysical = index;
+        }
+        releaseNode(prev);
+    }
+
+    uint32_t next = nodes[index].nextPhysical;
+    if (next != INVALID_NODE && nodes[next].free) {
+        removeFree(next);
+        nodes[index].size += nodes[next].size;
+        nodes[index].nextPhysical = nodes[next].nextPhysical;
+        if (nodes[index].nextPhysical != INVALID_NODE) {
+            nodes[nodes[index].nextPhysical].prevPhysical = index;
+        }
+        releaseNode(next);
+    }
+
+    insertFree(index);
+}
+
+}  // namespace vge
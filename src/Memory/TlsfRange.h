@@ -0,0 +1,86 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace vge {
+
+// Two-level segregated fit allocator over an abstract range [0, size). It only hands out
+// offsets, the memory itself belongs to the caller. Allocation and free are O(1): free ranges
+// are binned by size class (power of two, split into SL_COUNT linear steps) and a pair of
+// bitmaps finds the first non-empty bin that is large enough. Freed ranges merge with their
+// physical neighbours immediately.
+class TlsfRange {
+public:
+    static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+
+    explicit TlsfRange(uint64_t size);
+
+    // Returns a node handle for free(), or INVALID_NODE when nothing large enough is free
+    uint32_t allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+    void free(uint32_t node);
+
+    uint64_t getSize() const {
+        return size;
+    }
+    uint64_t getUsedBytes() const {
+        return usedBytes;
+    }
+    uint32_t getAllocationCount() const {
+        return allocationCount;
+    }
+    bool isEmpty() const {
+        return allocationCount == 0;
+    }
+
+    // Visits (node, offset, size) of every live allocation
+    template <typename Function>
+    void forEachAllocation(Function&& function) const {
+        for (uint32_t i = 0; i < nodes.size(); i++) {
+            const Node& node = nodes[i];
+            if (node.inUse && !node.free) {
+                function(i, node.offset, node.size);
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t SL_LOG2 = 4;
+    static constexpr uint32_t SL_COUNT = 1u << SL_LOG2;
+    static constexpr uint32_t FL_OFFSET = 8;  // sizes below 256 bytes share the first level
+    static constexpr uint32_t FL_COUNT = 48;
+    static constexpr uint64_t MIN_SPLIT = 64;
+
+    struct Node {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t prevPhysical = INVALID_NODE;
+        uint32_t nextPhysical = INVALID_NODE;
+        uint32_t prevFree = INVALID_NODE;
+        uint32_t nextFree = INVALID_NODE;
+        bool free = false;
+        bool inUse = false;  // false while the slot sits in the recycled node list
+    };
+
+    static void mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+    static void mappingSearch(uint64_t size, uint32_t& fl, uint32_t& sl);
+
+    uint32_t createNode(uint64_t offset, uint64_t size);
+    void releaseNode(uint32_t node);
+    void insertFree(uint32_t node);
+    void removeFree(uint32_t node);
+    uint32_t findFree(uint32_t fl, uint32_t sl) const;
+
+    uint64_t size;
+    uint64_t usedBytes = 0;
+    uint32_t allocationCount = 0;
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> recycledNodes;
+    uint64_t flBitmap = 0;
+    uint32_t slBitmap[FL_COUNT] = {};
+    uint32_t freeHeads[FL_COUNT][SL_COUNT];
+};
+
+}  // namespace vge
@@ -1,6 +1,7 @@
 #include "Model.h"
 
 #include "../Buffer/Buffer.h"
+#include "../Device/TransferManager.h"
 #include "../Utils/utils.h"
 
 // libs
@@ -34,10 +35,17 @@ namespace vge {
 Model::Model(VgeDevice& device, const Model::Builder& builder) : vgeDevice{device} {
     createVertexBuffer(builder.vertices);
     createIndexBuffer(builder.indices);
+    registerBindless();
+    enableRelocation();
     materials = builder.materials;
 }
 
-Model::~Model() {}
+Model::~Model() {
+    if (vgeDevice.supportsBindless()) {
+        vgeDevice.getBindlessRegistry().releaseBuffer(vertexBufferIndex);
+        vgeDevice.getBindlessRegistry().releaseBuffer(indexBufferIndex);
+    }
+}
 
 std::unique_ptr<Model> Model::createModelFromFile(VgeDevice& device, const std::string& filepath) {
     Builder builder{};
@@ -52,23 +60,14 @@ void Model::createVertexBuffer(const std::vector<Vertex>& vertices) {
     VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
     uint32_t vertexSize = sizeof(vertices[0]);
 
-    VgeBuffer stagingBuffer{
-        vgeDevice,
-        vertexSize,
-        vertexCount,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    };
-
-    stagingBuffer.map();
-    stagingBuffer.writeToBuffer((void*)vertices.data());
-
     vertexBuffer = std::make_unique<VgeBuffer>(
         vgeDevice, vertexSize, vertexCount,
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-    vgeDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+    // Batched with the other pending uploads, submitted at the latest before the next frame
+    vgeDevice.getTransferManager().upload(vertexBuffer->getBuffer(), vertices.data(), bufferSize);
 }
 
 void Model::createIndexBuffer(const std::vector<uint32_t>& indices) {
@@ -82,23 +81,39 @@ void Model::createIndexBuffer(const std::vector<uint32_t>& indices) {
     VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
     uint32_t indexSize = sizeof(indices[0]);
 
-    VgeBuffer stagingBuffer{
-        vgeDevice,
-        indexSize,
-        indexCount,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    };
-
-    stagingBuffer.map();
-    stagingBuffer.writeToBuffer((void*)indices.data());
-
     indexBuffer = std::make_unique<VgeBuffer>(
         vgeDevice, indexSize, indexCount,
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-    vgeDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+    vgeDevice.getTransferManager().upload(indexBuffer->getBuffer(), indices.data(), bufferSize);
+}
+
+void Model::registerBindless() {
+    if (!vgeDevice.supportsBindless()) {
+        return;
+    }
+    // Vertex shaders read both buffers as plain storage buffers
+    auto& registry = vgeDevice.getBindlessRegistry();
+    vertexBufferIndex = registry.registerBuffer(vertexBuffer->getBuffer());
+    if (hasIndexBuffer) {
+        indexBufferIndex = registry.registerBuffer(indexBuffer->getBuffer());
+    }
+}
+
+void Model::enableRelocation() {
+    // bind() reads the handles on every draw, only the bindless slots keep a copy. Without
+    // bindless the indices are invalid and updateBuffer is never reached.
+    auto rebind = [this](VgeBuffer& buffer, uint32_t index) {
+        if (index != VgeBindlessRegistry::INVALID_INDEX) {
+            vgeDevice.getBindlessRegistry().updateBuffer(index, buffer.getBuffer());
+        }
+    };
+    vertexBuffer->enableRelocation([this, rebind] { rebind(*vertexBuffer, vertexBufferIndex); });
+    if (hasIndexBuffer) {
+        indexBuffer->enableRelocation([this, rebind] { rebind(*indexBuffer, indexBufferIndex); });
+    }
 }
 
 void Model::bind(VkCommandBuffer commandBuffer) {
@@ -111,14 +126,14 @@ void Model::bind(VkCommandBuffer commandBuffer) {
     }
 }
 
-void Model::draw(VkCommandBuffer commandBuffer) {
+void Model::draw(VkCommandBuffer commandBuffer, uint32_t firstInstance) {
     if (hasIndexBuffer) {
         // This command draws geometry based onan index buffer
-        vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+        vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, firstInstance);
     } else {
         // This command draws geometry directly from the vertex buffer, without
         // using index buffer
-        vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+        vkCmdDraw(commandBuffer, vertexCount, 1, 0, firstInstance);
     }
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../Buffer/Buffer.h"
+#include "../Descriptor/BindlessRegistry.h"
 #include "../Device/Device.h"
 
 // libs
@@ -61,11 +62,27 @@ class Model {
                                                       const std::string& filepath);
 
     void bind(VkCommandBuffer commandBuffer);
-    void draw(VkCommandBuffer commandBuffer);
+    // firstInstance reaches the shaders through gl_InstanceIndex
+    void draw(VkCommandBuffer commandBuffer, uint32_t firstInstance = 0);
+
+    // Bindless slots of the vertex and index buffers, for shaders that pull vertices themselves.
+    // INVALID_INDEX without bindless support, and for the index buffer of non-indexed models
+    uint32_t getVertexBufferIndex() const {
+        return vertexBufferIndex;
+    }
+    uint32_t getIndexBufferIndex() const {
+        return indexBufferIndex;
+    }
+    // Vertices a draw of the whole model covers
+    uint32_t getDrawVertexCount() const {
+        return hasIndexBuffer ? indexCount : vertexCount;
+    }
 
    private:
     void createVertexBuffer(const std::vector<Vertex>& vertices);
     void createIndexBuffer(const std::vector<uint32_t>& indices);
+    void registerBindless();
+    void enableRelocation();
 
     VgeDevice& vgeDevice;
 
@@ -76,6 +93,9 @@ class Model {
     std::unique_ptr<VgeBuffer> indexBuffer;
     uint32_t indexCount;
 
+    uint32_t vertexBufferIndex = VgeBindlessRegistry::INVALID_INDEX;
+    uint32_t indexBufferIndex = VgeBindlessRegistry::INVALID_INDEX;
+
     std::vector<Material> materials{};
 };
 }  // namespace vge
@@ -1,6 +1,9 @@
 #include "SwapChain.h"
 
+#include "../Device/FrameScheduler.h"
+
 // std
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <cstring>
@@ -8,30 +11,39 @@
 #include <limits>
 #include <memory>
 #include <stdexcept>
+#include <utility>
 
 namespace vge {
 
-VgeSwapChain::VgeSwapChain(VgeDevice& deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+VgeSwapChain::VgeSwapChain(VgeDevice& deviceRef, VkExtent2D extent, const Settings& settings)
+    : settings{settings}, device{deviceRef}, windowExtent{extent} {
     init();
 }
 
-VgeSwapChain::VgeSwapChain(VgeDevice& deviceRef, VkExtent2D extent,
+VgeSwapChain::VgeSwapChain(VgeDevice& deviceRef, VkExtent2D extent, const Settings& settings,
                            std::shared_ptr<VgeSwapChain> previous)
-    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+    : settings{settings}, device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
     init();
 
-    // clean up old swap chain since it's no longer needed
+    // The old swap chain is destroyed by whoever owns it, once its frames have retired
     oldSwapChain = nullptr;
 }
 
 void VgeSwapChain::init() {
-    createSwapChain();
+    if (device.isHeadless()) {
+        createOffscreenImages();
+    } else {
+        createSwapChain();
+    }
     createImageViews();
     createRenderPass();
     createDepthResources();
     createFramebuffers();
-    createSyncObjects();
+    if (oldSwapChain == nullptr) {
+        createSyncObjects();
+    } else {
+        adoptSyncObjects(*oldSwapChain);
+    }
 }
 
 VgeSwapChain::~VgeSwapChain() {
@@ -45,6 +57,11 @@ VgeSwapChain::~VgeSwapChain() {
         swapChain = nullptr;
     }
 
+    for (size_t i = 0; i < offscreenImageMemorys.size(); i++) {
+        vkDestroyImage(device.device(), swapChainImages[i], nullptr);
+        vkFreeMemory(device.device(), offscreenImageMemorys[i], nullptr);
+    }
+
     for (int i = 0; i < depthImages.size(); i++) {
         vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
         vkDestroyImage(device.device(), depthImages[i], nullptr);
@@ -56,18 +73,31 @@ VgeSwapChain::~VgeSwapChain() {
     }
 
     vkDestroyRenderPass(device.device(), renderPass, nullptr);
+    if (overlayRenderPass != VK_NULL_HANDLE) {
+        vkDestroyRenderPass(device.device(), overlayRenderPass, nullptr);
+    }
 
-    // cleanup synchronization objects
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    // cleanup synchronization objects, unless a newer swap chain took them over
+    for (size_t i = 0; i < imageAvailableSemaphores.size(); i++) {
         vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(device.device(), inFlightFences[i], nullptr);
     }
 }
 
 VkResult VgeSwapChain::acquireNextImage(uint32_t* imageIndex) {
-    vkWaitForFences(device.device(), 1, &inFlightFences[currentFrame], VK_TRUE,
-                    std::numeric_limits<uint64_t>::max());
+    // Never more than framesInFlight frames queued, which also covers the frame that last used
+    // this frame's semaphores and command buffer
+    VgeFrameScheduler& scheduler = device.getFrameScheduler();
+    uint64_t nextFrame = scheduler.getCurrentFrame() + 1;
+    if (nextFrame > settings.framesInFlight) {
+        scheduler.waitForFrame(nextFrame - settings.framesInFlight);
+    }
+
+    if (device.isHeadless()) {
+        // One image per frame index, submitCommandBuffers still waits for its last frame
+        *imageIndex = static_cast<uint32_t>(currentFrame % imageCount());
+        return VK_SUCCESS;
+    }
 
     VkResult result = vkAcquireNextImageKHR(
         device.device(), swapChain, std::numeric_limits<uint64_t>::max(),
@@ -78,38 +108,52 @@ VkResult VgeSwapChain::acquireNextImage(uint32_t* imageIndex) {
 }
 
 VkResult VgeSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex) {
-    if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-        vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-    }
-    imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
+    VgeFrameScheduler& scheduler = device.getFrameScheduler();
+    uint64_t frame = scheduler.getCurrentFrame();
+    scheduler.waitForFrame(imageFrames[*imageIndex]);
+    imageFrames[*imageIndex] = frame;
 
+    bool headless = device.isHeadless();
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+    // Offscreen images are never acquired, so there is nothing to wait for
     VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
     VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = headless ? 0 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = buffers;
 
-    VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-    submitInfo.signalSemaphoreCount = 1;
+    // Presentation only understands binary semaphores, the frame timeline is signaled alongside
+    VkSemaphore signalSemaphores[] = {scheduler.getSemaphore(),
+                                      renderFinishedSemaphores[currentFrame]};
+    uint64_t signalValues[] = {frame, 0};  // the binary semaphore ignores its value
+    submitInfo.signalSemaphoreCount = headless ? 1 : 2;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-        VK_SUCCESS) {
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+    submitInfo.pNext = &timelineInfo;
+
+    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
 
+    if (headless) {
+        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        return VK_SUCCESS;
+    }
+
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+    presentInfo.pWaitSemaphores = &renderFinishedSemaphores[currentFrame];
 
     VkSwapchainKHR swapChains[] = {swapChain};
     presentInfo.swapchainCount = 1;
@@ -128,10 +172,12 @@ void VgeSwapChain::createSwapChain() {
     SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+    // Enough images that a full queue of frames never waits on presentation for one
+    uint32_t imageCount = std::max(swapChainSupport.capabilities.minImageCount + 1,
+                                   settings.framesInFlight + 1);
     if (swapChainSupport.capabilities.maxImageCount > 0 &&
         imageCount > swapChainSupport.capabilities.maxImageCount) {
         imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -147,6 +193,13 @@ void VgeSwapChain::createSwapChain() {
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // Lets a frame rendered at another resolution be blitted in, the window surface usually
+    // allows it
+    transferDestination =
+        swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if (transferDestination) {
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
 
     QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
     uint32_t queueFamilyIndices[] = {indices.graphicsFamily, indices.presentFamily};
@@ -185,6 +238,37 @@ void VgeSwapChain::createSwapChain() {
     swapChainExtent = extent;
 }
 
+void VgeSwapChain::createOffscreenImages() {
+    // RGBA so frames read back byte for byte into image files, sRGB to match the window path
+    swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    swapChainExtent = windowExtent;
+    presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    transferDestination = true;
+
+    swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+    offscreenImageMemorys.resize(MAX_FRAMES_IN_FLIGHT);
+    for (size_t i = 0; i < swapChainImages.size(); i++) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = swapChainExtent.width;
+        imageInfo.extent.height = swapChainExtent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = swapChainImageFormat;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                          VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                   swapChainImages[i], offscreenImageMemorys[i]);
+    }
+}
+
 void VgeSwapChain::createImageViews() {
     swapChainImageViews.resize(swapChainImages.size());
     for (size_t i = 0; i < swapChainImages.size(); i++) {
@@ -229,7 +313,8 @@ void VgeSwapChain::createRenderPass() {
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = device.isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                                      : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference colorAttachmentRef = {};
     colorAttachmentRef.attachment = 0;
@@ -265,6 +350,22 @@ void VgeSwapChain::createRenderPass() {
     if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
         throw std::runtime_error("failed to create render pass!");
     }
+
+    if (!transferDestination) {
+        return;
+    }
+
+    // Same attachments, so it stays compatible, but the color is kept from a blit into the image
+    attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    attachments[0].initialLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    dependency.srcStageMask |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependency.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+
+    if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &overlayRenderPass) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create overlay render pass!");
+    }
 }
 
 void VgeSwapChain::createFramebuffers() {
@@ -339,27 +440,31 @@ void VgeSwapChain::createDepthResources() {
 void VgeSwapChain::createSyncObjects() {
     imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+    imageFrames.assign(imageCount(), 0);
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo = {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr,
                               &imageAvailableSemaphores[i]) != VK_SUCCESS ||
             vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr,
-                              &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+                              &renderFinishedSemaphores[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
     }
 }
 
+void VgeSwapChain::adoptSyncObjects(VgeSwapChain& previous) {
+    // Frames submitted against the old swap chain may still wait on or signal these semaphores,
+    // so they carry over and nothing has to idle the device
+    imageAvailableSemaphores = std::exchange(previous.imageAvailableSemaphores, {});
+    renderFinishedSemaphores = std::exchange(previous.renderFinishedSemaphores, {});
+    currentFrame = previous.currentFrame;
+    // None of the new images have been handed out yet
+    imageFrames.assign(imageCount(), 0);
+}
+
 VkSurfaceFormatKHR VgeSwapChain::chooseSwapSurfaceFormat(
     const std::vector<VkSurfaceFormatKHR>& availableFormats) {
     for (const auto& availableFormat : availableFormats) {
@@ -375,23 +480,32 @@ VkSurfaceFormatKHR VgeSwapChain::chooseSwapSurfaceFormat(
 VkPresentModeKHR VgeSwapChain::chooseSwapPresentMode(
     const std::vector<VkPresentModeKHR>& availablePresentModes) {
     for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            std::cout << "Present mode: Mailbox" << std::endl;
+        if (availablePresentMode == settings.presentMode) {
+            std::cout << "Present mode: " << getPresentModeName(availablePresentMode) << std::endl;
             return availablePresentMode;
         }
     }
 
-    // for (const auto &availablePresentMode : availablePresentModes) {
-    //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-    //     std::cout << "Present mode: Immediate" << std::endl;
-    //     return availablePresentMode;
-    //   }
-    // }
-
-    std::cout << "Present mode: V-Sync" << std::endl;
+    std::cout << "Present mode: " << getPresentModeName(settings.presentMode)
+              << " unsupported, using V-Sync" << std::endl;
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+const char* VgeSwapChain::getPresentModeName(VkPresentModeKHR mode) {
+    switch (mode) {
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "V-Sync";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "Relaxed V-Sync";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "Mailbox";
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "Immediate";
+        default:
+            return "Unknown";
+    }
+}
+
 VkExtent2D VgeSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
     if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
         return capabilities.currentExtent;
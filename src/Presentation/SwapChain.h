@@ -11,12 +11,23 @@
 
 namespace vge {
 
+// On a headless device there is no surface, and the swap chain cycles through offscreen images
+// it owns instead. They are left in TRANSFER_SRC_OPTIMAL for reading back, and nothing is
+// presented.
 class VgeSwapChain {
    public:
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-
-    VgeSwapChain(VgeDevice& deviceRef, VkExtent2D windowExtent);
-    VgeSwapChain(VgeDevice& deviceRef, VkExtent2D windowExtent,
+    // Per frame resources are sized for this many frames and cycled through in order, the
+    // framesInFlight setting only limits how far the CPU may run ahead of the GPU
+    static constexpr int MAX_FRAMES_IN_FLIGHT = 3;
+
+    struct Settings {
+        // Falls back to FIFO, the one mode every device supports
+        VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+        uint32_t framesInFlight = 2;  // 1 to MAX_FRAMES_IN_FLIGHT
+    };
+
+    VgeSwapChain(VgeDevice& deviceRef, VkExtent2D windowExtent, const Settings& settings);
+    VgeSwapChain(VgeDevice& deviceRef, VkExtent2D windowExtent, const Settings& settings,
                  std::shared_ptr<VgeSwapChain> previous);
     ~VgeSwapChain();
 
@@ -29,9 +40,21 @@ class VgeSwapChain {
     VkRenderPass getRenderPass() {
         return renderPass;
     }
+    // Compatible with getRenderPass() and its framebuffers, but loads the color attachment from
+    // a transfer into the image instead of clearing it. VK_NULL_HANDLE when the images can not
+    // be transfer destinations.
+    VkRenderPass getOverlayRenderPass() {
+        return overlayRenderPass;
+    }
+    bool isTransferDestination() const {
+        return transferDestination;
+    }
     VkImageView getImageView(int index) {
         return swapChainImageViews[index];
     }
+    VkImage getImage(int index) {
+        return swapChainImages[index];
+    }
     size_t imageCount() {
         return swapChainImages.size();
     }
@@ -53,6 +76,11 @@ class VgeSwapChain {
                static_cast<float>(swapChainExtent.height);
     }
     VkFormat findDepthFormat();
+    // The mode actually in use, which differs from the requested one when that is unsupported
+    VkPresentModeKHR getPresentMode() const {
+        return presentMode;
+    }
+    static const char* getPresentModeName(VkPresentModeKHR mode);
 
     VkResult acquireNextImage(uint32_t* imageIndex);
     VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
@@ -65,11 +93,14 @@ class VgeSwapChain {
    private:
     void init();
     void createSwapChain();
+    void createOffscreenImages();
     void createImageViews();
     void createDepthResources();
     void createRenderPass();
     void createFramebuffers();
     void createSyncObjects();
+    // Takes over the semaphores of the swap chain this one replaces
+    void adoptSyncObjects(VgeSwapChain& previous);
 
     // Helper functions
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(
@@ -78,29 +109,35 @@ class VgeSwapChain {
         const std::vector<VkPresentModeKHR>& availablePresentModes);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
+    Settings settings;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
     VkFormat swapChainImageFormat;
     VkFormat swapChainDepthFormat;
     VkExtent2D swapChainExtent;
 
     std::vector<VkFramebuffer> swapChainFramebuffers;
     VkRenderPass renderPass;
+    VkRenderPass overlayRenderPass = VK_NULL_HANDLE;
+    bool transferDestination = false;
 
     std::vector<VkImage> depthImages;
     std::vector<VkDeviceMemory> depthImageMemorys;
     std::vector<VkImageView> depthImageViews;
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
+    // Only for headless devices, where the swap chain images are its own
+    std::vector<VkDeviceMemory> offscreenImageMemorys;
 
     VgeDevice& device;
     VkExtent2D windowExtent;
 
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     std::shared_ptr<VgeSwapChain> oldSwapChain;
 
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> imagesInFlight;
+    // Frame that last rendered to each image, on the device's frame timeline
+    std::vector<uint64_t> imageFrames;
     size_t currentFrame = 0;
 };
 
@@ -0,0 +1,188 @@
+#include "CommandRecorder.h"
+
+#include "../Device/JobSystem.h"
+
+// std
+#include <stdexcept>
+
+namespace vge {
+
+// Dynamic state is not inherited from the primary command buffer
+static void beginSecondaryCommandBuffer(VkCommandBuffer commandBuffer,
+                                        const VkCommandBufferInheritanceInfo& inheritance,
+                                        VkCommandBufferUsageFlags flags, VkExtent2D extent) {
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | flags;
+    beginInfo.pInheritanceInfo = &inheritance;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording secondary command buffer!!!");
+    }
+
+    VkViewport viewport{};
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    VkRect2D scissor{{0, 0}, extent};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+VgeCommandRecorder::VgeCommandRecorder(VgeDevice& device, uint32_t frameCount)
+    : vgeDevice{device} {
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = vgeDevice.findPhysicalQueueFamilies().graphicsFamily;
+    // Buffers are never reset one by one, only their whole pool once a frame
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    uint32_t threadCount = vgeDevice.getJobSystem().getThreadCount();
+    framePools.resize(frameCount);
+    for (auto& threadPools : framePools) {
+        threadPools.resize(threadCount);
+        for (auto& pool : threadPools) {
+            if (vkCreateCommandPool(vgeDevice.device(), &poolInfo, nullptr, &pool.commandPool) !=
+                VK_SUCCESS) {
+                throw std::runtime_error("failed to create secondary command pool!!!");
+            }
+        }
+    }
+}
+
+VgeCommandRecorder::~VgeCommandRecorder() {
+    // Destroying a pool frees its command buffers
+    for (auto& threadPools : framePools) {
+        for (auto& pool : threadPools) {
+            vkDestroyCommandPool(vgeDevice.device(), pool.commandPool, nullptr);
+        }
+    }
+}
+
+void VgeCommandRecorder::beginFrame(int frameIndex) {
+    this->frameIndex = frameIndex;
+    for (auto& pool : framePools[frameIndex]) {
+        if (pool.used == 0) {
+            continue;
+        }
+        vkResetCommandPool(vgeDevice.device(), pool.commandPool, 0);
+        pool.used = 0;
+    }
+}
+
+void VgeCommandRecorder::record(FrameInfo& frameInfo, const std::vector<RenderJob>& jobs,
+                                VkRenderPass renderPass, VkFramebuffer framebuffer,
+                                VkExtent2D extent) {
+    if (jobs.empty()) {
+        return;
+    }
+
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = renderPass;
+    inheritance.subpass = 0;
+    inheritance.framebuffer = framebuffer;
+
+    recorded.assign(jobs.size(), VK_NULL_HANDLE);
+    auto& threadPools = framePools[frameIndex];
+    vgeDevice.getJobSystem().parallelFor(
+        static_cast<uint32_t>(jobs.size()), [&](uint32_t index, uint32_t threadIndex) {
+            VkCommandBuffer commandBuffer =
+                beginSecondary(threadPools[threadIndex], inheritance, extent);
+
+            FrameInfo jobInfo = frameInfo;
+            jobInfo.commandBuffer = commandBuffer;
+            jobs[index](jobInfo);
+
+            if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to record secondary command buffer!!!");
+            }
+            recorded[index] = commandBuffer;
+        });
+
+    vkCmdExecuteCommands(frameInfo.commandBuffer, static_cast<uint32_t>(recorded.size()),
+                         recorded.data());
+}
+
+VkCommandBuffer VgeCommandRecorder::beginSecondary(
+    ThreadPool& pool, const VkCommandBufferInheritanceInfo& inheritance, VkExtent2D extent) {
+    if (pool.used == pool.commandBuffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandPool = pool.commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(vgeDevice.device(), &allocInfo, &commandBuffer) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate secondary command buffer!!!");
+        }
+        pool.commandBuffers.push_back(commandBuffer);
+    }
+    VkCommandBuffer commandBuffer = pool.commandBuffers[pool.used++];
+    beginSecondaryCommandBuffer(commandBuffer, inheritance,
+                                VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, extent);
+    return commandBuffer;
+}
+
+VgeCachedCommands::VgeCachedCommands(VgeDevice& device, uint32_t frameCount) : vgeDevice{device} {
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = vgeDevice.findPhysicalQueueFamilies().graphicsFamily;
+    // Each frame index's buffer is re-recorded on its own
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    if (vkCreateCommandPool(vgeDevice.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create cached command pool!!!");
+    }
+
+    std::vector<VkCommandBuffer> commandBuffers(frameCount);
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = frameCount;
+    if (vkAllocateCommandBuffers(vgeDevice.device(), &allocInfo, commandBuffers.data()) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate cached command buffers!!!");
+    }
+
+    slots.resize(frameCount);
+    for (uint32_t i = 0; i < frameCount; i++) {
+        slots[i].commandBuffer = commandBuffers[i];
+    }
+}
+
+VgeCachedCommands::~VgeCachedCommands() {
+    vkDestroyCommandPool(vgeDevice.device(), commandPool, nullptr);
+}
+
+VkCommandBuffer VgeCachedCommands::get(int frameIndex, const Key& key, FrameInfo& frameInfo,
+                                       const RenderJob& job) {
+    Slot& slot = slots[frameIndex];
+    replayCount++;
+    if (slot.recorded && slot.key == key) {
+        return slot.commandBuffer;
+    }
+
+    // Not one time submit, the framebuffer is left out as it changes with the swap chain image
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = key.renderPass;
+    inheritance.subpass = 0;
+    beginSecondaryCommandBuffer(slot.commandBuffer, inheritance, 0, key.extent);
+
+    FrameInfo jobInfo = frameInfo;
+    jobInfo.commandBuffer = slot.commandBuffer;
+    job(jobInfo);
+
+    if (vkEndCommandBuffer(slot.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record cached command buffer!!!");
+    }
+    slot.key = key;
+    slot.recorded = true;
+    recordCount++;
+    return slot.commandBuffer;
+}
+
+}  // namespace vge
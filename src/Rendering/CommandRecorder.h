@@ -0,0 +1,111 @@
+#pragma once
+
+#include "../Device/Device.h"
+#include "../FrameInfo.h"
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <functional>
+#include <vector>
+
+namespace vge {
+
+// Records part of a render pass into frameInfo.commandBuffer, which is a secondary command buffer
+// of its own when the renderer records in parallel
+using RenderJob = std::function<void(FrameInfo& frameInfo)>;
+
+// Records render pass contents into secondary command buffers, one per job, spread over the
+// device's job system. Command pools may only be used by one thread at a time, so every job
+// system thread has its own pool per frame index. The pools of a frame index are reset when it
+// comes around again, once the frame that last used them has completed.
+class VgeCommandRecorder {
+public:
+    VgeCommandRecorder(VgeDevice& device, uint32_t frameCount);
+    ~VgeCommandRecorder();
+
+    VgeCommandRecorder(const VgeCommandRecorder&) = delete;
+    VgeCommandRecorder& operator=(const VgeCommandRecorder&) = delete;
+
+    // Call once the frame that last used this index has completed
+    void beginFrame(int frameIndex);
+
+    // Records the jobs in parallel and executes them on frameInfo.commandBuffer in order. It must
+    // be inside a subpass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, extent is the
+    // viewport the jobs draw to, as dynamic state is not inherited.
+    void record(FrameInfo& frameInfo, const std::vector<RenderJob>& jobs, VkRenderPass renderPass,
+                VkFramebuffer framebuffer, VkExtent2D extent);
+
+private:
+    struct ThreadPool {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> commandBuffers;
+        size_t used = 0;
+    };
+
+    VkCommandBuffer beginSecondary(ThreadPool& pool,
+                                   const VkCommandBufferInheritanceInfo& inheritance,
+                                   VkExtent2D extent);
+
+    VgeDevice& vgeDevice;
+    // Indexed by frame index, then by job system thread
+    std::vector<std::vector<ThreadPool>> framePools;
+    int frameIndex = 0;
+    std::vector<VkCommandBuffer> recorded;
+};
+
+// Commands for content that rarely changes, recorded once into a secondary command buffer per
+// frame index and replayed every frame after that. A frame index's buffer is recorded again the
+// first time it is used with a different key, see Renderer::recordCached. Whatever the commands
+// read that is not covered by the key, such as the camera, has to come from buffers.
+class VgeCachedCommands {
+public:
+    struct Key {
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        VkExtent2D extent{0, 0};
+        VkDescriptorSet globalDescriptorSet = VK_NULL_HANDLE;
+        uint32_t globalUboOffset = 0;
+        // Bumped by the owner whenever the content changes
+        uint64_t version = 0;
+
+        bool operator==(const Key& other) const {
+            return renderPass == other.renderPass && extent.width == other.extent.width &&
+                   extent.height == other.extent.height &&
+                   globalDescriptorSet == other.globalDescriptorSet &&
+                   globalUboOffset == other.globalUboOffset && version == other.version;
+        }
+    };
+
+    VgeCachedCommands(VgeDevice& device, uint32_t frameCount);
+    ~VgeCachedCommands();
+
+    VgeCachedCommands(const VgeCachedCommands&) = delete;
+    VgeCachedCommands& operator=(const VgeCachedCommands&) = delete;
+
+    // The buffer of this frame index, recorded through job first when its key differs. The frame
+    // that last used the frame index must have completed.
+    VkCommandBuffer get(int frameIndex, const Key& key, FrameInfo& frameInfo, const RenderJob& job);
+
+    // How often the commands were recorded, against the frames they were replayed in
+    uint64_t getRecordCount() const {
+        return recordCount;
+    }
+    uint64_t getReplayCount() const {
+        return replayCount;
+    }
+
+private:
+    struct Slot {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        Key key{};
+        bool recorded = false;
+    };
+
+    VgeDevice& vgeDevice;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    std::vector<Slot> slots;
+    uint64_t recordCount = 0;
+    uint64_t replayCount = 0;
+};
+
+}  // namespace vge
@@ -0,0 +1,175 @@
+#include "FrameCapture.h"
+
+// std
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace vge {
+
+static constexpr uint32_t BYTES_PER_PIXEL = 4;
+// Largest block deflate can store uncompressed
+static constexpr size_t MAX_STORED_BLOCK = 65535;
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        return table;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static void appendChunk(std::vector<uint8_t>& out, const char* type,
+                        const std::vector<uint8_t>& data) {
+    appendBigEndian(out, static_cast<uint32_t>(data.size()));
+    size_t typeStart = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    appendBigEndian(out, crc32(out.data() + typeStart, out.size() - typeStart));
+}
+
+void VgeFrameCapture::record(VkCommandBuffer commandBuffer, VkImage image, VkExtent2D extent) {
+    VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * BYTES_PER_PIXEL;
+    if (!readbackBuffer || readbackBuffer->getBufferSize() < size) {
+        // Captures wait for their frame, so no frame in flight can still be copying into it
+        readbackBuffer = std::make_unique<VgeBuffer>(
+            vgeDevice, size, 1, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+    capturedExtent = extent;
+
+    // The render pass leaves the image in TRANSFER_SRC_OPTIMAL, only its writes need ordering
+    VkImageMemoryBarrier toTransfer{};
+    toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    toTransfer.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.image = image;
+    toTransfer.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1,
+                         &toTransfer);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;  // tightly packed
+    region.bufferImageHeight = 0;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           readbackBuffer->getBuffer(), 1, &region);
+
+    VkMemoryBarrier toHost{};
+    toHost.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &toHost, 0, nullptr, 0, nullptr);
+}
+
+void VgeFrameCapture::write(const std::string& path) {
+    if (!readbackBuffer) {
+        throw std::runtime_error("no frame recorded for capture!!!");
+    }
+
+    readbackBuffer->map();
+    auto* pixels = static_cast<const uint8_t*>(readbackBuffer->getMappedMemory());
+    bool png = path.size() >= 4 && path.compare(path.size() - 4, 4, ".png") == 0;
+    if (png) {
+        writePng(path, pixels, capturedExtent);
+    } else {
+        writeRaw(path, pixels, capturedExtent);
+    }
+    readbackBuffer->unmap();
+}
+
+void VgeFrameCapture::writePng(const std::string& path, const uint8_t* pixels,
+                               VkExtent2D extent) {
+    // Scanlines with filter type 0, stored in uncompressed deflate blocks. Files are larger
+    // than they need to be, but there is no compression library to depend on.
+    size_t rowSize = static_cast<size_t>(extent.width) * BYTES_PER_PIXEL;
+    std::vector<uint8_t> scanlines;
+    scanlines.reserve((rowSize + 1) * extent.height);
+    for (uint32_t y = 0; y < extent.height; y++) {
+        scanlines.push_back(0);
+        scanlines.insert(scanlines.end(), pixels + y * rowSize, pixels + (y + 1) * rowSize);
+    }
+
+    std::vector<uint8_t> zlib{0x78, 0x01};
+    size_t offset = 0;
+    do {
+        size_t blockSize = std::min(MAX_STORED_BLOCK, scanlines.size() - offset);
+        bool last = offset + blockSize == scanlines.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(blockSize));
+        zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+        zlib.push_back(static_cast<uint8_t>(~blockSize));
+        zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+        zlib.insert(zlib.end(), scanlines.begin() + offset,
+                    scanlines.begin() + offset + blockSize);
+        offset += blockSize;
+    } while (offset < scanlines.size());
+
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (uint8_t byte : scanlines) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian(zlib, (b << 16) | a);
+
+    std::vector<uint8_t> header;
+    appendBigEndian(header, extent.width);
+    appendBigEndian(header, extent.height);
+    header.push_back(8);  // bits per channel
+    header.push_back(6);  // RGBA
+    header.push_back(0);  // deflate
+    header.push_back(0);  // adaptive filtering
+    header.push_back(0);  // not interlaced
+
+    std::vector<uint8_t> file{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    appendChunk(file, "IHDR", header);
+    appendChunk(file, "IDAT", zlib);
+    appendChunk(file, "IEND", {});
+
+    std::ofstream out{path, std::ios::binary};
+    if (!out.write(reinterpret_cast<const char*>(file.data()), file.size())) {
+        throw std::runtime_error("failed to write capture " + path + "!!!");
+    }
+}
+
+void VgeFrameCapture::writeRaw(const std::string& path, const uint8_t* pixels,
+                               VkExtent2D extent) {
+    size_t size = static_cast<size_t>(extent.width) * extent.height * BYTES_PER_PIXEL;
+    std::ofstream out{path, std::ios::binary};
+    if (!out.write(reinterpret_cast<const char*>(pixels), size)) {
+        throw std::runtime_error("failed to write capture " + path + "!!!");
+    }
+}
+
+}  // namespace vge
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../Buffer/Buffer.h"
+#include "../Device/Device.h"
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <memory>
+#include <string>
+
+namespace vge {
+
+// Copies a rendered RGBA8 image into host memory and writes it out, for headless runs where
+// there is no window to look at. Files ending in .png are written as PNG, anything else as raw
+// tightly packed RGBA rows, top row first.
+class VgeFrameCapture {
+public:
+    explicit VgeFrameCapture(VgeDevice& device) : vgeDevice{device} {}
+
+    VgeFrameCapture(const VgeFrameCapture&) = delete;
+    VgeFrameCapture& operator=(const VgeFrameCapture&) = delete;
+
+    // Records the copy, the image must be in TRANSFER_SRC_OPTIMAL after color attachment writes
+    void record(VkCommandBuffer commandBuffer, VkImage image, VkExtent2D extent);
+    // Only once the frame that recorded the copy has finished on the GPU
+    void write(const std::string& path);
+
+private:
+    static void writePng(const std::string& path, const uint8_t* pixels, VkExtent2D extent);
+    static void writeRaw(const std::string& path, const uint8_t* pixels, VkExtent2D extent);
+
+    VgeDevice& vgeDevice;
+    std::unique_ptr<VgeBuffer> readbackBuffer;
+    VkExtent2D capturedExtent{0, 0};
+};
+
+}  // namespace vge
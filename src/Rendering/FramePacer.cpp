@@ -0,0 +1,74 @@
+#include "FramePacer.h"
+
+// std
+#include <algorithm>
+#include <thread>
+
+namespace vge {
+
+// A wait shorter than this means the slot was already free when beginFrame asked for it
+static constexpr float GATED_THRESHOLD = 0.05f;
+// How much the interval shrinks per frame while the pacer is not gated, in case the GPU sped up
+static constexpr float PROBE_FACTOR = 0.98f;
+// OS sleeps overshoot, the last stretch before a target is spun out instead
+static constexpr auto SPIN_WINDOW = std::chrono::microseconds(1500);
+
+static FramePacer::Clock::duration toDuration(float milliseconds) {
+    return std::chrono::duration_cast<FramePacer::Clock::duration>(
+        std::chrono::duration<float, std::milli>(milliseconds));
+}
+
+static float toMilliseconds(FramePacer::Clock::duration duration) {
+    return std::chrono::duration<float, std::milli>(duration).count();
+}
+
+void FramePacer::waitForNextFrame() {
+    auto now = Clock::now();
+    auto target = now;
+    if (settings.enabled && hasHistory) {
+        target = std::max(target, lastReady + toDuration(frameInterval - settings.safetyMargin -
+                                                         cpuLead));
+    }
+    if (settings.frameRateCap > 0.0f && lastWake != Clock::time_point{}) {
+        target = std::max(target, lastWake + toDuration(1000.0f / settings.frameRateCap));
+    }
+
+    if (target > now) {
+        sleepUntil(target);
+    }
+    lastWake = Clock::now();
+    sleepTime = toMilliseconds(lastWake - now);
+}
+
+void FramePacer::frameBegun(Clock::time_point waitStart, Clock::time_point ready) {
+    slotWaitTime = toMilliseconds(ready - waitStart);
+    if (lastWake != Clock::time_point{}) {
+        float lead = std::max(0.0f, toMilliseconds(waitStart - lastWake));
+        cpuLead = cpuLead * 0.9f + lead * 0.1f;
+    }
+
+    if (hasHistory) {
+        float interval = toMilliseconds(ready - lastReady);
+        if (slotWaitTime > GATED_THRESHOLD) {
+            // The GPU or the display decided when the slot came free, so this is the real pace
+            frameInterval =
+                frameInterval == 0.0f ? interval : frameInterval * 0.9f + interval * 0.1f;
+        } else {
+            // Only says when the loop showed up, which the pacer itself chose
+            frameInterval = std::min(frameInterval, interval) * PROBE_FACTOR;
+        }
+    }
+    lastReady = ready;
+    hasHistory = true;
+}
+
+void FramePacer::sleepUntil(Clock::time_point target) {
+    if (Clock::now() < target - SPIN_WINDOW) {
+        std::this_thread::sleep_until(target - SPIN_WINDOW);
+    }
+    while (Clock::now() < target) {
+        std::this_thread::yield();
+    }
+}
+
+}  // namespace vge
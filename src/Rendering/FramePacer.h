@@ -0,0 +1,54 @@
+#pragma once
+
+// std
+#include <chrono>
+
+namespace vge {
+
+// Moves input sampling as close to the start of GPU work as it can. Without it the main loop
+// reads input, then blocks in beginFrame until a frame slot frees up, so under v-sync the camera
+// is up to a frame old before recording even starts. The pacer remembers when beginFrame last
+// got its slot and how far apart slots come, sleeps until just before the next one is due, and
+// only then lets the loop poll input. Throughput is unchanged as long as it wakes early enough,
+// so when it was ever late it probes the interval back down. Also applies an optional cap.
+class FramePacer {
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    struct Settings {
+        bool enabled = true;
+        float safetyMargin = 1.5f;  // ms to wake ahead of the predicted slot
+        float frameRateCap = 0.0f;  // frames per second, 0 for uncapped
+    };
+
+    // Call before polling input
+    void waitForNextFrame();
+    // Called by the renderer once beginFrame has its frame slot, with when it started waiting
+    void frameBegun(Clock::time_point waitStart, Clock::time_point ready);
+
+    // Milliseconds, for display
+    float getSleepTime() const {
+        return sleepTime;
+    }
+    float getSlotWaitTime() const {
+        return slotWaitTime;
+    }
+    float getFrameInterval() const {
+        return frameInterval;
+    }
+
+    Settings settings{};
+
+private:
+    static void sleepUntil(Clock::time_point target);
+
+    bool hasHistory = false;
+    Clock::time_point lastReady;
+    Clock::time_point lastWake;
+    float frameInterval = 0.0f;  // smoothed time between frame slots, ms
+    float cpuLead = 0.0f;        // smoothed time from waking to beginFrame, ms
+    float sleepTime = 0.0f;
+    float slotWaitTime = 0.0f;
+};
+
+}  // namespace vge
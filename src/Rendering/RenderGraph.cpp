@@ -0,0 +1,520 @@
+#include "RenderGraph.h"
+
+#include "../Device/DeletionQueue.h"
+#include "../Utils/utils.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace vge {
+
+namespace {
+
+struct AccessInfo {
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    VkImageLayout layout;  // for images only
+    bool write;
+};
+
+AccessInfo getAccessInfo(VgeRenderGraph::Access access) {
+    using Access = VgeRenderGraph::Access;
+    switch (access) {
+        case Access::VertexBuffer:
+            return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+                    VK_IMAGE_LAYOUT_UNDEFINED, false};
+        case Access::ComputeRead:
+            return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                    VK_IMAGE_LAYOUT_GENERAL, false};
+        case Access::ComputeWrite:
+            return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_GENERAL, true};
+        case Access::ComputeReadWrite:
+            return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_GENERAL, true};
+        case Access::TransferWrite:
+            return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true};
+        case Access::FragmentSampled:
+            return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+        case Access::ColorAttachment:
+            return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                    VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true};
+    }
+    throw std::runtime_error("unknown render graph access!!!");
+}
+
+constexpr VkAccessFlags WRITE_ACCESS_MASK =
+    VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+VgeRenderGraph::PassBuilder& VgeRenderGraph::PassBuilder::access(Resource resource,
+                                                                 Access access) {
+    if (resource.isValid()) {
+        assert(resource.index < graph.resources.size() && "Resource from another frame");
+        graph.passes[passIndex].accesses.emplace_back(resource.index, access);
+    }
+    return *this;
+}
+
+VgeRenderGraph::PassBuilder& VgeRenderGraph::PassBuilder::execute(
+    std::function<void(VkCommandBuffer)> callback) {
+    graph.passes[passIndex].callback = std::move(callback);
+    return *this;
+}
+
+VgeRenderGraph::VgeRenderGraph(VgeDevice& device) : vgeDevice{device} {}
+
+VgeRenderGraph::~VgeRenderGraph() {
+    for (auto& heap : heaps) {
+        retireHeap(heap);
+    }
+}
+
+void VgeRenderGraph::beginFrame(int frameIndex) {
+    this->frameIndex = frameIndex;
+    resources.clear();
+    passes.clear();
+    transients.clear();
+}
+
+VgeRenderGraph::Resource VgeRenderGraph::importBuffer(const std::string& name, VkBuffer buffer) {
+    ResourceNode node{};
+    node.name = name;
+    node.kind = ResourceKind::ImportedBuffer;
+    node.buffer = buffer;
+    resources.push_back(std::move(node));
+    return {static_cast<uint32_t>(resources.size() - 1)};
+}
+
+VgeRenderGraph::Resource VgeRenderGraph::importExternal(const std::string& name) {
+    ResourceNode node{};
+    node.name = name;
+    node.kind = ResourceKind::External;
+    resources.push_back(std::move(node));
+    return {static_cast<uint32_t>(resources.size() - 1)};
+}
+
+VgeRenderGraph::Resource VgeRenderGraph::createBuffer(const std::string& name,
+                                                      const BufferDesc& desc) {
+    ResourceNode node{};
+    node.name = name;
+    node.kind = ResourceKind::TransientBuffer;
+    node.bufferDesc = desc;
+    resources.push_back(std::move(node));
+    return {static_cast<uint32_t>(resources.size() - 1)};
+}
+
+VgeRenderGraph::Resource VgeRenderGraph::createImage(const std::string& name,
+                                                     const ImageDesc& desc) {
+    ResourceNode node{};
+    node.name = name;
+    node.kind = ResourceKind::TransientImage;
+    node.imageDesc = desc;
+    resources.push_back(std::move(node));
+    return {static_cast<uint32_t>(resources.size() - 1)};
+}
+
+VgeRenderGraph::PassBuilder VgeRenderGraph::addPass(const std::string& name) {
+    PassNode pass{};
+    pass.name = name;
+    passes.push_back(std::move(pass));
+    return PassBuilder{*this, static_cast<uint32_t>(passes.size() - 1)};
+}
+
+void VgeRenderGraph::markOutput(Resource resource) {
+    if (resource.isValid()) {
+        resources[resource.index].output = true;
+    }
+}
+
+bool VgeRenderGraph::isWrite(Access access) {
+    return getAccessInfo(access).write;
+}
+
+void VgeRenderGraph::execute(VkCommandBuffer commandBuffer) {
+    stats = {};
+    cullPasses();
+    computeLifetimes();
+    realizeTransients();
+
+    std::vector<SyncState> states(resources.size());
+    for (size_t i = 0; i < resources.size(); i++) {
+        if (resources[i].kind == ResourceKind::ImportedBuffer) {
+            // Written by last frame or by anything outside the graph
+            states[i].writeStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            states[i].writeAccess = VK_ACCESS_MEMORY_WRITE_BIT;
+        }
+    }
+
+    for (uint32_t i = 0; i < passes.size(); i++) {
+        PassNode& pass = passes[i];
+        if (pass.culled) {
+            stats.culledPasses++;
+            continue;
+        }
+        stats.passes++;
+
+        recordBarriers(commandBuffer, i, states);
+        if (pass.callback) {
+            pass.callback(commandBuffer);
+        }
+    }
+}
+
+void VgeRenderGraph::cullPasses() {
+    // Walking backwards, a pass survives if something still needed reads what it writes.
+    // Imported resources outlive the frame, so writing one always counts.
+    std::vector<bool> needed(resources.size(), false);
+    for (size_t i = 0; i < resources.size(); i++) {
+        needed[i] = resources[i].output || resources[i].kind == ResourceKind::ImportedBuffer ||
+                    resources[i].kind == ResourceKind::External;
+    }
+
+    for (auto pass = passes.rbegin(); pass != passes.rend(); ++pass) {
+        pass->culled = std::none_of(
+            pass->accesses.begin(), pass->accesses.end(),
+            [&](const auto& access) { return isWrite(access.second) && needed[access.first]; });
+        if (pass->culled) {
+            continue;
+        }
+        for (const auto& [resource, access] : pass->accesses) {
+            needed[resource] = true;
+        }
+    }
+}
+
+void VgeRenderGraph::computeLifetimes() {
+    for (int i = 0; i < static_cast<int>(passes.size()); i++) {
+        if (passes[i].culled) {
+            continue;
+        }
+        for (const auto& [resource, access] : passes[i].accesses) {
+            ResourceNode& node = resources[resource];
+            if (node.firstPass < 0) {
+                node.firstPass = i;
+            }
+            node.lastPass = i;
+        }
+    }
+
+    // Transients no surviving pass touches get no memory at all
+    for (uint32_t i = 0; i < resources.size(); i++) {
+        ResourceNode& node = resources[i];
+        bool transient = node.kind == ResourceKind::TransientBuffer ||
+                         node.kind == ResourceKind::TransientImage;
+        if (transient && node.firstPass >= 0) {
+            node.transientIndex = static_cast<uint32_t>(transients.size());
+            transients.push_back(i);
+        }
+    }
+}
+
+std::size_t VgeRenderGraph::hashTransients() const {
+    std::size_t seed = transients.size();
+    for (uint32_t index : transients) {
+        const ResourceNode& node = resources[index];
+        hashCombine(seed, static_cast<int>(node.kind), node.firstPass, node.lastPass);
+        if (node.kind == ResourceKind::TransientBuffer) {
+            hashCombine(seed, node.bufferDesc.size, node.bufferDesc.usage);
+        } else {
+            hashCombine(seed, node.imageDesc.extent.width, node.imageDesc.extent.height,
+                        static_cast<int>(node.imageDesc.format), node.imageDesc.usage);
+        }
+    }
+    return seed;
+}
+
+void VgeRenderGraph::realizeTransients() {
+    TransientHeap& heap = heaps[frameIndex];
+    std::size_t key = hashTransients();
+    if (heap.key != key || (heap.memory == VK_NULL_HANDLE && !transients.empty())) {
+        retireHeap(heap);
+        heap.key = key;
+
+        VkDevice device = vgeDevice.device();
+        size_t count = transients.size();
+        heap.buffers.assign(count, VK_NULL_HANDLE);
+        heap.images.assign(count, VK_NULL_HANDLE);
+        heap.imageViews.assign(count, VK_NULL_HANDLE);
+        heap.offsets.assign(count, 0);
+        heap.sizes.assign(count, 0);
+
+        std::vector<VkMemoryRequirements> requirements(count);
+        uint32_t memoryTypeBits = ~0u;
+        for (size_t t = 0; t < count; t++) {
+            const ResourceNode& node = resources[transients[t]];
+            if (node.kind == ResourceKind::TransientBuffer) {
+                VkBufferCreateInfo bufferInfo{};
+                bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+                bufferInfo.size = node.bufferDesc.size;
+                bufferInfo.usage = node.bufferDesc.usage;
+                bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+                if (vkCreateBuffer(device, &bufferInfo, nullptr, &heap.buffers[t]) !=
+                    VK_SUCCESS) {
+                    throw std::runtime_error("failed to create render graph buffer!!!");
+                }
+                vkGetBufferMemoryRequirements(device, heap.buffers[t], &requirements[t]);
+            } else {
+                VkImageCreateInfo imageInfo{};
+                imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+                imageInfo.imageType = VK_IMAGE_TYPE_2D;
+                imageInfo.extent = {node.imageDesc.extent.width, node.imageDesc.extent.height, 1};
+                imageInfo.mipLevels = 1;
+                imageInfo.arrayLayers = 1;
+                imageInfo.format = node.imageDesc.format;
+                imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+                imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                imageInfo.usage = node.imageDesc.usage;
+                imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+                imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+                if (vkCreateImage(device, &imageInfo, nullptr, &heap.images[t]) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create render graph image!!!");
+                }
+                vkGetImageMemoryRequirements(device, heap.images[t], &requirements[t]);
+            }
+            memoryTypeBits &= requirements[t].memoryTypeBits;
+        }
+
+        // Greedy first fit, largest first. Two transients may share bytes only when no pass
+        // uses both, buffers and images are kept a full granularity apart.
+        std::vector<size_t> order(count);
+        for (size_t t = 0; t < count; t++) {
+            order[t] = t;
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return requirements[a].size > requirements[b].size;
+        });
+
+        VkDeviceSize granularity = vgeDevice.properties.limits.bufferImageGranularity;
+        std::vector<size_t> placed;
+        for (size_t t : order) {
+            const ResourceNode& node = resources[transients[t]];
+            VkDeviceSize alignment = std::max(requirements[t].alignment, granularity);
+
+            std::vector<std::pair<VkDeviceSize, VkDeviceSize>> taken;
+            for (size_t other : placed) {
+                const ResourceNode& otherNode = resources[transients[other]];
+                if (node.firstPass <= otherNode.lastPass && otherNode.firstPass <= node.lastPass) {
+                    taken.emplace_back(heap.offsets[other],
+                                       heap.offsets[other] + heap.sizes[other]);
+                }
+            }
+            std::sort(taken.begin(), taken.end());
+
+            VkDeviceSize offset = 0;
+            for (const auto& [begin, end] : taken) {
+                if (offset + requirements[t].size <= begin) {
+                    break;
+                }
+                offset = std::max(offset, alignUp(end, alignment));
+            }
+
+            heap.offsets[t] = offset;
+            heap.sizes[t] = requirements[t].size;
+            heap.size = std::max(heap.size, offset + requirements[t].size);
+            heap.requestedSize += requirements[t].size;
+            placed.push_back(t);
+        }
+
+        if (count > 0) {
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = heap.size;
+            allocInfo.memoryTypeIndex =
+                vgeDevice.findMemoryType(memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            if (vkAllocateMemory(device, &allocInfo, nullptr, &heap.memory) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate render graph memory!!!");
+            }
+        }
+
+        for (size_t t = 0; t < count; t++) {
+            if (heap.buffers[t] != VK_NULL_HANDLE) {
+                if (vkBindBufferMemory(device, heap.buffers[t], heap.memory, heap.offsets[t]) !=
+                    VK_SUCCESS) {
+                    throw std::runtime_error("failed to bind render graph buffer memory!!!");
+                }
+                continue;
+            }
+            if (vkBindImageMemory(device, heap.images[t], heap.memory, heap.offsets[t]) !=
+                VK_SUCCESS) {
+                throw std::runtime_error("failed to bind render graph image memory!!!");
+            }
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = heap.images[t];
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = resources[transients[t]].imageDesc.format;
+            viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+            if (vkCreateImageView(device, &viewInfo, nullptr, &heap.imageViews[t]) !=
+                VK_SUCCESS) {
+                throw std::runtime_error("failed to create render graph image view!!!");
+            }
+        }
+    }
+
+    for (size_t t = 0; t < transients.size(); t++) {
+        ResourceNode& node = resources[transients[t]];
+        node.buffer = heap.buffers[t];
+        node.image = heap.images[t];
+        node.imageView = heap.imageViews[t];
+    }
+    stats.transientBytes = heap.size;
+    stats.requestedBytes = heap.requestedSize;
+}
+
+void VgeRenderGraph::retireHeap(TransientHeap& heap) {
+    if (heap.memory != VK_NULL_HANDLE) {
+        VkDevice device = vgeDevice.device();
+        vgeDevice.getDeletionQueue().push([device, memory = heap.memory, buffers = heap.buffers,
+                                           images = heap.images, views = heap.imageViews]() {
+            for (VkImageView view : views) {
+                vkDestroyImageView(device, view, nullptr);
+            }
+            for (VkImage image : images) {
+                vkDestroyImage(device, image, nullptr);
+            }
+            for (VkBuffer buffer : buffers) {
+                vkDestroyBuffer(device, buffer, nullptr);
+            }
+            vkFreeMemory(device, memory, nullptr);
+        });
+    }
+    heap = TransientHeap{};
+}
+
+bool VgeRenderGraph::aliases(uint32_t a, uint32_t b) const {
+    const TransientHeap& heap = heaps[frameIndex];
+    return heap.offsets[a] < heap.offsets[b] + heap.sizes[b] &&
+           heap.offsets[b] < heap.offsets[a] + heap.sizes[a];
+}
+
+void VgeRenderGraph::recordBarriers(VkCommandBuffer commandBuffer, uint32_t passIndex,
+                                    std::vector<SyncState>& states) {
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    bool needsMemoryBarrier = false;
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+
+    for (const auto& [index, access] : passes[passIndex].accesses) {
+        const ResourceNode& node = resources[index];
+        if (node.kind == ResourceKind::External) {
+            continue;
+        }
+        AccessInfo info = getAccessInfo(access);
+        SyncState& state = states[index];
+        bool image = node.kind == ResourceKind::TransientImage;
+
+        if (node.transientIndex != Resource::INVALID &&
+            node.firstPass == static_cast<int>(passIndex)) {
+            // First use of aliased memory, whatever used those bytes before has to be done
+            for (uint32_t other : transients) {
+                const ResourceNode& otherNode = resources[other];
+                if (otherNode.lastPass < node.firstPass &&
+                    aliases(node.transientIndex, otherNode.transientIndex)) {
+                    state.writeStages |= states[other].writeStages;
+                    state.writeAccess |= states[other].writeAccess;
+                    state.readStages |= states[other].readStages;
+                }
+            }
+        }
+
+        bool layoutChange = image && state.layout != info.layout;
+        VkPipelineStageFlags waitStages = 0;
+        VkAccessFlags flushAccess = 0;
+        if (info.write || layoutChange) {
+            // Write after read or write: earlier accesses must finish, earlier writes flushed
+            waitStages = state.writeStages | state.readStages;
+            flushAccess = state.writeAccess;
+        } else if (state.writeStages != 0 && (state.visibleStages & info.stages) != info.stages) {
+            // Read after write the reading stages have not been shown yet
+            waitStages = state.writeStages;
+            flushAccess = state.writeAccess;
+        }
+
+        bool hazard = waitStages != 0 || layoutChange;
+        if (hazard) {
+            srcStages |= waitStages;
+            dstStages |= info.stages;
+            if (image) {
+                VkImageMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.srcAccessMask = flushAccess;
+                barrier.dstAccessMask = info.access;
+                barrier.oldLayout = state.layout;  // UNDEFINED on first use, contents discarded
+                barrier.newLayout = info.layout;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = node.image;
+                barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+                imageBarriers.push_back(barrier);
+                if (layoutChange) {
+                    stats.imageTransitions++;
+                }
+            } else {
+                memoryBarrier.srcAccessMask |= flushAccess;
+                memoryBarrier.dstAccessMask |= info.access;
+                needsMemoryBarrier = true;
+            }
+        }
+
+        if (info.write) {
+            state.writeStages = info.stages;
+            state.writeAccess = info.access & WRITE_ACCESS_MASK;
+            state.readStages = 0;
+            state.visibleStages = 0;
+        } else {
+            if (layoutChange) {
+                // Later barriers chain through the one that moved the layout
+                state.writeStages |= info.stages;
+            }
+            state.readStages |= info.stages;
+            if (hazard) {
+                state.visibleStages |= info.stages;
+            }
+        }
+        if (image) {
+            state.layout = info.layout;
+        }
+    }
+
+    if (!needsMemoryBarrier && imageBarriers.empty()) {
+        return;
+    }
+    if (srcStages == 0) {
+        // Only layout transitions of fresh images, nothing to wait for
+        srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    }
+    vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, needsMemoryBarrier ? 1 : 0,
+                         &memoryBarrier, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()),
+                         imageBarriers.data());
+    stats.barriers++;
+}
+
+VkBuffer VgeRenderGraph::getBuffer(Resource resource) const {
+    return resources[resource.index].buffer;
+}
+
+VkImage VgeRenderGraph::getImage(Resource resource) const {
+    return resources[resource.index].image;
+}
+
+VkImageView VgeRenderGraph::getImageView(Resource resource) const {
+    return resources[resource.index].imageView;
+}
+
+}  // namespace vge
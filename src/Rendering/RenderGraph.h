@@ -0,0 +1,183 @@
+#pragma once
+
+#include "../Device/Device.h"
+#include "../Presentation/SwapChain.h"
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace vge {
+
+// Frame graph rebuilt every frame. Systems add passes and declare how each one touches its
+// resources instead of writing barriers by hand. execute() then:
+//  - culls passes whose results never reach an imported resource or one marked as output,
+//  - places transient buffers and images in one memory heap per frame in flight, aliasing
+//    resources whose lifetimes do not overlap,
+//  - records the surviving passes in order, each behind one merged barrier covering exactly the
+//    hazards and layout changes its accesses need.
+// Everything runs on the command buffer it is given, in declaration order. There is no queue
+// assignment: the device has no async compute queue, so compute passes are not moved off the
+// graphics queue. A pass without an execute callback is recorded by its owner afterwards, e.g.
+// the scene pass inside the swap chain render pass; the graph still places its barriers, so
+// such passes go last. Work recorded outside the graph, such as the resolution scaler's
+// upscale, keeps its own barriers.
+class VgeRenderGraph {
+public:
+    enum class Access {
+        VertexBuffer,
+        ComputeRead,       // storage buffer or storage image read
+        ComputeWrite,      // storage buffer or storage image write
+        ComputeReadWrite,  // e.g. atomics
+        TransferWrite,
+        FragmentSampled,
+        ColorAttachment,
+    };
+
+    struct Resource {
+        static constexpr uint32_t INVALID = ~0u;
+        uint32_t index = INVALID;
+
+        bool isValid() const {
+            return index != INVALID;
+        }
+    };
+
+    struct BufferDesc {
+        VkDeviceSize size;
+        VkBufferUsageFlags usage;
+    };
+
+    struct ImageDesc {
+        VkExtent2D extent;
+        VkFormat format;
+        VkImageUsageFlags usage;
+    };
+
+    struct Stats {
+        uint32_t passes = 0;
+        uint32_t culledPasses = 0;
+        uint32_t barriers = 0;
+        uint32_t imageTransitions = 0;
+        VkDeviceSize transientBytes = 0;  // heap size with aliasing
+        VkDeviceSize requestedBytes = 0;  // what the transients would take without it
+    };
+
+    class PassBuilder {
+    public:
+        PassBuilder(VgeRenderGraph& graph, uint32_t passIndex)
+            : graph{graph}, passIndex{passIndex} {}
+
+        // Invalid resources are ignored, so optional inputs can be passed straight through
+        PassBuilder& access(Resource resource, Access access);
+        PassBuilder& execute(std::function<void(VkCommandBuffer)> callback);
+
+    private:
+        VgeRenderGraph& graph;
+        uint32_t passIndex;
+    };
+
+    explicit VgeRenderGraph(VgeDevice& device);
+    ~VgeRenderGraph();
+
+    VgeRenderGraph(const VgeRenderGraph&) = delete;
+    VgeRenderGraph& operator=(const VgeRenderGraph&) = delete;
+
+    // Drops last frame's passes and resources, transient memory for this frame index is reused
+    void beginFrame(int frameIndex);
+
+    // Imported resources start out as if anything earlier may have written them
+    Resource importBuffer(const std::string& name, VkBuffer buffer);
+    // Only ordered and culled against, whoever owns it handles its synchronization
+    Resource importExternal(const std::string& name);
+    Resource createBuffer(const std::string& name, const BufferDesc& desc);
+    Resource createImage(const std::string& name, const ImageDesc& desc);
+    PassBuilder addPass(const std::string& name);
+    void markOutput(Resource resource);
+
+    void execute(VkCommandBuffer commandBuffer);
+
+    // Valid inside pass callbacks and for the rest of the frame
+    VkBuffer getBuffer(Resource resource) const;
+    VkImage getImage(Resource resource) const;
+    VkImageView getImageView(Resource resource) const;
+
+    Stats getStats() const {
+        return stats;
+    }
+
+private:
+    enum class ResourceKind { ImportedBuffer, External, TransientBuffer, TransientImage };
+
+    struct ResourceNode {
+        std::string name;
+        ResourceKind kind;
+        BufferDesc bufferDesc{};
+        ImageDesc imageDesc{};
+        bool output = false;
+
+        // Set while compiling
+        int firstPass = -1;
+        int lastPass = -1;
+        uint32_t transientIndex = Resource::INVALID;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView imageView = VK_NULL_HANDLE;
+    };
+
+    struct PassNode {
+        std::string name;
+        std::vector<std::pair<uint32_t, Access>> accesses;
+        std::function<void(VkCommandBuffer)> callback;
+        bool culled = false;
+    };
+
+    // Where a resource's last accesses left it, for deriving the next barrier
+    struct SyncState {
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+        VkPipelineStageFlags readStages = 0;     // reads since the last write
+        VkPipelineStageFlags visibleStages = 0;  // stages the last write was made visible to
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+
+    // Transient objects of one frame index, rebuilt only when the graph's transients change
+    struct TransientHeap {
+        std::size_t key = 0;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        VkDeviceSize requestedSize = 0;
+        std::vector<VkBuffer> buffers;
+        std::vector<VkImage> images;
+        std::vector<VkImageView> imageViews;
+        std::vector<VkDeviceSize> offsets;
+        std::vector<VkDeviceSize> sizes;
+    };
+
+    static bool isWrite(Access access);
+
+    void cullPasses();
+    void computeLifetimes();
+    std::size_t hashTransients() const;
+    void realizeTransients();
+    void retireHeap(TransientHeap& heap);
+    bool aliases(uint32_t a, uint32_t b) const;
+    void recordBarriers(VkCommandBuffer commandBuffer, uint32_t passIndex,
+                        std::vector<SyncState>& states);
+
+    VgeDevice& vgeDevice;
+    int frameIndex = 0;
+    std::vector<ResourceNode> resources;
+    std::vector<PassNode> passes;
+    std::vector<uint32_t> transients;  // resource indices, in transientIndex order
+    std::array<TransientHeap, VgeSwapChain::MAX_FRAMES_IN_FLIGHT> heaps;
+    Stats stats{};
+};
+
+}  // namespace vge
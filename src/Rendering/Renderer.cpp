@@ -1,41 +1,100 @@
 #include "Renderer.h"
 
+#include "../Device/FrameScheduler.h"
+#include "../Device/TransferManager.h"
+
 // std
 #include <vulkan/vulkan_core.h>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <stdexcept>
 
 namespace vge {
-Renderer::Renderer(Window& window, VgeDevice& device) : vgeWindow{window}, vgeDevice{device} {
+Renderer::Renderer(Window& window, VgeDevice& device) : vgeWindow{&window}, vgeDevice{device} {
+    supportedPresentModes = vgeDevice.getSwapChainSupport().presentModes;
+    // Nothing can be recorded without a first swap chain, so this one waits for a visible window
+    while (!recreateSwapChain()) {
+        glfwWaitEvents();
+    }
+    createCommandBuffers();
+    createTimestampQueries();
+    resolutionScaler = std::make_unique<VgeResolutionScaler>(vgeDevice, *vgeSwapChain);
+    commandRecorder =
+        std::make_unique<VgeCommandRecorder>(vgeDevice, VgeSwapChain::MAX_FRAMES_IN_FLIGHT);
+}
+
+Renderer::Renderer(VgeDevice& device, VkExtent2D extent)
+    : headlessExtent{extent}, vgeDevice{device} {
+    assert(device.isHeadless() && "Headless renderer needs a device created without a window.");
     recreateSwapChain();
     createCommandBuffers();
+    createTimestampQueries();
+    resolutionScaler = std::make_unique<VgeResolutionScaler>(vgeDevice, *vgeSwapChain);
+    commandRecorder =
+        std::make_unique<VgeCommandRecorder>(vgeDevice, VgeSwapChain::MAX_FRAMES_IN_FLIGHT);
 }
 
 Renderer::~Renderer() {
+    if (timestampQueryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(vgeDevice.device(), timestampQueryPool, nullptr);
+    }
     freeCommandBuffers();
 }
 
-void Renderer::recreateSwapChain() {
-    auto extent = vgeWindow.getExtent();
-    while (extent.width == 0 || extent.height == 0) {
-        extent = vgeWindow.getExtent();
-        glfwWaitEvents();
+bool Renderer::recreateSwapChain() {
+    auto extent = vgeWindow ? vgeWindow->getExtent() : headlessExtent;
+    if (extent.width == 0 || extent.height == 0) {
+        // Minimized, tried again by every beginFrame until the window has an area
+        swapChainOutOfDate = true;
+        return false;
     }
-
-    vkDeviceWaitIdle(vgeDevice.device());
+    swapChainOutOfDate = false;
 
     if (vgeSwapChain == nullptr) {
-        vgeSwapChain = std::make_unique<VgeSwapChain>(vgeDevice, extent);
+        vgeSwapChain = std::make_unique<VgeSwapChain>(vgeDevice, extent, swapChainSettings);
     } else {
+        // Frames in flight keep running. The new swap chain inherits their fences, and the old
+        // one with its images and framebuffers is destroyed once those frames have retired.
         std::shared_ptr<VgeSwapChain> oldSwapChain = std::move(vgeSwapChain);
-        vgeSwapChain = std::make_unique<VgeSwapChain>(vgeDevice, extent, oldSwapChain);
+        vgeSwapChain =
+            std::make_unique<VgeSwapChain>(vgeDevice, extent, swapChainSettings, oldSwapChain);
 
         if (!oldSwapChain->compareSwapFormats(*vgeSwapChain.get())) {
             throw std::runtime_error("Swap chain image(or depth) format has changed!!!");
         }
+        vgeDevice.getDeletionQueue().retire(std::move(oldSwapChain));
+        if (resolutionScaler) {
+            resolutionScaler->resize(*vgeSwapChain);
+        }
+    }
+    return true;
+}
+
+void Renderer::setPresentMode(VkPresentModeKHR mode) {
+    if (swapChainSettings.presentMode != mode) {
+        swapChainSettings.presentMode = mode;
+        swapChainOutOfDate = true;
+    }
+}
+
+void Renderer::setFramesInFlight(uint32_t count) {
+    count = std::clamp<uint32_t>(count, 1, VgeSwapChain::MAX_FRAMES_IN_FLIGHT);
+    if (swapChainSettings.framesInFlight != count) {
+        swapChainSettings.framesInFlight = count;
+        swapChainOutOfDate = true;
+    }
+}
+
+void Renderer::captureFrame(const std::string& path) {
+    if (!vgeDevice.isHeadless()) {
+        throw std::runtime_error("frame capture is only supported headless!!!");
     }
+    if (!frameCapture) {
+        frameCapture = std::make_unique<VgeFrameCapture>(vgeDevice);
+    }
+    pendingCapturePath = path;
 }
 
 void Renderer::createCommandBuffers() {
@@ -53,6 +112,69 @@ void Renderer::createCommandBuffers() {
     }
 }
 
+void Renderer::createTimestampQueries() {
+    // Without timestamp support the GPU frame time simply stays at 0
+    if (!vgeDevice.properties.limits.timestampComputeAndGraphics) {
+        return;
+    }
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(vgeDevice.getPhysicalDevice(), &queueFamilyCount,
+                                             nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(vgeDevice.getPhysicalDevice(), &queueFamilyCount,
+                                             queueFamilies.data());
+    uint32_t validBits =
+        queueFamilies[vgeDevice.findPhysicalQueueFamilies().graphicsFamily].timestampValidBits;
+    if (validBits == 0) {
+        return;
+    }
+    // The bits above timestampValidBits are undefined, and the counter wraps within the rest
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = 2 * static_cast<uint32_t>(commandBuffers.size());
+
+    if (vkCreateQueryPool(vgeDevice.device(), &queryPoolInfo, nullptr, &timestampQueryPool) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create timestamp query pool!!!");
+    }
+    timestampsWritten.assign(commandBuffers.size(), false);
+}
+
+void Renderer::readTimestampQueries() {
+    // Called once the frame that last used this frame index has completed, so results are ready
+    if (timestampQueryPool == VK_NULL_HANDLE || !timestampsWritten[currentFrameIndex]) {
+        return;
+    }
+
+    uint64_t timestamps[2] = {};
+    VkResult result = vkGetQueryPoolResults(
+        vgeDevice.device(), timestampQueryPool, 2 * currentFrameIndex, 2, sizeof(timestamps),
+        timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result == VK_SUCCESS) {
+        uint64_t ticks = (timestamps[1] - timestamps[0]) & timestampMask;
+        float periodNs = vgeDevice.properties.limits.timestampPeriod;
+        gpuFrameTime = static_cast<float>(ticks) * periodNs / 1000000.0f;
+    }
+}
+
+void Renderer::updateInputLatency(uint64_t completedFrame) {
+    auto now = std::chrono::high_resolution_clock::now();
+    for (auto& sample : latencySamples) {
+        if (sample.frame == 0 || sample.frame > completedFrame) {
+            continue;
+        }
+        float latency =
+            std::chrono::duration<float, std::chrono::milliseconds::period>(now - sample.inputTime)
+                .count();
+        inputLatency = inputLatency == 0.0f ? latency : inputLatency * 0.9f + latency * 0.1f;
+        sample.frame = 0;
+    }
+}
+
 void Renderer::freeCommandBuffers() {
     vkFreeCommandBuffers(vgeDevice.device(), vgeDevice.getCommandPool(),
                          static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
@@ -62,6 +184,15 @@ void Renderer::freeCommandBuffers() {
 VkCommandBuffer Renderer::beginFrame() {
     assert(!isFrameStarted && "Can't call beginFrame while already in progress.");
 
+    if (swapChainOutOfDate && !recreateSwapChain()) {
+        // Nothing to present while minimized, wait a little instead of spinning the main loop
+        if (vgeWindow) {
+            glfwWaitEventsTimeout(MINIMIZED_WAIT_SECONDS);
+        }
+        return nullptr;
+    }
+
+    auto waitStart = std::chrono::high_resolution_clock::now();
     auto result = vgeSwapChain->acquireNextImage(&currentImageIndex);
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         recreateSwapChain();
@@ -72,6 +203,28 @@ VkCommandBuffer Renderer::beginFrame() {
     }
 
     isFrameStarted = true;
+    cpuFrameStart = std::chrono::high_resolution_clock::now();
+    framePacer.frameBegun(waitStart, cpuFrameStart);
+    readTimestampQueries();
+
+    float frameInterval =
+        std::chrono::duration<float, std::chrono::seconds::period>(cpuFrameStart - lastFrameStart)
+            .count();
+    lastFrameStart = cpuFrameStart;
+    resolutionScaler->update(gpuFrameTime, std::min(frameInterval, 1.0f));
+    upscaling = resolutionScaler->settings.enabled && vgeSwapChain->isTransferDestination();
+    subpassContents = parallelRecording ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+                                        : VK_SUBPASS_CONTENTS_INLINE;
+    commandRecorder->beginFrame(currentFrameIndex);
+
+    // Only counted once an image is acquired, every frame begun is also submitted
+    VgeFrameScheduler& scheduler = vgeDevice.getFrameScheduler();
+    uint64_t frame = scheduler.beginFrame();
+    uint64_t completedFrame = scheduler.getCompletedFrame();
+    vgeDevice.getDeletionQueue().beginFrame(frame, completedFrame);
+
+    updateInputLatency(completedFrame);
+    latencySamples[currentFrameIndex] = {frame, inputSampleTime};
 
     auto commandBuffer = getCurrentCommandBuffer();
     VkCommandBufferBeginInfo beginInfo{};
@@ -80,25 +233,58 @@ VkCommandBuffer Renderer::beginFrame() {
     if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
         throw std::runtime_error("failed to begin recording command buffer!!!");
     }
+
+    if (timestampQueryPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(commandBuffer, timestampQueryPool, 2 * currentFrameIndex, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool,
+                            2 * currentFrameIndex);
+    }
     return commandBuffer;
 }
 
 void Renderer::endFrame() {
     assert(isFrameStarted && "Can't call endFrame while frame is not in progress.");
     auto commandBuffer = getCurrentCommandBuffer();
+    bool capturing = !pendingCapturePath.empty();
+    if (capturing) {
+        frameCapture->record(commandBuffer, vgeSwapChain->getImage(currentImageIndex),
+                             vgeSwapChain->getSwapChainExtent());
+    }
+    if (timestampQueryPool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                            timestampQueryPool, 2 * currentFrameIndex + 1);
+        timestampsWritten[currentFrameIndex] = true;
+    }
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to record command buffer!!!");
     }
 
+    // CPU time covers recording only; fence and present waits are excluded
+    cpuFrameTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                       std::chrono::high_resolution_clock::now() - cpuFrameStart)
+                       .count();
+
+    // Uploads recorded this frame go out ahead of the frame that uses them
+    vgeDevice.getTransferManager().flush();
+
     auto result = vgeSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
-        vgeWindow.wasWindowResized()) {
-        vgeWindow.resetWindowResizedFlag();
+        (vgeWindow && vgeWindow->wasWindowResized())) {
+        if (vgeWindow) {
+            vgeWindow->resetWindowResizedFlag();
+        }
         recreateSwapChain();
     } else if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to acquire swap chain image!!!");
     }
 
+    if (capturing) {
+        VgeFrameScheduler& scheduler = vgeDevice.getFrameScheduler();
+        scheduler.waitForFrame(scheduler.getCurrentFrame());
+        frameCapture->write(pendingCapturePath);
+        pendingCapturePath.clear();
+    }
+
     isFrameStarted = false;
     currentFrameIndex = (currentFrameIndex + 1) % VgeSwapChain::MAX_FRAMES_IN_FLIGHT;
 }
@@ -108,13 +294,44 @@ void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
     assert(commandBuffer == getCurrentCommandBuffer() &&
            "Can't begin render pass on command buffer from a different frame.");
 
+    overlayPassBegun = false;
+    if (upscaling) {
+        beginRenderPass(commandBuffer, resolutionScaler->getRenderPass(),
+                        resolutionScaler->getFramebuffer(currentFrameIndex),
+                        resolutionScaler->getRenderExtent());
+    } else {
+        beginRenderPass(commandBuffer, vgeSwapChain->getRenderPass(),
+                        vgeSwapChain->getFrameBuffer(currentImageIndex),
+                        vgeSwapChain->getSwapChainExtent());
+    }
+}
+
+void Renderer::beginOverlayPass(VkCommandBuffer commandBuffer) {
+    assert(isFrameStarted && "Can't call beginOverlayPass if frame is not in progress.");
+    assert(commandBuffer == getCurrentCommandBuffer() &&
+           "Can't begin overlay pass on command buffer from a different frame.");
+    if (!upscaling || overlayPassBegun) {
+        return;
+    }
+    overlayPassBegun = true;
+
+    vkCmdEndRenderPass(commandBuffer);
+    resolutionScaler->upscale(commandBuffer, currentFrameIndex,
+                              vgeSwapChain->getImage(currentImageIndex));
+    beginRenderPass(commandBuffer, vgeSwapChain->getOverlayRenderPass(),
+                    vgeSwapChain->getFrameBuffer(currentImageIndex),
+                    vgeSwapChain->getSwapChainExtent());
+}
+
+void Renderer::beginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass,
+                               VkFramebuffer framebuffer, VkExtent2D extent) {
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = vgeSwapChain->getRenderPass();
-    renderPassInfo.framebuffer = vgeSwapChain->getFrameBuffer(currentImageIndex);
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = framebuffer;
 
     renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = vgeSwapChain->getSwapChainExtent();
+    renderPassInfo.renderArea.extent = extent;
 
     std::array<VkClearValue, 2> clearValues{};
     // background color
@@ -124,25 +341,69 @@ void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, subpassContents);
+    currentRenderPass = renderPass;
+    currentFramebuffer = framebuffer;
+    currentExtent = extent;
+    if (subpassContents != VK_SUBPASS_CONTENTS_INLINE) {
+        // Nothing but secondary command buffers may be recorded, they set their own viewport
+        return;
+    }
 
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>(vgeSwapChain->getSwapChainExtent().width);
-    viewport.height = static_cast<float>(vgeSwapChain->getSwapChainExtent().height);
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
-    VkRect2D scissor{{0, 0}, vgeSwapChain->getSwapChainExtent()};
+    VkRect2D scissor{{0, 0}, extent};
     vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
 
+void Renderer::recordParallel(FrameInfo& frameInfo, const std::vector<RenderJob>& jobs) {
+    assert(isFrameStarted && "Can't call recordParallel if frame is not in progress.");
+    assert(frameInfo.commandBuffer == getCurrentCommandBuffer() &&
+           "Can't record render jobs for a command buffer from a different frame.");
+
+    if (subpassContents == VK_SUBPASS_CONTENTS_INLINE) {
+        for (const auto& job : jobs) {
+            job(frameInfo);
+        }
+        return;
+    }
+    commandRecorder->record(frameInfo, jobs, currentRenderPass, currentFramebuffer,
+                            currentExtent);
+}
+
+void Renderer::recordCached(FrameInfo& frameInfo, VgeCachedCommands& cache, uint64_t version,
+                            const RenderJob& job) {
+    assert(isFrameStarted && "Can't call recordCached if frame is not in progress.");
+    assert(frameInfo.commandBuffer == getCurrentCommandBuffer() &&
+           "Can't record render jobs for a command buffer from a different frame.");
+
+    if (subpassContents == VK_SUBPASS_CONTENTS_INLINE) {
+        job(frameInfo);
+        return;
+    }
+
+    VgeCachedCommands::Key key{};
+    key.renderPass = currentRenderPass;
+    key.extent = currentExtent;
+    key.globalDescriptorSet = frameInfo.globalDescriptorSet;
+    key.globalUboOffset = frameInfo.globalUboOffset;
+    key.version = version;
+    VkCommandBuffer commandBuffer = cache.get(currentFrameIndex, key, frameInfo, job);
+    vkCmdExecuteCommands(frameInfo.commandBuffer, 1, &commandBuffer);
+}
+
 void Renderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
     assert(isFrameStarted && "Can't call endSwapChainRenderPass if frame is not in progress.");
     assert(commandBuffer == getCurrentCommandBuffer() &&
            "Can't end render pass on command buffer from a different frame.");
 
+    beginOverlayPass(commandBuffer);
     vkCmdEndRenderPass(commandBuffer);
 }
 }  // namespace vge
@@ -3,19 +3,27 @@
 #include "../Device/Device.h"
 #include "../Presentation/SwapChain.h"
 #include "../Window.h"
+#include "CommandRecorder.h"
+#include "FrameCapture.h"
+#include "FramePacer.h"
+#include "ResolutionScaler.h"
 
 // std
 #include <vulkan/vulkan_core.h>
 
 #include <array>
 #include <cassert>
+#include <chrono>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace vge {
 class Renderer {
    public:
     Renderer(Window& window, VgeDevice& device);
+    // Headless, renders into the swap chain's offscreen images at a fixed extent
+    Renderer(VgeDevice& device, VkExtent2D extent);
     ~Renderer();
 
     Renderer(const Renderer&) = delete;
@@ -24,9 +32,22 @@ class Renderer {
     VkRenderPass getSwapChainRenderPass() const {
         return vgeSwapChain->getRenderPass();
     }
+    // For creating pipelines. Compatible with every render pass the scene is drawn in, and
+    // unlike the swap chain's it lives as long as the renderer, so pipelines that compile later
+    // (e.g. permutation variants) can still reference it after the swap chain was recreated.
+    VkRenderPass getPipelineRenderPass() const {
+        return resolutionScaler->getRenderPass();
+    }
     float getAspectRatio() const {
         return vgeSwapChain->extentAspectRatio();
     }
+    VkExtent2D getSwapChainExtent() const {
+        return vgeSwapChain->getSwapChainExtent();
+    }
+    // Extent the scene is drawn at this frame, below the swap chain's with dynamic resolution
+    VkExtent2D getRenderExtent() const {
+        return upscaling ? resolutionScaler->getRenderExtent() : getSwapChainExtent();
+    }
     bool isFrameInProgress() const {
         return isFrameStarted;
     }
@@ -43,27 +64,158 @@ class Renderer {
 
     VkCommandBuffer beginFrame();
     void endFrame();
+    // The scene is drawn between this and beginOverlayPass, at the render extent
     void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+    // Everything after this, the UI, is drawn at native resolution. With dynamic resolution
+    // this upscales the scene into the swap chain image and continues in the swap chain's
+    // render pass, otherwise it does nothing. endSwapChainRenderPass calls it when nobody did.
+    void beginOverlayPass(VkCommandBuffer commandBuffer);
     void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
+    // Everything inside the render passes is recorded through these, frameInfo.commandBuffer
+    // being the current one. With parallel recording every job gets a secondary command buffer
+    // recorded on the job system, otherwise they are recorded into the frame's command buffer
+    // one after another. Either way they execute in order.
+    void recordParallel(FrameInfo& frameInfo, const std::vector<RenderJob>& jobs);
+    void record(FrameInfo& frameInfo, const RenderJob& job) {
+        recordParallel(frameInfo, {job});
+    }
+    // Replays what job recorded into cache until version changes, or anything else the commands
+    // depend on such as the render pass or the extent. Without parallel recording the render
+    // passes are recorded inline, and job runs every frame instead.
+    void recordCached(FrameInfo& frameInfo, VgeCachedCommands& cache, uint64_t version,
+                      const RenderJob& job);
+    // Takes effect from the next frame
+    void setParallelRecording(bool enabled) {
+        parallelRecording = enabled;
+    }
+    bool isParallelRecording() const {
+        return parallelRecording;
+    }
+
     void setBackgroundColor(float r, float g, float b, float a) {
         backgroundColor = {r, g, b, a};
     }
 
+    // Timings of the most recently completed frame, in milliseconds. GPU time is 0 when the
+    // device does not support timestamp queries on the graphics queue.
+    float getGpuFrameTime() const {
+        return gpuFrameTime;
+    }
+    float getCpuFrameTime() const {
+        return cpuFrameTime;
+    }
+    bool hasGpuTimings() const {
+        return timestampQueryPool != VK_NULL_HANDLE;
+    }
+
+    // Both take effect by recreating the swap chain at the start of the next frame
+    void setPresentMode(VkPresentModeKHR mode);
+    void setFramesInFlight(uint32_t count);
+    VkPresentModeKHR getPresentMode() const {
+        return vgeSwapChain->getPresentMode();
+    }
+    uint32_t getFramesInFlight() const {
+        return swapChainSettings.framesInFlight;
+    }
+    const std::vector<VkPresentModeKHR>& getSupportedPresentModes() const {
+        return supportedPresentModes;
+    }
+
+    // Takes effect from the next frame. Only has an effect when the swap chain images can be
+    // blitted into, see hasDynamicResolution.
+    VgeResolutionScaler::Settings& getResolutionSettings() {
+        return resolutionScaler->settings;
+    }
+    bool hasDynamicResolution() const {
+        return vgeSwapChain->isTransferDestination();
+    }
+    float getResolutionScale() const {
+        return upscaling ? resolutionScaler->getScale() : 1.0f;
+    }
+
+    // The main loop waits on it before reading input, beginFrame reports to it
+    FramePacer& getFramePacer() {
+        return framePacer;
+    }
+
+    // Marks where input for the next frame was read, the start of its measured latency
+    void markInputSampled() {
+        inputSampleTime = std::chrono::high_resolution_clock::now();
+    }
+    // Smoothed time in milliseconds from reading input to the GPU finishing the frame built from
+    // it. Completion is noticed when the next frames begin, so this errs slightly high.
+    float getInputLatency() const {
+        return inputLatency;
+    }
+
+    // Headless only. The frame recorded next is read back and written to path once it has
+    // finished, which waits for the GPU at the end of that frame.
+    void captureFrame(const std::string& path);
+
    private:
+    static constexpr double MINIMIZED_WAIT_SECONDS = 0.1;
+
     void createCommandBuffers();
     void freeCommandBuffers();
-    void recreateSwapChain();
+    // Returns false while the window is minimized, the swap chain is then left as it was
+    bool recreateSwapChain();
+    void createTimestampQueries();
+    void readTimestampQueries();
+    void updateInputLatency(uint64_t completedFrame);
+    void beginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass,
+                         VkFramebuffer framebuffer, VkExtent2D extent);
 
-    Window& vgeWindow;
+    Window* vgeWindow = nullptr;
+    VkExtent2D headlessExtent{0, 0};
     VgeDevice& vgeDevice;
     std::unique_ptr<VgeSwapChain> vgeSwapChain;
+    VgeSwapChain::Settings swapChainSettings{};
+    std::vector<VkPresentModeKHR> supportedPresentModes;
     std::vector<VkCommandBuffer> commandBuffers;
 
     uint32_t currentImageIndex;
     int currentFrameIndex{0};
     bool isFrameStarted{false};
+    bool swapChainOutOfDate{false};
+    // This frame's scene goes through the resolution scaler, and whether it already has
+    bool upscaling{false};
+    bool overlayPassBegun{false};
+
+    // The render pass being recorded, for the secondary command buffers to inherit
+    std::unique_ptr<VgeCommandRecorder> commandRecorder;
+    bool parallelRecording{true};
+    VkSubpassContents subpassContents{VK_SUBPASS_CONTENTS_INLINE};
+    VkRenderPass currentRenderPass{VK_NULL_HANDLE};
+    VkFramebuffer currentFramebuffer{VK_NULL_HANDLE};
+    VkExtent2D currentExtent{0, 0};
 
     std::array<float, 4> backgroundColor{0.01f, 0.01f, 0.01f, 1.0f};
+
+    // Two timestamps (start, end) per frame in flight
+    VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+    std::vector<bool> timestampsWritten;
+    uint64_t timestampMask = ~0ull;
+    float gpuFrameTime = 0.0f;
+    float cpuFrameTime = 0.0f;
+    std::chrono::high_resolution_clock::time_point cpuFrameStart;
+    std::chrono::high_resolution_clock::time_point lastFrameStart;
+
+    std::unique_ptr<VgeResolutionScaler> resolutionScaler;
+
+    // Input time of the frame recorded in each frame index, frame 0 once measured
+    struct LatencySample {
+        uint64_t frame = 0;
+        std::chrono::high_resolution_clock::time_point inputTime;
+    };
+    std::array<LatencySample, VgeSwapChain::MAX_FRAMES_IN_FLIGHT> latencySamples{};
+    std::chrono::high_resolution_clock::time_point inputSampleTime =
+        std::chrono::high_resolution_clock::now();
+    float inputLatency = 0.0f;
+
+    FramePacer framePacer;
+
+    std::unique_ptr<VgeFrameCapture> frameCapture;
+    std::string pendingCapturePath;
 };
 }  // namespace vge
@@ -0,0 +1,390 @@
+#include "ResolutionScaler.h"
+
+#include "../Graphics/ShaderRegistry.h"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+namespace vge {
+
+constexpr const char* UPSCALE_SHADER = "shaders/upscale_sharpen.comp.spv";
+// Enough range and precision to blit into an sRGB swap chain without banding
+constexpr VkFormat OUTPUT_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+struct ResolutionUpscalePushConstants {
+    glm::vec2 inputScale{1.0f};
+    glm::vec2 inputTexelSize{1.0f};
+    glm::ivec2 outputSize{0};
+    float sharpness = 0.0f;
+};
+
+VgeResolutionScaler::VgeResolutionScaler(VgeDevice& device, VgeSwapChain& swapChain)
+    : vgeDevice{device},
+      colorFormat{swapChain.getSwapChainImageFormat()},
+      depthFormat{swapChain.findDepthFormat()} {
+    createRenderPass();
+    createSampler();
+    createPipeline();
+    targets = createTargets(swapChain.getSwapChainExtent());
+}
+
+VgeResolutionScaler::~VgeResolutionScaler() {
+    // Frames still in flight may be rendering into the targets
+    auto& deletionQueue = vgeDevice.getDeletionQueue();
+    deletionQueue.retire(std::move(targets));
+    deletionQueue.retire(std::move(pipeline));
+    deletionQueue.retire(std::move(setLayout));
+
+    VkDevice device = vgeDevice.device();
+    VkRenderPass pass = renderPass;
+    VkSampler targetSampler = sampler;
+    VkPipelineLayout layout = pipelineLayout;
+    deletionQueue.push([device, pass, targetSampler, layout]() {
+        vkDestroyPipelineLayout(device, layout, nullptr);
+        vkDestroySampler(device, targetSampler, nullptr);
+        vkDestroyRenderPass(device, pass, nullptr);
+    });
+}
+
+VgeResolutionScaler::Targets::~Targets() {
+    VkDevice vkDevice = device.device();
+    for (VkFramebuffer framebuffer : framebuffers) {
+        vkDestroyFramebuffer(vkDevice, framebuffer, nullptr);
+    }
+    for (VkImageView view : imageViews) {
+        vkDestroyImageView(vkDevice, view, nullptr);
+    }
+    for (size_t i = 0; i < images.size(); i++) {
+        vkDestroyImage(vkDevice, images[i], nullptr);
+        vkFreeMemory(vkDevice, imageMemorys[i], nullptr);
+    }
+}
+
+void VgeResolutionScaler::resize(VgeSwapChain& swapChain) {
+    assert(swapChain.getSwapChainImageFormat() == colorFormat &&
+           "Resolution scaler targets need the swap chain format to stay the same");
+    vgeDevice.getDeletionQueue().retire(std::move(targets));
+    targets = createTargets(swapChain.getSwapChainExtent());
+}
+
+void VgeResolutionScaler::update(float gpuFrameTime, float deltaTime) {
+    float minScale = std::clamp(settings.minScale, 0.1f, 1.0f);
+    float maxScale = std::clamp(settings.maxScale, minScale, 1.0f);
+    if (!settings.enabled || gpuFrameTime <= 0.0f) {
+        // Starts at full resolution when enabled, or stays there without GPU timings
+        scale = maxScale;
+        measuredGpuTime = 0.0f;
+        return;
+    }
+
+    // Same smoothing and bands as the quality governor, so single spikes change nothing
+    if (measuredGpuTime == 0.0f) {
+        measuredGpuTime = gpuFrameTime;
+    } else {
+        measuredGpuTime += (gpuFrameTime - measuredGpuTime) * SMOOTHING;
+    }
+
+    timeSinceAdjust += deltaTime;
+    if (timeSinceAdjust < ADJUST_INTERVAL) {
+        scale = std::clamp(scale, minScale, maxScale);
+        return;
+    }
+    timeSinceAdjust = 0.0f;
+
+    float target = settings.targetGpuTime;
+    if (measuredGpuTime > target * UPPER_BAND) {
+        // Fill cost goes with the pixel count, the square of the scale
+        scale *= std::max(MAX_STEP_DOWN, std::sqrt(target / measuredGpuTime));
+    } else if (measuredGpuTime < target * LOWER_BAND) {
+        scale *= STEP_UP;
+    }
+    scale = std::clamp(scale, minScale, maxScale);
+}
+
+VkExtent2D VgeResolutionScaler::getRenderExtent() const {
+    auto scaled = [this](uint32_t size) {
+        return std::clamp(static_cast<uint32_t>(std::lround(size * scale)), 1u, size);
+    };
+    return {scaled(targets->extent.width), scaled(targets->extent.height)};
+}
+
+void VgeResolutionScaler::createRenderPass() {
+    // Attachments match the swap chain render pass for compatibility, only the layouts and the
+    // dependencies differ
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = colorFormat;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = depthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorAttachmentRef{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkAttachmentReference depthAttachmentRef{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+    std::array<VkSubpassDependency, 2> dependencies{};
+    // The upscaler of the last frame to use this target may still be reading it
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                   VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstStageMask =
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[0].dstAccessMask =
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    // And this frame's upscaler reads it next
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
+
+    if (vkCreateRenderPass(vgeDevice.device(), &renderPassInfo, nullptr, &renderPass) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create scaled scene render pass!!!");
+    }
+}
+
+void VgeResolutionScaler::createSampler() {
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(vgeDevice.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upscale sampler!!!");
+    }
+}
+
+void VgeResolutionScaler::createPipeline() {
+    auto reflection = vgeDevice.getShaderRegistry().reflect({UPSCALE_SHADER});
+    assert(reflection.pushConstantSize >= sizeof(ResolutionUpscalePushConstants) &&
+           "Upscale push constants out of sync with the shader");
+    setLayout = VgeDescriptorSetLayout::Builder(vgeDevice).addBindings(reflection, 0).build();
+
+    VkDescriptorSetLayout descriptorSetLayout = setLayout->getDescriptorSetLayout();
+    auto pushConstantRanges = reflection.pushConstantRanges();
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+    if (vkCreatePipelineLayout(vgeDevice.device(), &pipelineLayoutInfo, nullptr,
+                               &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upscale pipeline layout!!!");
+    }
+
+    auto config = std::make_unique<PipelineConfigInfo>();
+    config->pipelineLayout = pipelineLayout;
+    pipeline = vgeDevice.getPipelineCompiler().compileCompute(UPSCALE_SHADER, std::move(config));
+}
+
+VkImage VgeResolutionScaler::createImage(Targets& targets, VkExtent2D extent, VkFormat format,
+                                         VkImageUsageFlags usage, VkImageAspectFlags aspect) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {extent.width, extent.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = usage;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkImage image;
+    VkDeviceMemory memory;
+    vgeDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, memory);
+    targets.images.push_back(image);
+    targets.imageMemorys.push_back(memory);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = {aspect, 0, 1, 0, 1};
+
+    VkImageView view;
+    if (vkCreateImageView(vgeDevice.device(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upscale image view!!!");
+    }
+    targets.imageViews.push_back(view);
+    return image;
+}
+
+std::unique_ptr<VgeResolutionScaler::Targets> VgeResolutionScaler::createTargets(
+    VkExtent2D extent) {
+    auto newTargets = std::make_unique<Targets>(vgeDevice);
+    newTargets->extent = extent;
+    newTargets->descriptorAllocator =
+        VgeDescriptorAllocator::Builder(vgeDevice)
+            .setInitialSets(VgeSwapChain::MAX_FRAMES_IN_FLIGHT)
+            .addRatio(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f)
+            .addRatio(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f)
+            .build();
+
+    // Scaled frames render into the top left corner, so the targets never need reallocating
+    // when the scale changes
+    for (int i = 0; i < VgeSwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+        createImage(*newTargets, extent, colorFormat,
+                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                    VK_IMAGE_ASPECT_COLOR_BIT);
+        VkImageView colorView = newTargets->imageViews.back();
+        createImage(*newTargets, extent, depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                    VK_IMAGE_ASPECT_DEPTH_BIT);
+        VkImageView depthView = newTargets->imageViews.back();
+        newTargets->outputImages.push_back(createImage(
+            *newTargets, extent, OUTPUT_FORMAT,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_IMAGE_ASPECT_COLOR_BIT));
+        VkImageView outputView = newTargets->imageViews.back();
+
+        std::array<VkImageView, 2> attachments = {colorView, depthView};
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferInfo.pAttachments = attachments.data();
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
+        framebufferInfo.layers = 1;
+
+        VkFramebuffer framebuffer;
+        if (vkCreateFramebuffer(vgeDevice.device(), &framebufferInfo, nullptr, &framebuffer) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create scaled scene framebuffer!!!");
+        }
+        newTargets->framebuffers.push_back(framebuffer);
+
+        VkDescriptorImageInfo sceneInfo{sampler, colorView,
+                                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        VkDescriptorImageInfo outputInfo{VK_NULL_HANDLE, outputView, VK_IMAGE_LAYOUT_GENERAL};
+        VkDescriptorSet descriptorSet;
+        if (!VgeDescriptorWriter(*setLayout, *newTargets->descriptorAllocator)
+                 .writeImage(0, &sceneInfo)
+                 .writeImage(1, &outputInfo)
+                 .build(descriptorSet)) {
+            throw std::runtime_error("failed to allocate upscale descriptor set!!!");
+        }
+        newTargets->descriptorSets.push_back(descriptorSet);
+    }
+    return newTargets;
+}
+
+void VgeResolutionScaler::upscale(VkCommandBuffer commandBuffer, int frameIndex,
+                                  VkImage swapChainImage) {
+    VkExtent2D extent = targets->extent;
+    VkExtent2D renderExtent = getRenderExtent();
+    VkImage outputImage = targets->outputImages[frameIndex];
+
+    // The output's previous contents were blitted out by an earlier frame, they can be dropped
+    VkImageMemoryBarrier toStorage{};
+    toStorage.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toStorage.srcAccessMask = 0;
+    toStorage.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    toStorage.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    toStorage.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    toStorage.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toStorage.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toStorage.image = outputImage;
+    toStorage.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1,
+                         &toStorage);
+
+    ResolutionUpscalePushConstants push{};
+    push.inputScale = {static_cast<float>(renderExtent.width) / extent.width,
+                       static_cast<float>(renderExtent.height) / extent.height};
+    push.inputTexelSize = {1.0f / extent.width, 1.0f / extent.height};
+    push.outputSize = {static_cast<int>(extent.width), static_cast<int>(extent.height)};
+    push.sharpness = std::clamp(settings.sharpness, 0.0f, 1.0f);
+
+    pipeline->bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1,
+                            &targets->descriptorSets[frameIndex], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(ResolutionUpscalePushConstants), &push);
+    vkCmdDispatch(commandBuffer, (extent.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+                  (extent.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+
+    // The swap chain image waits on acquisition at the color attachment stage, its transition
+    // has to come after that
+    std::array<VkImageMemoryBarrier, 2> toTransfer{};
+    toTransfer[0] = toStorage;
+    toTransfer[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    toTransfer[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    toTransfer[0].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    toTransfer[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toTransfer[1] = toStorage;
+    toTransfer[1].srcAccessMask = 0;
+    toTransfer[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toTransfer[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    toTransfer[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    toTransfer[1].image = swapChainImage;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+        static_cast<uint32_t>(toTransfer.size()), toTransfer.data());
+
+    // Same size, the blit is only there to convert to the swap chain's format
+    VkImageBlit region{};
+    region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.srcOffsets[1] = {static_cast<int32_t>(extent.width),
+                            static_cast<int32_t>(extent.height), 1};
+    region.dstSubresource = region.srcSubresource;
+    region.dstOffsets[1] = region.srcOffsets[1];
+    vkCmdBlitImage(commandBuffer, outputImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   swapChainImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region,
+                   VK_FILTER_NEAREST);
+}
+
+}  // namespace vge
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "../Descriptor/Descriptors.h"
+#include "../Device/Device.h"
+#include "../Graphics/PipelineCompiler.h"
+#include "../Presentation/SwapChain.h"
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <memory>
+#include <vector>
+
+namespace vge {
+
+// Dynamic resolution for the scene. When enabled the scene pass draws into an offscreen target
+// at a fraction of the swap chain extent, picked each frame from the measured GPU frame time,
+// and a sharpening upscaler in compute brings it back to native resolution. The target's render
+// pass is compatible with the swap chain's, so pipelines built for one draw into the other.
+class VgeResolutionScaler {
+public:
+    static constexpr int WORKGROUP_SIZE = 8;
+
+    struct Settings {
+        bool enabled = false;
+        float minScale = 0.5f;  // of the swap chain width and height
+        float maxScale = 1.0f;  // at most 1, targets are allocated at native size
+        float targetGpuTime = 6.0f;  // ms
+        float sharpness = 0.5f;      // 0 to 1
+    };
+
+    VgeResolutionScaler(VgeDevice& device, VgeSwapChain& swapChain);
+    ~VgeResolutionScaler();
+
+    VgeResolutionScaler(const VgeResolutionScaler&) = delete;
+    VgeResolutionScaler& operator=(const VgeResolutionScaler&) = delete;
+
+    // Rebuilds the targets for a recreated swap chain, whose formats must not have changed
+    void resize(VgeSwapChain& swapChain);
+    // Moves the scale towards the target GPU time, a few times per second
+    void update(float gpuFrameTime, float deltaTime);
+
+    VkRenderPass getRenderPass() const {
+        return renderPass;
+    }
+    VkFramebuffer getFramebuffer(int frameIndex) const {
+        return targets->framebuffers[frameIndex];
+    }
+    // Extent the scene is rendered at this frame, from the top left of the target
+    VkExtent2D getRenderExtent() const;
+    float getScale() const {
+        return scale;
+    }
+
+    // Upscales frameIndex's scene target into the swap chain image, which is left in
+    // TRANSFER_DST_OPTIMAL for the swap chain's overlay render pass. Outside any render pass.
+    void upscale(VkCommandBuffer commandBuffer, int frameIndex, VkImage swapChainImage);
+
+    Settings settings{};
+
+private:
+    // Everything sized by the swap chain extent, one set per frame index. Retired as a whole
+    // when the swap chain is recreated, frames in flight may still be using it.
+    struct Targets {
+        explicit Targets(VgeDevice& device) : device{device} {}
+        ~Targets();
+
+        Targets(const Targets&) = delete;
+        Targets& operator=(const Targets&) = delete;
+
+        VgeDevice& device;
+        VkExtent2D extent{};
+        // Every image the targets own: scene color, depth and upscaled output per frame
+        std::vector<VkImage> images;
+        std::vector<VkDeviceMemory> imageMemorys;
+        std::vector<VkImageView> imageViews;
+        std::vector<VkFramebuffer> framebuffers;
+        std::vector<VkImage> outputImages;
+        std::unique_ptr<VgeDescriptorAllocator> descriptorAllocator;
+        std::vector<VkDescriptorSet> descriptorSets;
+    };
+
+    static constexpr float SMOOTHING = 0.1f;
+    static constexpr float ADJUST_INTERVAL = 0.25f;  // seconds between decisions
+    static constexpr float UPPER_BAND = 1.05f;       // above target * this, lower the scale
+    static constexpr float LOWER_BAND = 0.85f;       // below target * this, raise the scale
+    static constexpr float MAX_STEP_DOWN = 0.8f;
+    static constexpr float STEP_UP = 1.03f;
+
+    void createRenderPass();
+    void createSampler();
+    void createPipeline();
+    std::unique_ptr<Targets> createTargets(VkExtent2D extent);
+    VkImage createImage(Targets& targets, VkExtent2D extent, VkFormat format,
+                        VkImageUsageFlags usage, VkImageAspectFlags aspect);
+
+    VgeDevice& vgeDevice;
+    VkFormat colorFormat;
+    VkFormat depthFormat;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    std::unique_ptr<VgeDescriptorSetLayout> setLayout;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    PendingPipeline pipeline;
+
+    std::unique_ptr<Targets> targets;
+
+    float scale = 1.0f;
+    float measuredGpuTime = 0.0f;
+    float timeSinceAdjust = 0.0f;
+};
+
+}  // namespace vge
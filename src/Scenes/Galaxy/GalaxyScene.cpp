@@ -1,5 +1,6 @@
 #include "GalaxyScene.h"
 
+#include "../../Graphics/PipelineCompiler.h"
 #include "imgui.h"
 
 namespace vge {
@@ -12,20 +13,146 @@ GalaxyScene::GalaxyScene(VgeDevice& device,
 }
 
 void GalaxyScene::init() {
-    // Create galaxy system
+    // Systems queue their pipelines on construction. The dust system goes first so its
+    // pipelines compile while the galaxy system initializes its stars.
+    dustSystem = std::make_unique<DustSystem>(device, renderer.getPipelineRenderPass());
     galaxySystem =
-        std::make_unique<GalaxySystem>(device, renderer.getSwapChainRenderPass(), globalSetLayout);
+        std::make_unique<GalaxySystem>(device, renderer.getPipelineRenderPass(), globalSetLayout);
+    renderGraph = std::make_unique<VgeRenderGraph>(device);
+
+    // Finish here rather than stalling the first frame
+    device.getPipelineCompiler().waitIdle();
 }
 
 void GalaxyScene::updateUbo(GlobalUbo& ubo, FrameInfo& frameInfo) {}
 
 void GalaxyScene::update(FrameInfo& frameInfo) {
+    processDatasetRequests();
+    if (snapshotSource) {
+        snapshotSource->update(frameInfo);
+        return;
+    }
+    if (tileStreamer) {
+        tileStreamer->update(frameInfo);
+        return;
+    }
+
+    qualityGovernor.update(renderer.getCpuFrameTime(), renderer.getGpuFrameTime(),
+                           frameInfo.frameTime);
+    applyQualityDecision();
+
     galaxySystem->update(frameInfo);
-    galaxySystem->computeStars(frameInfo);
+
+    using Access = VgeRenderGraph::Access;
+    renderGraph->beginFrame(frameInfo.frameIndex);
+    auto stars =
+        renderGraph->importBuffer("Stars", galaxySystem->getCurrentStarBuffer().getBuffer());
+
+    // At reduced simulation rates the skipped frames' time is carried into the next step
+    simulationTimeAccumulator += frameInfo.frameTime;
+    if (++framesSinceSimulation >= qualityGovernor.getDecision().simulationInterval) {
+        auto source = renderGraph->importBuffer(
+            "Stars source", galaxySystem->getSimulationSourceBuffer().getBuffer());
+
+        FrameInfo simulationInfo = frameInfo;
+        simulationInfo.frameTime = simulationTimeAccumulator;
+        renderGraph->addPass("Simulate stars")
+            .access(source, Access::ComputeRead)
+            .access(stars, Access::ComputeWrite)
+            .execute([this, simulationInfo](VkCommandBuffer commandBuffer) mutable {
+                simulationInfo.commandBuffer = commandBuffer;
+                galaxySystem->computeStars(simulationInfo);
+            });
+        // The buffers swap, the rest of the frame reads the step's source
+        stars = source;
+
+        framesSinceSimulation = 0;
+        simulationTimeAccumulator = 0.0f;
+    }
+
+    auto dustVolume = dustSystem->addPasses(*renderGraph, frameInfo, stars,
+                                            galaxySystem->getActiveStarCount(),
+                                            renderer.getRenderExtent());
+
+    // Recorded by render() inside the swap chain render pass, declared so the graph puts the
+    // barriers for the star and dust reads ahead of it
+    auto backbuffer = renderGraph->importExternal("Backbuffer");
+    renderGraph->addPass("Scene")
+        .access(stars, Access::VertexBuffer)
+        .access(dustVolume, Access::FragmentSampled)
+        .access(backbuffer, Access::ColorAttachment);
+    renderGraph->markOutput(backbuffer);
+
+    renderGraph->execute(frameInfo.commandBuffer);
+}
+
+void GalaxyScene::processDatasetRequests() {
+    // Handled at the start of a frame, the UI that sets them runs after this frame's draws
+    // were recorded
+    if (attachRequested || detachRequested) {
+        if (snapshotSource) {
+            device.getDeletionQueue().retire(std::move(snapshotSource));
+        }
+        if (attachRequested) {
+            try {
+                snapshotSource = std::make_unique<StarSnapshotSource>(device, sharedMemoryName);
+                attachError.clear();
+            } catch (const std::exception& e) {
+                attachError = e.what();
+            }
+        }
+        attachRequested = false;
+        detachRequested = false;
+    }
+
+    if (!loadDatasetRequested && !unloadDatasetRequested) {
+        return;
+    }
+
+    if (tileStreamer) {
+        // Its buffers may be read by frames still in flight
+        device.getDeletionQueue().retire(std::move(tileStreamer));
+    }
+
+    if (loadDatasetRequested) {
+        try {
+            VkDeviceSize budget = static_cast<VkDeviceSize>(streamingBudgetMb) * 1024 * 1024;
+            tileStreamer = std::make_unique<StarTileStreamer>(device, datasetPath, budget);
+            datasetError.clear();
+        } catch (const std::exception& e) {
+            datasetError = e.what();
+        }
+    }
+
+    loadDatasetRequested = false;
+    unloadDatasetRequested = false;
+}
+
+void GalaxyScene::applyQualityDecision() {
+    const auto& decision = qualityGovernor.getDecision();
+    galaxySystem->setActiveStarCount(decision.activeStars);
+    galaxySystem->setPointSizeScale(decision.pointSizeScale);
+    galaxySystem->setBrightness(decision.brightness);
 }
 
 void GalaxyScene::render(FrameInfo& frameInfo) {
-    galaxySystem->render(frameInfo);
+    if (snapshotSource) {
+        renderer.record(frameInfo, [this](FrameInfo& jobInfo) {
+            galaxySystem->renderBuffers(jobInfo, snapshotSource->getDrawRanges());
+        });
+        return;
+    }
+    if (tileStreamer) {
+        renderer.record(frameInfo, [this](FrameInfo& jobInfo) {
+            galaxySystem->renderBuffers(jobInfo, tileStreamer->getDrawRanges());
+        });
+        return;
+    }
+
+    // The dust composite is the only job using the frame's descriptor allocator
+    renderer.recordParallel(frameInfo,
+                            {[this](FrameInfo& jobInfo) { dustSystem->render(jobInfo); },
+                             [this](FrameInfo& jobInfo) { galaxySystem->render(jobInfo); }});
 }
 
 void GalaxyScene::renderUI() {
@@ -46,18 +173,146 @@ void GalaxyScene::renderUI() {
     }
 
     handleGalaxyParameterChanges(parametersChanged);
+
+    ImGui::Spacing();
+    int blendMode = galaxySystem->getBlendMode() == BlendMode::Additive ? 1 : 0;
+    if (ImGui::Combo("Star Blending", &blendMode, "Alpha\0Additive\0")) {
+        galaxySystem->setBlendMode(blendMode == 1 ? BlendMode::Additive : BlendMode::Alpha);
+    }
+
+    ImGui::Spacing();
+    renderDustParameters();
+    renderStreamingParameters();
+    renderSharedMemoryParameters();
+
+    ImGui::TreePop();
+}
+
+void GalaxyScene::renderDustParameters() {
+    if (!ImGui::TreeNode("Dust Lanes")) return;
+
+    auto& settings = dustSystem->settings;
+    ImGui::Checkbox("Enabled", &settings.enabled);
+    ImGui::DragFloat("Absorption", &settings.absorption, 0.005f, 0.0f, 2.0f, "%.3f");
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("How strongly dense regions block what is behind them");
+    }
+    ImGui::DragFloat("Emission Strength", &settings.emissionStrength, 0.001f, 0.0f, 0.5f, "%.3f");
+    ImGui::ColorEdit3("Emission Color", &settings.emissionColor.x);
+
     ImGui::TreePop();
 }
 
+void GalaxyScene::renderStreamingParameters() {
+    if (!ImGui::TreeNode("Streaming Dataset")) return;
+
+    ImGui::InputText("File", datasetPath, sizeof(datasetPath));
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Tiled star file written by GalaxyTiler");
+    }
+    ImGui::DragInt("GPU Budget (MB)", &streamingBudgetMb, 16.0f, 16, 16384);
+
+    if (ImGui::Button(tileStreamer ? "Reload" : "Load")) {
+        loadDatasetRequested = true;
+    }
+    if (tileStreamer) {
+        ImGui::SameLine();
+        if (ImGui::Button("Unload")) {
+            unloadDatasetRequested = true;
+        }
+    }
+    if (!datasetError.empty()) {
+        ImGui::TextWrapped("%s", datasetError.c_str());
+    }
+
+    if (tileStreamer) {
+        auto stats = tileStreamer->getStats();
+        ImGui::Text("Tiles: %u resident, %u loading, %u slots, %u total", stats.residentTiles,
+                    stats.loadingTiles, stats.slotCount, stats.totalTiles);
+        ImGui::Text("Stars drawn: %llu of %llu",
+                    static_cast<unsigned long long>(stats.coarseStars + stats.residentStars),
+                    static_cast<unsigned long long>(stats.totalStars));
+        ImGui::Text("Streamed: %.1f MB", stats.bytesStreamed / (1024.0 * 1024.0));
+    }
+
+    ImGui::TreePop();
+}
+
+void GalaxyScene::renderSharedMemoryParameters() {
+    if (!ImGui::TreeNode("Shared Memory Stars")) return;
+
+    ImGui::InputText("Name", sharedMemoryName, sizeof(sharedMemoryName));
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Published by VgeEngine --simulate or GalaxyCluster --serve");
+    }
+
+    if (ImGui::Button(snapshotSource ? "Reattach" : "Attach")) {
+        attachRequested = true;
+    }
+    if (snapshotSource) {
+        ImGui::SameLine();
+        if (ImGui::Button("Detach")) {
+            detachRequested = true;
+        }
+    }
+    if (!attachError.empty()) {
+        ImGui::TextWrapped("%s", attachError.c_str());
+    }
+
+    if (snapshotSource) {
+        auto stats = snapshotSource->getStats();
+        ImGui::Text("Stars: %u", stats.numStars);
+        ImGui::Text("Step drawn: %llu of %llu", static_cast<unsigned long long>(stats.drawnStep),
+                    static_cast<unsigned long long>(stats.publishedStep));
+        ImGui::Text("Overtaken reads: %llu",
+                    static_cast<unsigned long long>(stats.overtakenReads));
+    }
+
+    ImGui::TreePop();
+}
+
+void GalaxyScene::renderPerformanceUI() {
+    auto& settings = qualityGovernor.settings;
+    const auto& decision = qualityGovernor.getDecision();
+
+    ImGui::Spacing();
+    ImGui::Text("Quality Governor");
+    ImGui::Checkbox("Enabled", &settings.enabled);
+    ImGui::DragFloat("Target (ms)", &settings.targetFrameTime, 0.1f, 1.0f, 50.0f, "%.1f");
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Frame time the governor tries to hold, 8.3 ms is 120 FPS");
+    }
+
+    ImGui::Text("Measured: %.2f ms (CPU %.2f / GPU %.2f)", qualityGovernor.getMeasuredFrameTime(),
+                qualityGovernor.getMeasuredCpuTime(), qualityGovernor.getMeasuredGpuTime());
+    if (!renderer.hasGpuTimings()) {
+        ImGui::Text("GPU timestamps unavailable, using CPU time only");
+    }
+    ImGui::Text("Quality: %.0f%%", decision.quality * 100.0f);
+    ImGui::Text("Stars: %d / %d", decision.activeStars, GalaxySystem::NUM_STARS);
+    ImGui::Text("Point size: %.2fx  Brightness: %.2fx", decision.pointSizeScale,
+                decision.brightness);
+    ImGui::Text("Simulation: every %d frame(s)", decision.simulationInterval);
+
+    auto graphStats = renderGraph->getStats();
+    ImGui::Text("Render graph: %u passes (%u culled), %u barriers, %u transitions",
+                graphStats.passes, graphStats.culledPasses, graphStats.barriers,
+                graphStats.imageTransitions);
+    ImGui::Text("Transients: %.2f MB (%.2f MB unaliased)",
+                graphStats.transientBytes / (1024.0 * 1024.0),
+                graphStats.requestedBytes / (1024.0 * 1024.0));
+}
+
 void GalaxyScene::renderGalaxyShapeParameters(bool& parametersChanged) {
-    if (ImGui::DragFloat("Base Radius", &Ellipse::baseRadius, 0.01f, 1.0f, 5.0f, "%.2f")) {
+    if (ImGui::DragFloat("Base Radius", &Ellipse::shape.baseRadius, 0.01f, 1.0f, 5.0f,
+                         "%.2f")) {
         parametersChanged = true;
     }
     if (ImGui::IsItemHovered()) {
         ImGui::SetTooltip("Starting radius for the first ellipse");
     }
 
-    if (ImGui::DragFloat("Radius Increment", &Ellipse::radiusIncrement, 0.01f, 0.1f, 2.0f,
+    if (ImGui::DragFloat("Radius Increment", &Ellipse::shape.radiusIncrement, 0.01f, 0.1f, 2.0f,
                          "%.2f")) {
         parametersChanged = true;
     }
@@ -65,44 +320,46 @@ void GalaxyScene::renderGalaxyShapeParameters(bool& parametersChanged) {
         ImGui::SetTooltip("How much larger each successive ellipse becomes");
     }
 
-    float baseTiltDegrees = glm::degrees(Ellipse::baseTilt);
+    float baseTiltDegrees = glm::degrees(Ellipse::shape.baseTilt);
     if (ImGui::DragFloat("Base Tilt", &baseTiltDegrees, 1.0f, -180.0f, 180.0f, "%.1f°")) {
-        Ellipse::baseTilt = glm::radians(baseTiltDegrees);
+        Ellipse::shape.baseTilt = glm::radians(baseTiltDegrees);
         parametersChanged = true;
     }
 
-    float tiltIncrementDegrees = glm::degrees(Ellipse::tiltIncrement);
+    float tiltIncrementDegrees = glm::degrees(Ellipse::shape.tiltIncrement);
     if (ImGui::DragFloat("Tilt Increment", &tiltIncrementDegrees, 0.1f, 0.0f, 45.0f, "%.1f°")) {
-        Ellipse::tiltIncrement = glm::radians(tiltIncrementDegrees);
+        Ellipse::shape.tiltIncrement = glm::radians(tiltIncrementDegrees);
         parametersChanged = true;
     }
 
-    if (ImGui::DragFloat("Eccentricity", &Ellipse::eccentricity, 0.01f, 0.1f, 1.0f, "%.2f")) {
+    if (ImGui::DragFloat("Eccentricity", &Ellipse::shape.eccentricity, 0.01f, 0.1f, 1.0f,
+                         "%.2f")) {
         parametersChanged = true;
     }
 }
 
 void GalaxyScene::renderHeightDistributionParameters(bool& parametersChanged) {
-    if (ImGui::DragFloat("Central Intensity (I_0)", &Ellipse::centralIntensity, 0.1f, 0.1f, 50.0f,
-                         "%.1f")) {
+    if (ImGui::DragFloat("Central Intensity (I_0)", &Ellipse::shape.centralIntensity, 0.1f, 0.1f,
+                         50.0f, "%.1f")) {
         parametersChanged = true;
     }
 
-    if (ImGui::DragFloat("Base Radius2", &Ellipse::baseRadius2, 0.01f, 0.1f, 5.0f, "%.2f")) {
+    if (ImGui::DragFloat("Base Radius2", &Ellipse::shape.baseRadius2, 0.01f, 0.1f, 5.0f,
+                         "%.2f")) {
         parametersChanged = true;
     }
 
-    if (ImGui::DragFloat("Distribution Constant (b)", &Ellipse::constant, 0.1f, 0.1f, 10.0f,
+    if (ImGui::DragFloat("Distribution Constant (b)", &Ellipse::shape.constant, 0.1f, 0.1f, 10.0f,
                          "%.1f")) {
         parametersChanged = true;
     }
 
-    if (ImGui::DragFloat("Effective Radius (Re)", &Ellipse::effectiveRadiusScale, 0.1f, 0.1f, 10.0f,
-                         "%.1f")) {
+    if (ImGui::DragFloat("Effective Radius (Re)", &Ellipse::shape.effectiveRadiusScale, 0.1f,
+                         0.1f, 10.0f, "%.1f")) {
         parametersChanged = true;
     }
 
-    if (ImGui::DragFloat("Max Height", &Ellipse::maxHeight, 0.01f, 0.1f, 2.0f, "%.2f")) {
+    if (ImGui::DragFloat("Max Height", &Ellipse::shape.maxHeight, 0.01f, 0.1f, 2.0f, "%.2f")) {
         parametersChanged = true;
     }
 }
@@ -115,17 +372,7 @@ void GalaxyScene::handleGalaxyParameterChanges(bool parametersChanged) {
 }
 
 void GalaxyScene::restoreDefaultGalaxyParameters() {
-    Ellipse::baseRadius = 1.83f;
-    Ellipse::radiusIncrement = 0.5f;
-    Ellipse::baseTilt = 0.0f;
-    Ellipse::tiltIncrement = 0.16f;
-    Ellipse::eccentricity = 0.8f;
-
-    Ellipse::centralIntensity = 10.0f;
-    Ellipse::baseRadius2 = 1.83f;
-    Ellipse::constant = 1.4f;
-    Ellipse::effectiveRadiusScale = 2.0f;
-    Ellipse::maxHeight = 0.5f;
+    Ellipse::shape = Ellipse::Shape{};
 
     Ellipse::generateEllipseParams(Ellipse::MAX_ELLIPSES);
     galaxySystem->updateGalaxyParameters();
@@ -1,8 +1,13 @@
 #pragma once
 
 #include "../Scene.h"
+#include "QualityGovernor.h"
 #include "../../systems/Galaxy/GalaxySystem.h"
+#include "../../systems/Galaxy/DustSystem.h"
+#include "../../systems/Galaxy/StarSnapshotSource.h"
+#include "../../systems/Galaxy/StarTileStreamer.h"
 #include "../../Device/Device.h"
+#include "../../Rendering/RenderGraph.h"
 #include "../../Rendering/Renderer.h"
 
 
@@ -17,17 +22,49 @@ namespace vge {
         void update(FrameInfo& frameInfo) override;
         void render(FrameInfo& frameInfo) override;
         void renderUI() override;
+        void renderPerformanceUI() override;
         void updateUbo(GlobalUbo& ubo, FrameInfo& frameInfo) override;
         const char* getName() const override { return "Galaxy Scene"; }
 
+        // With it off the galaxy stays at full quality whatever the frame time
+        void setAdaptiveQuality(bool enabled) { qualityGovernor.settings.enabled = enabled; }
+
         // UI helper methods
         void renderGalaxyShapeParameters(bool& parametersChanged);
         void renderHeightDistributionParameters(bool& parametersChanged);
         void handleGalaxyParameterChanges(bool parametersChanged);
         void restoreDefaultGalaxyParameters();
+        void renderDustParameters();
+        void renderStreamingParameters();
+        void renderSharedMemoryParameters();
 
     private:
+        void applyQualityDecision();
+        void processDatasetRequests();
+
         std::unique_ptr<GalaxySystem> galaxySystem;
+        std::unique_ptr<DustSystem> dustSystem;
+        // Rebuilt every frame from the simulation and dust passes
+        std::unique_ptr<VgeRenderGraph> renderGraph;
+
+        // Out-of-core dataset, replaces the simulated stars while loaded
+        std::unique_ptr<StarTileStreamer> tileStreamer;
+        char datasetPath[256] = "galaxy.vgst";
+        int streamingBudgetMb = 512;
+        bool loadDatasetRequested = false;
+        bool unloadDatasetRequested = false;
+        std::string datasetError;
+
+        // Stars published by another process, replaces the simulated stars while attached
+        std::unique_ptr<StarSnapshotSource> snapshotSource;
+        char sharedMemoryName[128] = "/vge_stars";
+        bool attachRequested = false;
+        bool detachRequested = false;
+        std::string attachError;
+
+        QualityGovernor qualityGovernor{GalaxySystem::NUM_STARS, GalaxySystem::WORKGROUP_SIZE};
+        int framesSinceSimulation = 0;
+        float simulationTimeAccumulator = 0.0f;
     };
 
 } // namespace
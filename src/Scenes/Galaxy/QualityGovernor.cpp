@@ -0,0 +1,85 @@
+#include "QualityGovernor.h"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+namespace vge {
+
+QualityGovernor::QualityGovernor(int maxStars, int granularity)
+    : maxStars{maxStars}, granularity{std::max(granularity, 1)} {
+    reset();
+}
+
+void QualityGovernor::reset() {
+    decision = Decision{};
+    decision.activeStars = maxStars;
+    measuredFrameTime = 0.0f;
+    timeSinceAdjust = 0.0f;
+}
+
+void QualityGovernor::update(float cpuFrameTime, float gpuFrameTime, float deltaTime) {
+    // Exponential moving averages keep single spikes from triggering a quality drop
+    if (measuredFrameTime == 0.0f) {
+        measuredCpuTime = cpuFrameTime;
+        measuredGpuTime = gpuFrameTime;
+    } else {
+        measuredCpuTime += (cpuFrameTime - measuredCpuTime) * SMOOTHING;
+        measuredGpuTime += (gpuFrameTime - measuredGpuTime) * SMOOTHING;
+    }
+    // Whichever side is slower bounds the frame rate
+    measuredFrameTime = std::max(measuredCpuTime, measuredGpuTime);
+
+    if (!settings.enabled) {
+        if (decision.quality != 1.0f) {
+            decision.quality = 1.0f;
+            applyQuality();
+        }
+        return;
+    }
+
+    timeSinceAdjust += deltaTime;
+    if (timeSinceAdjust < ADJUST_INTERVAL || measuredFrameTime <= 0.0f) {
+        return;
+    }
+    timeSinceAdjust = 0.0f;
+
+    float target = settings.targetFrameTime;
+    float quality = decision.quality;
+    if (measuredFrameTime > target * UPPER_BAND) {
+        // Cost scales roughly with quality, so step straight towards the target
+        quality *= std::max(MAX_STEP_DOWN, target / measuredFrameTime);
+    } else if (measuredFrameTime < target * LOWER_BAND) {
+        // Climb back slowly to avoid oscillating around the target
+        quality *= STEP_UP;
+    } else {
+        return;
+    }
+
+    float minQuality = std::min(settings.minStarFraction, 1.0f);
+    decision.quality = std::clamp(quality, minQuality, 1.0f);
+    applyQuality();
+}
+
+void QualityGovernor::applyQuality() {
+    float quality = decision.quality;
+
+    // Star count carries most of the reduction; point size drops more gently
+    float starFraction = std::max(settings.minStarFraction, quality);
+    int stars = static_cast<int>(std::ceil(starFraction * maxStars / granularity)) * granularity;
+    decision.activeStars = std::clamp(stars, granularity, maxStars);
+
+    decision.pointSizeScale = std::max(settings.minPointSizeScale, std::sqrt(quality));
+
+    // Simulate less often as quality falls, stepping with the accumulated time
+    int interval = static_cast<int>(std::ceil((1.0f - quality) * 4.0f));
+    decision.simulationInterval =
+        std::clamp(interval, 1, std::max(settings.maxSimulationInterval, 1));
+
+    // Perceived density goes with star count times point area, so boost brightness to match
+    float drawnFraction = static_cast<float>(decision.activeStars) / maxStars;
+    float coverage = drawnFraction * decision.pointSizeScale * decision.pointSizeScale;
+    decision.brightness = std::min(settings.maxBrightness, 1.0f / coverage);
+}
+
+}  // namespace vge
@@ -0,0 +1,68 @@
+#pragma once
+
+namespace vge {
+
+// Holds the frame time near a target by trading galaxy quality for speed. Each frame it is fed
+// the measured CPU and GPU frame times; a few times per second it moves a single quality factor
+// and maps it onto star count, point size and simulation rate.
+class QualityGovernor {
+public:
+    struct Settings {
+        bool enabled = true;
+        float targetFrameTime = 8.3f;  // ms
+        float minStarFraction = 0.1f;
+        float minPointSizeScale = 0.5f;
+        int maxSimulationInterval = 4;
+        float maxBrightness = 4.0f;
+    };
+
+    struct Decision {
+        int activeStars;
+        float pointSizeScale = 1.0f;
+        float brightness = 1.0f;
+        int simulationInterval = 1;  // run the simulation every N frames
+        float quality = 1.0f;
+    };
+
+    // granularity rounds the star count up to whole compute workgroups
+    QualityGovernor(int maxStars, int granularity);
+
+    void update(float cpuFrameTime, float gpuFrameTime, float deltaTime);
+    void reset();
+
+    const Decision& getDecision() const {
+        return decision;
+    }
+    float getMeasuredFrameTime() const {
+        return measuredFrameTime;
+    }
+    float getMeasuredCpuTime() const {
+        return measuredCpuTime;
+    }
+    float getMeasuredGpuTime() const {
+        return measuredGpuTime;
+    }
+
+    Settings settings{};
+
+private:
+    void applyQuality();
+
+    static constexpr float SMOOTHING = 0.1f;
+    static constexpr float ADJUST_INTERVAL = 0.25f;  // seconds between decisions
+    static constexpr float UPPER_BAND = 1.05f;       // above target * this, lower quality
+    static constexpr float LOWER_BAND = 0.85f;       // below target * this, raise quality
+    static constexpr float MAX_STEP_DOWN = 0.8f;
+    static constexpr float STEP_UP = 1.05f;
+
+    int maxStars;
+    int granularity;
+
+    Decision decision{};
+    float measuredFrameTime = 0.0f;
+    float measuredCpuTime = 0.0f;
+    float measuredGpuTime = 0.0f;
+    float timeSinceAdjust = 0.0f;
+};
+
+}  // namespace vge
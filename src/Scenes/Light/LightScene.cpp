@@ -1,4 +1,5 @@
 #include "LightScene.h"
+#include "../../Graphics/PipelineCompiler.h"
 #include "imgui.h"
 
 #ifndef ENGINE_DIR
@@ -15,17 +16,19 @@ namespace vge {
     void LightScene::init() {
         renderSystem = std::make_unique<RenderSystem>(
             device,
-            renderer.getSwapChainRenderPass(),
+            renderer.getPipelineRenderPass(),
             globalSetLayout
         );
 
         pointLightSystem = std::make_unique<PointLightSystem>(
             device,
-            renderer.getSwapChainRenderPass(),
+            renderer.getPipelineRenderPass(),
             globalSetLayout
         );
 
+        // Both systems' pipelines compile on the worker threads while the models load
         loadGameObjects();
+        device.getPipelineCompiler().waitIdle();
     }
 
     void LightScene::loadGameObjects() {
@@ -39,6 +42,7 @@ namespace vge {
         tree.transform.translation = {0.0f, 0.0f, 0.0f};
         tree.transform.scale = glm::vec3{1.0f};
         tree.transform.rotation = glm::vec3{glm::radians(180.0f), 0.f, 0.f};
+        tree.isStatic = true;
         gameObjects.emplace(tree.getId(), std::move(tree));
 
         // Create point lights with different colors and positions
@@ -79,16 +83,33 @@ namespace vge {
     }
 
     void LightScene::render(FrameInfo& frameInfo) {
-        // First render all regular objects
-        renderSystem->renderGameObjects(frameInfo);
+        // The static models' draws are replayed. Anything else, including the lights the UI
+        // edits, is recorded every frame.
+        renderSystem->renderStatic(frameInfo, renderer);
+
+        std::vector<RenderJob> jobs;
+        renderSystem->addRenderJobs(frameInfo, jobs);
+        jobs.push_back([this](FrameInfo& jobInfo) { pointLightSystem->render(jobInfo); });
+        renderer.recordParallel(frameInfo, jobs);
+    }
 
-        // Then render point lights
-        pointLightSystem->render(frameInfo);
+    void LightScene::renderPerformanceUI() {
+        const VgeCachedCommands& staticCommands = renderSystem->getStaticCommands();
+        ImGui::Text("Static draws recorded %llu times in %llu frames",
+                    static_cast<unsigned long long>(staticCommands.getRecordCount()),
+                    static_cast<unsigned long long>(staticCommands.getReplayCount()));
     }
 
     void LightScene::renderUI() {
         if (!ImGui::TreeNode("Light Controls")) return;
 
+        if (device.supportsWireframe()) {
+            bool wireframe = renderSystem->isWireframe();
+            if (ImGui::Checkbox("Wireframe", &wireframe)) {
+                renderSystem->setWireframe(wireframe);
+            }
+        }
+
         // Light control UI
         for (auto& kv : gameObjects) {
             auto& obj = kv.second;
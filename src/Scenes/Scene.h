@@ -26,6 +26,9 @@ class Scene {
     virtual const char* getName() const = 0;
     virtual void updateUbo(GlobalUbo& ubo, FrameInfo& frameInfo) = 0;
 
+    // Optional scene specific readouts shown in the performance panel
+    virtual void renderPerformanceUI() {}
+
     bool shouldDestroy{false};
     GameObject::Map& getGameObjects() {
         return gameObjects;
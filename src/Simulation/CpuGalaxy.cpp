@@ -0,0 +1,104 @@
+#include "CpuGalaxy.h"
+
+#include "../Utils/hashFunction.h"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+namespace vge {
+
+// Must match the constants in galaxy_compute.comp
+static constexpr float BASE_ROTATION_SPEED = -0.05f;
+static constexpr float SPEED_MULTIPLIER = 20.0f;
+static constexpr float TWO_PI = 2.0f * 3.14159f;
+
+CpuGalaxy::CpuGalaxy(const GalaxyShape& shape, int numStars, int numEllipses)
+    : ellipses{shape.generateEllipseParams(numEllipses)},
+      stars{createInitialStars(shape, ellipses, numStars)} {}
+
+std::vector<Star> CpuGalaxy::createInitialStars(
+    const GalaxyShape& shape, const std::vector<Ellipse::EllipseParams>& ellipses, int numStars) {
+    std::vector<Star> initialStars(numStars);
+    for (int i = 0; i < numStars; i++) {
+        initialStars[i] = createInitialStar(shape, ellipses, i);
+    }
+    return initialStars;
+}
+
+Star CpuGalaxy::createInitialStar(const GalaxyShape& shape,
+                                  const std::vector<Ellipse::EllipseParams>& ellipses, int index) {
+    const int numEllipses = static_cast<int>(ellipses.size());
+    const double goldenRatioConjugate = 0.6180339887498949;
+
+    int ellipseIndex = index % numEllipses;
+    int localIndex = index / numEllipses;
+
+    float t =
+        static_cast<float>(std::fmod(localIndex * goldenRatioConjugate, 1.0) * 2.0 * M_PI);
+
+    // Get base ellipse position without height
+    glm::vec3 basePos = Ellipse::calculateEllipsePoint(t, ellipses[ellipseIndex], 0.0f);
+
+    // Calculate height using de Vaucouleurs's Law
+    float baseHeight = shape.calculateVaucouleursHeight(basePos.x, basePos.z);
+    // Hashed as integers, floats stop telling indices apart above 2^24 stars. The salts are
+    // xor'ed in so each value gets its own stream without two indices sharing one.
+    uint32_t id = static_cast<uint32_t>(index);
+    float randomizedHeight = baseHeight * (hash(id) * 2.0f - 1.0f);
+
+    // NTS: replace 4.0f with the ellipse's major axis
+    float randRadius = hash(id ^ 0x68bc21ebU) * 4.0f;
+    float randAngle = hash(id ^ 0x02e5be93U) * 2.0f * M_PI;
+
+    // Calculate random offset in polar coordinates
+    float offsetX = randRadius * std::cos(randAngle);
+    float offsetZ = randRadius * std::sin(randAngle);
+
+    Star star;
+    star.position = basePos + glm::vec3(offsetX, randomizedHeight, offsetZ);
+    star.velocity = glm::vec3(t, randomizedHeight, randRadius);
+    return star;
+}
+
+Star CpuGalaxy::stepStar(const Star& star, const Ellipse::EllipseParams& params,
+                         float deltaTime) {
+    float currentAngle = star.velocity.x;
+    float storedHeight = star.velocity.y;
+    float radialOffset = star.velocity.z;
+
+    // Rotation speed falls off with ellipse size
+    float speedFactor = SPEED_MULTIPLIER / std::max(params.majorAxis, 0.1f);
+    float rotationSpeed = BASE_ROTATION_SPEED * speedFactor;
+
+    float newAngle = currentAngle + rotationSpeed * deltaTime;
+    if (newAngle > TWO_PI) {
+        newAngle -= TWO_PI;
+    }
+
+    glm::vec3 basePos = Ellipse::calculateEllipsePoint(newAngle, params, storedHeight);
+
+    // Stored radial offset in the orbital plane
+    float offsetAngle = newAngle + radialOffset;
+    glm::vec3 offset{std::cos(offsetAngle) * radialOffset, 0.0f,
+                     std::sin(offsetAngle) * radialOffset};
+
+    Star result;
+    result.position = basePos + offset;
+    result.velocity = glm::vec3(newAngle, storedHeight, radialOffset);
+    return result;
+}
+
+void CpuGalaxy::step(float deltaTime) {
+    step(deltaTime, 0, stars.size());
+}
+
+void CpuGalaxy::step(float deltaTime, size_t begin, size_t end) {
+    const size_t numEllipses = ellipses.size();
+    end = std::min(end, stars.size());
+    for (size_t i = begin; i < end; i++) {
+        stars[i] = stepStar(stars[i], ellipses[i % numEllipses], deltaTime);
+    }
+}
+
+}  // namespace vge
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../Utils/ellipse.h"
+#include "Star.h"
+
+// std
+#include <cstddef>
+#include <vector>
+
+namespace vge {
+
+// Tunable galaxy parameters, by value
+using GalaxyShape = Ellipse::Shape;
+
+// CPU implementation of the galaxy simulation. Initialization is shared with GalaxySystem and
+// step() mirrors shaders/Galaxy/galaxy_compute.comp, so results match the GPU path.
+class CpuGalaxy {
+public:
+    CpuGalaxy(const GalaxyShape& shape, int numStars, int numEllipses = Ellipse::MAX_ELLIPSES);
+
+    // Advances every star by deltaTime
+    void step(float deltaTime);
+    // Advances stars [begin, end) only, for callers that split the work themselves
+    void step(float deltaTime, size_t begin, size_t end);
+
+    const std::vector<Star>& getStars() const {
+        return stars;
+    }
+    std::vector<Star>& getStars() {
+        return stars;
+    }
+    const std::vector<Ellipse::EllipseParams>& getEllipses() const {
+        return ellipses;
+    }
+
+    // Stars are interleaved across ellipses with golden ratio angles, so any prefix of the
+    // result covers the whole galaxy evenly
+    static std::vector<Star> createInitialStars(const GalaxyShape& shape,
+                                                const std::vector<Ellipse::EllipseParams>& ellipses,
+                                                int numStars);
+    // Star with the given global index, independent of every other star
+    static Star createInitialStar(const GalaxyShape& shape,
+                                  const std::vector<Ellipse::EllipseParams>& ellipses, int index);
+    static Star stepStar(const Star& star, const Ellipse::EllipseParams& params, float deltaTime);
+
+private:
+    std::vector<Ellipse::EllipseParams> ellipses;
+    std::vector<Star> stars;
+};
+
+}  // namespace vge
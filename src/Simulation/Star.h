@@ -0,0 +1,14 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace vge {
+
+// Matches the std430 Star struct in shaders/Galaxy/galaxy_compute.comp.
+// velocity holds the orbit state rather than a velocity: x = angle, y = height, z = radial offset
+struct Star {
+    alignas(16) glm::vec3 position;
+    alignas(16) glm::vec3 velocity;
+};
+
+}  // namespace vge
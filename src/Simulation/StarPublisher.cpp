@@ -0,0 +1,102 @@
+#include "StarPublisher.h"
+
+// std
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace vge {
+
+StarPublisher::StarPublisher(const std::string& name, uint32_t numStars, float deltaTime)
+    : name{name}, numStars{numStars}, layout{StarSnapshotLayout::compute(numStars)} {
+    void* mapped = nullptr;
+#ifdef _WIN32
+    uint64_t size = layout.totalSize;
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                 static_cast<DWORD>(size >> 32), static_cast<DWORD>(size),
+                                 name.c_str());
+    if (!mapping || GetLastError() == ERROR_ALREADY_EXISTS) {
+        if (mapping) CloseHandle(mapping);
+        throw std::runtime_error("failed to create shared memory " + name + "!!!");
+    }
+    mapped = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (!mapped) {
+        CloseHandle(mapping);
+        throw std::runtime_error("failed to map shared memory!!!");
+    }
+#else
+    // A publisher that crashed leaves its region behind, and unlike on Windows nothing
+    // removes it. Take the name over; readers still attached to the old region keep it
+    // until they detach.
+    shm_unlink(name.c_str());
+    // Readers only ever map it read only, 0644 lets other users of the machine attach too
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("failed to create shared memory " + name + ": " +
+                                 std::strerror(errno));
+    }
+    if (ftruncate(fd, static_cast<off_t>(layout.totalSize)) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("failed to size shared memory!!!");
+    }
+    mapped = mmap(nullptr, layout.totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw std::runtime_error("failed to map shared memory!!!");
+    }
+#endif
+
+    // The region starts out zeroed, so readers see magic 0 until the header is complete
+    header = new (mapped) StarSnapshotHeader{};
+    header->version = STAR_SNAPSHOT_VERSION;
+    header->numStars = numStars;
+    header->starSize = sizeof(Star);
+    header->slotOffset = layout.slotOffset;
+    header->slotStride = layout.slotStride;
+    header->latestSlot.store(STAR_SNAPSHOT_SLOTS - 1, std::memory_order_relaxed);
+    header->latestStep.store(0, std::memory_order_relaxed);
+    for (auto& sequence : header->slotSequence) {
+        sequence.store(0, std::memory_order_relaxed);
+    }
+    header->deltaTime = deltaTime;
+    header->magic.store(STAR_SNAPSHOT_MAGIC, std::memory_order_release);
+}
+
+StarPublisher::~StarPublisher() {
+#ifdef _WIN32
+    UnmapViewOfFile(header);
+    CloseHandle(mapping);
+#else
+    munmap(header, layout.totalSize);
+    shm_unlink(name.c_str());
+#endif
+}
+
+Star* StarPublisher::getSlot(uint32_t slot) {
+    auto* base = reinterpret_cast<uint8_t*>(header);
+    return reinterpret_cast<Star*>(base + layout.slotOffset + slot * layout.slotStride);
+}
+
+void StarPublisher::publish(const Star* stars, uint64_t step) {
+    // Only this process writes, so relaxed loads of its own stores are enough
+    uint32_t slot = (header->latestSlot.load(std::memory_order_relaxed) + 1) % STAR_SNAPSHOT_SLOTS;
+    uint64_t sequence = header->slotSequence[slot].load(std::memory_order_relaxed);
+
+    header->slotSequence[slot].store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(getSlot(slot), stars, sizeof(Star) * numStars);
+    header->slotSequence[slot].store(sequence + 2, std::memory_order_release);
+
+    header->latestSlot.store(slot, std::memory_order_release);
+    header->latestStep.store(step, std::memory_order_release);
+}
+
+}  // namespace vge
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Star.h"
+#include "StarSnapshot.h"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+namespace vge {
+
+// Writer side of a StarSnapshot region. Creates the named shared memory, POSIX shm_open on Linux
+// and a named file mapping on Windows, and removes it again on destruction. A region left over
+// under the same name, e.g. by a publisher that crashed, is replaced. Readers open it by the
+// same name.
+class StarPublisher {
+public:
+    StarPublisher(const std::string& name, uint32_t numStars, float deltaTime);
+    ~StarPublisher();
+
+    StarPublisher(const StarPublisher&) = delete;
+    StarPublisher& operator=(const StarPublisher&) = delete;
+
+    // Copies the stars into the slot readers are not on and makes it the latest
+    void publish(const Star* stars, uint64_t step);
+
+    const std::string& getName() const {
+        return name;
+    }
+    size_t size() const {
+        return layout.totalSize;
+    }
+
+private:
+    Star* getSlot(uint32_t slot);
+
+    std::string name;
+    uint32_t numStars;
+    StarSnapshotLayout layout;
+    StarSnapshotHeader* header = nullptr;
+#ifdef _WIN32
+    HANDLE mapping = nullptr;
+#endif
+};
+
+}  // namespace vge
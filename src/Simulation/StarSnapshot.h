@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Star.h"
+
+// std
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace vge {
+
+// Layout of the shared memory a simulation server publishes stars through, so other local
+// processes can map it and read the latest step in place. All offsets are from the start of the
+// mapping:
+//   StarSnapshotHeader
+//   Star slots[2][numStars]  slot i starts at slotOffset + i * slotStride
+//
+// The server fills the slot that is not latestSlot and then flips latestSlot. Each slot has a
+// sequence number that is odd while it is being written. A reader that holds on to a slot for
+// longer than a step can be overtaken, so it checks the sequence before and after reading:
+//
+//   uint64_t sequence;
+//   const Star* stars = beginSnapshotRead(header, sequence);
+//   ... read stars ...
+//   if (!endSnapshotRead(header, stars, sequence)) { discard what was read, try again }
+constexpr uint32_t STAR_SNAPSHOT_MAGIC = 0x56474553;  // "VGES"
+constexpr uint32_t STAR_SNAPSHOT_VERSION = 1;
+constexpr uint32_t STAR_SNAPSHOT_SLOTS = 2;
+
+struct StarSnapshotHeader {
+    // Stored last, readers wait for STAR_SNAPSHOT_MAGIC before trusting anything else
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t numStars;
+    uint32_t starSize;  // sizeof(Star), std430 layout with 16 byte aligned vec3s
+    uint64_t slotOffset;
+    uint64_t slotStride;
+
+    std::atomic<uint32_t> latestSlot;
+    std::atomic<uint64_t> latestStep;  // 0 until the first step is published
+    std::atomic<uint64_t> slotSequence[STAR_SNAPSHOT_SLOTS];
+    float deltaTime;  // simulated seconds per step
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared memory needs lock free atomics to be usable across processes");
+
+struct StarSnapshotLayout {
+    size_t slotOffset;
+    size_t slotStride;
+    size_t totalSize;
+
+    static StarSnapshotLayout compute(uint32_t numStars) {
+        auto alignUp = [](size_t value) { return (value + 63) / 64 * 64; };
+        StarSnapshotLayout layout;
+        layout.slotOffset = alignUp(sizeof(StarSnapshotHeader));
+        layout.slotStride = alignUp(sizeof(Star) * numStars);
+        layout.totalSize = layout.slotOffset + layout.slotStride * STAR_SNAPSHOT_SLOTS;
+        return layout;
+    }
+};
+
+inline const Star* getSnapshotSlot(const StarSnapshotHeader& header, uint32_t slot) {
+    auto* base = reinterpret_cast<const uint8_t*>(&header);
+    return reinterpret_cast<const Star*>(base + header.slotOffset + slot * header.slotStride);
+}
+
+inline bool isSnapshotCompatible(const StarSnapshotHeader& header) {
+    return header.magic.load(std::memory_order_acquire) == STAR_SNAPSHOT_MAGIC &&
+           header.version == STAR_SNAPSHOT_VERSION && header.starSize == sizeof(Star);
+}
+
+// Returns the most recently published stars, or nullptr if there are none yet or the server is
+// already overwriting them
+inline const Star* beginSnapshotRead(const StarSnapshotHeader& header, uint64_t& sequence) {
+    if (!isSnapshotCompatible(header) || header.latestStep.load(std::memory_order_acquire) == 0) {
+        return nullptr;
+    }
+    uint32_t slot = header.latestSlot.load(std::memory_order_acquire);
+    sequence = header.slotSequence[slot].load(std::memory_order_acquire);
+    return (sequence & 1) ? nullptr : getSnapshotSlot(header, slot);
+}
+
+// True if the stars returned by beginSnapshotRead were not touched while they were read
+inline bool endSnapshotRead(const StarSnapshotHeader& header, const Star* stars,
+                            uint64_t sequence) {
+    uint32_t slot = stars == getSnapshotSlot(header, 0) ? 0 : 1;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return header.slotSequence[slot].load(std::memory_order_relaxed) == sequence;
+}
+
+}  // namespace vge
@@ -0,0 +1,93 @@
+#include "StarSnapshotReader.h"
+
+// std
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vge {
+
+StarSnapshotReader::StarSnapshotReader(const std::string& name) : name{name} {
+    void* mapped = nullptr;
+#ifdef _WIN32
+    mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+    if (!mapping) {
+        throw std::runtime_error("failed to open shared memory " + name + "!!!");
+    }
+    mapped = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!mapped) {
+        CloseHandle(mapping);
+        throw std::runtime_error("failed to map shared memory!!!");
+    }
+    MEMORY_BASIC_INFORMATION info{};
+    VirtualQuery(mapped, &info, sizeof(info));
+    mappedSize = info.RegionSize;
+#else
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw std::runtime_error("failed to open shared memory " + name + ": " +
+                                 std::strerror(errno));
+    }
+    struct stat status {};
+    if (fstat(fd, &status) != 0) {
+        close(fd);
+        throw std::runtime_error("failed to query shared memory size!!!");
+    }
+    mappedSize = static_cast<size_t>(status.st_size);
+    mapped = mappedSize > 0 ? mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("failed to map shared memory!!!");
+    }
+#endif
+    header = static_cast<const StarSnapshotHeader*>(mapped);
+
+    // The publisher writes the header before the magic, a region that is still being set up
+    // is rejected like a foreign one
+    bool valid = mappedSize >= sizeof(StarSnapshotHeader) && isSnapshotCompatible(*header) &&
+                 header->slotOffset + header->slotStride * STAR_SNAPSHOT_SLOTS <= mappedSize &&
+                 sizeof(Star) * static_cast<uint64_t>(header->numStars) <= header->slotStride;
+    if (!valid) {
+#ifdef _WIN32
+        UnmapViewOfFile(mapped);
+        CloseHandle(mapping);
+#else
+        munmap(mapped, mappedSize);
+#endif
+        throw std::runtime_error("shared memory " + name + " holds no compatible stars!!!");
+    }
+}
+
+StarSnapshotReader::~StarSnapshotReader() {
+#ifdef _WIN32
+    UnmapViewOfFile(header);
+    CloseHandle(mapping);
+#else
+    munmap(const_cast<StarSnapshotHeader*>(header), mappedSize);
+#endif
+}
+
+uint64_t StarSnapshotReader::read(Star* destination) const {
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++) {
+        // The step is loaded first, a newer one published meanwhile only makes it conservative
+        uint64_t step = getLatestStep();
+        uint64_t sequence = 0;
+        const Star* stars = beginSnapshotRead(*header, sequence);
+        if (!stars) {
+            continue;
+        }
+        std::memcpy(destination, stars, sizeof(Star) * header->numStars);
+        if (endSnapshotRead(*header, stars, sequence)) {
+            return step;
+        }
+    }
+    return 0;
+}
+
+}  // namespace vge
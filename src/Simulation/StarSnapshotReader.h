@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Star.h"
+#include "StarSnapshot.h"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+namespace vge {
+
+// Reader side of a StarSnapshot region, mapped read only by the name a StarPublisher created it
+// with. The publisher may come and go independently, a reader of a removed region keeps seeing
+// the last published stars.
+class StarSnapshotReader {
+public:
+    explicit StarSnapshotReader(const std::string& name);
+    ~StarSnapshotReader();
+
+    StarSnapshotReader(const StarSnapshotReader&) = delete;
+    StarSnapshotReader& operator=(const StarSnapshotReader&) = delete;
+
+    // Copies the latest published stars to destination, which holds getNumStars() stars, and
+    // returns their step. Returns 0 with destination left undefined when nothing was published
+    // yet or the publisher kept overwriting the stars while they were copied.
+    uint64_t read(Star* destination) const;
+
+    uint32_t getNumStars() const {
+        return header->numStars;
+    }
+    uint64_t getLatestStep() const {
+        return header->latestStep.load(std::memory_order_acquire);
+    }
+    float getDeltaTime() const {
+        return header->deltaTime;
+    }
+
+private:
+    // A copy overtaken by the publisher is retried this many times before giving up
+    static constexpr int MAX_READ_ATTEMPTS = 4;
+
+    std::string name;
+    size_t mappedSize = 0;
+    const StarSnapshotHeader* header = nullptr;
+#ifdef _WIN32
+    HANDLE mapping = nullptr;
+#endif
+};
+
+}  // namespace vge
@@ -0,0 +1,163 @@
+#include "StarTileFile.h"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace vge {
+
+StarTileReader::StarTileReader(const std::string& filepath)
+    : file{filepath, std::ios::binary} {
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open star tile file: " + filepath);
+    }
+
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, STAR_TILE_MAGIC, sizeof(STAR_TILE_MAGIC)) != 0 ||
+        header.version != STAR_TILE_VERSION) {
+        throw std::runtime_error("not a supported star tile file: " + filepath);
+    }
+
+    tiles.resize(header.tileCount);
+    file.read(reinterpret_cast<char*>(tiles.data()), sizeof(StarTileEntry) * tiles.size());
+    if (!file) {
+        throw std::runtime_error("failed to read star tile table!!!");
+    }
+}
+
+void StarTileReader::readStars(uint64_t offset, uint32_t count, Star* destination) {
+    file.seekg(static_cast<std::streamoff>(offset));
+    file.read(reinterpret_cast<char*>(destination), sizeof(Star) * count);
+    if (!file) {
+        file.clear();
+        throw std::runtime_error("failed to read star tile data!!!");
+    }
+}
+
+void StarTileWriter::generate(const std::string& filepath, const Settings& settings) {
+    if (settings.numStars == 0 || settings.gridSize == 0 || settings.coarseStride == 0 ||
+        settings.numStars > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+        throw std::runtime_error("invalid star tile settings!!!");
+    }
+
+    const uint32_t gridSize = settings.gridSize;
+    const uint32_t tileCount = gridSize * gridSize;
+    const auto ellipses = settings.shape.generateEllipseParams(settings.numEllipses);
+    auto createStar = [&](uint64_t i) {
+        return CpuGalaxy::createInitialStar(settings.shape, ellipses, static_cast<int>(i));
+    };
+    auto isCoarse = [&](uint64_t i) { return i % settings.coarseStride == 0; };
+
+    StarTileHeader header{};
+    std::memcpy(header.magic, STAR_TILE_MAGIC, sizeof(STAR_TILE_MAGIC));
+    header.version = STAR_TILE_VERSION;
+    header.gridSize = gridSize;
+    header.coarseStride = settings.coarseStride;
+    header.totalStars = settings.numStars;
+    header.tileCount = tileCount;
+
+    // Pass 1: overall bounds, so the tile grid covers the galaxy
+    glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+    glm::vec3 boundsMax{std::numeric_limits<float>::lowest()};
+    for (uint64_t i = 0; i < settings.numStars; i++) {
+        glm::vec3 p = createStar(i).position;
+        boundsMin = glm::vec3(std::min(boundsMin.x, p.x), std::min(boundsMin.y, p.y),
+                              std::min(boundsMin.z, p.z));
+        boundsMax = glm::vec3(std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y),
+                              std::max(boundsMax.z, p.z));
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        header.boundsMin[axis] = boundsMin[axis];
+        header.boundsMax[axis] = boundsMax[axis];
+    }
+
+    auto tileOf = [&](const glm::vec3& p) {
+        auto cell = [&](float value, float low, float high) {
+            float t = (value - low) / std::max(high - low, 1e-6f);
+            return std::min(static_cast<uint32_t>(std::max(t, 0.0f) * gridSize), gridSize - 1);
+        };
+        return cell(p.z, boundsMin.z, boundsMax.z) * gridSize +
+               cell(p.x, boundsMin.x, boundsMax.x);
+    };
+
+    // Pass 2: per tile counts and tight bounds
+    std::vector<StarTileEntry> tiles(tileCount);
+    for (auto& tile : tiles) {
+        for (int axis = 0; axis < 3; axis++) {
+            tile.boundsMin[axis] = std::numeric_limits<float>::max();
+            tile.boundsMax[axis] = std::numeric_limits<float>::lowest();
+        }
+    }
+    for (uint64_t i = 0; i < settings.numStars; i++) {
+        if (isCoarse(i)) {
+            header.coarseCount++;
+            continue;
+        }
+        glm::vec3 p = createStar(i).position;
+        StarTileEntry& tile = tiles[tileOf(p)];
+        tile.starCount++;
+        for (int axis = 0; axis < 3; axis++) {
+            tile.boundsMin[axis] = std::min(tile.boundsMin[axis], p[axis]);
+            tile.boundsMax[axis] = std::max(tile.boundsMax[axis], p[axis]);
+        }
+    }
+
+    uint64_t offset = sizeof(StarTileHeader) + sizeof(StarTileEntry) * tileCount;
+    header.coarseOffset = offset;
+    offset += sizeof(Star) * header.coarseCount;
+    for (auto& tile : tiles) {
+        tile.offset = offset;
+        offset += sizeof(Star) * tile.starCount;
+        header.maxTileStars = std::max(header.maxTileStars, tile.starCount);
+        if (tile.starCount == 0) {
+            std::fill(std::begin(tile.boundsMin), std::end(tile.boundsMin), 0.0f);
+            std::fill(std::begin(tile.boundsMax), std::end(tile.boundsMax), 0.0f);
+        }
+    }
+
+    std::fstream file{filepath, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc};
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to create star tile file: " + filepath);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(tiles.data()), sizeof(StarTileEntry) * tileCount);
+
+    // Pass 3: stars, buffered per tile and flushed to each tile's running write position
+    static constexpr size_t FLUSH_COUNT = 256;
+    std::vector<std::vector<Star>> pending(tileCount + 1);  // last entry is the coarse set
+    std::vector<uint64_t> writePositions(tileCount + 1);
+    for (uint32_t t = 0; t < tileCount; t++) {
+        writePositions[t] = tiles[t].offset;
+    }
+    writePositions[tileCount] = header.coarseOffset;
+
+    auto flush = [&](uint32_t bucket) {
+        std::vector<Star>& stars = pending[bucket];
+        if (stars.empty()) return;
+        file.seekp(static_cast<std::streamoff>(writePositions[bucket]));
+        file.write(reinterpret_cast<const char*>(stars.data()), sizeof(Star) * stars.size());
+        writePositions[bucket] += sizeof(Star) * stars.size();
+        stars.clear();
+    };
+
+    for (uint64_t i = 0; i < settings.numStars; i++) {
+        Star star = createStar(i);
+        uint32_t bucket = isCoarse(i) ? tileCount : tileOf(star.position);
+        pending[bucket].push_back(star);
+        if (pending[bucket].size() >= FLUSH_COUNT) {
+            flush(bucket);
+        }
+    }
+    for (uint32_t bucket = 0; bucket <= tileCount; bucket++) {
+        flush(bucket);
+    }
+
+    if (!file) {
+        throw std::runtime_error("failed to write star tile file: " + filepath);
+    }
+}
+
+}  // namespace vge
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "CpuGalaxy.h"
+#include "Star.h"
+
+// std
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace vge {
+
+// Tiled on-disk star format (.vgst) for datasets larger than memory.
+//
+//   StarTileHeader
+//   StarTileEntry tiles[gridSize * gridSize]   fine tiles, row major over x then z
+//   Star stars[...]                            coarse stars, then each fine tile's stars
+//
+// Every coarseStride-th star goes to the coarse set instead of its fine tile, so the coarse
+// set is a uniform sample of the whole galaxy that is small enough to keep resident, and
+// drawing coarse plus any resident fine tiles never draws a star twice. Stars are stored in
+// the GPU Star layout so tile payloads upload without conversion.
+struct StarTileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t gridSize;
+    uint32_t coarseStride;
+    float boundsMin[3];
+    float boundsMax[3];
+    uint64_t totalStars;
+    uint64_t coarseOffset;  // bytes from the start of the file
+    uint64_t coarseCount;
+    uint32_t tileCount;
+    uint32_t maxTileStars;  // largest fine tile, sizes the GPU slots
+};
+
+struct StarTileEntry {
+    float boundsMin[3];
+    float boundsMax[3];
+    uint64_t offset;  // bytes from the start of the file
+    uint32_t starCount;
+    uint32_t padding;
+};
+
+static constexpr char STAR_TILE_MAGIC[4] = {'V', 'G', 'S', 'T'};
+static constexpr uint32_t STAR_TILE_VERSION = 1;
+
+// Reads the header and tile table up front; star payloads are read on demand. Not thread
+// safe, give each thread its own reader.
+class StarTileReader {
+public:
+    explicit StarTileReader(const std::string& filepath);
+
+    StarTileReader(const StarTileReader&) = delete;
+    StarTileReader& operator=(const StarTileReader&) = delete;
+
+    const StarTileHeader& getHeader() const {
+        return header;
+    }
+    const std::vector<StarTileEntry>& getTiles() const {
+        return tiles;
+    }
+
+    void readStars(uint64_t offset, uint32_t count, Star* destination);
+
+private:
+    std::ifstream file;
+    StarTileHeader header{};
+    std::vector<StarTileEntry> tiles;
+};
+
+// Generates a galaxy straight into a tile file in streaming passes (bounds, counts, write),
+// so memory use is bounded by the tile table and small per-tile write buffers, not the
+// number of stars
+class StarTileWriter {
+public:
+    struct Settings {
+        uint64_t numStars = 100000000;
+        uint32_t gridSize = 64;
+        uint32_t coarseStride = 64;
+        int numEllipses = Ellipse::MAX_ELLIPSES;
+        GalaxyShape shape{};
+    };
+
+    static void generate(const std::string& filepath, const Settings& settings);
+};
+
+}  // namespace vge
@@ -0,0 +1,164 @@
+#include "SimulationServer.h"
+
+#include "Device/FrameScheduler.h"
+#include "Device/TransferManager.h"
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace vge {
+
+static std::atomic<bool> stopRequested{false};
+
+static void requestStop(int) {
+    stopRequested = true;
+}
+
+SimulationServer::SimulationServer(const Settings& settings) : settings{settings} {
+    galaxySystem = std::make_unique<GalaxySystem>(vgeDevice);
+    publisher = std::make_unique<StarPublisher>(settings.sharedMemoryName, GalaxySystem::NUM_STARS,
+                                                settings.deltaTime);
+    createCommandBuffer();
+}
+
+SimulationServer::~SimulationServer() {
+    vkDeviceWaitIdle(vgeDevice.device());
+    galaxySystem.reset();
+    vgeDevice.getDeletionQueue().flush();
+    vkFreeCommandBuffers(vgeDevice.device(), vgeDevice.getCommandPool(), 1, &commandBuffer);
+}
+
+void SimulationServer::createCommandBuffer() {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = vgeDevice.getCommandPool();
+    allocInfo.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(vgeDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate command buffers!!!");
+    }
+}
+
+uint64_t SimulationServer::submitStep() {
+    VgeFrameScheduler& scheduler = vgeDevice.getFrameScheduler();
+    uint64_t frame = scheduler.beginFrame();
+    vgeDevice.getDeletionQueue().beginFrame(frame, scheduler.getCompletedFrame());
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording command buffer!!!");
+    }
+
+    // The previous step wrote the stars this one reads, and two steps back read the buffer
+    // this one writes
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0,
+                         nullptr);
+
+    galaxySystem->computeStars(commandBuffer, settings.deltaTime);
+
+    // The star buffers are host visible, the result is read straight out of them
+    VkMemoryBarrier toHost{};
+    toHost.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    toHost.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &toHost, 0, nullptr, 0, nullptr);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!!!");
+    }
+
+    vgeDevice.getTransferManager().flush();
+
+    VkSemaphore timeline = scheduler.getSemaphore();
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &frame;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &timeline;
+
+    if (vkQueueSubmit(vgeDevice.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit compute command buffer!!!");
+    }
+    return frame;
+}
+
+void SimulationServer::run() {
+    stopRequested = false;
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+
+    std::cout << "publishing " << GalaxySystem::NUM_STARS << " stars to "
+              << publisher->getName() << " (" << publisher->size() / (1024 * 1024) << " MB)"
+              << std::endl;
+
+    VgeFrameScheduler& scheduler = vgeDevice.getFrameScheduler();
+    double stepTimeTotal = 0.0;
+    double publishTimeTotal = 0.0;
+    uint64_t step = 0;
+
+    auto stepInterval = std::chrono::duration<double>(settings.deltaTime);
+    auto nextStepTime = std::chrono::steady_clock::now();
+    uint64_t maxSteps = static_cast<uint64_t>(settings.steps);
+    while (!stopRequested && (maxSteps == 0 || step < maxSteps)) {
+        auto stepStart = std::chrono::high_resolution_clock::now();
+        uint64_t frame = submitStep();
+        scheduler.waitForFrame(frame);
+        auto stepEnd = std::chrono::high_resolution_clock::now();
+
+        // The step toggled the buffers, so what it wrote is now the next step's source
+        VgeBuffer& stars = galaxySystem->getSimulationSourceBuffer();
+        if (stars.map() != VK_SUCCESS) {
+            throw std::runtime_error("failed to map star buffer!!!");
+        }
+        publisher->publish(static_cast<const Star*>(stars.getMappedMemory()), ++step);
+        stars.unmap();
+        auto publishEnd = std::chrono::high_resolution_clock::now();
+
+        stepTimeTotal += std::chrono::duration<double, std::milli>(stepEnd - stepStart).count();
+        publishTimeTotal += std::chrono::duration<double, std::milli>(publishEnd - stepEnd).count();
+
+        if (settings.paced) {
+            nextStepTime +=
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(stepInterval);
+            // A step that ran late moves the schedule instead of being caught up in a burst
+            auto now = std::chrono::steady_clock::now();
+            if (nextStepTime < now) {
+                nextStepTime = now;
+            }
+            std::this_thread::sleep_until(nextStepTime);
+        }
+    }
+
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+
+    if (step > 0) {
+        std::cout << step << " steps, average step " << stepTimeTotal / step << " ms, publish "
+                  << publishTimeTotal / step << " ms" << std::endl;
+    }
+}
+
+}  // namespace vge
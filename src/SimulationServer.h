@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Device/Device.h"
+#include "Simulation/StarPublisher.h"
+#include "systems/Galaxy/GalaxySystem.h"
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <memory>
+#include <string>
+
+namespace vge {
+// Steps the galaxy simulation on a compute only device, without a window or swap chain, and
+// publishes every step to shared memory for other local processes to read in place. See
+// Simulation/StarSnapshot.h for the layout readers map.
+class SimulationServer {
+public:
+    struct Settings {
+        std::string sharedMemoryName = "/vge_stars";
+        int steps = 0;  // 0 runs until interrupted
+        float deltaTime = 1.0f / 60.0f;
+        // Sleeps so steps come deltaTime apart, otherwise runs as fast as the device allows
+        bool paced = true;
+    };
+
+    explicit SimulationServer(const Settings& settings);
+    ~SimulationServer();
+
+    SimulationServer(const SimulationServer&) = delete;
+    SimulationServer& operator=(const SimulationServer&) = delete;
+
+    void run();
+
+private:
+    void createCommandBuffer();
+    // Records and submits one simulation step, returns its value on the frame timeline
+    uint64_t submitStep();
+
+    Settings settings;
+    VgeDevice vgeDevice{VgeDevice::HeadlessMode::ComputeOnly};
+    std::unique_ptr<GalaxySystem> galaxySystem;
+    std::unique_ptr<StarPublisher> publisher;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+};
+}  // namespace vge
@@ -0,0 +1,195 @@
+#include "ClusterCoordinator.h"
+
+#include "ClusterWorker.h"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+// posix
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace vge {
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+ClusterCoordinator::ClusterCoordinator(const Settings& settings) : settings{settings} {
+    if (settings.numWorkers < 1 || settings.numStars < 1) {
+        throw std::runtime_error("cluster needs at least one worker and one star!!!");
+    }
+
+    const uint32_t numWorkers = static_cast<uint32_t>(settings.numWorkers);
+    const uint32_t numStars = static_cast<uint32_t>(settings.numStars);
+
+    // Per step only a thin shell of stars crosses a slab boundary, anything beyond the
+    // capacity waits for the next step
+    uint32_t capacity = std::max<uint32_t>(1024, numStars / numWorkers / 32);
+
+    ClusterLayout layout = ClusterLayout::compute(numWorkers, numStars, capacity);
+    std::string name = "/vge_cluster_" + std::to_string(getpid());
+    region = std::make_unique<SharedRegion>(name, layout.totalSize);
+    view = ClusterView{static_cast<uint8_t*>(region->data()), layout};
+
+    view.header() = ClusterHeader{numWorkers, numStars, capacity};
+    for (uint32_t source = 0; source < numWorkers; source++) {
+        for (uint32_t destination = 0; destination < numWorkers; destination++) {
+            view.mailbox(source, destination).count = 0;
+        }
+    }
+
+    computeSlabBounds();
+
+    auto start = Clock::now();
+    try {
+        spawnWorkers();
+
+        // Each worker replies once its slab is populated
+        ownedStars.resize(numWorkers);
+        for (uint32_t i = 0; i < numWorkers; i++) {
+            ownedStars[i] = receiveMessage<Reply>(workerSockets[i]).ownedStars;
+        }
+    } catch (...) {
+        shutdown();
+        throw;
+    }
+    initMs = millisecondsSince(start);
+}
+
+ClusterCoordinator::~ClusterCoordinator() {
+    shutdown();
+}
+
+void ClusterCoordinator::computeSlabBounds() {
+    // Equal count slabs from the radii of an evenly spaced sample of the initial stars
+    const int sampleCount = std::min(settings.numStars, 65536);
+    auto ellipses = settings.shape.generateEllipseParams(settings.numEllipses);
+
+    std::vector<float> radii(sampleCount);
+    for (int i = 0; i < sampleCount; i++) {
+        int index = static_cast<int>(static_cast<int64_t>(i) * settings.numStars / sampleCount);
+        Star star = CpuGalaxy::createInitialStar(settings.shape, ellipses, index);
+        radii[i] = std::sqrt(star.position.x * star.position.x +
+                             star.position.z * star.position.z);
+    }
+    std::sort(radii.begin(), radii.end());
+
+    float* bounds = view.slabBounds();
+    bounds[0] = 0.0f;
+    for (int w = 1; w < settings.numWorkers; w++) {
+        bounds[w] = radii[static_cast<size_t>(w) * sampleCount / settings.numWorkers];
+    }
+    bounds[settings.numWorkers] = std::numeric_limits<float>::infinity();
+}
+
+void ClusterCoordinator::spawnWorkers() {
+    for (int i = 0; i < settings.numWorkers; i++) {
+        int sockets[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets) != 0) {
+            throw std::runtime_error("failed to create worker socket pair!!!");
+        }
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(sockets[0]);
+            close(sockets[1]);
+            throw std::runtime_error("failed to fork worker process!!!");
+        }
+
+        if (pid == 0) {
+            // Child: drop the coordinator's ends, run until Quit, and skip the parent's
+            // destructors (they would unlink the shared memory and signal the siblings)
+            close(sockets[0]);
+            for (int socket : workerSockets) {
+                close(socket);
+            }
+
+            int status = 0;
+            try {
+                ClusterWorker worker{static_cast<uint32_t>(i), sockets[1], view, settings.shape,
+                                     settings.numEllipses};
+                worker.run();
+            } catch (const std::exception& e) {
+                std::cerr << "worker " << i << ": " << e.what() << "\n";
+                status = 1;
+            }
+            _exit(status);
+        }
+
+        close(sockets[1]);
+        workerPids.push_back(pid);
+        workerSockets.push_back(sockets[0]);
+    }
+}
+
+void ClusterCoordinator::shutdown() {
+    for (int socket : workerSockets) {
+        try {
+            sendMessage(socket, Command{CommandType::Quit, 0.0f});
+        } catch (const std::exception&) {
+            // Worker already gone, waitpid below still reaps it
+        }
+        close(socket);
+    }
+    for (pid_t pid : workerPids) {
+        waitpid(pid, nullptr, 0);
+    }
+    workerSockets.clear();
+    workerPids.clear();
+}
+
+std::vector<Reply> ClusterCoordinator::broadcast(const Command& command) {
+    // Send to everyone first so the workers run concurrently, then collect
+    for (int socket : workerSockets) {
+        sendMessage(socket, command);
+    }
+    std::vector<Reply> replies;
+    replies.reserve(workerSockets.size());
+    for (int socket : workerSockets) {
+        replies.push_back(receiveMessage<Reply>(socket));
+    }
+    return replies;
+}
+
+ClusterCoordinator::StepTimings ClusterCoordinator::step(float deltaTime) {
+    StepTimings timings;
+    auto start = Clock::now();
+
+    // Two phases with a barrier in between: nobody reads a mailbox until every worker has
+    // finished posting to it
+    double stepBusy = 0.0;
+    for (const Reply& reply : broadcast(Command{CommandType::Step, deltaTime})) {
+        stepBusy = std::max(stepBusy, reply.busyMs);
+        timings.migratedStars += reply.migratedStars;
+    }
+
+    double exchangeBusy = 0.0;
+    auto replies = broadcast(Command{CommandType::Exchange, 0.0f});
+    for (size_t i = 0; i < replies.size(); i++) {
+        exchangeBusy = std::max(exchangeBusy, replies[i].busyMs);
+        ownedStars[i] = replies[i].ownedStars;
+    }
+
+    timings.maxBusyMs = stepBusy + exchangeBusy;
+    timings.wallMs = millisecondsSince(start);
+    return timings;
+}
+
+double ClusterCoordinator::publish() {
+    auto start = Clock::now();
+    broadcast(Command{CommandType::Publish, 0.0f});
+    return millisecondsSince(start);
+}
+
+}  // namespace vge
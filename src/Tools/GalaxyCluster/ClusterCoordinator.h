@@ -0,0 +1,72 @@
+#pragma once
+
+#include "../../Simulation/CpuGalaxy.h"
+#include "ClusterProtocol.h"
+#include "SharedRegion.h"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// posix
+#include <sys/types.h>
+
+namespace vge {
+
+// Splits the galaxy into radial slabs, one per forked worker process. Commands and replies go
+// over a Unix socket pair per worker; migrating stars and the published results go through a
+// shared memory region. The results buffer holds every star in global index order, the order
+// of the GPU buffer, so GalaxyCluster --serve republishes it as is for the engine to attach to.
+class ClusterCoordinator {
+public:
+    struct Settings {
+        int numWorkers = 1;
+        int numStars = 100000;
+        int numEllipses = Ellipse::MAX_ELLIPSES;
+        GalaxyShape shape{};
+    };
+
+    struct StepTimings {
+        double wallMs = 0.0;
+        double maxBusyMs = 0.0;  // slowest worker, the rest is waiting and IPC
+        uint64_t migratedStars = 0;
+    };
+
+    explicit ClusterCoordinator(const Settings& settings);
+    ~ClusterCoordinator();
+
+    ClusterCoordinator(const ClusterCoordinator&) = delete;
+    ClusterCoordinator& operator=(const ClusterCoordinator&) = delete;
+
+    StepTimings step(float deltaTime);
+    // Gathers every worker's stars into the results buffer, returns the wall time in ms
+    double publish();
+
+    const Star* getResults() const {
+        return view.results();
+    }
+    double getInitMs() const {
+        return initMs;
+    }
+    const std::vector<uint64_t>& getOwnedStars() const {
+        return ownedStars;
+    }
+
+private:
+    void computeSlabBounds();
+    void spawnWorkers();
+    void shutdown();
+    std::vector<Reply> broadcast(const Command& command);
+
+    Settings settings;
+    std::unique_ptr<SharedRegion> region;
+    ClusterView view;
+
+    std::vector<pid_t> workerPids;
+    std::vector<int> workerSockets;
+    std::vector<uint64_t> ownedStars;
+    double initMs = 0.0;
+};
+
+}  // namespace vge
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "../../Simulation/Star.h"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+// posix
+#include <sys/socket.h>
+
+namespace vge {
+
+// Messages sent over the Unix socket between the coordinator and each worker. Bulk data never
+// goes through the socket, only through the shared memory region described below.
+enum class CommandType : uint32_t {
+    Step,      // advance owned stars and post out of slab stars to the mailboxes
+    Exchange,  // collect stars posted to this worker by the others
+    Publish,   // write owned stars into the shared result buffer
+    Quit,
+};
+
+struct Command {
+    CommandType type;
+    float deltaTime;
+};
+
+struct Reply {
+    uint64_t ownedStars;
+    uint64_t migratedStars;  // sent during Step, received during Exchange
+    double busyMs;           // time spent working on the command
+};
+
+// A star leaving its slab, tagged with its global index so it keeps its ellipse and its
+// slot in the result buffer
+struct MigrationRecord {
+    uint32_t id;
+    Star star;
+};
+
+// Layout of the shared memory region, all offsets from the start of the mapping:
+//   ClusterHeader
+//   float slabBounds[numWorkers + 1]           inner radius of each slab, last is infinity
+//   Mailbox mailboxes[numWorkers][numWorkers]  [source][destination], fixed capacity each
+//   Star results[numStars]                     indexed by global star id
+struct ClusterHeader {
+    uint32_t numWorkers;
+    uint32_t numStars;
+    uint32_t mailboxCapacity;
+};
+
+struct MailboxHeader {
+    uint32_t count;
+};
+
+struct ClusterLayout {
+    size_t slabBoundsOffset;
+    size_t mailboxOffset;
+    size_t mailboxStride;
+    size_t resultsOffset;
+    size_t totalSize;
+
+    static size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static ClusterLayout compute(uint32_t numWorkers, uint32_t numStars, uint32_t capacity) {
+        ClusterLayout layout;
+        layout.slabBoundsOffset = alignUp(sizeof(ClusterHeader), 64);
+        layout.mailboxOffset =
+            alignUp(layout.slabBoundsOffset + sizeof(float) * (numWorkers + 1), 64);
+        layout.mailboxStride =
+            alignUp(alignUp(sizeof(MailboxHeader), alignof(MigrationRecord)) +
+                        sizeof(MigrationRecord) * capacity,
+                    64);
+        layout.resultsOffset = alignUp(
+            layout.mailboxOffset + layout.mailboxStride * numWorkers * numWorkers, 64);
+        layout.totalSize = layout.resultsOffset + sizeof(Star) * numStars;
+        return layout;
+    }
+};
+
+// Typed access to a mapped cluster region
+struct ClusterView {
+    uint8_t* base;
+    ClusterLayout layout;
+
+    ClusterHeader& header() const {
+        return *reinterpret_cast<ClusterHeader*>(base);
+    }
+    float* slabBounds() const {
+        return reinterpret_cast<float*>(base + layout.slabBoundsOffset);
+    }
+    MailboxHeader& mailbox(uint32_t source, uint32_t destination) const {
+        size_t index = source * header().numWorkers + destination;
+        return *reinterpret_cast<MailboxHeader*>(base + layout.mailboxOffset +
+                                                 layout.mailboxStride * index);
+    }
+    MigrationRecord* mailboxRecords(uint32_t source, uint32_t destination) const {
+        size_t recordsOffset =
+            ClusterLayout::alignUp(sizeof(MailboxHeader), alignof(MigrationRecord));
+        return reinterpret_cast<MigrationRecord*>(
+            reinterpret_cast<uint8_t*>(&mailbox(source, destination)) + recordsOffset);
+    }
+    Star* results() const {
+        return reinterpret_cast<Star*>(base + layout.resultsOffset);
+    }
+};
+
+// Socket pairs are SOCK_SEQPACKET, so each message arrives whole or not at all
+template <typename T>
+void sendMessage(int socket, const T& message) {
+    if (send(socket, &message, sizeof(T), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(T))) {
+        throw std::runtime_error("failed to send cluster message!!!");
+    }
+}
+
+template <typename T>
+T receiveMessage(int socket) {
+    T message;
+    if (recv(socket, &message, sizeof(T), 0) != static_cast<ssize_t>(sizeof(T))) {
+        throw std::runtime_error("failed to receive cluster message!!!");
+    }
+    return message;
+}
+
+}  // namespace vge
@@ -0,0 +1,133 @@
+#include "ClusterWorker.h"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace vge {
+
+ClusterWorker::ClusterWorker(uint32_t workerIndex, int socket, ClusterView view,
+                             const GalaxyShape& shape, int numEllipses)
+    : workerIndex{workerIndex},
+      socket{socket},
+      view{view},
+      ellipses{shape.generateEllipseParams(numEllipses)} {
+    initialize(shape);
+}
+
+void ClusterWorker::initialize(const GalaxyShape& shape) {
+    // Every worker walks the whole index range but only keeps its own slab, so no process
+    // ever holds more than its share of the population
+    const uint32_t numStars = view.header().numStars;
+    for (uint32_t i = 0; i < numStars; i++) {
+        Star star = CpuGalaxy::createInitialStar(shape, ellipses, static_cast<int>(i));
+        if (slabOf(star) == workerIndex) {
+            ids.push_back(i);
+            stars.push_back(star);
+        }
+    }
+}
+
+void ClusterWorker::run() {
+    using Clock = std::chrono::steady_clock;
+
+    // Initial reply tells the coordinator this worker is ready
+    sendMessage(socket, Reply{stars.size(), 0, 0.0});
+
+    while (true) {
+        Command command = receiveMessage<Command>(socket);
+        if (command.type == CommandType::Quit) {
+            return;
+        }
+
+        auto start = Clock::now();
+        uint64_t migrated = 0;
+        switch (command.type) {
+            case CommandType::Step:
+                migrated = step(command.deltaTime);
+                break;
+            case CommandType::Exchange:
+                migrated = exchange();
+                break;
+            case CommandType::Publish:
+                publish();
+                break;
+            case CommandType::Quit:
+                break;
+        }
+        double busyMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        sendMessage(socket, Reply{stars.size(), migrated, busyMs});
+    }
+}
+
+uint32_t ClusterWorker::slabOf(const Star& star) const {
+    const uint32_t numWorkers = view.header().numWorkers;
+    const float* bounds = view.slabBounds();
+    float radius = std::sqrt(star.position.x * star.position.x +
+                             star.position.z * star.position.z);
+
+    // bounds[0] is 0 and bounds[numWorkers] is infinity, find the slab with
+    // bounds[slab] <= radius < bounds[slab + 1]
+    const float* upper = std::upper_bound(bounds + 1, bounds + numWorkers, radius);
+    return static_cast<uint32_t>(upper - (bounds + 1));
+}
+
+uint64_t ClusterWorker::step(float deltaTime) {
+    const size_t numEllipses = ellipses.size();
+    const uint32_t capacity = view.header().mailboxCapacity;
+    uint64_t sent = 0;
+
+    size_t i = 0;
+    while (i < stars.size()) {
+        stars[i] = CpuGalaxy::stepStar(stars[i], ellipses[ids[i] % numEllipses], deltaTime);
+
+        uint32_t slab = slabOf(stars[i]);
+        MailboxHeader& mailbox = view.mailbox(workerIndex, slab);
+        // A full mailbox just means the star stays here one more step
+        if (slab == workerIndex || mailbox.count >= capacity) {
+            i++;
+            continue;
+        }
+
+        view.mailboxRecords(workerIndex, slab)[mailbox.count++] = MigrationRecord{ids[i], stars[i]};
+        sent++;
+
+        // Swap remove, the star moved into slot i has not been stepped yet
+        ids[i] = ids.back();
+        stars[i] = stars.back();
+        ids.pop_back();
+        stars.pop_back();
+    }
+    return sent;
+}
+
+uint64_t ClusterWorker::exchange() {
+    const uint32_t numWorkers = view.header().numWorkers;
+    uint64_t received = 0;
+
+    for (uint32_t source = 0; source < numWorkers; source++) {
+        if (source == workerIndex) continue;
+
+        MailboxHeader& mailbox = view.mailbox(source, workerIndex);
+        const MigrationRecord* records = view.mailboxRecords(source, workerIndex);
+        for (uint32_t r = 0; r < mailbox.count; r++) {
+            ids.push_back(records[r].id);
+            stars.push_back(records[r].star);
+        }
+        received += mailbox.count;
+        mailbox.count = 0;
+    }
+    return received;
+}
+
+void ClusterWorker::publish() {
+    // Results are scattered by global index, so the buffer has the same order as the
+    // single process star buffer and can be uploaded as is
+    Star* results = view.results();
+    for (size_t i = 0; i < stars.size(); i++) {
+        results[ids[i]] = stars[i];
+    }
+}
+
+}  // namespace vge
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../../Simulation/CpuGalaxy.h"
+#include "ClusterProtocol.h"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace vge {
+
+// Runs in a forked child. Owns the stars whose radius falls inside its slab and answers
+// coordinator commands until told to quit. Stars are independent, so the only exchange
+// between slabs is stars migrating across a boundary as their orbits carry them.
+class ClusterWorker {
+public:
+    ClusterWorker(uint32_t workerIndex, int socket, ClusterView view, const GalaxyShape& shape,
+                  int numEllipses);
+
+    ClusterWorker(const ClusterWorker&) = delete;
+    ClusterWorker& operator=(const ClusterWorker&) = delete;
+
+    void run();
+
+private:
+    void initialize(const GalaxyShape& shape);
+    uint64_t step(float deltaTime);
+    uint64_t exchange();
+    void publish();
+
+    uint32_t slabOf(const Star& star) const;
+
+    uint32_t workerIndex;
+    int socket;
+    ClusterView view;
+
+    std::vector<Ellipse::EllipseParams> ellipses;
+    std::vector<uint32_t> ids;  // global star index, parallel to stars
+    std::vector<Star> stars;
+};
+
+}  // namespace vge
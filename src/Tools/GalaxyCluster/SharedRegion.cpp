@@ -0,0 +1,43 @@
+#include "SharedRegion.h"
+
+// std
+#include <cstring>
+#include <stdexcept>
+
+// posix
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace vge {
+
+SharedRegion::SharedRegion(const std::string& name, size_t size) : name{name}, regionSize{size} {
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("failed to create shared memory " + name + ": " +
+                                 std::strerror(errno));
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("failed to size shared memory!!!");
+    }
+
+    mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        mapped = nullptr;
+        shm_unlink(name.c_str());
+        throw std::runtime_error("failed to map shared memory!!!");
+    }
+}
+
+SharedRegion::~SharedRegion() {
+    if (mapped) {
+        munmap(mapped, regionSize);
+    }
+    shm_unlink(name.c_str());
+}
+
+}  // namespace vge
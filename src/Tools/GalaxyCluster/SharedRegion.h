@@ -0,0 +1,32 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <string>
+
+namespace vge {
+
+// POSIX shared memory mapping. The creating process owns the name and unlinks it on
+// destruction; forked workers inherit the mapping and never open it by name.
+class SharedRegion {
+public:
+    SharedRegion(const std::string& name, size_t size);
+    ~SharedRegion();
+
+    SharedRegion(const SharedRegion&) = delete;
+    SharedRegion& operator=(const SharedRegion&) = delete;
+
+    void* data() const {
+        return mapped;
+    }
+    size_t size() const {
+        return regionSize;
+    }
+
+private:
+    std::string name;
+    size_t regionSize;
+    void* mapped = nullptr;
+};
+
+}  // namespace vge
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../Simulation/StarPublisher.h"
+#include "ClusterCoordinator.h"
+
+static void printUsage() {
+    std::cerr << "usage: GalaxyCluster [--stars <n>] [--steps <n>] [--workers <max>] "
+                 "[--dt <seconds>] [--verify] [--serve <shared memory name>]\n";
+}
+
+static std::atomic<bool> stopRequested{false};
+
+static void requestStop(int) {
+    stopRequested = true;
+}
+
+// Runs one cluster of maxWorkers until interrupted, publishing every step as a star snapshot
+// the engine can attach to, paced at deltaTime like the --simulate server
+static void serveCluster(const std::string& name, int workers, int numStars, float deltaTime) {
+    vge::ClusterCoordinator::Settings settings;
+    settings.numWorkers = workers;
+    settings.numStars = numStars;
+    vge::ClusterCoordinator cluster{settings};
+    vge::StarPublisher publisher{name, static_cast<uint32_t>(numStars), deltaTime};
+
+    stopRequested = false;
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+    std::printf("publishing %d stars from %d worker(s) to %s\n", numStars, workers,
+                name.c_str());
+
+    auto stepInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(deltaTime));
+    auto nextStepTime = std::chrono::steady_clock::now();
+    uint64_t step = 0;
+    while (!stopRequested) {
+        cluster.step(deltaTime);
+        cluster.publish();
+        publisher.publish(cluster.getResults(), ++step);
+
+        // A step that ran late moves the schedule instead of being caught up in a burst
+        nextStepTime = std::max(nextStepTime + stepInterval, std::chrono::steady_clock::now());
+        std::this_thread::sleep_until(nextStepTime);
+    }
+
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    std::printf("%llu steps published\n", static_cast<unsigned long long>(step));
+}
+
+struct ScalingResult {
+    int workers;
+    double initMs;
+    double stepMs;
+    double busyMs;
+    double publishMs;
+    double migratedPerStep;
+    double maxError;
+};
+
+// Runs the same simulation with one cluster size and averages the step cost
+static ScalingResult runCluster(int workers, int numStars, int steps, float deltaTime,
+                                const std::vector<vge::Star>* reference) {
+    vge::ClusterCoordinator::Settings settings;
+    settings.numWorkers = workers;
+    settings.numStars = numStars;
+    vge::ClusterCoordinator cluster{settings};
+
+    ScalingResult result{workers, cluster.getInitMs(), 0.0, 0.0, 0.0, 0.0, 0.0};
+    uint64_t migrated = 0;
+    for (int step = 0; step < steps; step++) {
+        auto timings = cluster.step(deltaTime);
+        result.stepMs += timings.wallMs;
+        result.busyMs += timings.maxBusyMs;
+        migrated += timings.migratedStars;
+    }
+    result.publishMs = cluster.publish();
+
+    if (steps > 0) {
+        result.stepMs /= steps;
+        result.busyMs /= steps;
+        result.migratedPerStep = static_cast<double>(migrated) / steps;
+    }
+
+    if (reference) {
+        const vge::Star* stars = cluster.getResults();
+        for (int i = 0; i < numStars; i++) {
+            glm::vec3 difference = stars[i].position - (*reference)[i].position;
+            float error = std::max({std::abs(difference.x), std::abs(difference.y),
+                                    std::abs(difference.z)});
+            result.maxError = std::max(result.maxError, static_cast<double>(error));
+        }
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    int numStars = 1000000;
+    int steps = 200;
+    int maxWorkers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    float deltaTime = 1.0f / 60.0f;
+    bool verify = false;
+    std::string serveName;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--stars" && i + 1 < argc) {
+            numStars = std::atoi(argv[++i]);
+        } else if (arg == "--steps" && i + 1 < argc) {
+            steps = std::atoi(argv[++i]);
+        } else if (arg == "--workers" && i + 1 < argc) {
+            maxWorkers = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--dt" && i + 1 < argc) {
+            deltaTime = static_cast<float>(std::atof(argv[++i]));
+        } else if (arg == "--verify") {
+            verify = true;
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serveName = argv[++i];
+        } else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    try {
+        if (!serveName.empty()) {
+            serveCluster(serveName, maxWorkers, numStars, deltaTime);
+            return EXIT_SUCCESS;
+        }
+
+        // Single process reference, only built when checking the cluster against it
+        std::vector<vge::Star> reference;
+        if (verify) {
+            vge::CpuGalaxy galaxy{vge::GalaxyShape{}, numStars};
+            for (int step = 0; step < steps; step++) {
+                galaxy.step(deltaTime);
+            }
+            reference = galaxy.getStars();
+        }
+
+        // Doubling worker counts, always ending at the maximum
+        std::vector<int> workerCounts;
+        for (int workers = 1; workers < maxWorkers; workers *= 2) {
+            workerCounts.push_back(workers);
+        }
+        workerCounts.push_back(maxWorkers);
+
+        std::printf("%d stars, %d steps, up to %d worker process(es)\n", numStars, steps,
+                    maxWorkers);
+        std::printf("%8s %10s %10s %10s %9s %11s %11s %12s%s\n", "workers", "init ms",
+                    "step ms", "busy ms", "speedup", "efficiency", "publish ms", "migrated/st",
+                    verify ? "    max error" : "");
+
+        double baseStepMs = 0.0;
+        for (int workers : workerCounts) {
+            ScalingResult result =
+                runCluster(workers, numStars, steps, deltaTime, verify ? &reference : nullptr);
+            if (workers == workerCounts.front()) {
+                baseStepMs = result.stepMs * workers;
+            }
+
+            // Strong scaling: same population, efficiency relative to the one worker run
+            double speedup = result.stepMs > 0.0 ? baseStepMs / result.stepMs : 0.0;
+            double efficiency = speedup / workers;
+            std::printf("%8d %10.1f %10.3f %10.3f %8.2fx %10.0f%% %11.2f %12.0f", workers,
+                        result.initMs, result.stepMs, result.busyMs, speedup, efficiency * 100.0,
+                        result.publishMs, result.migratedPerStep);
+            if (verify) {
+                std::printf("    %.3g", result.maxError);
+            }
+            std::printf("\n");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
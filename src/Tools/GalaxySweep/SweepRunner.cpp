@@ -0,0 +1,224 @@
+#include "SweepRunner.h"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace vge {
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+SweepRunner::SweepRunner(const SweepSpec& spec, const std::string& outputDir, int numThreads)
+    : spec{spec}, outputDir{outputDir}, numThreads{std::max(numThreads, 1)} {}
+
+void SweepRunner::run() {
+    std::filesystem::create_directories(outputDir);
+
+    std::vector<SweepRun> runs = spec.expand();
+    std::vector<RunStats> stats(runs.size());
+    int workerCount = std::min<int>(numThreads, static_cast<int>(runs.size()));
+
+    std::cout << "Running " << runs.size() << " configuration(s) on " << workerCount
+              << " thread(s), " << spec.numStars << " stars x " << spec.steps << " steps\n";
+
+    // With several threads the first runs go on this one alone, as the baseline the parallel
+    // rest is measured against. Every run costs about the same, only the shape differs.
+    size_t baselineRuns = 0;
+    if (workerCount > 1 && runs.size() > static_cast<size_t>(workerCount)) {
+        baselineRuns = static_cast<size_t>(workerCount);
+    }
+
+    std::atomic<size_t> nextRun{0};
+    std::atomic<size_t> completed{0};
+    std::mutex outputMutex;
+    std::exception_ptr firstError;
+
+    auto worker = [&](size_t end) {
+        for (size_t i = nextRun++; i < end; i = nextRun++) {
+            try {
+                stats[i] = runOne(runs[i]);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock{outputMutex};
+                if (!firstError) firstError = std::current_exception();
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock{outputMutex};
+            std::printf("[%zu/%zu] run %04d  %.1f ms\n", ++completed, runs.size(), runs[i].index,
+                        stats[i].totalMs);
+        }
+    };
+
+    auto start = Clock::now();
+    worker(baselineRuns);
+    double baselineMs = millisecondsSince(start);
+    nextRun = baselineRuns;
+
+    auto parallelStart = Clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workerCount; i++) {
+        threads.emplace_back(worker, runs.size());
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double parallelMs = millisecondsSince(parallelStart);
+    double wallMs = millisecondsSince(start);
+
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+
+    writeSummary(runs, stats);
+
+    double starSteps = static_cast<double>(spec.numStars) * spec.steps * runs.size();
+    std::printf("Finished in %.2f s: %.2f runs/s, %.1f M star steps/s\n", wallMs / 1000.0,
+                runs.size() * 1000.0 / wallMs, starSteps / (wallMs * 1000.0));
+
+    // Strong scaling: throughput of the parallel runs against the one thread baseline
+    if (baselineRuns > 0 && baselineMs > 0.0 && parallelMs > 0.0) {
+        double baselineRate = baselineRuns / baselineMs;
+        double parallelRate = (runs.size() - baselineRuns) / parallelMs;
+        double speedup = parallelRate / baselineRate;
+        std::printf("Speedup %.2fx on %d threads over 1, parallel efficiency %.0f%%\n", speedup,
+                    workerCount, speedup / workerCount * 100.0);
+    }
+}
+
+RunStats SweepRunner::runOne(const SweepRun& run) const {
+    RunStats stats;
+    auto start = Clock::now();
+
+    CpuGalaxy galaxy{run.shape, spec.numStars, spec.numEllipses};
+    for (int step = 0; step < spec.steps; step++) {
+        galaxy.step(spec.deltaTime);
+    }
+    stats.simulateMs = millisecondsSince(start);
+
+    const std::vector<Star>& stars = galaxy.getStars();
+    const int size = spec.imageSize;
+    std::vector<uint32_t> topView(static_cast<size_t>(size) * size, 0);
+    std::vector<uint32_t> edgeView(static_cast<size_t>(size) * size, 0);
+    std::vector<float> radii;
+    radii.reserve(stars.size());
+
+    double radiusSum = 0.0;
+    double heightSquaredSum = 0.0;
+    auto toPixel = [&](float value) {
+        return static_cast<int>((value / spec.imageExtent * 0.5f + 0.5f) * size);
+    };
+
+    for (const auto& star : stars) {
+        const glm::vec3& p = star.position;
+        float radius = std::sqrt(p.x * p.x + p.z * p.z);
+        radii.push_back(radius);
+        radiusSum += radius;
+        heightSquaredSum += p.y * p.y;
+        stats.maxAbsHeight = std::max(stats.maxAbsHeight, std::abs(p.y));
+
+        int x = toPixel(p.x);
+        int z = toPixel(p.z);
+        int y = toPixel(-p.y);  // up is up in the edge view
+        if (x >= 0 && x < size && z >= 0 && z < size) {
+            topView[static_cast<size_t>(z) * size + x]++;
+        }
+        if (x >= 0 && x < size && y >= 0 && y < size) {
+            edgeView[static_cast<size_t>(y) * size + x]++;
+        }
+    }
+
+    if (!stars.empty()) {
+        size_t count = radii.size();
+        stats.meanRadius = static_cast<float>(radiusSum / count);
+        stats.rmsHeight = static_cast<float>(std::sqrt(heightSquaredSum / count));
+
+        std::nth_element(radii.begin(), radii.begin() + count / 2, radii.end());
+        stats.medianRadius = radii[count / 2];
+        size_t index90 = std::min(count - 1, count * 9 / 10);
+        std::nth_element(radii.begin(), radii.begin() + index90, radii.end());
+        stats.radius90 = radii[index90];
+    }
+
+    size_t occupied = 0;
+    for (uint32_t count : topView) {
+        if (count > 0) occupied++;
+        stats.peakDensity = std::max(stats.peakDensity, count);
+    }
+    stats.occupiedFraction = static_cast<float>(occupied) / topView.size();
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "run_%04d", run.index);
+    std::filesystem::path base = std::filesystem::path(outputDir) / name;
+    writeDensityImage(base.string() + "_top.pgm", topView);
+    writeDensityImage(base.string() + "_edge.pgm", edgeView);
+
+    stats.totalMs = millisecondsSince(start);
+    return stats;
+}
+
+void SweepRunner::writeDensityImage(const std::string& filepath,
+                                    const std::vector<uint32_t>& counts) const {
+    uint32_t peak = 1;
+    for (uint32_t count : counts) {
+        peak = std::max(peak, count);
+    }
+
+    // Log scale so both the core and the faint outer arms stay visible
+    const float scale = 255.0f / std::log1p(static_cast<float>(peak));
+    std::vector<unsigned char> pixels(counts.size());
+    for (size_t i = 0; i < counts.size(); i++) {
+        pixels[i] = static_cast<unsigned char>(std::log1p(static_cast<float>(counts[i])) * scale);
+    }
+
+    std::ofstream file{filepath, std::ios::binary};
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open file: " + filepath);
+    }
+    file << "P5\n" << spec.imageSize << " " << spec.imageSize << "\n255\n";
+    file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+}
+
+void SweepRunner::writeSummary(const std::vector<SweepRun>& runs,
+                               const std::vector<RunStats>& stats) const {
+    std::filesystem::path filepath = std::filesystem::path(outputDir) / "summary.csv";
+    std::ofstream file{filepath};
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open file: " + filepath.string());
+    }
+
+    const auto& names = SweepSpec::shapeParameterNames();
+    file << "run";
+    for (const auto& name : names) {
+        file << "," << name;
+    }
+    file << ",meanRadius,medianRadius,radius90,rmsHeight,maxAbsHeight,occupiedFraction,"
+            "peakDensity,simulateMs\n";
+
+    for (size_t i = 0; i < runs.size(); i++) {
+        GalaxyShape shape = runs[i].shape;
+        const RunStats& s = stats[i];
+
+        file << runs[i].index;
+        for (const auto& name : names) {
+            file << "," << SweepSpec::shapeParameter(shape, name);
+        }
+        file << "," << s.meanRadius << "," << s.medianRadius << "," << s.radius90 << ","
+             << s.rmsHeight << "," << s.maxAbsHeight << "," << s.occupiedFraction << ","
+             << s.peakDensity << "," << s.simulateMs << "\n";
+    }
+}
+
+}  // namespace vge
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "SweepSpec.h"
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vge {
+
+struct RunStats {
+    float meanRadius = 0.0f;
+    float medianRadius = 0.0f;  // half of the stars lie inside this radius
+    float radius90 = 0.0f;
+    float rmsHeight = 0.0f;
+    float maxAbsHeight = 0.0f;
+    float occupiedFraction = 0.0f;  // fraction of top view pixels with at least one star
+    uint32_t peakDensity = 0;       // most stars in a single top view pixel
+    double simulateMs = 0.0;
+    double totalMs = 0.0;
+};
+
+// Runs every configuration of a sweep on the CPU galaxy. Runs are independent and share nothing,
+// so each worker thread takes whole runs. With several threads the speedup over one is reported.
+// Per run a top view and an edge view density image (binary PGM) are written, followed by
+// summary.csv with the parameters and statistics of every run.
+class SweepRunner {
+public:
+    SweepRunner(const SweepSpec& spec, const std::string& outputDir, int numThreads);
+
+    void run();
+
+private:
+    RunStats runOne(const SweepRun& run) const;
+    void writeDensityImage(const std::string& filepath, const std::vector<uint32_t>& counts) const;
+    void writeSummary(const std::vector<SweepRun>& runs, const std::vector<RunStats>& stats) const;
+
+    const SweepSpec& spec;
+    std::string outputDir;
+    int numThreads;
+};
+
+}  // namespace vge
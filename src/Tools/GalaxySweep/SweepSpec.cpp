@@ -0,0 +1,163 @@
+#include "SweepSpec.h"
+
+// std
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace vge {
+
+static std::string trim(const std::string& text) {
+    const char* whitespace = " \t\r\n";
+    size_t begin = text.find_first_not_of(whitespace);
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(whitespace);
+    return text.substr(begin, end - begin + 1);
+}
+
+static float parseFloat(const std::string& text, int lineNumber) {
+    try {
+        size_t consumed = 0;
+        float value = std::stof(text, &consumed);
+        if (trim(text.substr(consumed)).empty()) {
+            return value;
+        }
+    } catch (const std::exception&) {
+    }
+    throw std::runtime_error("sweep spec line " + std::to_string(lineNumber) +
+                             ": invalid number '" + text + "'!!!");
+}
+
+static std::vector<float> parseValues(const std::string& text, int lineNumber) {
+    std::vector<float> values;
+
+    // start:end:count, end inclusive
+    if (text.find(':') != std::string::npos) {
+        std::stringstream stream{text};
+        std::string start, end, count;
+        std::getline(stream, start, ':');
+        std::getline(stream, end, ':');
+        std::getline(stream, count);
+
+        float first = parseFloat(start, lineNumber);
+        float last = parseFloat(end, lineNumber);
+        int steps = static_cast<int>(parseFloat(count, lineNumber));
+        if (steps < 1) {
+            throw std::runtime_error("sweep spec line " + std::to_string(lineNumber) +
+                                     ": range needs at least one value!!!");
+        }
+        for (int i = 0; i < steps; i++) {
+            float t = steps == 1 ? 0.0f : static_cast<float>(i) / (steps - 1);
+            values.push_back(first + (last - first) * t);
+        }
+        return values;
+    }
+
+    std::stringstream stream{text};
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        values.push_back(parseFloat(trim(item), lineNumber));
+    }
+    return values;
+}
+
+const std::vector<std::string>& SweepSpec::shapeParameterNames() {
+    static const std::vector<std::string> names = {
+        "baseRadius", "radiusIncrement",  "baseTilt",             "tiltIncrement", "eccentricity",
+        "constant",   "centralIntensity", "effectiveRadiusScale", "baseRadius2",   "maxHeight"};
+    return names;
+}
+
+float& SweepSpec::shapeParameter(GalaxyShape& shape, const std::string& name) {
+    if (name == "baseRadius") return shape.baseRadius;
+    if (name == "radiusIncrement") return shape.radiusIncrement;
+    if (name == "baseTilt") return shape.baseTilt;
+    if (name == "tiltIncrement") return shape.tiltIncrement;
+    if (name == "eccentricity") return shape.eccentricity;
+    if (name == "constant") return shape.constant;
+    if (name == "baseRadius2") return shape.baseRadius2;
+    if (name == "centralIntensity") return shape.centralIntensity;
+    if (name == "effectiveRadiusScale") return shape.effectiveRadiusScale;
+    if (name == "maxHeight") return shape.maxHeight;
+    throw std::runtime_error("unknown galaxy parameter '" + name + "'!!!");
+}
+
+SweepSpec SweepSpec::load(const std::string& filepath) {
+    std::ifstream file{filepath};
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open sweep spec: " + filepath);
+    }
+
+    SweepSpec spec;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+
+        size_t separator = line.find('=');
+        if (separator == std::string::npos) {
+            throw std::runtime_error("sweep spec line " + std::to_string(lineNumber) +
+                                     ": expected 'key = value'!!!");
+        }
+        std::string key = trim(line.substr(0, separator));
+        std::string value = trim(line.substr(separator + 1));
+
+        if (key == "steps") {
+            spec.steps = static_cast<int>(parseFloat(value, lineNumber));
+        } else if (key == "deltaTime") {
+            spec.deltaTime = parseFloat(value, lineNumber);
+        } else if (key == "stars") {
+            spec.numStars = static_cast<int>(parseFloat(value, lineNumber));
+        } else if (key == "ellipses") {
+            spec.numEllipses = static_cast<int>(parseFloat(value, lineNumber));
+        } else if (key == "imageSize") {
+            spec.imageSize = static_cast<int>(parseFloat(value, lineNumber));
+        } else if (key == "imageExtent") {
+            spec.imageExtent = parseFloat(value, lineNumber);
+        } else {
+            std::vector<float> values = parseValues(value, lineNumber);
+            if (values.size() == 1) {
+                shapeParameter(spec.baseShape, key) = values[0];
+            } else {
+                shapeParameter(spec.baseShape, key);  // validates the name
+                spec.axes.emplace_back(key, std::move(values));
+            }
+        }
+    }
+
+    if (spec.numStars < 1 || spec.numEllipses < 1 || spec.imageSize < 1 || spec.steps < 0) {
+        throw std::runtime_error("sweep spec has invalid run settings!!!");
+    }
+    return spec;
+}
+
+std::vector<SweepRun> SweepSpec::expand() const {
+    size_t runCount = 1;
+    for (const auto& axis : axes) {
+        runCount *= axis.second.size();
+    }
+
+    std::vector<SweepRun> runs(runCount);
+    for (size_t i = 0; i < runCount; i++) {
+        runs[i].index = static_cast<int>(i);
+        runs[i].shape = baseShape;
+
+        // Last axis varies fastest
+        size_t remainder = i;
+        for (auto axis = axes.rbegin(); axis != axes.rend(); ++axis) {
+            size_t count = axis->second.size();
+            shapeParameter(runs[i].shape, axis->first) = axis->second[remainder % count];
+            remainder /= count;
+        }
+    }
+    return runs;
+}
+
+}  // namespace vge
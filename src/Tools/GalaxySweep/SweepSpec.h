@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../../Simulation/CpuGalaxy.h"
+
+// std
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vge {
+
+// One configuration of a sweep
+struct SweepRun {
+    int index;
+    GalaxyShape shape;
+};
+
+// Parameter sweep read from a plain text file, one "key = value" per line, '#' starts a comment.
+// Run settings: steps, deltaTime, stars, ellipses, imageSize, imageExtent.
+// Any GalaxyShape field (e.g. eccentricity, tiltIncrement, constant) may be given as a single
+// value, a list "a, b, c", or an inclusive range "start:end:count". Angles are in radians.
+// The runs are the cartesian product of all listed parameters.
+struct SweepSpec {
+    int steps = 600;
+    float deltaTime = 1.0f / 60.0f;
+    int numStars = 100000;
+    int numEllipses = Ellipse::MAX_ELLIPSES;
+    int imageSize = 512;
+    float imageExtent = 24.0f;  // half width of the density images in world units
+
+    GalaxyShape baseShape{};
+    std::vector<std::pair<std::string, std::vector<float>>> axes;
+
+    static SweepSpec load(const std::string& filepath);
+
+    std::vector<SweepRun> expand() const;
+
+    static const std::vector<std::string>& shapeParameterNames();
+    static float& shapeParameter(GalaxyShape& shape, const std::string& name);
+};
+
+}  // namespace vge
@@ -0,0 +1,46 @@
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "SweepRunner.h"
+#include "SweepSpec.h"
+
+static void printUsage() {
+    std::cerr << "usage: GalaxySweep <spec file> [--out <dir>] [--threads <n>]\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::string specPath = argv[1];
+    std::string outputDir = "sweep_output";
+    int numThreads = static_cast<int>(std::thread::hardware_concurrency());
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            outputDir = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            numThreads = std::atoi(argv[++i]);
+        } else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    try {
+        vge::SweepSpec spec = vge::SweepSpec::load(specPath);
+        vge::SweepRunner runner{spec, outputDir, numThreads};
+        runner.run();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "../../Simulation/StarTileFile.h"
+
+static void printUsage() {
+    std::cerr << "usage: GalaxyTiler <output.vgst> [--stars <n>] [--grid <n>] "
+                 "[--coarse-stride <n>]\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::string outputPath = argv[1];
+    vge::StarTileWriter::Settings settings;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--stars" && i + 1 < argc) {
+            settings.numStars = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--grid" && i + 1 < argc) {
+            settings.gridSize = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--coarse-stride" && i + 1 < argc) {
+            settings.coarseStride = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        vge::StarTileWriter::generate(outputPath, settings);
+        double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        vge::StarTileReader reader{outputPath};
+        const auto& header = reader.getHeader();
+        std::printf("Wrote %llu stars (%llu coarse) in %u tiles, largest tile %u stars, %.1f s\n",
+                    static_cast<unsigned long long>(header.totalStars),
+                    static_cast<unsigned long long>(header.coarseCount), header.tileCount,
+                    header.maxTileStars, seconds);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
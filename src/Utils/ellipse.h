@@ -18,45 +18,56 @@ class Ellipse {
     static inline const int MAX_ELLIPSES = 30;
     static inline std::vector<EllipseParams> ellipseParams;
 
-    // Base parameters that will be scaled for each ellipse
-    static inline float baseRadius = 1.83f;
-    static inline float radiusIncrement = 0.5f;
-    static inline float baseTilt = 0.0f;
-    static inline float tiltIncrement = 0.16f;
-    static inline float eccentricity = 0.8f;
-
-    // Galaxy shape using Vaucouleurs Law
-    static inline float constant = 1.4f;
-    static inline float baseRadius2 = 1.83f;
-    static inline float centralIntensity = 10.0f;
-    static inline float effectiveRadiusScale = 2.0f;
-    static inline float maxHeight = 0.5f;
-
-    static void generateEllipseParams(int numEllipses) {
-        ellipseParams.clear();
-
-        for (int i = 0; i < numEllipses; i++) {
-            EllipseParams params;
-
-            // Calculate radius for this ellipse
-            float currentRadius = baseRadius + (i * radiusIncrement);
-
-            params.majorAxis = currentRadius;
-            params.minorAxis = currentRadius * eccentricity;
-
-            // Add a small tilt for each successive ellipse
-            params.tiltAngle = baseTilt + (i * tiltIncrement);
+    // Base parameters that will be scaled for each ellipse, and the galaxy shape using
+    // Vaucouleurs Law. A value type, so code that runs several galaxies at once (batch sweeps,
+    // worker processes) can keep a copy for each.
+    struct Shape {
+        float baseRadius = 1.83f;
+        float radiusIncrement = 0.5f;
+        float baseTilt = 0.0f;
+        float tiltIncrement = 0.16f;
+        float eccentricity = 0.8f;
+
+        float constant = 1.4f;
+        float baseRadius2 = 1.83f;
+        float centralIntensity = 10.0f;
+        float effectiveRadiusScale = 2.0f;
+        float maxHeight = 0.5f;
+
+        std::vector<EllipseParams> generateEllipseParams(int numEllipses) const {
+            std::vector<EllipseParams> params;
+
+            for (int i = 0; i < numEllipses; i++) {
+                EllipseParams ellipse;
+
+                // Calculate radius for this ellipse
+                float currentRadius = baseRadius + (i * radiusIncrement);
+
+                ellipse.majorAxis = currentRadius;
+                ellipse.minorAxis = currentRadius * eccentricity;
+
+                // Add a small tilt for each successive ellipse
+                ellipse.tiltAngle = baseTilt + (i * tiltIncrement);
+
+                params.push_back(ellipse);
+            }
+            return params;
+        }
 
-            ellipseParams.push_back(params);
+        float calculateVaucouleursHeight(float x, float z) const {
+            float radius = std::sqrt(x * x + z * z) + 0.0001f;
+            float effectiveRadius = baseRadius2 * effectiveRadiusScale;
+            float heightFactor =
+                centralIntensity * std::exp(-constant * std::pow(radius / effectiveRadius, 0.25f));
+            return maxHeight * heightFactor;
         }
-    }
+    };
 
-    static float calculateVaucouleursHeight(float x, float z, float maxHeight) {
-        float radius = std::sqrt(x * x + z * z) + 0.0001f;
-        float effectiveRadius = baseRadius2 * effectiveRadiusScale;
-        float heightFactor =
-            centralIntensity * std::exp(-constant * std::pow(radius / effectiveRadius, 0.25f));
-        return maxHeight * heightFactor;
+    // The shape edited in the UI
+    static Shape shape;
+
+    static void generateEllipseParams(int numEllipses) {
+        ellipseParams = shape.generateEllipseParams(numEllipses);
     }
 
     // Update the calculateEllipsePoint to use storedHeight parameter
@@ -80,4 +91,7 @@ class Ellipse {
     }
 };
 
+// Defined out of the class, Shape's member initializers are not usable before Ellipse is complete
+inline Ellipse::Shape Ellipse::shape{};
+
 }  // namespace vge
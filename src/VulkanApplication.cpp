@@ -4,6 +4,7 @@
 #include "Camera/Camera.h"
 #include "Descriptor/Descriptors.h"
 #include "Game/GameObject.h"
+#include "Graphics/PipelineCache.h"
 #include "Input/Input.h"
 #include "Presentation/SwapChain.h"
 #include "Rendering/Renderer.h"
@@ -24,59 +25,37 @@
 
 #include <cassert>
 #include <chrono>
+#include <iostream>
 #include <memory>
 
 namespace vge {
 
 VulkanApplication::VulkanApplication() {
-    // Initialize global descriptor pool
-    globalPool =
-        VgeDescriptorPool::Builder(vgeDevice)
-            .setMaxSets(VgeSwapChain::MAX_FRAMES_IN_FLIGHT)
-            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VgeSwapChain::MAX_FRAMES_IN_FLIGHT)
-            .build();
-
-    createDescriptorSetLayout();
+    // The global UBO is a per-frame allocation bound through the allocator's uniform set
+    frameAllocator =
+        std::make_unique<VgeFrameAllocator>(vgeDevice, VgeSwapChain::MAX_FRAMES_IN_FLIGHT);
 
+    auto sceneLoadStart = std::chrono::high_resolution_clock::now();
     currentScene = std::unique_ptr<Scene>(
-        new GalaxyScene(vgeDevice, vgeRenderer, globalSetLayout->getDescriptorSetLayout()));
+        new GalaxyScene(vgeDevice, vgeRenderer, frameAllocator->getUniformSetLayout()));
+    auto cacheStats = vgeDevice.getPipelineCache().getStats();
+    std::cout << "scene load: "
+              << std::chrono::duration<float, std::chrono::milliseconds::period>(
+                     std::chrono::high_resolution_clock::now() - sceneLoadStart)
+                     .count()
+              << " ms, " << cacheStats.pipelinesCreated << " pipelines in "
+              << cacheStats.creationTime << " ms ("
+              << (cacheStats.loadedFromDisk ? "warm" : "cold") << " pipeline cache)" << std::endl;
 
     // Initialize ImGui
     vgeImgui = std::make_unique<VgeImgui>(vgeWindow, vgeDevice, vgeRenderer,
                                           VgeSwapChain::MAX_FRAMES_IN_FLIGHT, &currentScene,
-                                          globalSetLayout->getDescriptorSetLayout(), &input);
+                                          frameAllocator->getUniformSetLayout(), &input);
 }
 
 VulkanApplication::~VulkanApplication() {}
 
-void VulkanApplication::createDescriptorSetLayout() {
-    globalSetLayout =
-        VgeDescriptorSetLayout::Builder(vgeDevice)
-            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-            .build();
-}
-
 void VulkanApplication::run() {
-    std::vector<std::unique_ptr<VgeBuffer>> uboBuffers(VgeSwapChain::MAX_FRAMES_IN_FLIGHT);
-    for (int i = 0; i < uboBuffers.size(); i++) {
-        uboBuffers[i] = std::make_unique<VgeBuffer>(vgeDevice, sizeof(GlobalUbo), 1,
-                                                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-        uboBuffers[i]->map();
-    }
-
-    std::vector<VkDescriptorSet> globalDescriptorSets(VgeSwapChain::MAX_FRAMES_IN_FLIGHT);
-    for (int i = 0; i < globalDescriptorSets.size(); i++) {
-        auto bufferInfo = uboBuffers[i]->descriptorInfo();
-        VgeDescriptorWriter(*globalSetLayout, *globalPool)
-            .writeBuffer(0, &bufferInfo)
-            .build(globalDescriptorSets[i]);
-    }
-
-    RenderSystem renderSystem{vgeDevice, vgeRenderer.getSwapChainRenderPass(),
-                              globalSetLayout->getDescriptorSetLayout()};
-    PointLightSystem pointLightSystem{vgeDevice, vgeRenderer.getSwapChainRenderPass(),
-                                      globalSetLayout->getDescriptorSetLayout()};
     Camera camera{};
 
     auto viewerObject = GameObject::createGameObject();
@@ -84,9 +63,13 @@ void VulkanApplication::run() {
     // Input input{};
 
     auto currentTime = std::chrono::high_resolution_clock::now();
+    bool defragmentPending = false;
 
     while (!vgeWindow.shouldClose()) {
+        // Sleeps until just before the next frame slot, so the input below is as fresh as it gets
+        vgeRenderer.getFramePacer().waitForNextFrame();
         glfwPollEvents();
+        vgeRenderer.markInputSampled();
 
         auto newTime = std::chrono::high_resolution_clock::now();
         float frameTime =
@@ -107,6 +90,18 @@ void VulkanApplication::run() {
         camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f,
                                         1000.f);  // FYI: 1000.f is the clipping plane
 
+        // An unloaded scene leaves holes all over the pools. Between frames with the device idle
+        // nothing can be reading the buffers, so it is the one point where moving them is safe.
+        if (defragmentPending) {
+            defragmentPending = false;
+            vkDeviceWaitIdle(vgeDevice.device());
+            vgeDevice.getDeletionQueue().flush();
+            auto stats = vgeDevice.getAllocator().defragment();
+            std::cout << "Defragmented: " << stats.allocationsMoved << " allocations, "
+                      << stats.bytesMoved << " bytes moved, " << stats.blocksReleased
+                      << " blocks released\n";
+        }
+
         // Render the rest of the game objects using Vulkan
         if (auto commandBuffer = vgeRenderer.beginFrame()) {
             int frameIndex = vgeRenderer.getFrameIndex();
@@ -114,20 +109,32 @@ void VulkanApplication::run() {
             GameObject::Map& sceneObjects =
                 currentScene ? currentScene->getGameObjects() : gameObjects;
 
-            FrameInfo frameInfo{
-                frameIndex,  frameTime, commandBuffer, camera, globalDescriptorSets[frameIndex],
-                sceneObjects};
-
-            // update
-            GlobalUbo ubo{};
+            // beginFrame has waited for the frame that last used this index, its region is free
+            frameAllocator->beginFrame(frameIndex);
+            auto uboAllocation = frameAllocator->allocateUniform(sizeof(GlobalUbo));
+
+            FrameInfo frameInfo{frameIndex,
+                                frameTime,
+                                commandBuffer,
+                                camera,
+                                frameAllocator->getUniformDescriptorSet(),
+                                sceneObjects,
+                                *frameAllocator,
+                                uboAllocation.offset};
+
+            // update, written straight into mapped memory. Point lights are left to the
+            // scenes that have any.
+            GlobalUbo& ubo = *static_cast<GlobalUbo*>(uboAllocation.data);
             ubo.projection = camera.getProjection();
             ubo.view = camera.getView();
             ubo.inverseView = camera.getInverseView();
+            ubo.ambientLightColor = glm::vec4{1.f, 1.f, 1.f, .02f};
+            ubo.numLights = 0;
 
-            // Wait for GPU to finish before destroying scene
+            // Frames still in flight may be drawing the scene, it is destroyed once they retire
             if (currentScene && currentScene->shouldDestroy) {
-                vkDeviceWaitIdle(vgeDevice.device());
-                currentScene.reset();
+                vgeDevice.getDeletionQueue().retire(std::move(currentScene));
+                defragmentPending = true;
             }
 
             if (currentScene) {
@@ -135,27 +142,30 @@ void VulkanApplication::run() {
                 currentScene->updateUbo(ubo, frameInfo);
             }
 
-            uboBuffers[frameIndex]->writeToBuffer(&ubo);
-            uboBuffers[frameIndex]->flush();
-
             vgeRenderer.beginSwapChainRenderPass(commandBuffer);
 
             if (currentScene) {
                 currentScene->render(frameInfo);
             }
 
+            // The UI stays at native resolution when the scene is rendered below it
+            vgeRenderer.beginOverlayPass(commandBuffer);
             vgeImgui->newFrame();
             vgeImgui->beginDockspace();
             vgeImgui->runHierarchy();
             vgeImgui->endDockspace();
-            vgeImgui->render(commandBuffer);
+            vgeRenderer.record(frameInfo, [this](FrameInfo& uiInfo) {
+                vgeImgui->render(uiInfo.commandBuffer);
+            });
 
             vgeRenderer.endSwapChainRenderPass(commandBuffer);
+            frameAllocator->flush();
             vgeRenderer.endFrame();
         }
     }
 
     vkDeviceWaitIdle(vgeDevice.device());
+    vgeDevice.getDeletionQueue().flush();
 }
 
 void VulkanApplication::loadGameObjects() {
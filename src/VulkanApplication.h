@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Buffer/FrameAllocator.h"
 #include "Descriptor/Descriptors.h"
 #include "Device/Device.h"
 #include "Game/GameObject.h"
@@ -29,15 +30,13 @@ public:
 
 private:
     void loadGameObjects();
-    void createDescriptorSetLayout();
 
     Window vgeWindow{WIDTH, HEIGHT, "AAAAAAAAAA"};
     VgeDevice vgeDevice{vgeWindow};
     Renderer vgeRenderer{vgeWindow, vgeDevice};
 
     // note: order of desclaration matters
-    std::unique_ptr<VgeDescriptorPool> globalPool{};
-    std::unique_ptr<VgeDescriptorSetLayout> globalSetLayout{};
+    std::unique_ptr<VgeFrameAllocator> frameAllocator{};
     GameObject::Map gameObjects;
 
     std::unique_ptr<VgeImgui> vgeImgui{};
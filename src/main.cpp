@@ -1,10 +1,100 @@
 #include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <string>
 
+#include "HeadlessApplication.h"
+#include "SimulationServer.h"
 #include "VulkanApplication.h"
 
-int main() {
+static void printUsage() {
+    std::cerr << "usage: VgeEngine [--headless [--width <w>] [--height <h>] [--frames <n>]\n"
+                 "                 [--capture <file.png|file.raw>] [--capture-every <n>]]\n"
+                 "       VgeEngine --simulate [--name <shared memory name>] [--steps <n>]\n"
+                 "                 [--dt <seconds>] [--unpaced]\n";
+}
+
+static int runHeadless(int argc, char** argv) {
+    vge::HeadlessApplication::Settings settings{};
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--width" && i + 1 < argc) {
+            settings.width = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--height" && i + 1 < argc) {
+            settings.height = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--frames" && i + 1 < argc) {
+            settings.frames = std::atoi(argv[++i]);
+        } else if (arg == "--capture" && i + 1 < argc) {
+            settings.capturePath = argv[++i];
+        } else if (arg == "--capture-every" && i + 1 < argc) {
+            settings.captureEvery = std::atoi(argv[++i]);
+        } else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (settings.width == 0 || settings.height == 0 || settings.frames <= 0) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        vge::HeadlessApplication app{settings};
+        app.run();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int runSimulationServer(int argc, char** argv) {
+    vge::SimulationServer::Settings settings{};
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--name" && i + 1 < argc) {
+            settings.sharedMemoryName = argv[++i];
+        } else if (arg == "--steps" && i + 1 < argc) {
+            settings.steps = std::atoi(argv[++i]);
+        } else if (arg == "--dt" && i + 1 < argc) {
+            settings.deltaTime = static_cast<float>(std::atof(argv[++i]));
+        } else if (arg == "--unpaced") {
+            settings.paced = false;
+        } else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (settings.steps < 0 || settings.deltaTime <= 0.0f) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        vge::SimulationServer server{settings};
+        server.run();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        std::string mode = argv[1];
+        if (mode == "--headless") {
+            return runHeadless(argc, argv);
+        }
+        if (mode == "--simulate") {
+            return runSimulationServer(argc, argv);
+        }
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
     vge::VulkanApplication app{};
 
     try {
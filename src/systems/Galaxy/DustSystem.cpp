@@ -0,0 +1,289 @@
+#include "DustSystem.h"
+
+#include "../../Buffer/FrameAllocator.h"
+#include "../../Graphics/ShaderRegistry.h"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <stdexcept>
+
+namespace vge {
+
+constexpr const char* SPLAT_SHADER = "shaders/Galaxy/dust_splat.comp.spv";
+constexpr const char* MARCH_SHADER = "shaders/Galaxy/dust_raymarch.comp.spv";
+constexpr const char* COMPOSITE_VERT_SHADER = "shaders/Galaxy/dust_composite.vert.spv";
+constexpr const char* COMPOSITE_FRAG_SHADER = "shaders/Galaxy/dust_composite.frag.spv";
+
+struct DustSplatPushConstants {
+    glm::vec4 boundsMin{};
+    glm::vec4 boundsSize{};
+    int numStars;
+};
+
+struct DustMarchPushConstants {
+    glm::mat4 invViewProjection{1.f};
+    glm::vec4 cameraPosition{};
+    glm::vec4 boundsMin{};   // w is the density normalization
+    glm::vec4 boundsSize{};  // w is the absorption coefficient
+    glm::vec4 emission{};    // rgb is emission color times strength
+};
+
+DustSystem::DustSystem(VgeDevice& device, VkRenderPass renderPass) : vgeDevice{device} {
+    createLayouts();
+    createSampler();
+    createPipelines(renderPass);
+}
+
+DustSystem::~DustSystem() {
+    // Frames still in flight may be running the passes, pipelines go ahead of their layouts
+    auto& deletionQueue = vgeDevice.getDeletionQueue();
+    deletionQueue.retire(std::move(splatPipeline));
+    deletionQueue.retire(std::move(marchPipeline));
+    deletionQueue.retire(std::move(compositePipeline));
+
+    VkDevice device = vgeDevice.device();
+    VkSampler sampler = volumeSampler;
+    std::array<VkPipelineLayout, 3> layouts{splatPipelineLayout, marchPipelineLayout,
+                                            compositePipelineLayout};
+    deletionQueue.push([device, sampler, layouts]() {
+        vkDestroySampler(device, sampler, nullptr);
+        for (VkPipelineLayout layout : layouts) {
+            vkDestroyPipelineLayout(device, layout, nullptr);
+        }
+    });
+}
+
+void DustSystem::createLayouts() {
+    // Each pass uses a single set, laid out exactly as its shaders declare it
+    auto& shaders = vgeDevice.getShaderRegistry();
+    auto splatReflection = shaders.reflect({SPLAT_SHADER});
+    auto marchReflection = shaders.reflect({MARCH_SHADER});
+    auto compositeReflection = shaders.reflect({COMPOSITE_VERT_SHADER, COMPOSITE_FRAG_SHADER});
+    assert(splatReflection.pushConstantSize >= sizeof(DustSplatPushConstants) &&
+           marchReflection.pushConstantSize >= sizeof(DustMarchPushConstants) &&
+           "Dust push constants out of sync with the shaders");
+
+    splatSetLayout =
+        VgeDescriptorSetLayout::Builder(vgeDevice).addBindings(splatReflection, 0).build();
+    marchSetLayout =
+        VgeDescriptorSetLayout::Builder(vgeDevice).addBindings(marchReflection, 0).build();
+    compositeSetLayout =
+        VgeDescriptorSetLayout::Builder(vgeDevice).addBindings(compositeReflection, 0).build();
+
+    splatPipelineLayout =
+        createPipelineLayout(vgeDevice, splatSetLayout->getDescriptorSetLayout(), splatReflection);
+    marchPipelineLayout =
+        createPipelineLayout(vgeDevice, marchSetLayout->getDescriptorSetLayout(), marchReflection);
+    compositePipelineLayout = createPipelineLayout(
+        vgeDevice, compositeSetLayout->getDescriptorSetLayout(), compositeReflection);
+}
+
+void DustSystem::createSampler() {
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(vgeDevice.device(), &samplerInfo, nullptr, &volumeSampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create dust sampler!!!");
+    }
+}
+
+VkPipelineLayout DustSystem::createPipelineLayout(VgeDevice& device,
+                                                  VkDescriptorSetLayout setLayout,
+                                                  const ShaderReflection& reflection) {
+    auto pushConstantRanges = reflection.pushConstantRanges();
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+    VkPipelineLayout pipelineLayout;
+    if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create dust pipeline layout!!!");
+    }
+    return pipelineLayout;
+}
+
+void DustSystem::createPipelines(VkRenderPass renderPass) {
+    auto& compiler = vgeDevice.getPipelineCompiler();
+
+    auto splatConfig = std::make_unique<PipelineConfigInfo>();
+    splatConfig->pipelineLayout = splatPipelineLayout;
+    splatPipeline = compiler.compileCompute(SPLAT_SHADER, std::move(splatConfig));
+
+    auto marchConfig = std::make_unique<PipelineConfigInfo>();
+    marchConfig->pipelineLayout = marchPipelineLayout;
+    marchPipeline = compiler.compileCompute(MARCH_SHADER, std::move(marchConfig));
+
+    auto compositeConfig = std::make_unique<PipelineConfigInfo>();
+    Pipeline::defaultPipelineConfigInfo(*compositeConfig);
+    compositeConfig->attributeDescriptions.clear();
+    compositeConfig->bindingDescriptions.clear();
+
+    // dst = dst * transmittance + emission
+    compositeConfig->colorBlendAttachment.blendEnable = VK_TRUE;
+    compositeConfig->colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    compositeConfig->colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    compositeConfig->colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    compositeConfig->colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    compositeConfig->colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    compositeConfig->colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    compositeConfig->depthStencilInfo.depthTestEnable = VK_FALSE;
+    compositeConfig->depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+    compositeConfig->renderPass = renderPass;
+    compositeConfig->pipelineLayout = compositePipelineLayout;
+    compositePipeline = compiler.compileGraphics(COMPOSITE_VERT_SHADER, COMPOSITE_FRAG_SHADER,
+                                                 std::move(compositeConfig));
+}
+
+VgeRenderGraph::Resource DustSystem::addPasses(VgeRenderGraph& graph, FrameInfo& frameInfo,
+                                               VgeRenderGraph::Resource stars, int numStars,
+                                               VkExtent2D targetExtent) {
+    using Access = VgeRenderGraph::Access;
+
+    volumeView = VK_NULL_HANDLE;
+    if (!settings.enabled || numStars <= 0) {
+        return {};
+    }
+
+    // Ray march at half width and height, i.e. a quarter of the pixels
+    VkExtent2D marchExtent{std::max(targetExtent.width / 2, 1u),
+                           std::max(targetExtent.height / 2, 1u)};
+
+    // Both only live for this frame, the graph places them in its transient memory
+    auto density = graph.createBuffer(
+        "Dust density", {sizeof(uint32_t) * GRID_SIZE_X * GRID_SIZE_Y * GRID_SIZE_Z,
+                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT});
+    auto volume = graph.createImage(
+        "Dust volume", {marchExtent, VK_FORMAT_R16G16B16A16_SFLOAT,
+                        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT});
+
+    glm::vec3 boundsMin = -settings.boundsHalfExtent;
+    glm::vec3 boundsSize = 2.0f * settings.boundsHalfExtent;
+
+    DustSplatPushConstants splatPush{};
+    splatPush.boundsMin = glm::vec4(boundsMin, 0.0f);
+    splatPush.boundsSize = glm::vec4(boundsSize, 0.0f);
+    splatPush.numStars = numStars;
+
+    const glm::mat4& projection = frameInfo.camera.getProjection();
+    const glm::mat4& view = frameInfo.camera.getView();
+
+    // Average occupied cell count is normalized to 1 regardless of how many stars are splatted
+    float cellCount = static_cast<float>(GRID_SIZE_X * GRID_SIZE_Y * GRID_SIZE_Z);
+    float densityScale = cellCount / static_cast<float>(numStars);
+
+    DustMarchPushConstants marchPush{};
+    marchPush.invViewProjection = glm::inverse(projection * view);
+    marchPush.cameraPosition = frameInfo.camera.getInverseView()[3];
+    marchPush.boundsMin = glm::vec4(boundsMin, densityScale);
+    marchPush.boundsSize = glm::vec4(boundsSize, settings.absorption);
+    marchPush.emission = glm::vec4(settings.emissionColor * settings.emissionStrength, 0.0f);
+
+    // Sets are transient: the star buffer alternates between frames and the graph hands out
+    // different transients, neither can be written into a set a frame in flight may still use
+    auto* descriptorAllocator = &frameInfo.frameAllocator.getDescriptorAllocator();
+
+    graph.addPass("Dust clear")
+        .access(density, Access::TransferWrite)
+        .execute([&graph, density](VkCommandBuffer commandBuffer) {
+            vkCmdFillBuffer(commandBuffer, graph.getBuffer(density), 0, VK_WHOLE_SIZE, 0);
+        });
+
+    graph.addPass("Dust splat")
+        .access(stars, Access::ComputeRead)
+        .access(density, Access::ComputeReadWrite)
+        .execute([this, &graph, stars, density, splatPush,
+                  descriptorAllocator](VkCommandBuffer commandBuffer) {
+            VkDescriptorBufferInfo starInfo{graph.getBuffer(stars), 0, VK_WHOLE_SIZE};
+            VkDescriptorBufferInfo densityInfo{graph.getBuffer(density), 0, VK_WHOLE_SIZE};
+            VkDescriptorSet splatDescriptorSet;
+            if (!VgeDescriptorWriter(*splatSetLayout, *descriptorAllocator)
+                     .writeBuffer(0, &starInfo)
+                     .writeBuffer(1, &densityInfo)
+                     .build(splatDescriptorSet)) {
+                throw std::runtime_error("failed to allocate dust descriptor sets!!!");
+            }
+
+            splatPipeline->bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                    splatPipelineLayout, 0, 1, &splatDescriptorSet, 0, nullptr);
+            vkCmdPushConstants(commandBuffer, splatPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                               sizeof(DustSplatPushConstants), &splatPush);
+            vkCmdDispatch(commandBuffer,
+                          (splatPush.numStars + SPLAT_WORKGROUP_SIZE - 1) / SPLAT_WORKGROUP_SIZE,
+                          1, 1);
+        });
+
+    graph.addPass("Dust march")
+        .access(density, Access::ComputeRead)
+        .access(volume, Access::ComputeWrite)
+        .execute([this, &graph, density, volume, marchPush, marchExtent,
+                  descriptorAllocator](VkCommandBuffer commandBuffer) {
+            VkDescriptorBufferInfo densityInfo{graph.getBuffer(density), 0, VK_WHOLE_SIZE};
+            VkDescriptorImageInfo storageInfo{VK_NULL_HANDLE, graph.getImageView(volume),
+                                              VK_IMAGE_LAYOUT_GENERAL};
+            VkDescriptorSet marchDescriptorSet;
+            if (!VgeDescriptorWriter(*marchSetLayout, *descriptorAllocator)
+                     .writeBuffer(0, &densityInfo)
+                     .writeImage(1, &storageInfo)
+                     .build(marchDescriptorSet)) {
+                throw std::runtime_error("failed to allocate dust descriptor sets!!!");
+            }
+
+            marchPipeline->bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                    marchPipelineLayout, 0, 1, &marchDescriptorSet, 0, nullptr);
+            vkCmdPushConstants(commandBuffer, marchPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                               sizeof(DustMarchPushConstants), &marchPush);
+            vkCmdDispatch(commandBuffer,
+                          (marchExtent.width + MARCH_WORKGROUP_SIZE - 1) / MARCH_WORKGROUP_SIZE,
+                          (marchExtent.height + MARCH_WORKGROUP_SIZE - 1) / MARCH_WORKGROUP_SIZE,
+                          1);
+
+            volumeView = graph.getImageView(volume);
+        });
+
+    return volume;
+}
+
+void DustSystem::render(FrameInfo& frameInfo) {
+    if (!settings.enabled || volumeView == VK_NULL_HANDLE) {
+        return;
+    }
+
+    VkDescriptorImageInfo sampledInfo{volumeSampler, volumeView,
+                                      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkDescriptorSet compositeDescriptorSet;
+    if (!VgeDescriptorWriter(*compositeSetLayout, frameInfo.frameAllocator.getDescriptorAllocator())
+             .writeImage(0, &sampledInfo)
+             .build(compositeDescriptorSet)) {
+        throw std::runtime_error("failed to allocate dust composite descriptor set!!!");
+    }
+
+    compositePipeline->bind(frameInfo.commandBuffer);
+    vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            compositePipelineLayout, 0, 1, &compositeDescriptorSet, 0, nullptr);
+
+    // Fullscreen triangle, the sampler does the bilinear upsample
+    vkCmdDraw(frameInfo.commandBuffer, 3, 1, 0, 0);
+}
+
+}  // namespace vge
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "../../Buffer/Buffer.h"
+#include "../../Descriptor/Descriptors.h"
+#include "../../Device/Device.h"
+#include "../../FrameInfo.h"
+#include "../../Graphics/Pipeline.h"
+#include "../../Graphics/PipelineCompiler.h"
+#include "../../Rendering/RenderGraph.h"
+
+// std
+#include <vulkan/vulkan_core.h>
+
+#include <memory>
+
+namespace vge {
+
+// Volumetric gas and dust for the galaxy. Every frame the stars are splatted into a coarse 3D
+// density grid with atomics, a half resolution ray march turns the grid into emission and
+// transmittance, and the result is upsampled and composited before the stars are drawn.
+// Apart from the splat itself the cost depends on grid and screen size, not on the star count.
+class DustSystem {
+public:
+    // Must match GRID_SIZE in the dust shaders
+    static constexpr int GRID_SIZE_X = 128;
+    static constexpr int GRID_SIZE_Y = 32;
+    static constexpr int GRID_SIZE_Z = 128;
+    static constexpr int SPLAT_WORKGROUP_SIZE = 256;
+    static constexpr int MARCH_WORKGROUP_SIZE = 8;
+
+    struct Settings {
+        bool enabled = true;
+        float absorption = 0.08f;
+        float emissionStrength = 0.02f;
+        glm::vec3 emissionColor{1.0f, 0.55f, 0.35f};
+        glm::vec3 boundsHalfExtent{24.0f, 2.0f, 24.0f};
+    };
+
+    DustSystem(VgeDevice& device, VkRenderPass renderPass);
+    ~DustSystem();
+
+    DustSystem(const DustSystem&) = delete;
+    DustSystem& operator=(const DustSystem&) = delete;
+
+    // Adds the clear, splat and ray march passes reading the given star buffer. Returns the
+    // volume render() composites, to be sampled by the pass that calls it, or an invalid
+    // resource when there is nothing to composite.
+    VgeRenderGraph::Resource addPasses(VgeRenderGraph& graph, FrameInfo& frameInfo,
+                                       VgeRenderGraph::Resource stars, int numStars,
+                                       VkExtent2D targetExtent);
+    // Composites the dust layer onto the current render pass
+    void render(FrameInfo& frameInfo);
+
+    Settings settings{};
+
+private:
+    void createLayouts();
+    void createSampler();
+    void createPipelines(VkRenderPass renderPass);
+
+    static VkPipelineLayout createPipelineLayout(VgeDevice& device, VkDescriptorSetLayout setLayout,
+                                                 const ShaderReflection& reflection);
+
+    VgeDevice& vgeDevice;
+
+    std::unique_ptr<VgeDescriptorSetLayout> splatSetLayout;
+    std::unique_ptr<VgeDescriptorSetLayout> marchSetLayout;
+    std::unique_ptr<VgeDescriptorSetLayout> compositeSetLayout;
+
+    VkPipelineLayout splatPipelineLayout = VK_NULL_HANDLE;
+    VkPipelineLayout marchPipelineLayout = VK_NULL_HANDLE;
+    VkPipelineLayout compositePipelineLayout = VK_NULL_HANDLE;
+    PendingPipeline splatPipeline;
+    PendingPipeline marchPipeline;
+    PendingPipeline compositePipeline;
+
+    VkSampler volumeSampler = VK_NULL_HANDLE;
+    // This frame's ray march output, set once the graph has recorded the march
+    VkImageView volumeView = VK_NULL_HANDLE;
+};
+
+}  // namespace vge
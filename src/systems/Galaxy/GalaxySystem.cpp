@@ -1,22 +1,35 @@
 #include "GalaxySystem.h"
 #include "../../Buffer/Buffer.h"
 #include "../../Utils/ellipse.h"
-#include "../../Utils/hashFunction.h"
+#include "../../Simulation/CpuGalaxy.h"
+#include "../../Graphics/ShaderRegistry.h"
 
+#include <algorithm>
+#include <cmath>
 #include <glm/ext/quaternion_geometric.hpp>
 #include <stdexcept>
 #include <vulkan/vulkan_core.h>
 
 namespace vge {
 
+    constexpr const char* VERT_SHADER = "shaders/Galaxy/galaxy_vertex.vert.spv";
+    constexpr const char* FRAG_SHADER = "shaders/Galaxy/galaxy_fragment.frag.spv";
+    constexpr const char* COMPUTE_SHADER = "shaders/Galaxy/galaxy_compute.comp.spv";
+
     GalaxySystem::GalaxySystem(VgeDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
-        : vgeDevice{device}, globalSetLayout{globalSetLayout} {
+        : GalaxySystem{device} {
+
+            this->globalSetLayout = globalSetLayout;
+            createPipelineLayout();
+            createPipeline(renderPass);
+    }
+
+    GalaxySystem::GalaxySystem(VgeDevice& device) : vgeDevice{device} {
 
             try {
-                computeDescriptorPool = VgeDescriptorPool::Builder(device)
-                    .setMaxSets(2)
-                    .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6)
-                    .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+                computeDescriptorAllocator = VgeDescriptorAllocator::Builder(device)
+                    .setInitialSets(2)
+                    .addRatio(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3.0f)
                     .build();
 
                 createComputeDescriptorSetLayout();
@@ -26,8 +39,6 @@ namespace vge {
                 createComputeDescriptorSets();
                 createComputePipelineLayout();
                 createComputePipeline();
-                createPipelineLayout();
-                createPipeline(renderPass);
                 initStars();
 
             } catch (const std::exception& e) {
@@ -37,32 +48,36 @@ namespace vge {
     }
 
     GalaxySystem::~GalaxySystem() {
-        // Wait for device to be idle before cleanup
-        vkDeviceWaitIdle(vgeDevice.device());
-
         if (ellipseBuffer) {
             ellipseBuffer->unmap();
         }
 
-        if (computeDescriptorSetA != VK_NULL_HANDLE) {
-            std::vector<VkDescriptorSet> sets = {computeDescriptorSetA};
-            computeDescriptorPool->freeDescriptors(sets);
-        }
-        if (computeDescriptorSetB != VK_NULL_HANDLE) {
-            std::vector<VkDescriptorSet> sets = {computeDescriptorSetB};
-            computeDescriptorPool->freeDescriptors(sets);
-        }
-
-        vkDestroyPipelineLayout(vgeDevice.device(), graphicsPipelineLayout, nullptr);
-        vkDestroyPipelineLayout(vgeDevice.device(), computePipelineLayout, nullptr);
+        // Frames still in flight may read the stars, everything goes once they retire. The
+        // pipelines are queued ahead of the layouts a variant may still be compiling against.
+        auto& deletionQueue = vgeDevice.getDeletionQueue();
+        deletionQueue.retire(std::move(graphicsPipelines));
+        deletionQueue.retire(std::move(computePipeline));
+        deletionQueue.retire(std::move(computeDescriptorAllocator));
+        deletionQueue.retire(std::move(starBufferA));
+        deletionQueue.retire(std::move(starBufferB));
+        deletionQueue.retire(std::move(ellipseBuffer));
+
+        VkDevice device = vgeDevice.device();
+        VkPipelineLayout graphicsLayout = graphicsPipelineLayout;
+        VkPipelineLayout computeLayout = computePipelineLayout;
+        deletionQueue.push([device, graphicsLayout, computeLayout]() {
+            vkDestroyPipelineLayout(device, graphicsLayout, nullptr);
+            vkDestroyPipelineLayout(device, computeLayout, nullptr);
+        });
     }
 
 
     void GalaxySystem::createPipelineLayout() {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(SimplePushConstantData);
+        // Set 0 is the frame allocator's global UBO, the push constant range comes from the shaders
+        auto reflection = vgeDevice.getShaderRegistry().reflect({VERT_SHADER, FRAG_SHADER});
+        auto pushConstantRanges = reflection.pushConstantRanges();
+        assert(reflection.pushConstantSize >= sizeof(GalaxyPushConstantData) && "Galaxy push constants out of sync with the shaders");
+        graphicsPushConstantStages = reflection.pushConstantStages;
 
         std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
 
@@ -70,8 +85,8 @@ namespace vge {
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
         pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+        pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
 
         if (vkCreatePipelineLayout(vgeDevice.device(), &pipelineLayoutInfo, nullptr, &graphicsPipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create pipeline layout!");
@@ -79,10 +94,9 @@ namespace vge {
     }
 
     void GalaxySystem::createComputePipelineLayout() {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(ComputePushConstants);
+        auto reflection = vgeDevice.getShaderRegistry().reflect({COMPUTE_SHADER});
+        auto pushConstantRanges = reflection.pushConstantRanges();
+        assert(reflection.pushConstantSize >= sizeof(ComputePushConstants) && "Compute push constants out of sync with the shader");
 
         std::vector<VkDescriptorSetLayout> descriptorSetLayouts{computeDescriptorSetLayout->getDescriptorSetLayout()};
 
@@ -90,8 +104,8 @@ namespace vge {
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
         pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+        pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
 
         if (vkCreatePipelineLayout(vgeDevice.device(), &pipelineLayoutInfo, nullptr, &computePipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create compute pipeline layout!");
@@ -102,58 +116,44 @@ namespace vge {
     void GalaxySystem::createPipeline(VkRenderPass renderPass) {
         assert(graphicsPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-        PipelineConfigInfo pipelineConfig{};
-        Pipeline::defaultPipelineConfigInfo(pipelineConfig);
-
-        // Configure for point rendering
-        pipelineConfig.inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
-
-        // Enable alpha blending
-        pipelineConfig.colorBlendAttachment.blendEnable = VK_TRUE;
-        pipelineConfig.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-        pipelineConfig.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-        pipelineConfig.colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-        pipelineConfig.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-        pipelineConfig.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-        pipelineConfig.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+        // Points with alpha blending, depth tested but not written so stars don't occlude each other
+        graphicsState.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+        graphicsState.blendMode = BlendMode::Alpha;
+        graphicsState.depthTest = true;
+        graphicsState.depthWrite = false;
 
-        // Enable depth testing but disable depth writing for transparency
-        pipelineConfig.depthStencilInfo.depthTestEnable = VK_TRUE;
-        pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
-        pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS;
-
-        pipelineConfig.renderPass = renderPass;
-        pipelineConfig.pipelineLayout = graphicsPipelineLayout;
-        pipelineConfig.bindingDescriptions = getBindingDescriptions();
-        pipelineConfig.attributeDescriptions = getAttributeDescriptions();
-
-        graphicsPipeline = std::make_unique<Pipeline>(
+        VkPipelineLayout layout = graphicsPipelineLayout;
+        graphicsPipelines = std::make_unique<VgePipelinePermutations>(
             vgeDevice,
-            "shaders/Galaxy/galaxy_vertex.vert.spv",
-            "shaders/Galaxy/galaxy_fragment.frag.spv",
-            pipelineConfig
+            VERT_SHADER,
+            FRAG_SHADER,
+            [renderPass, layout](PipelineConfigInfo& pipelineConfig) {
+                pipelineConfig.renderPass = renderPass;
+                pipelineConfig.pipelineLayout = layout;
+                pipelineConfig.bindingDescriptions = getBindingDescriptions();
+                pipelineConfig.attributeDescriptions = getAttributeDescriptions();
+            },
+            graphicsState
         );
     }
 
     void GalaxySystem::createComputePipeline() {
         assert(computePipelineLayout != nullptr && "Cannot create compute pipeline before pipeline layout");
 
-        PipelineConfigInfo computePipelineConfig{};
-        computePipelineConfig.pipelineLayout = computePipelineLayout;
+        auto computePipelineConfig = std::make_unique<PipelineConfigInfo>();
+        computePipelineConfig->pipelineLayout = computePipelineLayout;
 
-        computePipeline = std::make_unique<Pipeline>(
-            vgeDevice,
-            "shaders/Galaxy/galaxy_compute.comp.spv",
-            computePipelineConfig
+        computePipeline = vgeDevice.getPipelineCompiler().compileCompute(
+            COMPUTE_SHADER,
+            std::move(computePipelineConfig)
         );
     }
 
 
     void GalaxySystem::createComputeDescriptorSetLayout() {
+        auto reflection = vgeDevice.getShaderRegistry().reflect({COMPUTE_SHADER});
         computeDescriptorSetLayout = VgeDescriptorSetLayout::Builder(vgeDevice)
-                .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
-                .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
-                .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                .addBindings(reflection, 0)
                 .build();
     }
 
@@ -200,7 +200,7 @@ namespace vge {
             auto bufferInfoB = starBufferB->descriptorInfo();
             auto ellipseBufferInfo = ellipseBuffer->descriptorInfo();
 
-            if (!VgeDescriptorWriter(*computeDescriptorSetLayout, *computeDescriptorPool)
+            if (!VgeDescriptorWriter(*computeDescriptorSetLayout, *computeDescriptorAllocator)
                 .writeBuffer(0, &bufferInfoA)  // input buffer (binding 0)
                 .writeBuffer(1, &bufferInfoB)  // output buffer (binding 1)
                 .writeBuffer(2, &ellipseBufferInfo)
@@ -215,7 +215,7 @@ namespace vge {
             auto bufferInfoB = starBufferB->descriptorInfo();
             auto ellipseBufferInfo = ellipseBuffer->descriptorInfo();
 
-            if (!VgeDescriptorWriter(*computeDescriptorSetLayout, *computeDescriptorPool)
+            if (!VgeDescriptorWriter(*computeDescriptorSetLayout, *computeDescriptorAllocator)
                 .writeBuffer(0, &bufferInfoB)  // input buffer (binding 0)
                 .writeBuffer(1, &bufferInfoA)  // output buffer (binding 1)
                 .writeBuffer(2, &ellipseBufferInfo)
@@ -242,40 +242,10 @@ namespace vge {
 
 
     void GalaxySystem::initStars() {
-        std::vector<Star> initialStars(NUM_STARS);
-
-        int starsPerEllipse = NUM_STARS / MAX_ELLIPSES;
-
-        for (int ellipseIndex = 0; ellipseIndex < MAX_ELLIPSES; ellipseIndex++) {
-            int startIndex = ellipseIndex * starsPerEllipse;
-            int endIndex = (ellipseIndex == MAX_ELLIPSES - 1) ? NUM_STARS : startIndex + starsPerEllipse;
-            int starsInThisEllipse = endIndex - startIndex;
-
-            float angleStep = (2.0f * M_PI) / starsInThisEllipse;
-            float currentEllipseSize = Ellipse::ellipseParams[ellipseIndex].majorAxis;
-
-            for (int i = startIndex; i < endIndex; i++) {
-                float t = (i - startIndex) * angleStep;
-
-                // Get base ellipse position without height
-                glm::vec3 basePos = Ellipse::calculateEllipsePoint(t, Ellipse::ellipseParams[ellipseIndex], 0.0f);
-
-                // Calculate height using de Vaucouleurs's Law
-                float baseHeight = Ellipse::calculateVaucouleursHeight(basePos.x, basePos.z, Ellipse::maxHeight);
-                float randomizedHeight = baseHeight * (hash(float(i)) * 2.0f - 1.0f);
-
-                // NTS: replace 4.0f with currentEllipseSize
-                float randRadius = hash(float(i) * 12.345f) * 4.0f;
-                float randAngle = hash(float(i) * 67.890f) * 2.0f * M_PI;
-
-                // Calculate random offset in polar coordinates
-                float offsetX = randRadius * cos(randAngle);
-                float offsetZ = randRadius * sin(randAngle);
-
-                initialStars[i].position = basePos + glm::vec3(offsetX, randomizedHeight, offsetZ);
-                initialStars[i].velocity = glm::vec3(t, randomizedHeight, randRadius);
-            }
-        }
+        // Shared with the CPU simulation. Stars are interleaved across ellipses with golden
+        // ratio angles, so the quality governor can draw only the first activeStarCount stars.
+        std::vector<Star> initialStars = CpuGalaxy::createInitialStars(
+            Ellipse::shape, Ellipse::ellipseParams, NUM_STARS);
 
         // Write to buffers
         starBufferA->map();
@@ -285,6 +255,18 @@ namespace vge {
         starBufferB->map();
         starBufferB->writeToBuffer(initialStars.data());
         starBufferB->unmap();
+
+        // Every star starts over, whether it is active or not
+        bufferTime[0] = bufferTime[1] = 0.0f;
+        frozenRanges.clear();
+        if (activeStarCount < NUM_STARS) {
+            frozenRanges.push_back({activeStarCount, {0.0f, 0.0f}});
+        }
+    }
+
+
+    void GalaxySystem::setActiveStarCount(int count) {
+        requestedStarCount = std::clamp(count, 1, NUM_STARS);
     }
 
 
@@ -296,11 +278,16 @@ namespace vge {
 
 
     void GalaxySystem::computeStars(FrameInfo& frameInfo) {
+        computeStars(frameInfo.commandBuffer, frameInfo.frameTime);
+    }
+
+
+    void GalaxySystem::computeStars(VkCommandBuffer commandBuffer, float deltaTime) {
         // Bind the compute pipeline and descriptor set
         VkDescriptorSet currentDescriptorSet = useBufferA ? computeDescriptorSetA : computeDescriptorSetB;
-        computePipeline->bind(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+        computePipeline->bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
         vkCmdBindDescriptorSets(
-            frameInfo.commandBuffer,
+            commandBuffer,
             VK_PIPELINE_BIND_POINT_COMPUTE,
             computePipelineLayout,
             0, 1,
@@ -308,12 +295,53 @@ namespace vge {
             0, nullptr
         );
 
+        int source = useBufferA ? 0 : 1;
+        int destination = 1 - source;
+        float newTime = bufferTime[source] + deltaTime;
+
+        // Stars leaving the active prefix stop where both buffers have them now
+        int count = requestedStarCount;
+        if (count < activeStarCount) {
+            frozenRanges.push_back({count, {bufferTime[0], bufferTime[1]}});
+        }
+
+        // Stars joining it again are stepped from where the source buffer has them to where the
+        // active stars end up, so they carry on without a jump
+        while (!frozenRanges.empty() && frozenRanges.back().begin < count) {
+            FrozenRange& range = frozenRanges.back();
+            int end = frozenRanges.size() > 1 ? frozenRanges[frozenRanges.size() - 2].begin
+                                              : NUM_STARS;
+            dispatchStars(commandBuffer, range.begin, std::min(end, count),
+                          newTime - range.bufferTime[source]);
+            if (end > count) {
+                range.begin = count;
+                break;
+            }
+            frozenRanges.pop_back();
+        }
+
+        dispatchStars(commandBuffer, 0, std::min(activeStarCount, count), deltaTime);
+
+        activeStarCount = count;
+        bufferTime[destination] = newTime;
+
+        // Toggle buffer usage
+        useBufferA = !useBufferA;
+    }
+
+    void GalaxySystem::dispatchStars(VkCommandBuffer commandBuffer, int firstStar, int endStar,
+                                     float deltaTime) {
+        if (endStar <= firstStar) {
+            return;
+        }
+
         ComputePushConstants push{};
-        push.numStars = NUM_STARS;
+        push.numStars = endStar;
         push.numEllipses = MAX_ELLIPSES;
-        push.deltaTime = frameInfo.frameTime;
+        push.deltaTime = deltaTime;
+        push.firstStar = firstStar;
         vkCmdPushConstants(
-            frameInfo.commandBuffer,
+            commandBuffer,
             computePipelineLayout,
             VK_SHADER_STAGE_COMPUTE_BIT,
             0,
@@ -321,39 +349,42 @@ namespace vge {
             &push
         );
 
-        // Dispatch the compute shader
         vkCmdDispatch(
-            frameInfo.commandBuffer,
-            (NUM_STARS + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+            commandBuffer,
+            (endStar - firstStar + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
             1,
             1
         );
+    }
 
-        // Memory barrier to ensure compute writes are visible to the vertex shader
-        VkMemoryBarrier memoryBarrier{};
-        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-        memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-        memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
 
-        vkCmdPipelineBarrier(
-            frameInfo.commandBuffer,
-            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-            0,
-            1, &memoryBarrier,
-            0, nullptr,
-            0, nullptr
-        );
+    void GalaxySystem::render(FrameInfo& frameInfo) {
+        VgeBuffer* currentBuffer = useBufferA ? starBufferB.get() : starBufferA.get();
 
-        // Toggle buffer usage
-        useBufferA = !useBufferA;
+        bindGraphicsPipeline(frameInfo);
+
+        VkBuffer vertexBuffer = currentBuffer->getBuffer();
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(frameInfo.commandBuffer, 0, 1, &vertexBuffer, &offset);
+        vkCmdDraw(frameInfo.commandBuffer, activeStarCount, 1, 0, 0);
     }
 
+    void GalaxySystem::renderBuffers(FrameInfo& frameInfo, const std::vector<StarBufferRange>& ranges) {
+        if (ranges.empty()) {
+            return;
+        }
 
-    void GalaxySystem::render(FrameInfo& frameInfo) {
-        VgeBuffer* currentBuffer = useBufferA ? starBufferB.get() : starBufferA.get();
+        bindGraphicsPipeline(frameInfo);
 
-        graphicsPipeline->bind(frameInfo.commandBuffer);
+        VkDeviceSize offset = 0;
+        for (const auto& range : ranges) {
+            vkCmdBindVertexBuffers(frameInfo.commandBuffer, 0, 1, &range.buffer, &offset);
+            vkCmdDraw(frameInfo.commandBuffer, range.starCount, 1, 0, 0);
+        }
+    }
+
+    void GalaxySystem::bindGraphicsPipeline(FrameInfo& frameInfo) {
+        graphicsPipelines->get(graphicsState).bind(frameInfo.commandBuffer);
 
         vkCmdBindDescriptorSets(
             frameInfo.commandBuffer,
@@ -361,26 +392,22 @@ namespace vge {
             graphicsPipelineLayout,
             0, 1,
             &frameInfo.globalDescriptorSet,
-            0, nullptr
+            1, &frameInfo.globalUboOffset
         );
 
-        SimplePushConstantData push{};
+        GalaxyPushConstantData push{};
         push.modelMatrix = glm::mat4(1.0f);
-        push.normalMatrix = glm::mat4(1.0f);
+        push.pointSizeScale = pointSizeScale;
+        push.brightness = brightness;
 
         vkCmdPushConstants(
             frameInfo.commandBuffer,
             graphicsPipelineLayout,
-            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+            graphicsPushConstantStages,
             0,
-            sizeof(SimplePushConstantData),
+            sizeof(GalaxyPushConstantData),
             &push
         );
-
-        VkBuffer vertexBuffer = currentBuffer->getBuffer();
-        VkDeviceSize offset = 0;
-        vkCmdBindVertexBuffers(frameInfo.commandBuffer, 0, 1, &vertexBuffer, &offset);
-        vkCmdDraw(frameInfo.commandBuffer, NUM_STARS, 1, 0, 0);
     }
 
     std::vector<VkVertexInputBindingDescription> GalaxySystem::getBindingDescriptions() {
@@ -2,10 +2,13 @@
 
 #include "../../Device/Device.h"
 #include "../../Graphics/Pipeline.h"
+#include "../../Graphics/PipelineCompiler.h"
+#include "../../Graphics/PipelinePermutations.h"
 #include "../../FrameInfo.h"
 #include "../../Buffer/Buffer.h"
 #include "../../Descriptor/Descriptors.h"
 #include "../../Utils/ellipse.h"
+#include "../../Simulation/Star.h"
 
 #include <vulkan/vulkan.h>
 #include <memory>
@@ -14,14 +17,16 @@
 
 namespace vge {
 
-    struct Star {
-        alignas(16) glm::vec3 position;
-        alignas(16) glm::vec3 velocity;
+    struct GalaxyPushConstantData {
+        glm::mat4 modelMatrix{1.f};
+        float pointSizeScale{1.f};
+        float brightness{1.f};
     };
 
-    struct SimplePushConstantData {
-        glm::mat4 modelMatrix{1.f};
-        glm::mat4 normalMatrix{1.f};
+    // Star vertex data that lives outside the simulation buffers, e.g. streamed tiles
+    struct StarBufferRange {
+        VkBuffer buffer;
+        uint32_t starCount;
     };
 
     struct EllipseBufferObject {
@@ -29,9 +34,10 @@ namespace vge {
     };
 
     struct ComputePushConstants {
-        int numStars;
+        int numStars;  // end of the range of stars to step
         int numEllipses;
         float deltaTime;
+        int firstStar;
     };
 
     class GalaxySystem {
@@ -41,18 +47,44 @@ namespace vge {
         static constexpr int MAX_ELLIPSES = 30;
 
         GalaxySystem(VgeDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+        // Simulation only, for compute only devices. There is no graphics pipeline to render with.
+        explicit GalaxySystem(VgeDevice& device);
         ~GalaxySystem();
 
         GalaxySystem(const GalaxySystem&) = delete;
         GalaxySystem& operator=(const GalaxySystem&) = delete;
 
         void render(FrameInfo& frameInfo);
+        // Draws other star buffers with the galaxy pipeline instead of the simulated stars
+        void renderBuffers(FrameInfo& frameInfo, const std::vector<StarBufferRange>& ranges);
         void update(FrameInfo& frameInfo);
+        // Records one simulation step, barriers around it come from the render graph
         void computeStars(FrameInfo& frameInfo);
+        void computeStars(VkCommandBuffer commandBuffer, float deltaTime);
         void updateGalaxyParameters();
 
+        // Quality knobs driven by the QualityGovernor. Only the first activeStars stars are
+        // simulated and drawn; the buffer layout guarantees any prefix is a uniform sample.
+        // A new count takes effect with the next computeStars, stars that become active again
+        // are caught up to the rest in that step.
+        void setActiveStarCount(int count);
+        void setPointSizeScale(float scale) { pointSizeScale = scale; }
+        void setBrightness(float value) { brightness = value; }
+        int getActiveStarCount() const { return activeStarCount; }
+
+        // Alpha blending or additive glow, the variant compiles in the background on first use
+        void setBlendMode(BlendMode mode) { graphicsState.blendMode = mode; }
+        BlendMode getBlendMode() const { return graphicsState.blendMode; }
+
+        // Buffer holding the most recent simulation step, the one render() draws from
+        VgeBuffer& getCurrentStarBuffer() { return useBufferA ? *starBufferB : *starBufferA; }
+        // Buffer the next computeStars reads from, it writes the current one. Once the step has
+        // run the two swap, so this is what render() draws afterwards.
+        VgeBuffer& getSimulationSourceBuffer() { return useBufferA ? *starBufferA : *starBufferB; }
+
     private:
 
+        void bindGraphicsPipeline(FrameInfo& frameInfo);
         void createPipelineLayout();
         void createPipeline(VkRenderPass renderPass);
         void createComputePipelineLayout();
@@ -63,6 +95,8 @@ namespace vge {
         void createEllipseBuffer();
         void updateEllipseBuffer();
         void initStars();
+        void dispatchStars(VkCommandBuffer commandBuffer, int firstStar, int endStar,
+                           float deltaTime);
 
         // Helper functions
         static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
@@ -71,12 +105,14 @@ namespace vge {
         VgeDevice& vgeDevice;
 
         // Graphics pipeline related
-        std::unique_ptr<Pipeline> graphicsPipeline;
-        VkPipelineLayout graphicsPipelineLayout;
-        VkDescriptorSetLayout globalSetLayout;
+        std::unique_ptr<VgePipelinePermutations> graphicsPipelines;
+        PipelineStateKey graphicsState{};
+        VkPipelineLayout graphicsPipelineLayout = VK_NULL_HANDLE;
+        VkShaderStageFlags graphicsPushConstantStages = 0;
+        VkDescriptorSetLayout globalSetLayout = VK_NULL_HANDLE;
 
         // Compute pipeline related
-        std::unique_ptr<Pipeline> computePipeline;
+        PendingPipeline computePipeline;
         VkPipelineLayout computePipelineLayout;
         std::unique_ptr<VgeDescriptorSetLayout> computeDescriptorSetLayout;
 
@@ -90,8 +126,25 @@ namespace vge {
         std::unique_ptr<VgeBuffer> starBufferB;
         bool useBufferA = true;
 
-        // Descriptor pool for compute descriptor
-        std::unique_ptr<VgeDescriptorPool> computeDescriptorPool;
+        // Stars simulated by the last step, the requested count is applied by the next one
+        int activeStarCount = NUM_STARS;
+        int requestedStarCount = NUM_STARS;
+
+        // Stars past the active prefix stand still. Each range of them remembers the
+        // simulation time its state has in either buffer, so it can catch up in one step.
+        // Ranges are ordered by descending begin, a range ends where the one before begins.
+        struct FrozenRange {
+            int begin;
+            float bufferTime[2];  // starBufferA, starBufferB
+        };
+        std::vector<FrozenRange> frozenRanges;
+        // Simulation time of the active stars in starBufferA and starBufferB
+        float bufferTime[2] = {0.0f, 0.0f};
+        float pointSizeScale = 1.0f;
+        float brightness = 1.0f;
+
+        // Compute descriptor sets, released with the allocator
+        std::unique_ptr<VgeDescriptorAllocator> computeDescriptorAllocator;
 
         std::unique_ptr<VgeBuffer> ellipseBuffer;
     };
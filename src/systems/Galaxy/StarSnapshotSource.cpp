@@ -0,0 +1,57 @@
+#include "StarSnapshotSource.h"
+
+#include "../../Presentation/SwapChain.h"
+
+// std
+#include <stdexcept>
+
+namespace vge {
+
+StarSnapshotSource::StarSnapshotSource(VgeDevice& device, const std::string& sharedMemoryName)
+    : reader{std::make_unique<StarSnapshotReader>(sharedMemoryName)} {
+    frameBuffers.resize(VgeSwapChain::MAX_FRAMES_IN_FLIGHT);
+    for (auto& frameBuffer : frameBuffers) {
+        frameBuffer.buffer = std::make_unique<VgeBuffer>(
+            device, sizeof(Star), reader->getNumStars(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        if (frameBuffer.buffer->map() != VK_SUCCESS) {
+            throw std::runtime_error("failed to map star snapshot buffer!!!");
+        }
+    }
+}
+
+void StarSnapshotSource::update(FrameInfo& frameInfo) {
+    // beginFrame has waited for the frame that drew from this buffer last
+    currentFrame = frameInfo.frameIndex;
+    FrameBuffer& frameBuffer = frameBuffers[currentFrame];
+
+    uint64_t latest = reader->getLatestStep();
+    if (latest == 0 || latest == frameBuffer.step) {
+        return;
+    }
+
+    // Coherent memory, the copy is visible to the frame's submit without a flush
+    frameBuffer.step = reader->read(static_cast<Star*>(frameBuffer.buffer->getMappedMemory()));
+    if (frameBuffer.step == 0) {
+        overtakenReads++;
+    }
+}
+
+std::vector<StarBufferRange> StarSnapshotSource::getDrawRanges() const {
+    const FrameBuffer& frameBuffer = frameBuffers[currentFrame];
+    if (frameBuffer.step == 0) {
+        return {};
+    }
+    return {{frameBuffer.buffer->getBuffer(), reader->getNumStars()}};
+}
+
+StarSnapshotSource::Stats StarSnapshotSource::getStats() const {
+    Stats stats;
+    stats.numStars = reader->getNumStars();
+    stats.publishedStep = reader->getLatestStep();
+    stats.drawnStep = frameBuffers[currentFrame].step;
+    stats.overtakenReads = overtakenReads;
+    return stats;
+}
+
+}  // namespace vge
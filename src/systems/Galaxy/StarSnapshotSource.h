@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../../Buffer/Buffer.h"
+#include "../../Device/Device.h"
+#include "../../FrameInfo.h"
+#include "../../Simulation/StarSnapshotReader.h"
+#include "GalaxySystem.h"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vge {
+
+// Draws the stars another process publishes to shared memory, such as the --simulate server or
+// GalaxyCluster --serve. Every frame index has a host visible vertex buffer of its own, and the
+// latest snapshot is copied straight into it once the frame that last drew from it is done.
+class StarSnapshotSource {
+public:
+    struct Stats {
+        uint32_t numStars = 0;
+        uint64_t publishedStep = 0;
+        uint64_t drawnStep = 0;
+        uint64_t overtakenReads = 0;  // copies the publisher overwrote, retried next frame
+    };
+
+    StarSnapshotSource(VgeDevice& device, const std::string& sharedMemoryName);
+
+    StarSnapshotSource(const StarSnapshotSource&) = delete;
+    StarSnapshotSource& operator=(const StarSnapshotSource&) = delete;
+
+    // Copies a newer snapshot into this frame index's buffer, if there is one
+    void update(FrameInfo& frameInfo);
+
+    // Empty until a snapshot has been copied for this frame index
+    std::vector<StarBufferRange> getDrawRanges() const;
+    Stats getStats() const;
+
+private:
+    struct FrameBuffer {
+        std::unique_ptr<VgeBuffer> buffer;
+        uint64_t step = 0;  // 0 while the contents are not a complete snapshot
+    };
+
+    std::unique_ptr<StarSnapshotReader> reader;
+    std::vector<FrameBuffer> frameBuffers;
+    int currentFrame = 0;
+    uint64_t overtakenReads = 0;
+};
+
+}  // namespace vge
@@ -0,0 +1,295 @@
+#include "StarTileStreamer.h"
+
+#include "../../Device/FrameScheduler.h"
+#include "../../Device/TransferManager.h"
+#include "../../Presentation/SwapChain.h"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+namespace vge {
+
+StarTileStreamer::StarTileStreamer(VgeDevice& device, const std::string& filepath,
+                                   VkDeviceSize memoryBudget)
+    : vgeDevice{device}, reader{std::make_unique<StarTileReader>(filepath)} {
+    header = reader->getHeader();
+    entries = reader->getTiles();
+    tiles.resize(entries.size());
+
+    loadCoarseStars();
+
+    uint32_t nonEmptyTiles = static_cast<uint32_t>(std::count_if(
+        entries.begin(), entries.end(), [](const StarTileEntry& e) { return e.starCount > 0; }));
+
+    if (header.maxTileStars > 0) {
+        VkDeviceSize slotSize = sizeof(Star) * static_cast<VkDeviceSize>(header.maxTileStars);
+        VkDeviceSize slotCount =
+            std::clamp<VkDeviceSize>(memoryBudget / slotSize, 1, nonEmptyTiles);
+
+        slots.resize(slotCount);
+        for (auto& slot : slots) {
+            slot.buffer = std::make_unique<VgeBuffer>(
+                vgeDevice, sizeof(Star), header.maxTileStars,
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+
+        // Enough for a full batch of uploads in every frame in flight plus one being filled
+        stagingBuffers.resize(maxUploadsPerFrame * (VgeSwapChain::MAX_FRAMES_IN_FLIGHT + 1));
+        for (auto& staging : stagingBuffers) {
+            staging.buffer = std::make_unique<VgeBuffer>(
+                vgeDevice, sizeof(Star), header.maxTileStars, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            staging.buffer->map();
+        }
+    }
+
+    loader = std::thread(&StarTileStreamer::loaderLoop, this);
+}
+
+StarTileStreamer::~StarTileStreamer() {
+    {
+        std::lock_guard<std::mutex> lock{loaderMutex};
+        stopLoader = true;
+    }
+    loaderCondition.notify_all();
+    loader.join();
+}
+
+void StarTileStreamer::loadCoarseStars() {
+    if (header.coarseCount == 0) {
+        return;
+    }
+
+    // One time upload at load, the coarse set is small by construction
+    uint32_t count = static_cast<uint32_t>(header.coarseCount);
+    std::vector<Star> stars(count);
+    reader->readStars(header.coarseOffset, count, stars.data());
+
+    coarseBuffer = std::make_unique<VgeBuffer>(
+        vgeDevice, sizeof(Star), count,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    vgeDevice.getTransferManager().upload(coarseBuffer->getBuffer(), stars.data(),
+                                          coarseBuffer->getBufferSize());
+}
+
+void StarTileStreamer::update(FrameInfo& frameInfo) {
+    // Staging buffers are free again once the frame that recorded their copy has completed
+    VgeFrameScheduler& scheduler = vgeDevice.getFrameScheduler();
+    currentFrame = scheduler.getCurrentFrame();
+    uint64_t completedFrame = scheduler.getCompletedFrame();
+    for (auto& staging : stagingBuffers) {
+        if (staging.state == StagingState::Copying && staging.copyFrame <= completedFrame) {
+            staging.state = StagingState::Free;
+            staging.tile = -1;
+        }
+    }
+
+    recordFinishedUploads(frameInfo.commandBuffer);
+    requestTiles(glm::vec3(frameInfo.camera.getInverseView()[3]));
+}
+
+void StarTileStreamer::recordFinishedUploads(VkCommandBuffer commandBuffer) {
+    std::vector<int> finished;
+    {
+        std::lock_guard<std::mutex> lock{loaderMutex};
+        finished.swap(finishedLoads);
+    }
+    if (finished.empty()) {
+        return;
+    }
+
+    // Slots may have been drawn by frames still in flight before they were evicted. Draws from
+    // earlier submissions are in this barrier's first scope, so the copies wait for them.
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    for (int index : finished) {
+        StagingBuffer& staging = stagingBuffers[index];
+        Tile& tile = tiles[staging.tile];
+
+        if (staging.failed) {
+            slots[tile.slot].tile = -1;
+            tile.slot = -1;
+            tile.state = TileState::NotResident;
+            staging.state = StagingState::Free;
+            staging.tile = -1;
+            continue;
+        }
+
+        VkBufferCopy copyRegion{};
+        copyRegion.size = sizeof(Star) * static_cast<VkDeviceSize>(entries[staging.tile].starCount);
+        vkCmdCopyBuffer(commandBuffer, staging.buffer->getBuffer(),
+                        slots[tile.slot].buffer->getBuffer(), 1, &copyRegion);
+
+        bytesStreamed += copyRegion.size;
+        tile.state = TileState::Resident;
+        staging.state = StagingState::Copying;
+        staging.copyFrame = currentFrame;
+    }
+
+    VkMemoryBarrier uploadBarrier{};
+    uploadBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    uploadBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    uploadBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &uploadBarrier, 0, nullptr, 0,
+                         nullptr);
+}
+
+void StarTileStreamer::requestTiles(const glm::vec3& cameraPosition) {
+    if (slots.empty()) {
+        return;
+    }
+
+    // Distance from the camera to each tile's bounds, zero inside
+    std::vector<int> order;
+    order.reserve(tiles.size());
+    for (size_t i = 0; i < tiles.size(); i++) {
+        const StarTileEntry& entry = entries[i];
+        if (entry.starCount == 0) continue;
+
+        glm::vec3 boundsMin{entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2]};
+        glm::vec3 boundsMax{entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2]};
+        glm::vec3 closest = glm::clamp(cameraPosition, boundsMin, boundsMax);
+        tiles[i].distance = glm::length(cameraPosition - closest);
+        order.push_back(static_cast<int>(i));
+    }
+
+    // The nearest tiles that fit in the budget are the ones worth having
+    size_t wantedCount = std::min(order.size(), slots.size());
+    std::partial_sort(order.begin(), order.begin() + wantedCount, order.end(),
+                      [&](int a, int b) { return tiles[a].distance < tiles[b].distance; });
+
+    std::vector<bool> wanted(tiles.size(), false);
+    for (size_t i = 0; i < wantedCount; i++) {
+        wanted[order[i]] = true;
+    }
+
+    int requested = 0;
+    for (size_t i = 0; i < wantedCount && requested < maxUploadsPerFrame; i++) {
+        int tileIndex = order[i];
+        if (tiles[tileIndex].state != TileState::NotResident) continue;
+
+        int stagingIndex = acquireStagingBuffer();
+        if (stagingIndex < 0) break;
+        int slotIndex = acquireSlot(wanted);
+        if (slotIndex < 0) break;
+
+        Tile& tile = tiles[tileIndex];
+        tile.state = TileState::Loading;
+        tile.slot = slotIndex;
+        slots[slotIndex].tile = tileIndex;
+
+        StagingBuffer& staging = stagingBuffers[stagingIndex];
+        staging.state = StagingState::Loading;
+        staging.tile = tileIndex;
+        staging.failed = false;
+
+        {
+            std::lock_guard<std::mutex> lock{loaderMutex};
+            loadRequests.push_back(stagingIndex);
+        }
+        loaderCondition.notify_one();
+        requested++;
+    }
+}
+
+int StarTileStreamer::acquireSlot(const std::vector<bool>& wanted) {
+    // Prefer an empty slot, otherwise evict the farthest resident tile nobody wants anymore
+    int victim = -1;
+    for (size_t i = 0; i < slots.size(); i++) {
+        int tileIndex = slots[i].tile;
+        if (tileIndex < 0) {
+            return static_cast<int>(i);
+        }
+        const Tile& tile = tiles[tileIndex];
+        if (tile.state != TileState::Resident || wanted[tileIndex]) continue;
+        if (victim < 0 || tile.distance > tiles[slots[victim].tile].distance) {
+            victim = static_cast<int>(i);
+        }
+    }
+
+    if (victim >= 0) {
+        Tile& evicted = tiles[slots[victim].tile];
+        evicted.state = TileState::NotResident;
+        evicted.slot = -1;
+        slots[victim].tile = -1;
+    }
+    return victim;
+}
+
+int StarTileStreamer::acquireStagingBuffer() {
+    for (size_t i = 0; i < stagingBuffers.size(); i++) {
+        if (stagingBuffers[i].state == StagingState::Free) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void StarTileStreamer::loaderLoop() {
+    while (true) {
+        int index;
+        {
+            std::unique_lock<std::mutex> lock{loaderMutex};
+            loaderCondition.wait(lock, [this] { return stopLoader || !loadRequests.empty(); });
+            if (stopLoader) {
+                return;
+            }
+            index = loadRequests.front();
+            loadRequests.pop_front();
+        }
+
+        StagingBuffer& staging = stagingBuffers[index];
+        const StarTileEntry& entry = entries[staging.tile];
+        bool failed = false;
+        try {
+            reader->readStars(entry.offset, entry.starCount,
+                              static_cast<Star*>(staging.buffer->getMappedMemory()));
+        } catch (const std::exception&) {
+            failed = true;
+        }
+
+        std::lock_guard<std::mutex> lock{loaderMutex};
+        staging.failed = failed;
+        finishedLoads.push_back(index);
+    }
+}
+
+std::vector<StarBufferRange> StarTileStreamer::getDrawRanges() const {
+    std::vector<StarBufferRange> ranges;
+    if (coarseBuffer) {
+        ranges.push_back({coarseBuffer->getBuffer(), static_cast<uint32_t>(header.coarseCount)});
+    }
+    for (const auto& slot : slots) {
+        if (slot.tile >= 0 && tiles[slot.tile].state == TileState::Resident) {
+            ranges.push_back({slot.buffer->getBuffer(), entries[slot.tile].starCount});
+        }
+    }
+    return ranges;
+}
+
+StarTileStreamer::Stats StarTileStreamer::getStats() const {
+    Stats stats;
+    stats.totalTiles = static_cast<uint32_t>(tiles.size());
+    stats.slotCount = static_cast<uint32_t>(slots.size());
+    stats.coarseStars = header.coarseCount;
+    stats.totalStars = header.totalStars;
+    stats.bytesStreamed = bytesStreamed;
+    for (size_t i = 0; i < tiles.size(); i++) {
+        if (tiles[i].state == TileState::Resident) {
+            stats.residentTiles++;
+            stats.residentStars += entries[i].starCount;
+        } else if (tiles[i].state == TileState::Loading) {
+            stats.loadingTiles++;
+        }
+    }
+    return stats;
+}
+
+}  // namespace vge
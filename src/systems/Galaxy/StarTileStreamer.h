@@ -0,0 +1,107 @@
+#pragma once
+
+#include "../../Buffer/Buffer.h"
+#include "../../Device/Device.h"
+#include "../../FrameInfo.h"
+#include "../../Simulation/StarTileFile.h"
+#include "GalaxySystem.h"
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vge {
+
+// Residency manager for a tiled star file (see StarTileFile.h). The coarse stars stay resident
+// for the lifetime of the streamer. Fine tiles are paged into a fixed pool of GPU slots sized
+// by a memory budget, nearest to the camera first. A loader thread reads tiles into mapped
+// staging buffers and the frame only records the GPU copies, so neither disk reads nor
+// uploads ever block the frame; a tile that is not loaded yet is simply not drawn.
+class StarTileStreamer {
+public:
+    struct Stats {
+        uint32_t totalTiles = 0;
+        uint32_t residentTiles = 0;
+        uint32_t loadingTiles = 0;
+        uint32_t slotCount = 0;
+        uint64_t coarseStars = 0;
+        uint64_t residentStars = 0;
+        uint64_t totalStars = 0;
+        uint64_t bytesStreamed = 0;
+    };
+
+    StarTileStreamer(VgeDevice& device, const std::string& filepath, VkDeviceSize memoryBudget);
+    ~StarTileStreamer();
+
+    StarTileStreamer(const StarTileStreamer&) = delete;
+    StarTileStreamer& operator=(const StarTileStreamer&) = delete;
+
+    // Records uploads for finished loads and queues new ones, must be called outside of a
+    // render pass
+    void update(FrameInfo& frameInfo);
+
+    // Coarse stars plus every resident tile
+    std::vector<StarBufferRange> getDrawRanges() const;
+    Stats getStats() const;
+
+    // Uploads recorded per frame at most
+    int maxUploadsPerFrame = 8;
+
+private:
+    enum class TileState { NotResident, Loading, Resident };
+    enum class StagingState { Free, Loading, Copying };
+
+    struct Tile {
+        TileState state = TileState::NotResident;
+        int slot = -1;
+        float distance = 0.0f;
+    };
+
+    struct Slot {
+        std::unique_ptr<VgeBuffer> buffer;
+        int tile = -1;
+    };
+
+    struct StagingBuffer {
+        std::unique_ptr<VgeBuffer> buffer;
+        StagingState state = StagingState::Free;
+        int tile = -1;
+        uint64_t copyFrame = 0;  // frame that recorded the copy
+        bool failed = false;  // set by the loader when the read fails
+    };
+
+    void loadCoarseStars();
+    void recordFinishedUploads(VkCommandBuffer commandBuffer);
+    void requestTiles(const glm::vec3& cameraPosition);
+    int acquireSlot(const std::vector<bool>& wanted);
+    int acquireStagingBuffer();
+    void loaderLoop();
+
+    VgeDevice& vgeDevice;
+    std::unique_ptr<StarTileReader> reader;  // owned by the loader thread after construction
+    StarTileHeader header{};
+    std::vector<StarTileEntry> entries;
+
+    std::unique_ptr<VgeBuffer> coarseBuffer;
+    std::vector<Tile> tiles;
+    std::vector<Slot> slots;
+    std::vector<StagingBuffer> stagingBuffers;
+    uint64_t currentFrame = 0;  // frame scheduler number of the frame being recorded
+    uint64_t bytesStreamed = 0;
+
+    // Loader thread, requests and results are staging buffer indices
+    std::thread loader;
+    std::mutex loaderMutex;
+    std::condition_variable loaderCondition;
+    std::deque<int> loadRequests;
+    std::vector<int> finishedLoads;
+    bool stopLoader = false;
+};
+
+}  // namespace vge
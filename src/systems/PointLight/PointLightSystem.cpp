@@ -4,6 +4,7 @@
 
 #include "../../FrameInfo.h"
 #include "../../Game/GameObject.h"
+#include "../../Graphics/ShaderRegistry.h"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -19,6 +20,9 @@
 
 namespace vge {
 
+constexpr const char* VERT_SHADER = "shaders/PointLight/point_light_vertex.vert.spv";
+constexpr const char* FRAG_SHADER = "shaders/PointLight/point_light_fragment.frag.spv";
+
 struct PointLightPushConstants {
     glm::vec4 position{};
     glm::vec4 color{};
@@ -37,10 +41,12 @@ PointLightSystem::~PointLightSystem() {
 }
 
 void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-    VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(PointLightPushConstants);
+    // Set 0 is the frame allocator's global UBO, the push constant range comes from the shaders
+    auto reflection = vgeDevice.getShaderRegistry().reflect({VERT_SHADER, FRAG_SHADER});
+    auto pushConstantRanges = reflection.pushConstantRanges();
+    assert(reflection.pushConstantSize >= sizeof(PointLightPushConstants) &&
+           "Push constants out of sync with the shaders");
+    pushConstantStages = reflection.pushConstantStages;
 
     std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
 
@@ -48,8 +54,8 @@ void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayou
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
     pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
     if (vkCreatePipelineLayout(vgeDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
         VK_SUCCESS) {
         throw std::runtime_error("failed to create pipeline layout!!!");
@@ -59,15 +65,14 @@ void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayou
 void PointLightSystem::createPipeline(VkRenderPass renderPass) {
     assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!!!");
 
-    PipelineConfigInfo pipelineConfig{};
-    Pipeline::defaultPipelineConfigInfo(pipelineConfig);
-    pipelineConfig.attributeDescriptions.clear();
-    pipelineConfig.bindingDescriptions.clear();
-    pipelineConfig.renderPass = renderPass;
-    pipelineConfig.pipelineLayout = pipelineLayout;
-    vgePipeline = std::make_unique<Pipeline>(
-        vgeDevice, "shaders/PointLight/point_light_vertex.vert.spv",
-        "shaders/PointLight/point_light_fragment.frag.spv", pipelineConfig);
+    auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+    Pipeline::defaultPipelineConfigInfo(*pipelineConfig);
+    pipelineConfig->attributeDescriptions.clear();
+    pipelineConfig->bindingDescriptions.clear();
+    pipelineConfig->renderPass = renderPass;
+    pipelineConfig->pipelineLayout = pipelineLayout;
+    vgePipeline = vgeDevice.getPipelineCompiler().compileGraphics(VERT_SHADER, FRAG_SHADER,
+                                                                  std::move(pipelineConfig));
 }
 
 void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo, bool rotateLight) {
@@ -102,7 +107,8 @@ void PointLightSystem::render(FrameInfo& frameInfo) {
     vgePipeline->bind(frameInfo.commandBuffer);
 
     vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
+                            pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 1,
+                            &frameInfo.globalUboOffset);
 
     for (auto& kv : frameInfo.gameObjects) {
         auto& obj = kv.second;
@@ -113,8 +119,7 @@ void PointLightSystem::render(FrameInfo& frameInfo) {
         push.color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
         push.radius = obj.transform.scale.x;
 
-        vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout,
-                           VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+        vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, pushConstantStages, 0,
                            sizeof(PointLightPushConstants), &push);
         vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
     }
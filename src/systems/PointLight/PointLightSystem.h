@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../../Graphics/Pipeline.h"
+#include "../../Graphics/PipelineCompiler.h"
 #include "../../Device/Device.h"
 #include "../../FrameInfo.h"
 
@@ -27,7 +28,8 @@ namespace vge {
 
             VgeDevice& vgeDevice;
 
-            std::unique_ptr<Pipeline> vgePipeline;
+            PendingPipeline vgePipeline;
             VkPipelineLayout pipelineLayout;
+            VkShaderStageFlags pushConstantStages = 0;
     };
 } // namespace
@@ -1,6 +1,13 @@
 #include "RenderSystem.h"
 
+#include "../Buffer/FrameAllocator.h"
+#include "../Descriptor/BindlessRegistry.h"
+#include "../Device/JobSystem.h"
+#include "../Device/TransferManager.h"
 #include "../FrameInfo.h"
+#include "../Models/Model.h"
+#include "../Rendering/Renderer.h"
+#include "../Utils/utils.h"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -12,41 +19,53 @@
 // std
 #include <vulkan/vulkan_core.h>
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
 namespace vge {
 
-struct SimplePushConstantData {
-    glm::mat4 modelMatrix{1.f};
-    glm::mat4 normalMatrix{1.f};
-};
+constexpr const char* VERT_SHADER = "shaders/vertex_shader.vert.spv";
+constexpr const char* BINDLESS_VERT_SHADER = "shaders/bindless_vertex_shader.vert.spv";
+constexpr const char* FRAG_SHADER = "shaders/fragment_shader.frag.spv";
+
+// The bindless vertex shader reads Model::Vertex as 12 tightly packed 32 bit words
+static_assert(sizeof(Model::Vertex) == 12 * sizeof(uint32_t), "Vertex layout out of sync");
 
 RenderSystem::RenderSystem(VgeDevice& device, VkRenderPass renderPass,
                            VkDescriptorSetLayout globalSetLayout)
-    : vgeDevice{device} {
+    : vgeDevice{device},
+      bindless{device.supportsBindless()},
+      vertShader{bindless ? BINDLESS_VERT_SHADER : VERT_SHADER} {
     createPipelineLayout(globalSetLayout);
     createPipeline(renderPass);
+    staticCommands =
+        std::make_unique<VgeCachedCommands>(vgeDevice, VgeSwapChain::MAX_FRAMES_IN_FLIGHT);
 }
 
 RenderSystem::~RenderSystem() {
+    // A variant may still be compiling against the layout
+    pipelines.reset();
     vkDestroyPipelineLayout(vgeDevice.device(), pipelineLayout, nullptr);
 }
 
 void RenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-    VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(SimplePushConstantData);
-
-    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+    // Set 0 is the frame allocator's global UBO, set 1 the draw records. Same bindings as the
+    // frame allocator's storage set, so the cache hands back its layout.
+    drawSetLayout =
+        VgeDescriptorSetLayout::Builder(vgeDevice)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL)
+            .build();
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
+        globalSetLayout, drawSetLayout->getDescriptorSetLayout()};
+    if (bindless) {
+        descriptorSetLayouts.push_back(vgeDevice.getBindlessRegistry().getSetLayout());
+    }
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
     pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
     if (vkCreatePipelineLayout(vgeDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
         VK_SUCCESS) {
         throw std::runtime_error("failed to create pipeline layout!!!");
@@ -56,33 +75,222 @@ void RenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
 void RenderSystem::createPipeline(VkRenderPass renderPass) {
     assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!!!");
 
-    PipelineConfigInfo pipelineConfig{};
-    Pipeline::defaultPipelineConfigInfo(pipelineConfig);
-    pipelineConfig.renderPass = renderPass;
-    pipelineConfig.pipelineLayout = pipelineLayout;
-    vgePipeline = std::make_unique<Pipeline>(vgeDevice, "shaders/vertex_shader.vert.spv",
-                                             "shaders/fragment_shader.frag.spv", pipelineConfig);
+    VkPipelineLayout layout = pipelineLayout;
+    bool pullVertices = bindless;
+    pipelines = std::make_unique<VgePipelinePermutations>(
+        vgeDevice, vertShader, FRAG_SHADER,
+        [renderPass, layout, pullVertices](PipelineConfigInfo& configInfo) {
+            configInfo.renderPass = renderPass;
+            configInfo.pipelineLayout = layout;
+            if (pullVertices) {
+                configInfo.bindingDescriptions.clear();
+                configInfo.attributeDescriptions.clear();
+            }
+        },
+        stateKey);
 }
 
-void RenderSystem::renderGameObjects(FrameInfo& frameInfo) {
-    vgePipeline->bind(frameInfo.commandBuffer);
+void RenderSystem::setWireframe(bool enabled) {
+    if (!vgeDevice.supportsWireframe() || enabled == isWireframe()) return;
+    // The cached commands pick up the variant once it has compiled, see renderStatic
+    stateKey.polygonMode = enabled ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL;
+}
 
-    vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
+void RenderSystem::gatherDrawObjects(FrameInfo& frameInfo, bool isStatic,
+                                     std::vector<GameObject*>& objects) {
+    objects.clear();
+    for (auto& kv : frameInfo.gameObjects) {
+        if (kv.second.model != nullptr && kv.second.isStatic == isStatic) {
+            objects.push_back(&kv.second);
+        }
+    }
+}
 
+std::size_t RenderSystem::hashStaticObjects(FrameInfo& frameInfo) {
+    std::size_t seed = 0;
     for (auto& kv : frameInfo.gameObjects) {
-        auto& obj = kv.second;
-        if (obj.model == nullptr) continue;
-        SimplePushConstantData push{};
-        push.modelMatrix = obj.transform.mat4();
-        push.normalMatrix = obj.transform.normalMatrix();
-
-        vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout,
-                           VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
-                           sizeof(SimplePushConstantData), &push);
-
-        obj.model->bind(frameInfo.commandBuffer);
-        obj.model->draw(frameInfo.commandBuffer);
+        const GameObject& obj = kv.second;
+        if (obj.model == nullptr || !obj.isStatic) continue;
+
+        const TransformComponent& transform = obj.transform;
+        hashCombine(seed, kv.first, obj.model.get());
+        for (const glm::vec3* v : {&transform.translation, &transform.rotation, &transform.scale}) {
+            hashCombine(seed, v->x, v->y, v->z);
+        }
+    }
+    return seed;
+}
+
+void RenderSystem::addRenderJobs(FrameInfo& frameInfo, std::vector<RenderJob>& jobs) {
+    gatherDrawObjects(frameInfo, false, drawObjects);
+    if (drawObjects.empty()) {
+        return;
+    }
+
+    // Resolved here, a variant that is missing gets compiled and that is not thread safe
+    Pipeline* pipeline = &pipelines->get(stateKey);
+
+    size_t maxJobs = vgeDevice.getJobSystem().getThreadCount();
+    size_t jobCount = std::clamp<size_t>(drawObjects.size() / MIN_OBJECTS_PER_JOB, 1, maxJobs);
+    if (jobBatches.size() < jobCount) {
+        jobBatches.resize(jobCount);
+    }
+    for (size_t job = 0; job < jobCount; job++) {
+        size_t begin = drawObjects.size() * job / jobCount;
+        size_t end = drawObjects.size() * (job + 1) / jobCount;
+        DrawBatch* batch = &jobBatches[job];
+        jobs.push_back([this, pipeline, batch, begin, end](FrameInfo& jobInfo) {
+            buildBatch(drawObjects, begin, end, *batch);
+
+            VgeFrameAllocator& frameAllocator = jobInfo.frameAllocator;
+            auto records = frameAllocator.pushStorage(batch->records.data(), batch->records.size());
+            VkDeviceSize commandOffset = 0;
+            if (!batch->commands.empty() && vgeDevice.supportsMultiDrawIndirect()) {
+                commandOffset =
+                    frameAllocator.pushStorage(batch->commands.data(), batch->commands.size())
+                        .offset;
+            }
+            drawBatch(jobInfo, *pipeline, *batch, frameAllocator.getStorageDescriptorSet(),
+                      records.offset, frameAllocator.getBuffer(), commandOffset);
+        });
+    }
+}
+
+void RenderSystem::renderStatic(FrameInfo& frameInfo, Renderer& renderer) {
+    std::size_t hash = hashStaticObjects(frameInfo);
+    if (staticDirty || hash != staticHash) {
+        staticHash = hash;
+        rebuildStaticDraws(frameInfo);
+    }
+    if (!staticDraws) {
+        return;
+    }
+
+    // Resolved every frame, so the commands are recorded again once a requested variant has
+    // finished compiling instead of replaying the fallback
+    Pipeline* pipeline = &pipelines->get(stateKey);
+    if (pipeline != staticPipeline) {
+        staticPipeline = pipeline;
+        staticVersion++;
+    }
+
+    renderer.recordCached(frameInfo, *staticCommands, staticVersion,
+                          [this, pipeline](FrameInfo& jobInfo) {
+                              drawBatch(jobInfo, *pipeline, staticBatch, staticDraws->recordSet,
+                                        0, staticDraws->buffer->getBuffer(),
+                                        staticDraws->commandOffset);
+                          });
+}
+
+void RenderSystem::rebuildStaticDraws(FrameInfo& frameInfo) {
+    gatherDrawObjects(frameInfo, true, staticObjects);
+    buildBatch(staticObjects, 0, staticObjects.size(), staticBatch);
+    staticDirty = false;
+    staticVersion++;
+
+    if (staticDraws) {
+        vgeDevice.getDeletionQueue().retire(std::move(staticDraws));
+    }
+    if (staticBatch.records.empty()) {
+        return;
+    }
+
+    VkDeviceSize recordsSize = sizeof(DrawRecord) * staticBatch.records.size();
+    VkDeviceSize commandsSize = sizeof(VkDrawIndirectCommand) * staticBatch.commands.size();
+    auto draws = std::make_unique<StaticDraws>();
+    draws->buffer = std::make_unique<VgeBuffer>(
+        vgeDevice, recordsSize + commandsSize, 1,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    draws->commandOffset = recordsSize;
+
+    // Flushed before this frame is submitted, so the frame already draws from it
+    VgeTransferManager& transferManager = vgeDevice.getTransferManager();
+    transferManager.upload(draws->buffer->getBuffer(), staticBatch.records.data(), recordsSize);
+    if (commandsSize > 0) {
+        transferManager.upload(draws->buffer->getBuffer(), staticBatch.commands.data(),
+                               commandsSize, recordsSize);
+    }
+
+    draws->descriptorAllocator = VgeDescriptorAllocator::Builder(vgeDevice)
+                                     .setInitialSets(1)
+                                     .addRatio(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f)
+                                     .build();
+    auto recordsInfo = draws->buffer->descriptorInfo(recordsSize, 0);
+    if (!VgeDescriptorWriter(*drawSetLayout, *draws->descriptorAllocator)
+             .writeBuffer(0, &recordsInfo)
+             .build(draws->recordSet)) {
+        throw std::runtime_error("failed to allocate static draw record descriptor set!!!");
+    }
+    staticDraws = std::move(draws);
+}
+
+void RenderSystem::buildBatch(const std::vector<GameObject*>& objects, size_t begin, size_t end,
+                              DrawBatch& batch) const {
+    batch.records.clear();
+    batch.commands.clear();
+    batch.models.clear();
+    for (size_t i = begin; i < end; i++) {
+        GameObject& obj = *objects[i];
+        DrawRecord record{};
+        record.modelMatrix = obj.transform.mat4();
+        record.normalMatrix = obj.transform.normalMatrix();
+        record.vertexBuffer = obj.model->getVertexBufferIndex();
+        record.indexBuffer = obj.model->getIndexBufferIndex();
+
+        // firstInstance is how the shader finds its record
+        uint32_t recordIndex = static_cast<uint32_t>(batch.records.size());
+        batch.records.push_back(record);
+        if (bindless) {
+            // Indices are pulled, not bound
+            batch.commands.push_back({obj.model->getDrawVertexCount(), 1, 0, recordIndex});
+        } else {
+            batch.models.push_back(obj.model.get());
+        }
+    }
+}
+
+void RenderSystem::drawBatch(FrameInfo& frameInfo, Pipeline& pipeline, const DrawBatch& batch,
+                             VkDescriptorSet recordSet, uint32_t recordOffset,
+                             VkBuffer indirectBuffer, VkDeviceSize commandOffset) {
+    if (batch.records.empty()) {
+        return;
+    }
+
+    VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+    pipeline.bind(commandBuffer);
+
+    VkDescriptorSet sets[] = {frameInfo.globalDescriptorSet, recordSet,
+                              bindless ? vgeDevice.getBindlessRegistry().getDescriptorSet()
+                                       : VK_NULL_HANDLE};
+    uint32_t dynamicOffsets[] = {frameInfo.globalUboOffset, recordOffset};
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0,
+                            bindless ? 3 : 2, sets, 2, dynamicOffsets);
+
+    if (!bindless) {
+        for (size_t i = 0; i < batch.models.size(); i++) {
+            batch.models[i]->bind(commandBuffer);
+            batch.models[i]->draw(commandBuffer, static_cast<uint32_t>(i));
+        }
+        return;
+    }
+
+    if (!vgeDevice.supportsMultiDrawIndirect()) {
+        for (const auto& command : batch.commands) {
+            vkCmdDraw(commandBuffer, command.vertexCount, command.instanceCount,
+                      command.firstVertex, command.firstInstance);
+        }
+        return;
+    }
+
+    uint32_t commandCount = static_cast<uint32_t>(batch.commands.size());
+    uint32_t maxDrawCount = vgeDevice.properties.limits.maxDrawIndirectCount;
+    for (uint32_t first = 0; first < commandCount; first += maxDrawCount) {
+        uint32_t drawCount = std::min(maxDrawCount, commandCount - first);
+        vkCmdDrawIndirect(commandBuffer, indirectBuffer,
+                          commandOffset + first * sizeof(VkDrawIndirectCommand), drawCount,
+                          sizeof(VkDrawIndirectCommand));
     }
 }
 }  // namespace vge
@@ -1,15 +1,31 @@
 #pragma once
 
+#include "../Buffer/Buffer.h"
+#include "../Descriptor/Descriptors.h"
 #include "../Device/Device.h"
 #include "../FrameInfo.h"
 #include "../Graphics/Pipeline.h"
+#include "../Graphics/PipelinePermutations.h"
+#include "../Rendering/CommandRecorder.h"
 
 // std
 #include <vulkan/vulkan_core.h>
 
+#include <cstddef>
 #include <memory>
+#include <vector>
 
 namespace vge {
+class Renderer;
+class Model;
+
+// Draws the scene's game objects. Matrices are read from a buffer of draw records, found
+// through each draw's firstInstance, so nothing is pushed per object. On devices with descriptor
+// indexing the draws are bindless: vertices are pulled from the models' buffers through the
+// bindless registry and the whole scene is one indirect draw. Other devices bind per object.
+// Dynamic objects are drawn from records in the frame allocator, split into several render jobs
+// so large scenes record on several threads. Static objects (GameObject::isStatic) are drawn
+// from records kept in a buffer of the system's own, with commands recorded once and replayed.
 class RenderSystem {
    public:
     RenderSystem(VgeDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
@@ -18,15 +34,97 @@ class RenderSystem {
     RenderSystem(const RenderSystem&) = delete;
     RenderSystem& operator=(const RenderSystem&) = delete;
 
-    void renderGameObjects(FrameInfo& frameInfo);
+    // Adds jobs drawing the dynamic game objects, to be recorded before the next call
+    void addRenderJobs(FrameInfo& frameInfo, std::vector<RenderJob>& jobs);
+
+    // Draws the static game objects from cache. The records are rebuilt when a static object is
+    // added, removed, moved or given another model, or after invalidate(). The commands are also
+    // recorded again when the render pass, the extent or the pipeline variant changes.
+    void renderStatic(FrameInfo& frameInfo, Renderer& renderer);
+    // For changes the system cannot see, e.g. a model's contents being replaced
+    void invalidate() {
+        staticDirty = true;
+    }
+    const VgeCachedCommands& getStaticCommands() const {
+        return *staticCommands;
+    }
+
+    // Ignored on devices without line polygon mode
+    void setWireframe(bool enabled);
+    bool isWireframe() const {
+        return stateKey.polygonMode == VK_POLYGON_MODE_LINE;
+    }
 
    private:
+    // Fewer objects are not worth a job of their own
+    static constexpr size_t MIN_OBJECTS_PER_JOB = 256;
+
+    // Must match DrawRecord in the vertex shaders, std430
+    struct DrawRecord {
+        glm::mat4 modelMatrix{1.f};
+        glm::mat4 normalMatrix{1.f};
+        uint32_t vertexBuffer;
+        uint32_t indexBuffer;
+        uint32_t padding[2];
+    };
+
+    // The records of a run of objects and what it takes to draw them
+    struct DrawBatch {
+        std::vector<DrawRecord> records;
+        std::vector<VkDrawIndirectCommand> commands;  // bindless only
+        std::vector<Model*> models;                   // bound only
+    };
+
+    // Replaced as a whole when the static objects change, and retired as frames in flight may
+    // still read it
+    struct StaticDraws {
+        std::unique_ptr<VgeBuffer> buffer;  // the records, followed by the indirect commands
+        std::unique_ptr<VgeDescriptorAllocator> descriptorAllocator;
+        VkDescriptorSet recordSet = VK_NULL_HANDLE;
+        VkDeviceSize commandOffset = 0;
+    };
+
     void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
     void createPipeline(VkRenderPass renderPass);
 
+    // Objects with a model whose isStatic matches
+    static void gatherDrawObjects(FrameInfo& frameInfo, bool isStatic,
+                                  std::vector<GameObject*>& objects);
+    // Everything the static draws are built from: ids, models and transforms
+    static std::size_t hashStaticObjects(FrameInfo& frameInfo);
+    // Fills batch from objects[begin, end)
+    void buildBatch(const std::vector<GameObject*>& objects, size_t begin, size_t end,
+                    DrawBatch& batch) const;
+    // The records are bound at recordOffset in recordSet, a set with drawSetLayout. Indirect
+    // commands are read from indirectBuffer at commandOffset.
+    void drawBatch(FrameInfo& frameInfo, Pipeline& pipeline, const DrawBatch& batch,
+                   VkDescriptorSet recordSet, uint32_t recordOffset, VkBuffer indirectBuffer,
+                   VkDeviceSize commandOffset);
+    void rebuildStaticDraws(FrameInfo& frameInfo);
+
     VgeDevice& vgeDevice;
+    bool bindless;
+    const char* vertShader;
+
+    // Set 1, same bindings as the frame allocator's dynamic storage set
+    std::unique_ptr<VgeDescriptorSetLayout> drawSetLayout;
+    // Dynamic objects with a model, gathered before the jobs are handed out
+    std::vector<GameObject*> drawObjects;
+    // One per job, so no two threads ever fill the same vectors
+    std::vector<DrawBatch> jobBatches;
+
+    DrawBatch staticBatch;
+    std::unique_ptr<StaticDraws> staticDraws;
+    std::unique_ptr<VgeCachedCommands> staticCommands;
+    std::vector<GameObject*> staticObjects;
+    bool staticDirty = true;
+    std::size_t staticHash = 0;
+    uint64_t staticVersion = 0;
+    // The variant the cached commands bind, the fallback until the requested one is ready
+    const Pipeline* staticPipeline = nullptr;
 
-    std::unique_ptr<Pipeline> vgePipeline;
+    std::unique_ptr<VgePipelinePermutations> pipelines;
+    PipelineStateKey stateKey{};
     VkPipelineLayout pipelineLayout;
 };
 }  // namespace vge